@@ -6,6 +6,12 @@
 #include "InfiniteWolfenstein.h"
 #include "Entities.h"
 
+VOID CEntity::SetTimer (CLevelRenderer* pRenderer, CDungeonRegion* pRegion, DWORD cTicks)
+{
+	m_pTimerRegion = pRegion;
+	pRenderer->SetEntityTimer(this, cTicks);
+}
+
 HRESULT CDoor::CreateDoor (CLevelRenderer* pLevel, CWallTextures* pWalls, bool fNorthSouth, sysint idxTexture, INT nLockedType, __deref_out CDoor** ppDoor)
 {
 	*ppDoor = __new CDoor(pLevel, pWalls, fNorthSouth, idxTexture, nLockedType);
@@ -28,11 +34,12 @@ VOID CDoor::Draw (MODEL_LIST* pModels)
 {
 	DOUBLE x = m_dp.x;
 	DOUBLE z = m_dp.z;
+	DOUBLE dblPosition = GetPosition();
 
 	if(m_fNorthSouth)
 	{
 		z -= 0.5;
-		z += m_dblPosition;
+		z += dblPosition;
 
 		DOUBLE xWest = x - 0.06;
 		DOUBLE xEast = x + 0.06;
@@ -63,7 +70,7 @@ VOID CDoor::Draw (MODEL_LIST* pModels)
 			glTexCoord2f(m_rcTexture.left, m_rcTexture.top); glVertex3d(xEast, 1.0, z + 1.0);
 		}
 
-		if(m_dblPosition > 0.0)
+		if(dblPosition > 0.0)
 		{
 			FLOAT rOnePixel = m_rcTexture.left + (m_rcTexture.right - m_rcTexture.left) / 64.0f;
 
@@ -78,7 +85,7 @@ VOID CDoor::Draw (MODEL_LIST* pModels)
 	else
 	{
 		x -= 0.5f;
-		x += m_dblPosition;
+		x += dblPosition;
 
 		DOUBLE zNorth = z - 0.06;
 		DOUBLE zSouth = z + 0.06;
@@ -109,7 +116,7 @@ VOID CDoor::Draw (MODEL_LIST* pModels)
 		glTexCoord2f(m_rcTexture.right, m_rcTexture.top); glVertex3d(x + 1.0, 1.0, zSouth);
 		glTexCoord2f(m_rcTexture.left, m_rcTexture.top); glVertex3d(x, 1.0, zSouth);
 
-		if(m_dblPosition > 0.0)
+		if(dblPosition > 0.0)
 		{
 			FLOAT rOnePixel = m_rcTexture.left + (m_rcTexture.right - m_rcTexture.left) / 64.0f;
 
@@ -128,11 +135,12 @@ VOID CDoor::GetCollisionSolids (TArray<DBLRECT>* paSolids)
 	DBLRECT rect;
 	DOUBLE x = m_dp.x;
 	DOUBLE z = m_dp.z;
+	DOUBLE dblPosition = GetPosition();
 
 	if(m_fNorthSouth)
 	{
 		z -= 0.5;
-		z += m_dblPosition;
+		z += dblPosition;
 
 		DOUBLE xWest = x - 0.06;
 		DOUBLE xEast = x + 0.06;
@@ -152,7 +160,7 @@ VOID CDoor::GetCollisionSolids (TArray<DBLRECT>* paSolids)
 	else
 	{
 		x += 0.5f;
-		x -= m_dblPosition;
+		x -= dblPosition;
 
 		DOUBLE zNorth = z - 0.06;
 		DOUBLE zSouth = z + 0.06;
@@ -198,39 +206,36 @@ VOID CDoor::Activate (CLevelRenderer* pRenderer, CDungeonRegion* pRegion)
 			m_nLockedType = TYPE_ANY_DOOR;
 		}
 
-		if(SUCCEEDED(pRegion->AddActiveEntity(this)))
-		{
-			PlayDoorOpen(pRenderer);
-			m_eState = Opening;
-		}
+		PlayDoorOpen(pRenderer);
+		m_eState = Opening;
+		SetTimer(pRenderer, pRegion, 64);
 	}
 	else if(Waiting == m_eState)
-		StartClosingDoor(pRenderer);
+		StartClosingDoor(pRenderer, pRegion);
 }
 
+// Only a closing door is active, because it has to stop for the player every tick.
 VOID CDoor::Update (CLevelRenderer* pRenderer, CDungeonRegion* pRegion)
 {
-	switch(m_eState)
+	if(Closing == m_eState)
 	{
-	case Opening:
-		m_dblPosition += (1.0 / 64.0);
-		if(++m_nTimer == 64)
-		{
-			m_eState = Waiting;
-			m_nTimer = 0;
-		}
-		break;
-	case Waiting:
-		if(++m_nTimer == 400)
-			StartClosingDoor(pRenderer);
-		break;
-	case Closing:
 		m_dblPosition -= (1.0 / 64.0);
 		if(m_pLevel->CheckCollisionsWithEntity(this))
 		{
-			m_nTimer = 63 - m_nTimer;
-			m_eState = Opening;
-			Update(pRenderer, pRegion);
+			// Open again from where the door was, which takes as long as it spent closing.
+			m_dblPosition += (1.0 / 64.0);
+			pRegion->RemoveActiveEntity(this);
+			if(0 == m_nTimer)
+			{
+				m_eState = Waiting;
+				SetTimer(pRenderer, pRegion, 400);
+			}
+			else
+			{
+				m_eState = Opening;
+				SetTimer(pRenderer, pRegion, m_nTimer);
+			}
+			m_nTimer = 0;
 		}
 		else if(++m_nTimer == 64)
 		{
@@ -238,10 +243,32 @@ VOID CDoor::Update (CLevelRenderer* pRenderer, CDungeonRegion* pRegion)
 			m_nTimer = 0;
 			pRegion->RemoveActiveEntity(this);
 		}
+	}
+}
+
+VOID CDoor::OnTimer (CLevelRenderer* pRenderer, CDungeonRegion* pRegion)
+{
+	switch(m_eState)
+	{
+	case Opening:
+		m_dblPosition = 1.0;
+		m_eState = Waiting;
+		SetTimer(pRenderer, pRegion, 400);
+		break;
+	case Waiting:
+		StartClosingDoor(pRenderer, pRegion);
 		break;
 	}
 }
 
+DOUBLE CDoor::GetPosition (VOID)
+{
+	// An opening door isn't updated each tick, so its position follows its timer.
+	if(Opening == m_eState)
+		return 1.0 - static_cast<DOUBLE>(GetTimerRemaining()) / 64.0;
+	return m_dblPosition;
+}
+
 VOID CDoor::PlayDoorOpen (CLevelRenderer* pRenderer)
 {
 	pRenderer->PlaySound(SLP(L"DoorOpen.wav"), m_dp);
@@ -252,11 +279,15 @@ VOID CDoor::PlayDoorClose (CLevelRenderer* pRenderer)
 	pRenderer->PlaySound(SLP(L"DoorClose.wav"), m_dp);
 }
 
-VOID CDoor::StartClosingDoor (CLevelRenderer* pRenderer)
+VOID CDoor::StartClosingDoor (CLevelRenderer* pRenderer, CDungeonRegion* pRegion)
 {
-	PlayDoorClose(pRenderer);
-	m_eState = Closing;
-	m_nTimer = 0;
+	if(SUCCEEDED(pRegion->AddActiveEntity(this)))
+	{
+		KillTimer();
+		PlayDoorClose(pRenderer);
+		m_eState = Closing;
+		m_nTimer = 0;
+	}
 }
 
 HRESULT CSplitDoor::CreateDoor (CLevelRenderer* pLevel, CWallTextures* pWalls, bool fNorthSouth, sysint idxTexture, INT nLockedType, __deref_out CDoor** ppDoor)
@@ -277,7 +308,7 @@ VOID CSplitDoor::Draw (MODEL_LIST* pModels)
 		__super::Draw(pModels);
 	else
 	{
-		DOUBLE dblSlide = m_dblPosition / 2.0;
+		DOUBLE dblSlide = GetPosition() / 2.0;
 
 		DrawHalfDoor(-0.5 - dblSlide, 0.0f, 0.5f);
 		DrawHalfDoor(dblSlide, 0.5f, 1.0f);
@@ -337,11 +368,13 @@ VOID CSplitDoor::Draw (MODEL_LIST* pModels)
 
 VOID CSplitDoor::GetCollisionSolids (TArray<DBLRECT>* paSolids)
 {
-	if(0.0 == m_dblPosition)
+	DOUBLE dblPosition = GetPosition();
+
+	if(0.0 == dblPosition)
 		__super::GetCollisionSolids(paSolids);
 	else
 	{
-		DOUBLE dblSlide = m_dblPosition / 2.0;
+		DOUBLE dblSlide = dblPosition / 2.0;
 
 		DBLRECT rect;
 		DOUBLE x = m_dp.x;
@@ -465,7 +498,6 @@ CElevatorSwitch::CElevatorSwitch (BLOCK_DATA* pBlock, INT x, INT z, sysint idxUp
 	m_pBlock(pBlock),
 	m_x(x),
 	m_z(z),
-	m_nTimer(0),
 	m_idxUp(idxUp)
 {
 }
@@ -476,23 +508,23 @@ VOID CElevatorSwitch::Draw (MODEL_LIST* pModels)
 
 VOID CElevatorSwitch::Activate (CLevelRenderer* pRenderer, CDungeonRegion* pRegion)
 {
-	if(SUCCEEDED(pRegion->AddActiveEntity(this)))
+	if(!IsTimerSet())
 	{
 		pRenderer->PlaySound(SLP(L"Elevator.wav"), m_dp);
 		for(INT i = 0; i < ARRAYSIZE(m_pBlock->idxSides); i++)
 			m_pBlock->idxSides[i] = m_idxUp;
 		pRenderer->RenderRegion(pRegion);
-		m_nTimer = 40;
+		SetTimer(pRenderer, pRegion, 40);
 	}
 }
 
 VOID CElevatorSwitch::Update (CLevelRenderer* pRenderer, CDungeonRegion* pRegion)
 {
-	if(0 == --m_nTimer)
-	{
-		pRegion->RemoveActiveEntity(this);
-		pRenderer->ActivateElevator(m_x, m_z);
-	}
+}
+
+VOID CElevatorSwitch::OnTimer (CLevelRenderer* pRenderer, CDungeonRegion* pRegion)
+{
+	pRenderer->ActivateElevator(m_x, m_z);
 }
 
 CModelEntity::CModelEntity (CModel* pModel) :
@@ -600,7 +632,7 @@ VOID CSecretDoor::Draw (MODEL_LIST* pModels)
 	{
 		sysint* pidxSides = m_pActive->idxSides;
 		FRECT rc;
-		DOUBLE xMove = 0.0, zMove = 0.0, dblMove = (128.0 - (DOUBLE)m_pActive->nTravel) / 128.0;
+		DOUBLE xMove = 0.0, zMove = 0.0, dblMove = (128.0 - (DOUBLE)GetTimerRemaining()) / 128.0;
 		GetDirection(xMove, zMove);
 
 		DOUBLE x = m_pActive->dpBlock.x + dblMove * xMove;
@@ -656,7 +688,7 @@ VOID CSecretDoor::GetCollisionSolids (TArray<DBLRECT>* paSolids)
 	if(m_pActive)
 	{
 		DBLRECT rect;
-		DOUBLE xMove = 0.0, zMove = 0.0, dblMove = (128.0 - (DOUBLE)m_pActive->nTravel) / 128.0;
+		DOUBLE xMove = 0.0, zMove = 0.0, dblMove = (128.0 - (DOUBLE)GetTimerRemaining()) / 128.0;
 		GetDirection(xMove, zMove);
 
 		DOUBLE x = m_pActive->dpBlock.x + dblMove * xMove;
@@ -711,11 +743,12 @@ VOID CSecretDoor::Activate (CLevelRenderer* pRenderer, CDungeonRegion* pRegion)
 
 				m_pActive->dpBlock = m_dp;
 
-				if(TYPE_ANY_FLOOR == GetNextBlockType(pRegion) && SUCCEEDED(pRegion->AddActiveEntity(this)))
+				if(TYPE_ANY_FLOOR == GetNextBlockType(pRegion))
 				{
 					m_pActive->cBlocks = 2;
 					pRenderer->PlaySound(SLP(L"SecretDoor.wav"), m_dp);
 					PrepareNextBlockMovement(pBlock);
+					SetTimer(pRenderer, pRegion, 128);
 					pRenderer->RenderRegion(pRegion);
 				}
 				else
@@ -731,41 +764,44 @@ VOID CSecretDoor::Activate (CLevelRenderer* pRenderer, CDungeonRegion* pRegion)
 
 VOID CSecretDoor::Update (CLevelRenderer* pRenderer, CDungeonRegion* pRegion)
 {
-	if(0 == --m_pActive->nTravel)
-	{
-		DOUBLE xDir, zDir;
+}
 
-		GetDirection(xDir, zDir);
+// Each block slides for 128 ticks, and Draw() follows the timer in between.
+VOID CSecretDoor::OnTimer (CLevelRenderer* pRenderer, CDungeonRegion* pRegion)
+{
+	DOUBLE xDir, zDir;
 
-		m_pActive->dpBlock.x += xDir;
-		m_pActive->dpBlock.z += zDir;
+	GetDirection(xDir, zDir);
 
-		INT xBlock = (INT)(m_pActive->dpBlock.x - static_cast<DOUBLE>(pRegion->m_xRegion) * REGION_WIDTH);
-		INT zBlock = (INT)(m_pActive->dpBlock.z - static_cast<DOUBLE>(pRegion->m_zRegion) * REGION_WIDTH);
+	m_pActive->dpBlock.x += xDir;
+	m_pActive->dpBlock.z += zDir;
 
-		BLOCK_DATA* pBlock = pRegion->m_bRegion + zBlock * REGION_WIDTH + xBlock;
-		Assert(TYPE_ANY_FLOOR == pBlock->idxBlock);
-		pBlock->idxBlock = m_pActive->idxTravelBlock;
-		m_pActive->idxTravelBlock = 0;
+	INT xBlock = (INT)(m_pActive->dpBlock.x - static_cast<DOUBLE>(pRegion->m_xRegion) * REGION_WIDTH);
+	INT zBlock = (INT)(m_pActive->dpBlock.z - static_cast<DOUBLE>(pRegion->m_zRegion) * REGION_WIDTH);
 
-		for(INT n = 0; n < ARRAYSIZE(pBlock->idxSides); n++)
-		{
-			Assert(TYPE_ANY_FLOOR == pBlock->idxSides[n]);
-			pBlock->idxSides[n] = m_pActive->idxSides[n];
-		}
-
-		if(0 == --m_pActive->cBlocks || TYPE_ANY_FLOOR != GetNextBlockType(pRegion))
-		{
-			pRegion->RemoveActiveEntity(this);
+	BLOCK_DATA* pBlock = pRegion->m_bRegion + zBlock * REGION_WIDTH + xBlock;
+	Assert(TYPE_ANY_FLOOR == pBlock->idxBlock);
+	pBlock->idxBlock = m_pActive->idxTravelBlock;
+	m_pActive->idxTravelBlock = 0;
 
-			__delete m_pActive;
-			m_pActive = NULL;
-		}
-		else
-			PrepareNextBlockMovement(pBlock);
+	for(INT n = 0; n < ARRAYSIZE(pBlock->idxSides); n++)
+	{
+		Assert(TYPE_ANY_FLOOR == pBlock->idxSides[n]);
+		pBlock->idxSides[n] = m_pActive->idxSides[n];
+	}
 
-		pRenderer->RenderRegion(pRegion);
+	if(0 == --m_pActive->cBlocks || TYPE_ANY_FLOOR != GetNextBlockType(pRegion))
+	{
+		__delete m_pActive;
+		m_pActive = NULL;
 	}
+	else
+	{
+		PrepareNextBlockMovement(pBlock);
+		SetTimer(pRenderer, pRegion, 128);
+	}
+
+	pRenderer->RenderRegion(pRegion);
 }
 
 VOID CSecretDoor::GetDirection (__out DOUBLE& x, __out DOUBLE& z)
@@ -792,7 +828,6 @@ VOID CSecretDoor::GetDirection (__out DOUBLE& x, __out DOUBLE& z)
 
 VOID CSecretDoor::PrepareNextBlockMovement (BLOCK_DATA* pBlock)
 {
-	m_pActive->nTravel = 128;
 	m_pActive->idxTravelBlock = pBlock->idxBlock;
 	pBlock->idxBlock = TYPE_ANY_FLOOR;
 
@@ -2,6 +2,7 @@
 
 #include "Library\Core\Array.h"
 #include "Library\Spatial\GeometryTypes.h"
+#include "TimerWheel.h"
 
 class CLevelRenderer;
 class CDungeonRegion;
@@ -17,16 +18,18 @@ struct MODEL_LIST
 	TArray<CModelEntity*>* paModels;
 };
 
-class CEntity
+class CEntity : public CWheelTimer
 {
 public:
 	CEntity* m_pNext;
 	DPOINT m_dp;
+	CDungeonRegion* m_pTimerRegion;
 
 public:
 	CEntity ()
 	{
 		m_pNext = NULL;
+		m_pTimerRegion = NULL;
 	}
 
 	virtual ~CEntity ()
@@ -39,6 +42,12 @@ public:
 	virtual VOID GetCollisionSolids (TArray<DBLRECT>* paSolids) = 0;
 	virtual VOID Activate (CLevelRenderer* pRenderer, CDungeonRegion* pRegion) = 0;
 	virtual VOID Update (CLevelRenderer* pRenderer, CDungeonRegion* pRegion) = 0;
+
+	// Entities that are only waiting for their next state change set a timer instead
+	// of staying active, and OnTimer() is called once cTicks game ticks have passed.
+	// Setting a timer replaces any timer the entity already has.
+	VOID SetTimer (CLevelRenderer* pRenderer, CDungeonRegion* pRegion, DWORD cTicks);
+	virtual VOID OnTimer (CLevelRenderer* pRenderer, CDungeonRegion* pRegion) { }
 };
 
 class CDoor : public CEntity
@@ -57,8 +66,8 @@ public:
 		Waiting,
 		Closing
 	} m_eState;
-	INT m_nTimer;
-	DOUBLE m_dblPosition;
+	INT m_nTimer;			// Ticks spent closing
+	DOUBLE m_dblPosition;	// Use GetPosition(), which follows the timer while opening
 
 	INT m_nLockedType;
 
@@ -72,12 +81,15 @@ public:
 	virtual VOID GetCollisionSolids (TArray<DBLRECT>* paSolids);
 	virtual VOID Activate (CLevelRenderer* pRenderer, CDungeonRegion* pRegion);
 	virtual VOID Update (CLevelRenderer* pRenderer, CDungeonRegion* pRegion);
+	virtual VOID OnTimer (CLevelRenderer* pRenderer, CDungeonRegion* pRegion);
+
+	DOUBLE GetPosition (VOID);
 
 protected:
 	virtual VOID PlayDoorOpen (CLevelRenderer* pRenderer);
 	virtual VOID PlayDoorClose (CLevelRenderer* pRenderer);
 
-	VOID StartClosingDoor (CLevelRenderer* pRenderer);
+	VOID StartClosingDoor (CLevelRenderer* pRenderer, CDungeonRegion* pRegion);
 };
 
 class CSplitDoor : public CDoor
@@ -103,7 +115,6 @@ class CElevatorSwitch : public CEntity
 private:
 	BLOCK_DATA* m_pBlock;
 	INT m_x, m_z;
-	INT m_nTimer;
 	sysint m_idxUp;
 
 public:
@@ -113,6 +124,7 @@ public:
 	virtual VOID GetCollisionSolids (TArray<DBLRECT>* paSolids) { }
 	virtual VOID Activate (CLevelRenderer* pRenderer, CDungeonRegion* pRegion);
 	virtual VOID Update (CLevelRenderer* pRenderer, CDungeonRegion* pRegion);
+	virtual VOID OnTimer (CLevelRenderer* pRenderer, CDungeonRegion* pRegion);
 };
 
 class CModelEntity : public CEntity
@@ -155,7 +167,6 @@ struct ACTIVE_SECRET
 {
 	INT cBlocks;
 	DPOINT dpBlock;
-	INT nTravel;
 	sysint idxTravelBlock;
 	sysint idxSides[4];
 
@@ -182,6 +193,7 @@ public:
 	virtual VOID GetCollisionSolids (TArray<DBLRECT>* paSolids);
 	virtual VOID Activate (CLevelRenderer* pRenderer, CDungeonRegion* pRegion);
 	virtual VOID Update (CLevelRenderer* pRenderer, CDungeonRegion* pRegion);
+	virtual VOID OnTimer (CLevelRenderer* pRenderer, CDungeonRegion* pRegion);
 
 	VOID GetDirection (__out DOUBLE& x, __out DOUBLE& z);
 	VOID PrepareNextBlockMovement (BLOCK_DATA* pBlock);
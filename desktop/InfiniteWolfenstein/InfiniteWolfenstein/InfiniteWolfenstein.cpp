@@ -17,6 +17,12 @@
 #define	MOVE_RATE				0.1
 #define	PLAYER_RADIUS			0.35
 
+#define	REGION_PREFETCH_RADIUS	2		// The regions DrawFrame() can see around the player
+#define	REGION_PREFETCH_HEADING	0.5		// How much nearer a region straight ahead seems
+#define	REGION_UPLOAD_MS		4		// Display list building allowed per frame
+#define	SIMULATION_RADIUS		2		// Regions around the player whose entities are updated
+#define	STATS_TRACE_TICKS		300		// Ticks between statistics traces, about five seconds
+
 GLfloat LightAmbient[]=		{ 1.0f, 1.0f, 1.0f, 1.0f };
 GLfloat LightDiffuse[]=		{ 1.0f, 1.0f, 1.0f, 1.0f };
 
@@ -33,34 +39,60 @@ CLevelRenderer::CLevelRenderer (CInfiniteWolfenstein* pGame) :
 	m_pModels(NULL),
 	m_nCompassDir(-1),
 	m_pCompassFrame(NULL),
+	m_cache(MAX_CACHE_SIZE, MAX_CACHE_BYTES),
 	m_xRegion(0),
 	m_zRegion(0),
+	m_xPrefetch(0),
+	m_zPrefetch(0),
+	m_nPrefetchDir(-1),
+	m_nSimulationRadius(SIMULATION_RADIUS),
+	m_nTick(0),
+	m_fCatchingUp(FALSE),
+	m_fTraceStats(FALSE),
 	m_nPoints(0),
 	m_cGoldKeys(0),
 	m_cSilverKeys(0),
 	m_cDrawLockedDoorTicks(0)
 {
+	ZeroMemory(&m_statsScheduler, sizeof(m_statsScheduler));
 	Formatting::TPrintF(m_wzKeysLabel, ARRAYSIZE(m_wzKeysLabel), NULL, L"%d GOLD KEYS   %d SILVER KEYS", m_cGoldKeys, m_cSilverKeys);
 	AddPoints(0);
 }
 
 CLevelRenderer::~CLevelRenderer ()
 {
+	DetachLevelGenerator();
+	ClearSchedule();
+	DropDeferredTimers(NULL);
 	SafeRelease(m_pCompassFrame);
 }
 
-VOID CLevelRenderer::AttachLevelGenerator (CLevelGenerator* pGenerator)
+HRESULT CLevelRenderer::AttachLevelGenerator (CLevelGenerator* pGenerator)
 {
 	m_pGenerator = pGenerator;
 	m_pWalls = m_pGenerator->GetWalls();
 	m_pModels = m_pGenerator->GetModels();
+	return m_loader.Initialize(pGenerator, this);
+}
+
+VOID CLevelRenderer::DetachLevelGenerator (VOID)
+{
+	// The loader's workers read the generator's data, so they must stop before it's deleted.
+	m_loader.Shutdown();
+
+	m_pGenerator = NULL;
+	m_pWalls = NULL;
+	m_pModels = NULL;
 }
 
 HRESULT CLevelRenderer::StartGame (INT nLevel, INT xRegion, INT zRegion, BOOL fSetCamera)
 {
 	HRESULT hr;
 
-	m_aCache.Clear();
+	ClearSchedule();
+	DropDeferredTimers(NULL);
+	m_timers.Clear();
+	m_cache.Clear();
 	Check(PrepareLevel(nLevel, xRegion, zRegion, fSetCamera));
 	GetRegionPosition(m_xRegion, m_zRegion);
 	UpdateViewingTiles();
@@ -75,6 +107,14 @@ HRESULT CLevelRenderer::PrepareLevel (INT nLevel, INT xRegion, INT zRegion, BOOL
 	TStackRef<CDungeonRegion> srRegion;
 
 	Check(m_pGenerator->SetLevel(nLevel));
+#ifdef	_DEBUG
+	// The regions around the start must come out of the workers exactly as they
+	// would from this thread.
+	Check(m_loader.SelfTest(m_pGenerator, xRegion, zRegion, 1));
+#endif
+	m_loader.SetLevel(m_pGenerator);
+	m_nPrefetchDir = -1;
+
 	if(-1 == nLevel)
 		Check(TStrCchCpy(m_wzLevelLabel, ARRAYSIZE(m_wzLevelLabel), L"HELL"));
 	else
@@ -103,6 +143,9 @@ VOID CLevelRenderer::RenderRegion (CDungeonRegion* pRegion)
 	INT zRegion = pRegion->m_zRegion * REGION_WIDTH;
 	sysint idxFloor, idxCeiling;
 
+	if(0 == pRegion->m_nList)
+		pRegion->m_nList = glGenLists(1);
+
 	if(FAILED(m_pWalls->Resolve(pRegion->m_pChunk->m_rstrFloorW, &idxFloor)))
 		idxFloor = 0;
 	if(FAILED(m_pWalls->Resolve(pRegion->m_pChunk->m_rstrCeilingW, &idxCeiling)))
@@ -136,6 +179,10 @@ HRESULT CLevelRenderer::PlaySound (PCWSTR pcwzSound, INT cchSound, DPOINT& dpSou
 	HRESULT hr;
 	FLOAT rVolume = 1.0f;
 	DOUBLE dblDistance = Geometry::PointDistanceD(&m_camera.m_dblPoint, &dpSound);
+
+	// Ticks replayed for a region that was frozen happened while the player was away.
+	CheckIf(m_fCatchingUp, S_FALSE);
+
 	if(8.0 < dblDistance)
 	{
 		dblDistance -= 8.0;
@@ -250,6 +297,39 @@ VOID CLevelRenderer::GetPlayerPosition (__out DOUBLE* px, __out DOUBLE* pz)
 	*pz = m_camera.m_dblPoint.z;
 }
 
+VOID CLevelRenderer::SetRegionCacheBudget (sysint cMaxRegions, SIZE_T cbMaxRegions)
+{
+	m_cache.SetBudget(cMaxRegions, cbMaxRegions);
+}
+
+VOID CLevelRenderer::GetRegionCacheStats (__out REGION_CACHE_STATS* pStats)
+{
+	m_cache.GetStats(pStats);
+}
+
+VOID CLevelRenderer::SetSimulationRadius (INT nRadius)
+{
+	m_nSimulationRadius = nRadius;
+}
+
+VOID CLevelRenderer::GetEntitySchedulerStats (__out ENTITY_SCHEDULER_STATS* pStats)
+{
+	*pStats = m_statsScheduler;
+	pStats->cScheduled = m_aScheduled.Length();
+	pStats->cTimers = m_timers.Length();
+	pStats->cTimersDeferred = m_aDeferred.Length();
+}
+
+VOID CLevelRenderer::SetTraceStats (BOOL fTrace)
+{
+	m_fTraceStats = fTrace;
+}
+
+VOID CLevelRenderer::SetEntityTimer (CEntity* pEntity, DWORD cTicks)
+{
+	m_timers.Set(pEntity, cTicks);
+}
+
 // IGameInterface
 
 VOID CLevelRenderer::DrawFrame (VOID)
@@ -279,8 +359,9 @@ VOID CLevelRenderer::DrawFrame (VOID)
 			if(m_frustum.CubeInFrustum((xRegion + x) * (FLOAT)REGION_WIDTH + (REGION_WIDTH / 2.0f), 0.0f, (zRegion + z) * (FLOAT)REGION_WIDTH + (REGION_WIDTH / 2.0f), REGION_WIDTH / 2.0f))
 			{
 				CDungeonRegion* pRegion;
-				HRESULT hrRegion = GetDungeonRegion(xRegion + x, zRegion + z, &pRegion);
-				if(SUCCEEDED(hrRegion))
+
+				// Regions still being generated in the background are drawn once they're uploaded.
+				if(m_cache.Peek(xRegion + x, zRegion + z, &pRegion))
 				{
 					glCallList(pRegion->m_nList);
 					pRegion->DrawEntities(&mlData);
@@ -354,8 +435,18 @@ VOID CLevelRenderer::UpdateFrame (VOID)
 	if(0 < m_cDrawLockedDoorTicks)
 		m_cDrawLockedDoorTicks--;
 
-	for(sysint i = 0; i < m_aCache.Length(); i++)
-		m_aCache[i]->UpdateActiveEntities(this);
+	// The timer wheel moves to the new tick before entities are updated, so that timers
+	// they set count from it, but the timers that expired are fired afterwards.  Held
+	// timers fire first, so that regions coming back into the simulation radius catch
+	// up on what they started.
+	m_nTick++;
+	m_timers.AdvanceTo(m_nTick);
+	FireDeferredTimers();
+	UpdateScheduledRegions();
+	FireEntityTimers();
+
+	if(m_fTraceStats && 0 == m_nTick % STATS_TRACE_TICKS)
+		TraceStats();
 
 	POINT pt;
 	if(m_pGame->m_fTrackMouse && GetCursorPos(&pt))
@@ -453,11 +544,13 @@ VOID CLevelRenderer::UpdateFrame (VOID)
 		if(fCheckItemPickup)
 			CheckItemPickup();
 	}
+
+	UpdateRegionLoader();
 }
 
 VOID CLevelRenderer::OnMusicStopped (VOID)
 {
-	if(0 < m_aCache.Length())
+	if(0 < m_cache.Length())
 	{
 		RSTRING rstrMusicW;
 		if(SUCCEEDED(GetCurrentRegionMusic(&rstrMusicW)))
@@ -503,6 +596,7 @@ BOOL CLevelRenderer::OnKeyDown (UINT uMsg, WPARAM wParam, LPARAM lParam, LRESULT
 						pEntity->Activate(this, srRegion);
 						pEntity = pEntity->m_pNext;
 					} while(pEntity);
+					ScheduleRegion(srRegion);
 					break;
 				}
 			}
@@ -563,7 +657,7 @@ VOID CLevelRenderer::UpdateViewingTiles (VOID)
 	m_camera.SetPerspective();
 	m_frustum.Update();
 
-	if(0 < m_aCache.Length())
+	if(0 < m_cache.Length())
 	{
 		INT xRegion, zRegion;
 
@@ -595,41 +689,310 @@ VOID CLevelRenderer::GetRegionPosition (INT& xRegion, INT& zRegion)
 		zRegion--;
 }
 
-HRESULT CLevelRenderer::GetDungeonRegion (INT xRegion, INT zRegion, __deref_out CDungeonRegion** ppRegion)
+VOID CLevelRenderer::UpdateRegionLoader (VOID)
 {
-	HRESULT hr = S_OK;
-	CDungeonRegion* pRegion = NULL;
+	LARGE_INTEGER liFrequency, liStart, liNow;
+
+	if(m_xPrefetch != m_xRegion || m_zPrefetch != m_zRegion || m_nPrefetchDir != m_nCompassDir)
+		QueuePrefetch();
+
+	QueryPerformanceFrequency(&liFrequency);
+	QueryPerformanceCounter(&liStart);
+
+	// Building display lists is limited to a slice of each frame, so that a burst of
+	// finished regions doesn't stall the game.  At least one region is uploaded per frame.
+	for(;;)
+	{
+		CDungeonRegion* pRegion;
+		HRESULT hr = m_loader.TakeCompleted(&pRegion);
+		if(S_FALSE == hr)
+			break;
 
-	for(sysint i = 0; i < m_aCache.Length(); i++)
+		// A region that failed to generate is tried again by GetDungeonRegion() if needed.
+		if(SUCCEEDED(hr))
+		{
+			if(!m_cache.Contains(pRegion->m_xRegion, pRegion->m_zRegion))
+			{
+				RenderRegion(pRegion);
+				m_cache.Add(pRegion);
+			}
+			pRegion->Release();
+		}
+
+		QueryPerformanceCounter(&liNow);
+		if((liNow.QuadPart - liStart.QuadPart) * 1000 >= liFrequency.QuadPart * REGION_UPLOAD_MS)
+			break;
+	}
+}
+
+VOID CLevelRenderer::QueuePrefetch (VOID)
+{
+	DOUBLE xHeading = sin(m_camera.m_dblDirRadians);
+	DOUBLE zHeading = -cos(m_camera.m_dblDirRadians);
+	sysint cRequests;
+	REGION_REQUEST* prgRequests;
+
+	m_xPrefetch = m_xRegion;
+	m_zPrefetch = m_zRegion;
+	m_nPrefetchDir = m_nCompassDir;
+
+	for(INT z = -REGION_PREFETCH_RADIUS; z <= REGION_PREFETCH_RADIUS; z++)
 	{
-		pRegion = m_aCache[i];
-		if(pRegion->m_xRegion == xRegion && pRegion->m_zRegion == zRegion)
+		for(INT x = -REGION_PREFETCH_RADIUS; x <= REGION_PREFETCH_RADIUS; x++)
 		{
-			pRegion->AddRef();
-			*ppRegion = pRegion;
-			pRegion = NULL;
-			goto Cleanup;
+			REGION_REQUEST request;
+			DOUBLE dblDistance;
+
+			if((0 == x && 0 == z) || m_cache.Contains(m_xRegion + x, m_zRegion + z))
+				continue;
+
+			// Nearer regions are generated first, and regions in the direction the
+			// player is facing are treated as nearer than those behind.
+			dblDistance = sqrt(static_cast<DOUBLE>(x * x + z * z));
+			request.xRegion = m_xRegion + x;
+			request.zRegion = m_zRegion + z;
+			request.dblPriority = dblDistance * (1.0 - REGION_PREFETCH_HEADING * (x * xHeading + z * zHeading) / dblDistance);
+			if(FAILED(m_aPrefetch.Append(request)))
+				break;
 		}
 	}
 
-	if(MAX_CACHE_SIZE == m_aCache.Length())
+	m_aPrefetch.GetData(&prgRequests, &cRequests);
+	m_loader.Prefetch(prgRequests, cRequests);
+	m_aPrefetch.Clear();
+}
+
+VOID CLevelRenderer::ScheduleRegion (CDungeonRegion* pRegion)
+{
+	if(!pRegion->m_fScheduled && 0 < pRegion->m_aActive.Length() && SUCCEEDED(m_aScheduled.Append(pRegion)))
 	{
-		m_aCache.Remove(0, &pRegion);
-		pRegion->Reset();
-		pRegion->m_xRegion = xRegion;
-		pRegion->m_zRegion = zRegion;
+		pRegion->AddRef();
+		pRegion->m_fScheduled = TRUE;
+		pRegion->m_nSimulatedTick = m_nTick;
 	}
-	else
+}
+
+VOID CLevelRenderer::UnscheduleRegion (CDungeonRegion* pRegion)
+{
+	if(pRegion->m_fScheduled)
 	{
-		pRegion = __new CDungeonRegion(xRegion, zRegion);
-		CheckAlloc(pRegion);
+		for(sysint i = 0; i < m_aScheduled.Length(); i++)
+		{
+			if(m_aScheduled[i] == pRegion)
+			{
+				m_aScheduled.Remove(i, NULL);
+				break;
+			}
+		}
+
+		pRegion->m_fScheduled = FALSE;
+		pRegion->Release();
 	}
+}
 
-	Check(m_pGenerator->GenerateRegion(pRegion, this));
+VOID CLevelRenderer::ClearSchedule (VOID)
+{
+	for(sysint i = 0; i < m_aScheduled.Length(); i++)
+	{
+		m_aScheduled[i]->m_fScheduled = FALSE;
+		m_aScheduled[i]->Release();
+	}
+	m_aScheduled.Clear();
+}
+
+VOID CLevelRenderer::UpdateScheduledRegions (VOID)
+{
+	m_statsScheduler.cFrozen = 0;
+	m_statsScheduler.cRegionUpdates = 0;
+	m_statsScheduler.cEntityUpdates = 0;
+
+	// Updating entities can look up other regions or change the level, which changes
+	// the schedule, so the scheduled regions are collected first.
+	for(sysint i = 0; i < m_aScheduled.Length(); i++)
+	{
+		if(SUCCEEDED(m_aUpdate.Append(m_aScheduled[i])))
+			m_aScheduled[i]->AddRef();
+	}
+
+	for(sysint i = 0; i < m_aUpdate.Length(); i++)
+	{
+		CDungeonRegion* pRegion = m_aUpdate[i];
+
+		if(!pRegion->m_fScheduled)
+		{
+			// Unscheduled by an earlier update in this frame
+		}
+		else if(!m_cache.Contains(pRegion))
+		{
+			// An evicted region is generated again with its entities at rest.
+			UnscheduleRegion(pRegion);
+		}
+		else if(IsFrozen(pRegion))
+			m_statsScheduler.cFrozen++;
+		else
+		{
+			DWORD cTicks = m_nTick - pRegion->m_nSimulatedTick;
+			pRegion->m_nSimulatedTick = m_nTick;
+
+			// Every entity comes to rest after a limited number of ticks, so replaying the
+			// ticks a frozen region missed stops early once nothing is left active.
+			m_fCatchingUp = TRUE;
+			for(DWORD n = 1; n < cTicks && 0 < pRegion->m_aActive.Length(); n++)
+				m_statsScheduler.cEntityUpdates += pRegion->UpdateActiveEntities(this);
+			m_fCatchingUp = FALSE;
+
+			m_statsScheduler.cEntityUpdates += pRegion->UpdateActiveEntities(this);
+			m_statsScheduler.cRegionUpdates++;
+
+			if(0 == pRegion->m_aActive.Length())
+				UnscheduleRegion(pRegion);
+		}
+
+		pRegion->Release();
+	}
+	m_aUpdate.Clear();
+}
+
+VOID CLevelRenderer::FireDeferredTimers (VOID)
+{
+	sysint i = 0;
+
+	m_statsScheduler.cTimersFired = 0;
+
+	// Firing a timer can change the level, which empties the list.
+	while(i < m_aDeferred.Length())
+	{
+		DEFERRED_TIMER deferred = m_aDeferred[i];
+
+		if(m_cache.Contains(deferred.pRegion) && IsFrozen(deferred.pRegion))
+		{
+			i++;
+			continue;
+		}
+
+		m_aDeferred.Remove(i, NULL);
+
+		// An evicted region is generated again with its entities at rest, and an entity
+		// that has set another timer since has moved on.
+		if(m_cache.Contains(deferred.pRegion) && !deferred.pEntity->IsTimerSet())
+		{
+			m_fCatchingUp = TRUE;
+			FireEntityTimer(deferred.pEntity, deferred.pRegion, deferred.nExpired);
+			m_fCatchingUp = FALSE;
+		}
+		deferred.pRegion->Release();
+	}
+}
+
+VOID CLevelRenderer::FireEntityTimers (VOID)
+{
+	CWheelTimer* pTimer;
+
+	while(NULL != (pTimer = m_timers.TakeExpired()))
+	{
+		CEntity* pEntity = static_cast<CEntity*>(pTimer);
+		CDungeonRegion* pRegion = pEntity->m_pTimerRegion;
+
+		if(IsFrozen(pRegion))
+		{
+			DEFERRED_TIMER deferred = { pEntity, pRegion, m_nTick };
+
+			if(SUCCEEDED(m_aDeferred.Append(deferred)))
+			{
+				pRegion->AddRef();
+				continue;
+			}
+		}
+
+		FireEntityTimer(pEntity, pRegion, m_nTick);
+	}
+}
+
+VOID CLevelRenderer::FireEntityTimer (CEntity* pEntity, CDungeonRegion* pRegion, DWORD nExpired)
+{
+	// The region is kept alive in case the entity changes the level.
+	pRegion->AddRef();
+	pEntity->OnTimer(this, pRegion);
+	m_statsScheduler.cTimersFired++;
+
+	// An entity that has become active is updated every tick after the timer expired.
+	// A region that was already scheduled keeps its own earlier tick.
+	if(m_cache.Contains(pRegion))
+	{
+		ScheduleRegion(pRegion);
+		if(pRegion->m_fScheduled && 0 < static_cast<LONG>(pRegion->m_nSimulatedTick - nExpired))
+			pRegion->m_nSimulatedTick = nExpired;
+	}
+	pRegion->Release();
+}
+
+VOID CLevelRenderer::TraceStats (VOID)
+{
+	ENTITY_SCHEDULER_STATS statsScheduler;
+	REGION_CACHE_STATS statsCache;
+	WCHAR wzStats[256];
+
+	// Before entities were scheduled, every cached region was walked each frame, so
+	// the cached count is what the scheduled and updated counts compare against.
+	GetEntitySchedulerStats(&statsScheduler);
+	m_cache.GetStats(&statsCache);
+
+	if(SUCCEEDED(Formatting::TPrintF(wzStats, ARRAYSIZE(wzStats), NULL,
+		L"Tick %u: cached %Id, scheduled %Id, frozen %Id, region updates %Id, entity updates %Id, timers %Id, held %Id, fired %Id, cache hits %q, misses %q\r\n",
+		m_nTick, statsCache.cRegions, statsScheduler.cScheduled, statsScheduler.cFrozen, statsScheduler.cRegionUpdates, statsScheduler.cEntityUpdates,
+		statsScheduler.cTimers, statsScheduler.cTimersDeferred, statsScheduler.cTimersFired, statsCache.cHits, statsCache.cMisses)))
+	{
+		OutputDebugStringW(wzStats);
+	}
+}
+
+VOID CLevelRenderer::DropDeferredTimers (__in_opt CDungeonRegion* pRegion)
+{
+	for(sysint i = m_aDeferred.Length() - 1; 0 <= i; i--)
+	{
+		CDungeonRegion* pHeld = m_aDeferred[i].pRegion;
+
+		if(NULL == pRegion || pHeld == pRegion)
+		{
+			m_aDeferred.Remove(i, NULL);
+			pHeld->Release();
+		}
+	}
+}
+
+HRESULT CLevelRenderer::GetDungeonRegion (INT xRegion, INT zRegion, __deref_out CDungeonRegion** ppRegion)
+{
+	HRESULT hr = S_OK;
+	CDungeonRegion* pRegion = NULL;
+
+	if(m_cache.Find(xRegion, zRegion, ppRegion))
+		goto Cleanup;
+
+	// The loader may already have the region, or be generating it now.
+	if(S_OK != m_loader.Claim(xRegion, zRegion, &pRegion))
+	{
+		pRegion = m_cache.ReclaimOldest();
+		if(pRegion)
+		{
+			// Resetting the region deletes its entities.
+			UnscheduleRegion(pRegion);
+			DropDeferredTimers(pRegion);
+			pRegion->Reset();
+			pRegion->m_xRegion = xRegion;
+			pRegion->m_zRegion = zRegion;
+		}
+		else
+		{
+			pRegion = __new CDungeonRegion(xRegion, zRegion);
+			CheckAlloc(pRegion);
+		}
+
+		Check(m_pGenerator->GenerateRegion(pRegion, this));
+	}
 
 	RenderRegion(pRegion);
 
-	Check(m_aCache.Append(pRegion));
+	Check(m_cache.Add(pRegion));
 	*ppRegion = pRegion;
 	pRegion = NULL;
 
@@ -1066,6 +1429,7 @@ CInfiniteWolfenstein::~CInfiniteWolfenstein ()
 	m_mapMusic.DeleteAll();
 	RStrRelease(m_rstrMusic);
 
+	m_renderer.DetachLevelGenerator();
 	SafeDelete(m_pGenerator);
 	SafeDelete(m_pLevels);
 	SafeDelete(m_pChunkThemes);
@@ -1184,7 +1548,7 @@ HRESULT CInfiniteWolfenstein::Initialize (LPWSTR lpCmdLine, INT nCmdShow)
 
 	m_pGenerator = __new CLevelGenerator(m_pWalls, m_pWallThemes, m_pChunkThemes, m_pLevels, m_pRooms, m_pSpecial, m_pModels, dwlSeed);
 	CheckAlloc(m_pGenerator);
-	m_renderer.AttachLevelGenerator(m_pGenerator);
+	Check(m_renderer.AttachLevelGenerator(m_pGenerator));
 
 	INT nLevel = 0;
 	RSTRING rstrLevelW;
@@ -1210,6 +1574,9 @@ HRESULT CInfiniteWolfenstein::Initialize (LPWSTR lpCmdLine, INT nCmdShow)
 		RStrRelease(rstrLevelW);
 	}
 
+	if(options.FindParam(L"stats"))
+		m_renderer.SetTraceStats(TRUE);
+
 	Check(m_renderer.StartGame(nLevel, 0, 0, TRUE));
 
 	OnNotifyFinished(&m_player, TRUE);
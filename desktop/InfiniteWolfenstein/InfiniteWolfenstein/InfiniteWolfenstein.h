@@ -12,6 +12,9 @@
 #include "Rooms.h"
 #include "Models.h"
 #include "LevelGenerator.h"
+#include "RegionCache.h"
+#include "RegionLoader.h"
+#include "TimerWheel.h"
 
 interface ISimbeyInterchangeFile;
 interface ISimbeyInterchangeFileGLFont;
@@ -28,6 +31,25 @@ interface IGameInterface
 	virtual BOOL OnKeyUp (UINT uMsg, WPARAM wParam, LPARAM lParam, LRESULT& lResult) = 0;
 };
 
+struct ENTITY_SCHEDULER_STATS
+{
+	sysint cScheduled;			// Regions with active entities
+	sysint cFrozen;				// Scheduled regions outside the simulation radius
+	sysint cRegionUpdates;		// Regions updated during the last frame
+	sysint cEntityUpdates;		// Entity updates during the last frame, including catching up
+	sysint cTimers;				// Entities waiting for a timer
+	sysint cTimersFired;		// Timers that fired during the last frame
+	sysint cTimersDeferred;		// Expired timers waiting for their frozen regions
+};
+
+// A timer that expired while its entity's region was frozen
+struct DEFERRED_TIMER
+{
+	CEntity* pEntity;
+	CDungeonRegion* pRegion;	// Holds a reference
+	DWORD nExpired;				// The tick the timer expired on
+};
+
 class CLevelRenderer : public IGameInterface
 {
 private:
@@ -36,7 +58,8 @@ private:
 	CLevelGenerator* m_pGenerator;
 	CWallTextures* m_pWalls;
 	CModels* m_pModels;
-	TRefArray<CDungeonRegion> m_aCache;
+	CRegionCache m_cache;
+	CRegionLoader m_loader;
 	CFrustum m_frustum;
 	CCamera m_camera;
 	INT m_nCompassDir;
@@ -44,12 +67,32 @@ private:
 
 	TArray<DBLRECT> m_aSolids;			// Temporary Cache
 	TArray<CModelEntity*> m_aModels;	// Temporary Cache
+	TArray<CDungeonRegion*> m_aUpdate;	// Temporary Cache
+	TArray<REGION_REQUEST> m_aPrefetch;	// Temporary Cache
+
+	// Cached regions with active entities, each holding a reference.  Only regions
+	// within the simulation radius of the player are updated; the others are frozen
+	// and catch up when the player comes back.  Timers that expire in a frozen region
+	// are held until then, and fire as part of catching up.
+	TArray<CDungeonRegion*> m_aScheduled;
+	TArray<DEFERRED_TIMER> m_aDeferred;
+	INT m_nSimulationRadius;
+	DWORD m_nTick;
+	BOOL m_fCatchingUp;
+	ENTITY_SCHEDULER_STATS m_statsScheduler;
+	BOOL m_fTraceStats;
+
+	// Entities waiting for their next state change, counted in the same ticks
+	CTimerWheel m_timers;
 
 	WCHAR m_wzLevelLabel[32];
 	WCHAR m_wzScoreLabel[40];
 	WCHAR m_wzKeysLabel[40];
 	INT m_xRegion, m_zRegion;
 
+	// Where the prefetch queue was last built for
+	INT m_xPrefetch, m_zPrefetch, m_nPrefetchDir;
+
 	ULONG m_nPoints;
 	INT m_cGoldKeys, m_cSilverKeys;
 
@@ -61,7 +104,8 @@ public:
 	CLevelRenderer (CInfiniteWolfenstein* pGame);
 	~CLevelRenderer ();
 
-	VOID AttachLevelGenerator (CLevelGenerator* pGenerator);
+	HRESULT AttachLevelGenerator (CLevelGenerator* pGenerator);
+	VOID DetachLevelGenerator (VOID);
 	HRESULT StartGame (INT nLevel, INT xRegion, INT zRegion, BOOL fSetCamera);
 	HRESULT PrepareLevel (INT nLevel, INT xRegion, INT zRegion, BOOL fSetCamera);
 	VOID RenderRegion (CDungeonRegion* pRegion);
@@ -76,6 +120,14 @@ public:
 	VOID ShowLockedDoorMessage (PCWSTR pcwzMessage, BYTE bRed, BYTE bGreen, BYTE bBlue);
 	BOOL CheckCollisionsWithEntity (CEntity* pEntity);
 	VOID GetPlayerPosition (__out DOUBLE* px, __out DOUBLE* pz);
+	VOID SetRegionCacheBudget (sysint cMaxRegions, SIZE_T cbMaxRegions);
+	VOID GetRegionCacheStats (__out REGION_CACHE_STATS* pStats);
+	VOID SetSimulationRadius (INT nRadius);
+	VOID GetEntitySchedulerStats (__out ENTITY_SCHEDULER_STATS* pStats);
+
+	// Writes the scheduler and cache statistics to the debugger every few seconds.
+	VOID SetTraceStats (BOOL fTrace);
+	VOID SetEntityTimer (CEntity* pEntity, DWORD cTicks);
 
 	// IGameInterface
 	virtual VOID DrawFrame (VOID);
@@ -89,6 +141,25 @@ private:
 	VOID DrawCompass (VOID);
 	VOID UpdateViewingTiles (VOID);
 	VOID GetRegionPosition (INT& xRegion, INT& zRegion);
+	VOID UpdateRegionLoader (VOID);
+	VOID QueuePrefetch (VOID);
+	VOID ScheduleRegion (CDungeonRegion* pRegion);
+	VOID UnscheduleRegion (CDungeonRegion* pRegion);
+	VOID ClearSchedule (VOID);
+	VOID UpdateScheduledRegions (VOID);
+	VOID FireDeferredTimers (VOID);
+	VOID FireEntityTimers (VOID);
+	VOID FireEntityTimer (CEntity* pEntity, CDungeonRegion* pRegion, DWORD nExpired);
+	VOID TraceStats (VOID);
+
+	// Drops the held timers of pRegion, or of every region if pRegion is NULL.
+	VOID DropDeferredTimers (__in_opt CDungeonRegion* pRegion);
+
+	inline BOOL IsFrozen (CDungeonRegion* pRegion) const
+	{
+		return abs(pRegion->m_xRegion - m_xRegion) > m_nSimulationRadius || abs(pRegion->m_zRegion - m_zRegion) > m_nSimulationRadius;
+	}
+
 	HRESULT GetDungeonRegion (INT xRegion, INT zRegion, __deref_out CDungeonRegion** ppRegion);
 	HRESULT GetCurrentRegionMusic (RSTRING* prstrMusicW);
 	HRESULT UpdateKeysLabel (VOID);
@@ -22,7 +22,13 @@ CDungeonRegion::CDungeonRegion (INT xRegion, INT zRegion) :
 	m_zRegion(zRegion),
 	m_xStartCell(-1),
 	m_zStartCell(-1),
-	m_nList(glGenLists(1))
+	m_nList(0),
+	m_pHashNext(NULL),
+	m_pNewer(NULL),
+	m_pOlder(NULL),
+	m_cbCached(0),
+	m_fScheduled(FALSE),
+	m_nSimulatedTick(0)
 {
 	ZeroMemory(m_bRegion, sizeof(m_bRegion));
 }
@@ -30,12 +36,14 @@ CDungeonRegion::CDungeonRegion (INT xRegion, INT zRegion) :
 CDungeonRegion::~CDungeonRegion ()
 {
 	Reset();
-	glDeleteLists(m_nList, 1);
+	if(0 != m_nList)
+		glDeleteLists(m_nList, 1);
 }
 
 VOID CDungeonRegion::Reset (VOID)
 {
 	ZeroMemory(m_bRegion, sizeof(m_bRegion));
+	m_aActive.Clear();
 	m_aEntities.DeleteAll();
 
 	if(m_rstrMusic)
@@ -81,10 +89,17 @@ HRESULT CDungeonRegion::RemoveActiveEntity (CEntity* pEntity)
 	return m_aActive.Remove(pEntity);
 }
 
-VOID CDungeonRegion::UpdateActiveEntities (CLevelRenderer* pRenderer)
+sysint CDungeonRegion::UpdateActiveEntities (CLevelRenderer* pRenderer)
 {
+	sysint cUpdates = 0;
+
 	for(sysint i = 0; i < m_aActive.Length(); i++)
+	{
 		m_aActive[i]->Update(pRenderer, this);
+		cUpdates++;
+	}
+
+	return cUpdates;
 }
 
 VOID CDungeonRegion::FindRandomStart (CLevelGenerator* pGenerator)
@@ -133,6 +148,11 @@ VOID CDungeonRegion::FindRandomStart (CLevelGenerator* pGenerator)
 	}
 }
 
+SIZE_T CDungeonRegion::GetMemoryUsage (VOID)
+{
+	return sizeof(CDungeonRegion) + (m_aEntities.Length() + m_aActive.Length()) * sizeof(CEntity*);
+}
+
 CLevelGenerator::CLevelGenerator (CWallTextures* pWalls, CWallThemes* pWallThemes, CChunkThemes* pChunkThemes, CLevels* pLevels, CRooms* pRooms, CRooms* pSpecial, CModels* pModels, DWORDLONG dwlSeed) :
 	m_pWalls(pWalls),
 	m_pWallThemes(pWallThemes),
@@ -153,6 +173,12 @@ CLevelGenerator::~CLevelGenerator ()
 {
 }
 
+HRESULT CLevelGenerator::Duplicate (__deref_out CLevelGenerator** ppGenerator)
+{
+	*ppGenerator = __new CLevelGenerator(m_pWalls, m_pWallThemes, m_pChunkThemes, m_pLevels, m_pRooms, m_pSpecial, m_pModels, m_uliSeed.QuadPart);
+	return *ppGenerator ? S_OK : E_OUTOFMEMORY;
+}
+
 HRESULT CLevelGenerator::SetLevel (INT nLevel)
 {
 	HRESULT hr;
@@ -11,6 +11,7 @@
 #include "Entities.h"
 
 #define	MAX_CACHE_SIZE			512
+#define	MAX_CACHE_BYTES			0		// No limit on the memory used by cached regions
 
 class CMd5;
 class CWallTextures;
@@ -38,13 +39,23 @@ public:
 	RSTRING m_rstrMusic;
 	INT m_xRegion, m_zRegion;
 	INT m_xStartCell, m_zStartCell;
-	UINT m_nList;
+	UINT m_nList;			// Created by CLevelRenderer::RenderRegion() on the main thread
 
 	BLOCK_DATA m_bRegion[REGION_WIDTH * REGION_WIDTH];
 	TArray<CEntity*> m_aEntities;
 
 	TSortedArray<CEntity*> m_aActive;
 
+	// Owned by CRegionCache
+	CDungeonRegion* m_pHashNext;
+	CDungeonRegion* m_pNewer;
+	CDungeonRegion* m_pOlder;
+	SIZE_T m_cbCached;
+
+	// Owned by CLevelRenderer's entity scheduler
+	BOOL m_fScheduled;
+	DWORD m_nSimulatedTick;		// The last tick this region's entities were updated for
+
 public:
 	IMP_BASE_UNKNOWN
 
@@ -60,8 +71,11 @@ public:
 	VOID DrawEntities (MODEL_LIST* pModels);
 	HRESULT AddActiveEntity (CEntity* pEntity);
 	HRESULT RemoveActiveEntity (CEntity* pEntity);
-	VOID UpdateActiveEntities (CLevelRenderer* pRenderer);
+	sysint UpdateActiveEntities (CLevelRenderer* pRenderer);
 	VOID FindRandomStart (CLevelGenerator* pGenerator);
+
+	// Approximate, counting the region and its entity tables but not the entities
+	SIZE_T GetMemoryUsage (VOID);
 };
 
 class CLevelGenerator
@@ -91,8 +105,13 @@ public:
 	CLevelGenerator (CWallTextures* pWalls, CWallThemes* pWallThemes, CChunkThemes* pChunkThemes, CLevels* pLevels, CRooms* pRooms, CRooms* pSpecial, CModels* pModels, DWORDLONG dwlSeed);
 	~CLevelGenerator ();
 
+	// Creates a generator with the same data and seed, but without a level selected,
+	// for generating regions on another thread.
+	HRESULT Duplicate (__deref_out CLevelGenerator** ppGenerator);
+
 	HRESULT SetLevel (INT nLevel);
 	VOID SetHellStart (INT xHellStart, INT zHellStart);
+	VOID GetHellStart (__out INT& xHellStart, __out INT& zHellStart) { xHellStart = m_xHellStart; zHellStart = m_zHellStart; }
 	INT GetLevel (VOID) { return m_nLevel; }
 	RSTRING GetLevelName (VOID);
 	HRESULT GenerateRegion (CDungeonRegion* pRegion, CLevelRenderer* pRenderer);
@@ -0,0 +1,235 @@
+#include <windows.h>
+#include "Library\Core\CoreDefs.h"
+#include "RegionCache.h"
+
+// Packs both coordinates into one 64-bit key and keeps the top bits of its product
+// with the golden ratio, so neighboring regions land in different buckets.
+static inline UINT HashRegion (INT xRegion, INT zRegion)
+{
+	ULONGLONG ullKey = (static_cast<ULONGLONG>(static_cast<ULONG>(xRegion)) << 32) | static_cast<ULONG>(zRegion);
+	return static_cast<UINT>((ullKey * 0x9E3779B97F4A7C15ULL) >> (64 - REGION_CACHE_BUCKET_BITS));
+}
+
+CRegionCache::CRegionCache (sysint cMaxRegions, SIZE_T cbMaxRegions) :
+	m_pNewest(NULL),
+	m_pOldest(NULL),
+	m_cRegions(0),
+	m_cbRegions(0),
+	m_cMaxRegions(cMaxRegions),
+	m_cbMaxRegions(cbMaxRegions),
+	m_cHits(0),
+	m_cMisses(0),
+	m_cEvictions(0)
+{
+	ZeroMemory(m_rgBuckets, sizeof(m_rgBuckets));
+}
+
+CRegionCache::~CRegionCache ()
+{
+	Clear();
+}
+
+VOID CRegionCache::SetBudget (sysint cMaxRegions, SIZE_T cbMaxRegions)
+{
+	m_cMaxRegions = cMaxRegions;
+	m_cbMaxRegions = cbMaxRegions;
+
+	while(m_pOldest && IsOverBudget())
+		EvictOldest();
+}
+
+BOOL CRegionCache::Find (INT xRegion, INT zRegion, __deref_out CDungeonRegion** ppRegion)
+{
+	CDungeonRegion* pRegion = Lookup(xRegion, zRegion);
+
+	if(NULL == pRegion)
+	{
+		m_cMisses++;
+		return FALSE;
+	}
+
+	m_cHits++;
+	pRegion->AddRef();
+	*ppRegion = pRegion;
+	return TRUE;
+}
+
+BOOL CRegionCache::Peek (INT xRegion, INT zRegion, __deref_out CDungeonRegion** ppRegion)
+{
+	CDungeonRegion* pRegion = Lookup(xRegion, zRegion);
+
+	if(NULL == pRegion)
+		return FALSE;
+
+	pRegion->AddRef();
+	*ppRegion = pRegion;
+	return TRUE;
+}
+
+BOOL CRegionCache::Contains (INT xRegion, INT zRegion)
+{
+	for(CDungeonRegion* pRegion = m_rgBuckets[HashRegion(xRegion, zRegion)]; pRegion; pRegion = pRegion->m_pHashNext)
+	{
+		if(pRegion->m_xRegion == xRegion && pRegion->m_zRegion == zRegion)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+BOOL CRegionCache::Contains (CDungeonRegion* pRegion)
+{
+	for(CDungeonRegion* pCached = m_rgBuckets[HashRegion(pRegion->m_xRegion, pRegion->m_zRegion)]; pCached; pCached = pCached->m_pHashNext)
+	{
+		if(pCached == pRegion)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+CDungeonRegion* CRegionCache::ReclaimOldest (VOID)
+{
+	CDungeonRegion* pRegion = m_pOldest;
+
+	if(NULL == pRegion)
+		return NULL;
+	if(m_cRegions < m_cMaxRegions && (0 == m_cbMaxRegions || m_cbRegions < m_cbMaxRegions))
+		return NULL;
+
+	Unlink(pRegion);
+	m_cEvictions++;
+	return pRegion;
+}
+
+HRESULT CRegionCache::Add (CDungeonRegion* pRegion)
+{
+	HRESULT hr = S_OK;
+	UINT nBucket;
+
+	CheckIf(NULL == pRegion, E_INVALIDARG);
+
+	nBucket = HashRegion(pRegion->m_xRegion, pRegion->m_zRegion);
+	pRegion->m_pHashNext = m_rgBuckets[nBucket];
+	m_rgBuckets[nBucket] = pRegion;
+
+	pRegion->m_pNewer = NULL;
+	pRegion->m_pOlder = m_pNewest;
+	if(m_pNewest)
+		m_pNewest->m_pNewer = pRegion;
+	else
+		m_pOldest = pRegion;
+	m_pNewest = pRegion;
+
+	pRegion->m_cbCached = pRegion->GetMemoryUsage();
+	m_cbRegions += pRegion->m_cbCached;
+	m_cRegions++;
+	pRegion->AddRef();
+
+	while(m_pOldest != pRegion && IsOverBudget())
+		EvictOldest();
+
+Cleanup:
+	return hr;
+}
+
+VOID CRegionCache::Clear (VOID)
+{
+	CDungeonRegion* pRegion = m_pNewest;
+
+	// Detach everything first, in case releasing a region reenters the cache.
+	ZeroMemory(m_rgBuckets, sizeof(m_rgBuckets));
+	m_pNewest = NULL;
+	m_pOldest = NULL;
+	m_cRegions = 0;
+	m_cbRegions = 0;
+
+	while(pRegion)
+	{
+		CDungeonRegion* pOlder = pRegion->m_pOlder;
+		pRegion->m_pHashNext = NULL;
+		pRegion->m_pNewer = NULL;
+		pRegion->m_pOlder = NULL;
+		pRegion->Release();
+		pRegion = pOlder;
+	}
+}
+
+VOID CRegionCache::GetStats (__out REGION_CACHE_STATS* pStats)
+{
+	pStats->cHits = m_cHits;
+	pStats->cMisses = m_cMisses;
+	pStats->cEvictions = m_cEvictions;
+	pStats->cRegions = m_cRegions;
+	pStats->cbRegions = m_cbRegions;
+}
+
+VOID CRegionCache::ResetStats (VOID)
+{
+	m_cHits = 0;
+	m_cMisses = 0;
+	m_cEvictions = 0;
+}
+
+CDungeonRegion* CRegionCache::Lookup (INT xRegion, INT zRegion)
+{
+	for(CDungeonRegion* pRegion = m_rgBuckets[HashRegion(xRegion, zRegion)]; pRegion; pRegion = pRegion->m_pHashNext)
+	{
+		if(pRegion->m_xRegion == xRegion && pRegion->m_zRegion == zRegion)
+		{
+			if(m_pNewest != pRegion)
+			{
+				// Move the region to the front of the LRU list.
+				pRegion->m_pNewer->m_pOlder = pRegion->m_pOlder;
+				if(pRegion->m_pOlder)
+					pRegion->m_pOlder->m_pNewer = pRegion->m_pNewer;
+				else
+					m_pOldest = pRegion->m_pNewer;
+
+				pRegion->m_pNewer = NULL;
+				pRegion->m_pOlder = m_pNewest;
+				m_pNewest->m_pNewer = pRegion;
+				m_pNewest = pRegion;
+			}
+			return pRegion;
+		}
+	}
+	return NULL;
+}
+
+BOOL CRegionCache::IsOverBudget (VOID)
+{
+	return m_cRegions > m_cMaxRegions || (0 < m_cbMaxRegions && m_cbRegions > m_cbMaxRegions);
+}
+
+VOID CRegionCache::Unlink (CDungeonRegion* pRegion)
+{
+	CDungeonRegion** ppLink = m_rgBuckets + HashRegion(pRegion->m_xRegion, pRegion->m_zRegion);
+
+	while(*ppLink != pRegion)
+		ppLink = &(*ppLink)->m_pHashNext;
+	*ppLink = pRegion->m_pHashNext;
+
+	if(pRegion->m_pNewer)
+		pRegion->m_pNewer->m_pOlder = pRegion->m_pOlder;
+	else
+		m_pNewest = pRegion->m_pOlder;
+	if(pRegion->m_pOlder)
+		pRegion->m_pOlder->m_pNewer = pRegion->m_pNewer;
+	else
+		m_pOldest = pRegion->m_pNewer;
+
+	pRegion->m_pHashNext = NULL;
+	pRegion->m_pNewer = NULL;
+	pRegion->m_pOlder = NULL;
+
+	m_cbRegions -= pRegion->m_cbCached;
+	m_cRegions--;
+}
+
+VOID CRegionCache::EvictOldest (VOID)
+{
+	CDungeonRegion* pRegion = m_pOldest;
+
+	Unlink(pRegion);
+	m_cEvictions++;
+	pRegion->Release();
+}
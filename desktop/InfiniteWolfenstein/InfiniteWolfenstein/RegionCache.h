@@ -0,0 +1,76 @@
+#pragma once
+
+#include "LevelGenerator.h"
+
+#define	REGION_CACHE_BUCKET_BITS	10
+#define	REGION_CACHE_BUCKETS		(1 << REGION_CACHE_BUCKET_BITS)
+
+struct REGION_CACHE_STATS
+{
+	ULONGLONG cHits;
+	ULONGLONG cMisses;
+	ULONGLONG cEvictions;
+	sysint cRegions;
+	SIZE_T cbRegions;
+};
+
+// Generated regions, found by their coordinates through a hash table and evicted in
+// least recently used order.  The bucket chains and the LRU list are threaded through
+// the regions themselves, and the cache holds one reference to each region.
+class CRegionCache
+{
+private:
+	CDungeonRegion* m_rgBuckets[REGION_CACHE_BUCKETS];
+	CDungeonRegion* m_pNewest;
+	CDungeonRegion* m_pOldest;
+	sysint m_cRegions;
+	SIZE_T m_cbRegions;
+
+	sysint m_cMaxRegions;
+	SIZE_T m_cbMaxRegions;
+
+	ULONGLONG m_cHits;
+	ULONGLONG m_cMisses;
+	ULONGLONG m_cEvictions;
+
+public:
+	CRegionCache (sysint cMaxRegions, SIZE_T cbMaxRegions);
+	~CRegionCache ();
+
+	// A cbMaxRegions of zero doesn't limit the memory used.  Regions over the new
+	// budget are evicted immediately.
+	VOID SetBudget (sysint cMaxRegions, SIZE_T cbMaxRegions);
+
+	// Returns a new reference and marks the region as the most recently used.
+	BOOL Find (INT xRegion, INT zRegion, __deref_out CDungeonRegion** ppRegion);
+
+	// Like Find(), but isn't counted as a hit or a miss.  For callers that look at the
+	// same regions every frame and would swamp the statistics.
+	BOOL Peek (INT xRegion, INT zRegion, __deref_out CDungeonRegion** ppRegion);
+
+	// Doesn't change the LRU order or the statistics.
+	BOOL Contains (INT xRegion, INT zRegion);
+	BOOL Contains (CDungeonRegion* pRegion);
+
+	// When the cache is full, removes the least recently used region and returns the
+	// cache's reference to it so that the caller can reuse it.  Otherwise returns NULL.
+	CDungeonRegion* ReclaimOldest (VOID);
+
+	// The region must not already be cached.  Older regions are evicted until the
+	// cache is back within its budget, but the new region is always kept.
+	HRESULT Add (CDungeonRegion* pRegion);
+
+	VOID Clear (VOID);
+
+	inline sysint Length (VOID) const { return m_cRegions; }
+	inline CDungeonRegion* GetNewest (VOID) const { return m_pNewest; }
+
+	VOID GetStats (__out REGION_CACHE_STATS* pStats);
+	VOID ResetStats (VOID);
+
+private:
+	CDungeonRegion* Lookup (INT xRegion, INT zRegion);
+	BOOL IsOverBudget (VOID);
+	VOID Unlink (CDungeonRegion* pRegion);
+	VOID EvictOldest (VOID);
+};
@@ -0,0 +1,466 @@
+#include <windows.h>
+#include "Library\Core\CoreDefs.h"
+#include "Library\Util\RString.h"
+#include "RegionLoader.h"
+
+#ifdef	_DEBUG
+static BOOL SameEntity (CEntity* pA, CEntity* pB)
+{
+	// Without RTTI, entities of the same class are recognized by their shared vtable.
+	return *reinterpret_cast<PVOID*>(pA) == *reinterpret_cast<PVOID*>(pB) &&
+		pA->m_dp.x == pB->m_dp.x && pA->m_dp.y == pB->m_dp.y && pA->m_dp.z == pB->m_dp.z;
+}
+
+static BOOL SameRegion (CDungeonRegion* pA, CDungeonRegion* pB)
+{
+	INT nResult;
+
+	if(pA->m_pChunk != pB->m_pChunk || pA->m_xStartCell != pB->m_xStartCell || pA->m_zStartCell != pB->m_zStartCell)
+		return FALSE;
+
+	if(FAILED(RStrCompareRStr(pA->m_rstrMusic, pB->m_rstrMusic, &nResult)) || 0 != nResult)
+		return FALSE;
+
+	for(INT i = 0; i < ARRAYSIZE(pA->m_bRegion); i++)
+	{
+		const BLOCK_DATA* pcBlockA = pA->m_bRegion + i;
+		const BLOCK_DATA* pcBlockB = pB->m_bRegion + i;
+		CEntity* pEntityA = pcBlockA->m_pEntities;
+		CEntity* pEntityB = pcBlockB->m_pEntities;
+
+		if(pcBlockA->idxBlock != pcBlockB->idxBlock || 0 != memcmp(pcBlockA->idxSides, pcBlockB->idxSides, sizeof(pcBlockA->idxSides)))
+			return FALSE;
+
+		for(; pEntityA && pEntityB; pEntityA = pEntityA->m_pNext, pEntityB = pEntityB->m_pNext)
+		{
+			if(!SameEntity(pEntityA, pEntityB))
+				return FALSE;
+		}
+		if(pEntityA || pEntityB)
+			return FALSE;
+	}
+
+	if(pA->m_aEntities.Length() != pB->m_aEntities.Length())
+		return FALSE;
+
+	for(sysint i = 0; i < pA->m_aEntities.Length(); i++)
+	{
+		if(!SameEntity(pA->m_aEntities[i], pB->m_aEntities[i]))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+#endif
+
+CRegionLoader::CRegionLoader () :
+	m_pRenderer(NULL),
+	m_prgWorkers(NULL),
+	m_cWorkers(0),
+	m_hWake(NULL),
+	m_hDone(NULL),
+	m_fShutdown(FALSE),
+	m_dwEpoch(0),
+	m_nLevel(-1),
+	m_xHellStart(-1),
+	m_zHellStart(-1)
+{
+	InitializeCriticalSection(&m_cs);
+}
+
+CRegionLoader::~CRegionLoader ()
+{
+	Shutdown();
+	DeleteCriticalSection(&m_cs);
+}
+
+HRESULT CRegionLoader::Initialize (CLevelGenerator* pGenerator, CLevelRenderer* pRenderer, INT cThreads)
+{
+	HRESULT hr;
+
+	CheckIf(NULL != m_hWake, E_UNEXPECTED);
+	CheckIf(NULL == pGenerator || 0 > cThreads, E_INVALIDARG);
+
+	if(0 == cThreads)
+	{
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		cThreads = min(max(static_cast<INT>(si.dwNumberOfProcessors) - 1, 1), REGION_LOADER_MAX_THREADS);
+	}
+
+	m_pRenderer = pRenderer;
+
+	m_hWake = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+	CheckIfGetLastError(NULL == m_hWake);
+
+	m_hDone = CreateEvent(NULL, FALSE, FALSE, NULL);
+	CheckIfGetLastError(NULL == m_hDone);
+
+	m_fShutdown = FALSE;
+
+	m_prgWorkers = __new WORKER[cThreads];
+	CheckAlloc(m_prgWorkers);
+
+	for(INT i = 0; i < cThreads; i++)
+	{
+		WORKER* pWorker = m_prgWorkers + i;
+		DWORD idThread;
+
+		pWorker->pLoader = this;
+		pWorker->dwEpoch = 0;
+		pWorker->fBusy = FALSE;
+		pWorker->xRegion = 0;
+		pWorker->zRegion = 0;
+		pWorker->hThread = NULL;
+
+		Check(pGenerator->Duplicate(&pWorker->pGenerator));
+
+		pWorker->hThread = CreateThread(NULL, 0, _WorkerThread, pWorker, 0, &idThread);
+		if(NULL == pWorker->hThread)
+		{
+			hr = HRESULT_FROM_WIN32(GetLastError());
+			__delete pWorker->pGenerator;
+			goto Cleanup;
+		}
+
+		m_cWorkers++;
+	}
+
+	hr = S_OK;
+
+Cleanup:
+	if(FAILED(hr))
+		Shutdown();
+	return hr;
+}
+
+VOID CRegionLoader::Shutdown (VOID)
+{
+	if(0 < m_cWorkers)
+	{
+		m_fShutdown = TRUE;
+		ReleaseSemaphore(m_hWake, m_cWorkers, NULL);
+
+		for(INT i = 0; i < m_cWorkers; i++)
+		{
+			WaitForSingleObject(m_prgWorkers[i].hThread, INFINITE);
+			CloseHandle(m_prgWorkers[i].hThread);
+			__delete m_prgWorkers[i].pGenerator;
+		}
+		m_cWorkers = 0;
+	}
+
+	SafeDeleteArray(m_prgWorkers);
+	SafeCloseHandle(m_hWake);
+	SafeCloseHandle(m_hDone);
+
+	m_aQueue.Clear();
+	ClearDone();
+}
+
+VOID CRegionLoader::SetLevel (CLevelGenerator* pGenerator)
+{
+	EnterCriticalSection(&m_cs);
+
+	m_dwEpoch++;
+	m_nLevel = pGenerator->GetLevel();
+	pGenerator->GetHellStart(m_xHellStart, m_zHellStart);
+
+	m_aQueue.Clear();
+	ClearDone();
+
+	// Regions still being generated will be thrown away, so they mustn't stop the
+	// same coordinates from being queued or claimed for the new level.
+	for(INT i = 0; i < m_cWorkers; i++)
+		m_prgWorkers[i].fBusy = FALSE;
+
+	LeaveCriticalSection(&m_cs);
+}
+
+HRESULT CRegionLoader::Prefetch (const REGION_REQUEST* prgRequests, sysint cRequests)
+{
+	HRESULT hr = S_OK;
+	LONG cWake;
+
+	if(0 == m_cWorkers)
+		return S_FALSE;
+
+	EnterCriticalSection(&m_cs);
+
+	m_aQueue.Clear();
+	for(sysint i = 0; i < cRequests; i++)
+	{
+		const REGION_REQUEST& request = prgRequests[i];
+		sysint idxDone, idxInsert;
+
+		if(IsRunning(request.xRegion, request.zRegion) || FindDone(request.xRegion, request.zRegion, &idxDone))
+			continue;
+
+		// The queue is short, so a linear scan finds the insertion point.
+		for(idxInsert = m_aQueue.Length(); 0 < idxInsert; idxInsert--)
+		{
+			if(m_aQueue[idxInsert - 1].dblPriority <= request.dblPriority)
+				break;
+		}
+		Check(m_aQueue.InsertAt(request, idxInsert));
+	}
+
+	// Workers that wake to an empty queue go back to waiting, so extra wakes are harmless.
+	cWake = static_cast<LONG>(min(m_aQueue.Length(), static_cast<sysint>(m_cWorkers)));
+	if(0 < cWake)
+		ReleaseSemaphore(m_hWake, cWake, NULL);
+
+Cleanup:
+	LeaveCriticalSection(&m_cs);
+	return hr;
+}
+
+HRESULT CRegionLoader::Claim (INT xRegion, INT zRegion, __deref_out CDungeonRegion** ppRegion)
+{
+	HRESULT hr = S_FALSE;
+
+	EnterCriticalSection(&m_cs);
+
+	for(sysint i = 0; i < m_aQueue.Length(); i++)
+	{
+		if(m_aQueue[i].xRegion == xRegion && m_aQueue[i].zRegion == zRegion)
+		{
+			m_aQueue.Remove(i, NULL);
+			break;
+		}
+	}
+
+	for(;;)
+	{
+		sysint idxDone;
+
+		if(FindDone(xRegion, zRegion, &idxDone))
+		{
+			REGION_RESULT result;
+
+			m_aDone.Remove(idxDone, &result);
+			if(SUCCEEDED(result.hr))
+			{
+				*ppRegion = result.pRegion;
+				hr = S_OK;
+			}
+			else
+				SafeRelease(result.pRegion);
+			break;
+		}
+
+		if(!IsRunning(xRegion, zRegion))
+			break;
+
+		LeaveCriticalSection(&m_cs);
+		WaitForSingleObject(m_hDone, INFINITE);
+		EnterCriticalSection(&m_cs);
+	}
+
+	LeaveCriticalSection(&m_cs);
+	return hr;
+}
+
+HRESULT CRegionLoader::TakeCompleted (__deref_out CDungeonRegion** ppRegion)
+{
+	HRESULT hr = S_FALSE;
+
+	EnterCriticalSection(&m_cs);
+
+	if(0 < m_aDone.Length())
+	{
+		REGION_RESULT result;
+
+		m_aDone.Remove(0, &result);
+		hr = result.hr;
+		if(SUCCEEDED(hr))
+			*ppRegion = result.pRegion;
+		else
+			SafeRelease(result.pRegion);
+	}
+
+	LeaveCriticalSection(&m_cs);
+	return hr;
+}
+
+#ifdef	_DEBUG
+HRESULT CRegionLoader::SelfTest (CLevelGenerator* pGenerator, INT xCenter, INT zCenter, INT nRadius)
+{
+	HRESULT hr;
+	TArray<REGION_REQUEST> aRequests;
+	CDungeonRegion* pLoaded = NULL, *pExpected = NULL;
+	sysint cRemaining;
+
+	CheckIf(NULL == pGenerator || 0 > nRadius, E_INVALIDARG);
+	CheckIf(0 == m_cWorkers, S_FALSE);
+
+	for(INT z = zCenter - nRadius; z <= zCenter + nRadius; z++)
+	{
+		for(INT x = xCenter - nRadius; x <= xCenter + nRadius; x++)
+		{
+			REGION_REQUEST request;
+
+			request.xRegion = x;
+			request.zRegion = z;
+			request.dblPriority = 0.0;
+			Check(aRequests.Append(request));
+		}
+	}
+
+	// Regions still being generated from an earlier request must not be taken for these.
+	SetLevel(pGenerator);
+	Check(Prefetch(&aRequests[0], aRequests.Length()));
+
+	for(cRemaining = aRequests.Length(); 0 < cRemaining; cRemaining--)
+	{
+		BOOL fSame;
+
+		for(;;)
+		{
+			Check(TakeCompleted(&pLoaded));
+			if(S_OK == hr)
+				break;
+			CheckIf(WAIT_TIMEOUT == WaitForSingleObject(m_hDone, 30000), HRESULT_FROM_WIN32(ERROR_TIMEOUT));
+		}
+
+		pExpected = __new CDungeonRegion(pLoaded->m_xRegion, pLoaded->m_zRegion);
+		CheckAlloc(pExpected);
+		Check(pGenerator->GenerateRegion(pExpected, m_pRenderer));
+
+		fSame = SameRegion(pLoaded, pExpected);
+		if(!fSame)
+		{
+			WCHAR wzMessage[128];
+			wsprintf(wzMessage, L"CRegionLoader::SelfTest: region %d, %d differs from GenerateRegion()\r\n", pLoaded->m_xRegion, pLoaded->m_zRegion);
+			OutputDebugStringW(wzMessage);
+		}
+		CheckIf(!fSame, E_FAIL);
+
+		SafeRelease(pLoaded);
+		SafeRelease(pExpected);
+	}
+
+	hr = S_OK;
+
+Cleanup:
+	SafeRelease(pExpected);
+	SafeRelease(pLoaded);
+	return hr;
+}
+#endif
+
+BOOL CRegionLoader::FindDone (INT xRegion, INT zRegion, __out sysint* pidxDone)
+{
+	for(sysint i = 0; i < m_aDone.Length(); i++)
+	{
+		CDungeonRegion* pRegion = m_aDone[i].pRegion;
+		if(pRegion->m_xRegion == xRegion && pRegion->m_zRegion == zRegion)
+		{
+			*pidxDone = i;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+BOOL CRegionLoader::IsRunning (INT xRegion, INT zRegion)
+{
+	for(INT i = 0; i < m_cWorkers; i++)
+	{
+		WORKER* pWorker = m_prgWorkers + i;
+		if(pWorker->fBusy && pWorker->xRegion == xRegion && pWorker->zRegion == zRegion)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+VOID CRegionLoader::ClearDone (VOID)
+{
+	// These regions have never been drawn, so they can be released without a GL context.
+	for(sysint i = 0; i < m_aDone.Length(); i++)
+		SafeRelease(m_aDone[i].pRegion);
+	m_aDone.Clear();
+}
+
+BOOL CRegionLoader::RunWorker (WORKER* pWorker)
+{
+	HRESULT hr = S_OK;
+	REGION_REQUEST request;
+	DWORD dwEpoch;
+	INT nLevel, xHellStart, zHellStart;
+	CDungeonRegion* pRegion = NULL;
+	REGION_RESULT result;
+
+	EnterCriticalSection(&m_cs);
+
+	if(0 == m_aQueue.Length())
+	{
+		LeaveCriticalSection(&m_cs);
+		return FALSE;
+	}
+
+	m_aQueue.Remove(0, &request);
+	pWorker->fBusy = TRUE;
+	pWorker->xRegion = request.xRegion;
+	pWorker->zRegion = request.zRegion;
+
+	dwEpoch = m_dwEpoch;
+	nLevel = m_nLevel;
+	xHellStart = m_xHellStart;
+	zHellStart = m_zHellStart;
+
+	LeaveCriticalSection(&m_cs);
+
+	if(pWorker->dwEpoch != dwEpoch)
+	{
+		pWorker->pGenerator->SetHellStart(xHellStart, zHellStart);
+		hr = pWorker->pGenerator->SetLevel(nLevel);
+		pWorker->dwEpoch = SUCCEEDED(hr) ? dwEpoch : 0;
+	}
+
+	if(SUCCEEDED(hr))
+	{
+		pRegion = __new CDungeonRegion(request.xRegion, request.zRegion);
+		if(pRegion)
+			hr = pWorker->pGenerator->GenerateRegion(pRegion, m_pRenderer);
+	}
+
+	EnterCriticalSection(&m_cs);
+
+	pWorker->fBusy = FALSE;
+
+	// Regions generated for an earlier level are discarded.  Failures are kept, with
+	// their region, so that Claim() and TakeCompleted() can report them.
+	if(pRegion && dwEpoch == m_dwEpoch)
+	{
+		result.pRegion = pRegion;
+		result.hr = hr;
+		if(SUCCEEDED(m_aDone.Append(result)))
+			pRegion = NULL;
+	}
+
+	LeaveCriticalSection(&m_cs);
+
+	SafeRelease(pRegion);
+	SetEvent(m_hDone);
+	return TRUE;
+}
+
+DWORD CALLBACK CRegionLoader::_WorkerThread (PVOID pvParam)
+{
+	WORKER* pWorker = reinterpret_cast<WORKER*>(pvParam);
+	CRegionLoader* pLoader = pWorker->pLoader;
+
+	for(;;)
+	{
+		WaitForSingleObject(pLoader->m_hWake, INFINITE);
+		if(pLoader->m_fShutdown)
+			break;
+
+		// One wake drains the queue, since Prefetch() doesn't wake a worker per request.
+		while(!pLoader->m_fShutdown && pLoader->RunWorker(pWorker))
+			;
+	}
+
+	return 0;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Library\Core\Array.h"
+#include "LevelGenerator.h"
+
+#define	REGION_LOADER_MAX_THREADS	4
+
+struct REGION_REQUEST
+{
+	INT xRegion, zRegion;
+	DOUBLE dblPriority;		// Lower values are generated first
+};
+
+// Generates regions on worker threads ahead of the player.  Each worker has its own
+// CLevelGenerator, because a generator keeps scratch state while it builds a region.
+// Generation only depends on the seed, level and region coordinates, so a region built
+// here is the same as one built by GenerateRegion() on the main thread.  Finished
+// regions have no display list yet; the main thread takes them with TakeCompleted()
+// and builds their lists there.
+class CRegionLoader
+{
+private:
+	struct WORKER
+	{
+		CRegionLoader* pLoader;
+		CLevelGenerator* pGenerator;
+		DWORD dwEpoch;			// Level settings the generator was last given
+		HANDLE hThread;
+
+		// Guarded by m_cs while a region is being generated
+		BOOL fBusy;
+		INT xRegion, zRegion;
+	};
+
+	struct REGION_RESULT
+	{
+		CDungeonRegion* pRegion;
+		HRESULT hr;
+	};
+
+	CRITICAL_SECTION m_cs;
+	CLevelRenderer* m_pRenderer;
+	WORKER* m_prgWorkers;
+	INT m_cWorkers;
+	HANDLE m_hWake;
+	HANDLE m_hDone;
+	volatile BOOL m_fShutdown;
+
+	// Bumped by SetLevel(), so regions for an earlier level are thrown away.
+	DWORD m_dwEpoch;
+	INT m_nLevel;
+	INT m_xHellStart, m_zHellStart;
+
+	TArray<REGION_REQUEST> m_aQueue;		// Sorted by priority
+	TArray<REGION_RESULT> m_aDone;
+
+public:
+	CRegionLoader ();
+	~CRegionLoader ();
+
+	// With cThreads at zero, one thread is started for each additional processor, up
+	// to REGION_LOADER_MAX_THREADS.
+	HRESULT Initialize (CLevelGenerator* pGenerator, CLevelRenderer* pRenderer, INT cThreads = 0);
+	VOID Shutdown (VOID);
+
+	// Cancels all queued and finished regions, and has the workers match pGenerator's
+	// level before generating any more.
+	VOID SetLevel (CLevelGenerator* pGenerator);
+
+	// Replaces the queue.  Regions already being generated or waiting to be taken are
+	// skipped.
+	HRESULT Prefetch (const REGION_REQUEST* prgRequests, sysint cRequests);
+
+	// Takes a finished region, waiting for it if a worker is generating it now.  A
+	// queued request is removed instead, and S_FALSE is returned so that the caller
+	// generates the region itself.
+	HRESULT Claim (INT xRegion, INT zRegion, __deref_out CDungeonRegion** ppRegion);
+
+	// Takes the next region that finished generating.  Returns S_FALSE if there isn't
+	// one, or the generation failure for a region that couldn't be built.
+	HRESULT TakeCompleted (__deref_out CDungeonRegion** ppRegion);
+
+#ifdef	_DEBUG
+	// Generates the regions within nRadius of the center on the workers, and again
+	// with pGenerator on this thread, and fails if any of them differ.  This starts
+	// with SetLevel(pGenerator), which discards any queued or finished regions.
+	HRESULT SelfTest (CLevelGenerator* pGenerator, INT xCenter, INT zCenter, INT nRadius);
+#endif
+
+private:
+	BOOL FindDone (INT xRegion, INT zRegion, __out sysint* pidxDone);
+	BOOL IsRunning (INT xRegion, INT zRegion);
+	VOID ClearDone (VOID);
+	BOOL RunWorker (WORKER* pWorker);
+	static DWORD CALLBACK _WorkerThread (PVOID pvParam);
+};
@@ -0,0 +1,197 @@
+#include <windows.h>
+#include "Library\Core\CoreDefs.h"
+#include "TimerWheel.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// CWheelTimer
+///////////////////////////////////////////////////////////////////////////////
+
+CWheelTimer::CWheelTimer () :
+	m_pWheel(NULL),
+	m_pNext(NULL),
+	m_ppLink(NULL),
+	m_nDue(0),
+	m_fExpired(FALSE)
+{
+}
+
+CWheelTimer::~CWheelTimer ()
+{
+	KillTimer();
+}
+
+DWORD CWheelTimer::GetTimerRemaining (VOID) const
+{
+	if(NULL == m_pWheel || m_fExpired)
+		return 0;
+	return m_nDue - m_pWheel->m_nNow;
+}
+
+VOID CWheelTimer::KillTimer (VOID)
+{
+	if(m_pWheel)
+	{
+		// Expired timers are no longer counted by the wheel.
+		if(!m_fExpired)
+			m_pWheel->m_cTimers--;
+
+		CTimerWheel::Unlink(this);
+		m_pWheel = NULL;
+		m_fExpired = FALSE;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CTimerWheel
+///////////////////////////////////////////////////////////////////////////////
+
+CTimerWheel::CTimerWheel () :
+	m_pExpired(NULL),
+	m_nNow(0),
+	m_cTimers(0)
+{
+	ZeroMemory(m_rgSlots, sizeof(m_rgSlots));
+}
+
+CTimerWheel::~CTimerWheel ()
+{
+	Clear();
+}
+
+VOID CTimerWheel::Set (CWheelTimer* pTimer, DWORD cTicks)
+{
+	pTimer->KillTimer();
+
+	if(0 == cTicks)
+		cTicks = 1;
+	else if(TIMER_WHEEL_MAX_TICKS < cTicks)
+		cTicks = TIMER_WHEEL_MAX_TICKS;
+
+	pTimer->m_pWheel = this;
+	pTimer->m_nDue = m_nNow + cTicks;
+	Insert(pTimer);
+	m_cTimers++;
+}
+
+VOID CTimerWheel::AdvanceTo (DWORD nNow)
+{
+	while(m_nNow != nNow)
+	{
+		// With nothing waiting, there's nothing to move down or expire on the way.
+		if(0 == m_cTimers)
+		{
+			m_nNow = nNow;
+			break;
+		}
+
+		m_nNow++;
+
+		// When the levels below it wrap, the next slot of a higher level is moved down.
+		for(INT nLevel = 1; nLevel < TIMER_WHEEL_LEVELS; nLevel++)
+		{
+			INT nShift = nLevel * TIMER_WHEEL_SLOT_BITS;
+			if(0 != (m_nNow & ((1 << nShift) - 1)))
+				break;
+			Cascade(nLevel, (m_nNow >> nShift) & (TIMER_WHEEL_SLOTS - 1));
+		}
+
+		// Everything in the current slot of the first level is due now.
+		CWheelTimer** ppSlot = m_rgSlots[0] + (m_nNow & (TIMER_WHEEL_SLOTS - 1));
+		if(*ppSlot)
+		{
+			CWheelTimer** ppTail = &m_pExpired;
+
+			while(*ppTail)
+				ppTail = &(*ppTail)->m_pNext;
+
+			while(*ppSlot)
+			{
+				CWheelTimer* pTimer = *ppSlot;
+
+				Unlink(pTimer);
+				Link(ppTail, pTimer);
+				ppTail = &pTimer->m_pNext;
+				pTimer->m_fExpired = TRUE;
+				m_cTimers--;
+			}
+		}
+	}
+}
+
+CWheelTimer* CTimerWheel::TakeExpired (VOID)
+{
+	CWheelTimer* pTimer = m_pExpired;
+
+	if(pTimer)
+	{
+		Unlink(pTimer);
+		pTimer->m_pWheel = NULL;
+		pTimer->m_fExpired = FALSE;
+	}
+
+	return pTimer;
+}
+
+VOID CTimerWheel::Clear (VOID)
+{
+	for(INT nLevel = 0; nLevel < TIMER_WHEEL_LEVELS; nLevel++)
+	{
+		for(INT idxSlot = 0; idxSlot < TIMER_WHEEL_SLOTS; idxSlot++)
+		{
+			while(m_rgSlots[nLevel][idxSlot])
+			{
+				CWheelTimer* pTimer = m_rgSlots[nLevel][idxSlot];
+				Unlink(pTimer);
+				pTimer->m_pWheel = NULL;
+			}
+		}
+	}
+
+	while(TakeExpired())
+		;
+
+	m_cTimers = 0;
+}
+
+VOID CTimerWheel::Insert (CWheelTimer* pTimer)
+{
+	DWORD cTicks = pTimer->m_nDue - m_nNow;
+	INT nLevel = 0;
+
+	// Find the lowest level whose span reaches the due time.
+	while(nLevel < TIMER_WHEEL_LEVELS - 1 && cTicks >= (1UL << ((nLevel + 1) * TIMER_WHEEL_SLOT_BITS)))
+		nLevel++;
+
+	Link(m_rgSlots[nLevel] + ((pTimer->m_nDue >> (nLevel * TIMER_WHEEL_SLOT_BITS)) & (TIMER_WHEEL_SLOTS - 1)), pTimer);
+}
+
+VOID CTimerWheel::Cascade (INT nLevel, INT idxSlot)
+{
+	CWheelTimer** ppSlot = m_rgSlots[nLevel] + idxSlot;
+
+	while(*ppSlot)
+	{
+		CWheelTimer* pTimer = *ppSlot;
+
+		Unlink(pTimer);
+		Insert(pTimer);
+	}
+}
+
+VOID CTimerWheel::Link (CWheelTimer** ppHead, CWheelTimer* pTimer)
+{
+	pTimer->m_pNext = *ppHead;
+	if(pTimer->m_pNext)
+		pTimer->m_pNext->m_ppLink = &pTimer->m_pNext;
+	pTimer->m_ppLink = ppHead;
+	*ppHead = pTimer;
+}
+
+VOID CTimerWheel::Unlink (CWheelTimer* pTimer)
+{
+	*pTimer->m_ppLink = pTimer->m_pNext;
+	if(pTimer->m_pNext)
+		pTimer->m_pNext->m_ppLink = pTimer->m_ppLink;
+	pTimer->m_pNext = NULL;
+	pTimer->m_ppLink = NULL;
+}
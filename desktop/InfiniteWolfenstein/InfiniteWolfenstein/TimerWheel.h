@@ -0,0 +1,78 @@
+#pragma once
+
+#define	TIMER_WHEEL_SLOT_BITS		6
+#define	TIMER_WHEEL_SLOTS			(1 << TIMER_WHEEL_SLOT_BITS)
+#define	TIMER_WHEEL_LEVELS			4
+#define	TIMER_WHEEL_MAX_TICKS		((1 << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+class CTimerWheel;
+
+// A timer that can be set on a CTimerWheel.  The timer is linked into the wheel's
+// slots directly, so setting and killing timers never allocates, and destroying a
+// timer removes it from its wheel.
+class CWheelTimer
+{
+	friend class CTimerWheel;
+
+private:
+	CTimerWheel* m_pWheel;
+	CWheelTimer* m_pNext;
+	CWheelTimer** m_ppLink;		// The pointer that links to this timer
+	DWORD m_nDue;
+	BOOL m_fExpired;			// Waiting to be taken with CTimerWheel::TakeExpired()
+
+public:
+	CWheelTimer ();
+	virtual ~CWheelTimer ();
+
+	inline BOOL IsTimerSet (VOID) const { return NULL != m_pWheel; }
+
+	// Returns zero if the timer isn't set or has expired.
+	DWORD GetTimerRemaining (VOID) const;
+
+	VOID KillTimer (VOID);
+};
+
+// Hierarchical timer wheel, counted in game ticks.  Each level has 64 slots, and each
+// slot of a level spans all 64 slots of the level below it.  Timers due in the next
+// 64 ticks wait in the first level; later timers wait in a higher level until it
+// comes round, and are then moved down.  Setting a timer is constant time, and
+// advancing the wheel only touches the timers that are due or being moved down.
+class CTimerWheel
+{
+	friend class CWheelTimer;
+
+private:
+	CWheelTimer* m_rgSlots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+	CWheelTimer* m_pExpired;
+	DWORD m_nNow;
+	sysint m_cTimers;
+
+public:
+	CTimerWheel ();
+	~CTimerWheel ();
+
+	inline DWORD GetTime (VOID) const { return m_nNow; }
+	inline sysint Length (VOID) const { return m_cTimers; }
+
+	// Replaces any time already set on pTimer.  The timer expires once the wheel has
+	// advanced cTicks, which is at least one and at most TIMER_WHEEL_MAX_TICKS.
+	VOID Set (CWheelTimer* pTimer, DWORD cTicks);
+
+	// Moves the wheel forward one tick at a time until it reaches nNow.  The timers
+	// that expire are kept, in the order they expired, until they're taken with
+	// TakeExpired().
+	VOID AdvanceTo (DWORD nNow);
+
+	// Removes and returns the next expired timer, or NULL if none are left.
+	CWheelTimer* TakeExpired (VOID);
+
+	// Kills every timer, including expired timers that haven't been taken.
+	VOID Clear (VOID);
+
+private:
+	VOID Insert (CWheelTimer* pTimer);
+	VOID Cascade (INT nLevel, INT idxSlot);
+	static VOID Link (CWheelTimer** ppHead, CWheelTimer* pTimer);
+	static VOID Unlink (CWheelTimer* pTimer);
+};
@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <windows.h>
+#include "Library\Core\CoreDefs.h"
+#include "TimerWheel.h"
+
+// Deterministic checks for CTimerWheel.  The wheel is driven by a fake tick counter
+// instead of the game clock, with a fixed pseudo-random sequence of sets, kills and
+// jumps of the clock, and every expiry is compared with a model that only records each
+// timer's due tick.  It isn't part of the game's project; build it as a console
+// program from this directory:
+//
+//	cl /nologo /W3 /EHsc /I..\..\..\shared TimerWheelTest.cpp TimerWheel.cpp
+
+#define	TEST_SEEDS			40
+#define	TEST_TIMERS			300
+#define	TEST_STEPS			4000
+
+#define	TEST_EXPECT(x)		Expect(!!(x), #x, __LINE__)
+
+class CTestTimer : public CWheelTimer
+{
+public:
+	INT m_nId;
+};
+
+// The model's view of one timer
+struct TIMER_MODEL
+{
+	BOOL fSet;
+	DWORD nDue;
+};
+
+static INT s_cFailures;
+
+static VOID Expect (BOOL fCondition, PCSTR pcszCondition, INT nLine)
+{
+	if(!fCondition)
+	{
+		if(20 > s_cFailures)
+			wprintf(L"FAILED (line %d): %hs\r\n", nLine, pcszCondition);
+		s_cFailures++;
+	}
+}
+
+static DWORD NextRandom (DWORD* pnState)
+{
+	DWORD n = *pnState;
+	n ^= n << 13;
+	n ^= n >> 17;
+	n ^= n << 5;
+	*pnState = n;
+	return n;
+}
+
+// Signed distance from nFrom to nTo, which stays correct when the tick count wraps
+static inline LONG TickDelta (DWORD nFrom, DWORD nTo)
+{
+	return static_cast<LONG>(nTo - nFrom);
+}
+
+static VOID TestBasics (VOID)
+{
+	CTimerWheel wheel;
+	CTestTimer timerA, timerB, timerC;
+
+	wheel.Set(&timerA, 5);
+	TEST_EXPECT(timerA.IsTimerSet());
+	TEST_EXPECT(5 == timerA.GetTimerRemaining());
+	TEST_EXPECT(1 == wheel.Length());
+
+	wheel.AdvanceTo(4);
+	TEST_EXPECT(NULL == wheel.TakeExpired());
+	TEST_EXPECT(1 == timerA.GetTimerRemaining());
+
+	// An expired timer stays set until it's taken, but isn't counted or pending.
+	wheel.AdvanceTo(5);
+	TEST_EXPECT(timerA.IsTimerSet());
+	TEST_EXPECT(0 == timerA.GetTimerRemaining());
+	TEST_EXPECT(0 == wheel.Length());
+	TEST_EXPECT(&timerA == wheel.TakeExpired());
+	TEST_EXPECT(!timerA.IsTimerSet());
+	TEST_EXPECT(NULL == wheel.TakeExpired());
+
+	// Zero ticks means the next tick.
+	wheel.Set(&timerA, 0);
+	wheel.AdvanceTo(6);
+	TEST_EXPECT(&timerA == wheel.TakeExpired());
+
+	// Destroying a timer removes it from the wheel.
+	{
+		CTestTimer timerScoped;
+		wheel.Set(&timerScoped, 100);
+		TEST_EXPECT(1 == wheel.Length());
+	}
+	TEST_EXPECT(0 == wheel.Length());
+	wheel.AdvanceTo(200);
+	TEST_EXPECT(NULL == wheel.TakeExpired());
+
+	// Killing or setting again an expired timer that hasn't been taken.
+	wheel.Set(&timerA, 1);
+	wheel.Set(&timerB, 1);
+	wheel.AdvanceTo(201);
+	timerA.KillTimer();
+	TEST_EXPECT(0 == wheel.Length());
+	wheel.Set(&timerB, 10);
+	TEST_EXPECT(1 == wheel.Length());
+	TEST_EXPECT(NULL == wheel.TakeExpired());
+	TEST_EXPECT(10 == timerB.GetTimerRemaining());
+
+	// A long jump of the clock still expires everything due on the way.
+	wheel.Set(&timerC, 3);
+	wheel.AdvanceTo(1000);
+	TEST_EXPECT(NULL != wheel.TakeExpired());
+	TEST_EXPECT(NULL != wheel.TakeExpired());
+	TEST_EXPECT(NULL == wheel.TakeExpired());
+
+	// Times beyond the wheel's range are clamped.
+	wheel.Set(&timerA, 0xFFFFFFFF);
+	TEST_EXPECT(TIMER_WHEEL_MAX_TICKS == timerA.GetTimerRemaining());
+
+	// Clear() kills pending and expired timers.
+	wheel.Set(&timerB, 1);
+	wheel.AdvanceTo(1001);
+	wheel.Clear();
+	TEST_EXPECT(!timerA.IsTimerSet());
+	TEST_EXPECT(!timerB.IsTimerSet());
+	TEST_EXPECT(0 == wheel.Length());
+	TEST_EXPECT(NULL == wheel.TakeExpired());
+}
+
+static DWORD RandomTicks (DWORD* pnState)
+{
+	// Spread the times over every level of the wheel.
+	switch(NextRandom(pnState) % 4)
+	{
+	case 0:
+		return NextRandom(pnState) % 70;
+	case 1:
+		return NextRandom(pnState) % 5000;
+	case 2:
+		return NextRandom(pnState) % 300000;
+	}
+	return NextRandom(pnState) % 20000000;
+}
+
+static VOID TestAgainstModel (DWORD nSeed)
+{
+	CTimerWheel wheel;
+	CTestTimer rgTimers[TEST_TIMERS];
+	TIMER_MODEL rgModel[TEST_TIMERS];
+	DWORD nState = nSeed * 2654435761UL + 1;
+	DWORD nNow = 0;
+	sysint cSet = 0;
+
+	for(INT i = 0; i < TEST_TIMERS; i++)
+	{
+		rgTimers[i].m_nId = i;
+		rgModel[i].fSet = FALSE;
+		rgModel[i].nDue = 0;
+	}
+
+	// Half of the runs start just before the tick count wraps.
+	if(nSeed & 1)
+	{
+		nNow = 0xFFFFFF00 - nSeed * 977;
+		wheel.AdvanceTo(nNow);
+	}
+
+	for(INT nStep = 0; nStep < TEST_STEPS; nStep++)
+	{
+		DWORD nOp = NextRandom(&nState) % 10;
+
+		if(4 > nOp)
+		{
+			INT idxTimer = static_cast<INT>(NextRandom(&nState) % TEST_TIMERS);
+			DWORD cTicks = RandomTicks(&nState);
+
+			wheel.Set(rgTimers + idxTimer, cTicks);
+
+			if(0 == cTicks)
+				cTicks = 1;
+			else if(TIMER_WHEEL_MAX_TICKS < cTicks)
+				cTicks = TIMER_WHEEL_MAX_TICKS;
+			if(!rgModel[idxTimer].fSet)
+				cSet++;
+			rgModel[idxTimer].fSet = TRUE;
+			rgModel[idxTimer].nDue = nNow + cTicks;
+		}
+		else if(5 > nOp)
+		{
+			INT idxTimer = static_cast<INT>(NextRandom(&nState) % TEST_TIMERS);
+
+			rgTimers[idxTimer].KillTimer();
+			if(rgModel[idxTimer].fSet)
+				cSet--;
+			rgModel[idxTimer].fSet = FALSE;
+		}
+		else
+		{
+			DWORD nTarget = nNow + ((0 == NextRandom(&nState) % 4) ? NextRandom(&nState) % 200000 : NextRandom(&nState) % 100);
+			CWheelTimer* pTimer;
+			DWORD nPrevDue = nNow;
+
+			wheel.AdvanceTo(nTarget);
+			TEST_EXPECT(nTarget == wheel.GetTime());
+
+			// Timers come out in the order they were due, and only once they're due.
+			while(NULL != (pTimer = wheel.TakeExpired()))
+			{
+				TIMER_MODEL* pModel = rgModel + static_cast<CTestTimer*>(pTimer)->m_nId;
+
+				TEST_EXPECT(pModel->fSet);
+				TEST_EXPECT(0 < TickDelta(nNow, pModel->nDue) && 0 >= TickDelta(nTarget, pModel->nDue));
+				TEST_EXPECT(0 <= TickDelta(nPrevDue, pModel->nDue));
+				TEST_EXPECT(!pTimer->IsTimerSet());
+
+				nPrevDue = pModel->nDue;
+				pModel->fSet = FALSE;
+				cSet--;
+			}
+			nNow = nTarget;
+
+			for(INT i = 0; i < TEST_TIMERS; i++)
+			{
+				TEST_EXPECT(rgModel[i].fSet == rgTimers[i].IsTimerSet());
+				if(rgModel[i].fSet)
+				{
+					TEST_EXPECT(0 < TickDelta(nNow, rgModel[i].nDue));
+					TEST_EXPECT(rgModel[i].nDue - nNow == rgTimers[i].GetTimerRemaining());
+				}
+			}
+			TEST_EXPECT(cSet == wheel.Length());
+		}
+	}
+}
+
+INT wmain (INT cArgs, WCHAR* pwzArgs[])
+{
+	UNREFERENCED_PARAMETER(cArgs);
+	UNREFERENCED_PARAMETER(pwzArgs);
+
+	TestBasics();
+	for(DWORD nSeed = 0; nSeed < TEST_SEEDS; nSeed++)
+		TestAgainstModel(nSeed);
+
+	if(0 == s_cFailures)
+		wprintf(L"All CTimerWheel tests passed\r\n");
+	else
+		wprintf(L"%d CTimerWheel checks failed\r\n", s_cFailures);
+
+	return 0 == s_cFailures ? 0 : 1;
+}
@@ -1,5 +1,6 @@
 #include <windows.h>
 #include "Library\Core\CoreDefs.h"
+#include "Library\Util\StreamHelpers.h"
 #include "SIFPackage.h"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -85,10 +86,11 @@ HRESULT CSIFPackage::OpenPackage (PCWSTR pcwzPackage)
 {
 	HRESULT hr;
 	CHAR szSignature[4], *pszDir = NULL;
+	PWSTR pwzDir = NULL;
 	ULONG cb, cbDir;
+	INT cchDir;
 	FILETIME ft;
 	LARGE_INTEGER liDir;
-	RSTRING rstrDirW = NULL;
 	TStackRef<IJSONValue> srv;
 
 	Check(CFileStream::Open(pcwzPackage, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL, &m_pPackage, &m_uliSize));
@@ -106,9 +108,23 @@ HRESULT CSIFPackage::OpenPackage (PCWSTR pcwzPackage)
 	CheckAlloc(pszDir);
 
 	Check(m_pPackage->Read(pszDir, cbDir, &cb));
-	Check(RStrConvertToW(CP_UTF8, cbDir, pszDir, &rstrDirW));
 
-	Check(JSONParseWithDictionary(NULL, NULL, RStrToWide(rstrDirW), RStrLen(rstrDirW), &srv));
+	// The directory is almost entirely ASCII, so decode it straight into a buffer
+	// sized for the worst case rather than measuring it first.
+	pwzDir = __new WCHAR[cbDir + 1];
+	CheckAlloc(pwzDir);
+	hr = Stream::Utf8ToUtf16(pszDir, cbDir, pwzDir, cbDir, &cchDir);
+	if(HRESULT_FROM_WIN32(ERROR_NO_UNICODE_TRANSLATION) == hr)
+	{
+		// Malformed UTF-8 is left to the system, which substitutes replacement characters.
+		cchDir = MultiByteToWideChar(CP_UTF8, 0, pszDir, static_cast<INT>(cbDir), pwzDir, static_cast<INT>(cbDir));
+		CheckIfGetLastError(0 == cchDir);
+	}
+	else
+		Check(hr);
+	pwzDir[cchDir] = L'\0';
+
+	Check(JSONParseWithDictionary(NULL, NULL, pwzDir, cchDir, &srv));
 	CheckIf(NULL == srv, HRESULT_FROM_WIN32(ERROR_EMPTY));
 	Check(srv->GetArray(&m_pDirectory));
 
@@ -117,7 +133,7 @@ HRESULT CSIFPackage::OpenPackage (PCWSTR pcwzPackage)
 	Check(RStrCreateW(LSP(L"data"), &m_rstrData));
 
 Cleanup:
-	RStrRelease(rstrDirW);
+	SafeDeleteArray(pwzDir);
 	SafeDeleteArray(pszDir);
 	return hr;
 }
@@ -1917,10 +1917,9 @@ Cleanup:
 HRESULT CCombatScreen::StartMovingAction (INT xTile, INT yTile)
 {
 	HRESULT hr;
-	CAStar2D aStar;
+	CAStar2D aStar(&m_PathContext);
 	CMoveUnitAction* pAction = NULL;
 
-	Check(aStar.PreInit());
 	Check(aStar.FindPath(m_pSelected->m_xTile, m_pSelected->m_yTile, xTile, yTile, 64, this));
 
 	pAction = __new CMoveUnitAction(this, m_pMain, &m_Isometric, m_pSelected);
@@ -330,6 +330,7 @@ protected:
 	TRStrMap<CTileSet*> m_mapCombatTiles;
 
 	CIsometricTranslator m_Isometric;
+	CPathContext m_PathContext;
 
 	IJSONObject* m_pWizard;
 	IJSONObject* m_pPlacements;
@@ -11,6 +11,16 @@
 	#define	sysint	_W64 INT
 #endif
 
+// SSE2
+//
+// CORE_SSE2 is defined when SSE2 instructions can be used without checking the
+// processor: always on x64, and on x86 when the compiler targets SSE2 (/arch:SSE2 or
+// later).  Code using it includes <emmintrin.h> itself.
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define	CORE_SSE2
+#endif
+
 // Memory Management
 //
 // Instead of using new and delete, __new and __delete should be used.  Instead of
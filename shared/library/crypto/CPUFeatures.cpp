@@ -0,0 +1,109 @@
+#include <windows.h>
+#include <intrin.h>
+#include "CPUFeatures.h"
+
+#ifdef	CPUFEATURES_SSE2
+
+namespace CPUFeatures
+{
+	BOOL HasSSE2 (VOID)
+	{
+#ifdef	_M_X64
+		return TRUE;
+#else
+		static LONG s_nSSE2 = -1;
+		if(-1 == s_nSSE2)
+			s_nSSE2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE) ? 1 : 0;
+		return 1 == s_nSSE2;
+#endif
+	}
+
+	BOOL HasAVX2 (VOID)
+	{
+#ifdef	CPUFEATURES_AVX2
+		static LONG s_nAVX2 = -1;
+		if(-1 == s_nAVX2)
+		{
+			INT rgRegs[4];
+			LONG nAVX2 = 0;
+
+			__cpuid(rgRegs, 0);
+			if(7 <= rgRegs[0])
+			{
+				// The OS must save the YMM registers (OSXSAVE, AVX, XCR0 bits 1 and 2).
+				__cpuid(rgRegs, 1);
+				if((rgRegs[2] & (1 << 27)) && (rgRegs[2] & (1 << 28)) && 6 == (_xgetbv(0) & 6))
+				{
+					__cpuidex(rgRegs, 7, 0);
+					if(rgRegs[1] & (1 << 5))
+						nAVX2 = 1;
+				}
+			}
+
+			s_nAVX2 = nAVX2;
+		}
+		return 1 == s_nAVX2;
+#else
+		return FALSE;
+#endif
+	}
+
+	BOOL HasSHA (VOID)
+	{
+#ifdef	CPUFEATURES_SHA
+		static LONG s_nSHA = -1;
+		if(-1 == s_nSHA)
+		{
+			INT rgRegs[4];
+			LONG nSHA = 0;
+
+			__cpuid(rgRegs, 0);
+			if(7 <= rgRegs[0])
+			{
+				// SSSE3 and SSE4.1 are used to shuffle the message and state words.
+				__cpuid(rgRegs, 1);
+				if((rgRegs[2] & (1 << 9)) && (rgRegs[2] & (1 << 19)))
+				{
+					__cpuidex(rgRegs, 7, 0);
+					if(rgRegs[1] & (1 << 29))
+						nSHA = 1;
+				}
+			}
+
+			s_nSHA = nSHA;
+		}
+		return 1 == s_nSHA;
+#else
+		return FALSE;
+#endif
+	}
+}
+
+#else
+
+namespace CPUFeatures
+{
+	BOOL HasSSE2 (VOID)
+	{
+		return FALSE;
+	}
+
+	BOOL HasAVX2 (VOID)
+	{
+		return FALSE;
+	}
+
+	BOOL HasSHA (VOID)
+	{
+#ifdef	CPUFEATURES_SHA
+		static LONG s_nSHA = -1;
+		if(-1 == s_nSHA)
+			s_nSHA = IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE) ? 1 : 0;
+		return 1 == s_nSHA;
+#else
+		return FALSE;
+#endif
+	}
+}
+
+#endif
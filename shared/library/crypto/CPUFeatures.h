@@ -0,0 +1,31 @@
+#pragma once
+
+// Runtime detection of the instruction set extensions used by the accelerated
+// digest implementations.  Each query is evaluated once and then cached.
+
+#if defined(_M_IX86) || defined(_M_X64)
+	#define	CPUFEATURES_SSE2
+
+	// _xgetbv() and __cpuidex() first shipped with Visual Studio 2010 SP1, and the
+	// AVX2 intrinsics used by the digests require Visual Studio 2012.
+	#if _MSC_VER >= 1700
+		#define	CPUFEATURES_AVX2
+	#endif
+
+	// The SHA-NI intrinsics require Visual Studio 2015.
+	#if _MSC_VER >= 1900
+		#define	CPUFEATURES_SHA
+	#endif
+#elif defined(_M_ARM64)
+	// ARMv8 cryptography extensions (SHA1 and SHA2 instructions)
+	#define	CPUFEATURES_SHA
+#endif
+
+namespace CPUFeatures
+{
+	BOOL HasSSE2 (VOID);
+	BOOL HasAVX2 (VOID);
+
+	// SHA-NI with SSSE3 and SSE4.1 on x86, or the ARMv8 SHA1/SHA2 instructions
+	BOOL HasSHA (VOID);
+}
@@ -0,0 +1,231 @@
+#include <windows.h>
+#include "..\Core\CoreDefs.h"
+#include "MD4.h"
+#include "HMAC.h"
+#include "DigestBenchmark.h"
+
+#define	DIGEST_BENCHMARK_MIN_MESSAGE	16
+#define	DIGEST_BENCHMARK_MAX_MESSAGE	(64 * 1024 * 1024)
+#define	DIGEST_BENCHMARK_MAX_DIGEST		64
+
+// Chunk sizes used for the streamed runs.  The odd size keeps the digests' internal
+// buffering busy, while the larger size matches a typical file read.
+static const UINT c_rgStreamChunks[] = { 61, 4096 };
+
+static const BENCHMARK_COLUMN c_rgColumns[] =
+{
+	{ "digest", "digest", BENCHMARK_COLUMN_STRING, offsetof(DIGEST_BENCHMARK_RESULT, pcszName) },
+	{ "message_bytes", "messageBytes", BENCHMARK_COLUMN_SIZE, offsetof(DIGEST_BENCHMARK_RESULT, cbMessage) },
+	{ "chunk_bytes", "chunkBytes", BENCHMARK_COLUMN_UINT, offsetof(DIGEST_BENCHMARK_RESULT, cbChunk) },
+	{ "iterations", "iterations", BENCHMARK_COLUMN_ULONGLONG, offsetof(DIGEST_BENCHMARK_RESULT, cIterations) },
+	{ "mb_per_second", "mbPerSecond", BENCHMARK_COLUMN_DOUBLE, offsetof(DIGEST_BENCHMARK_RESULT, dblMBPerSecond) },
+	{ "cycles_per_byte", "cyclesPerByte", BENCHMARK_COLUMN_DOUBLE, offsetof(DIGEST_BENCHMARK_RESULT, dblCyclesPerByte) }
+};
+
+class CDigestBenchmark::CWorkload : public IBenchmarkWorkload
+{
+public:
+	CMessageDigest* m_pDigest;
+	CHmac* m_pHmac;
+	const BYTE* m_pcbKey;
+	INT m_cbKey;
+	const BYTE* m_pcbMessage;
+	SIZE_T m_cbMessage;
+	UINT m_cbChunk;
+
+	virtual HRESULT RunBatch (ULONGLONG cIterations);
+};
+
+HRESULT CDigestBenchmark::CWorkload::RunBatch (ULONGLONG cIterations)
+{
+	BYTE rgDigest[DIGEST_BENCHMARK_MAX_DIGEST];
+
+	for(ULONGLONG n = 0; n < cIterations; n++)
+	{
+		if(m_pHmac)
+		{
+			if(m_pcbKey)
+				m_pHmac->HmacInitRfc2104(m_pcbKey, m_cbKey);
+			else
+				m_pHmac->ResetToKey();
+		}
+		else
+			m_pDigest->Reset();
+
+		if(0 == m_cbChunk || m_cbChunk >= m_cbMessage)
+			m_pDigest->AddData(m_pcbMessage, static_cast<UINT>(m_cbMessage));
+		else
+		{
+			for(SIZE_T cbOffset = 0; cbOffset < m_cbMessage; cbOffset += m_cbChunk)
+			{
+				SIZE_T cbRemaining = m_cbMessage - cbOffset;
+				m_pDigest->AddData(m_pcbMessage + cbOffset, static_cast<UINT>(min(cbRemaining, m_cbChunk)));
+			}
+		}
+
+		m_pDigest->GetDigest(rgDigest);
+	}
+
+	return S_OK;
+}
+
+CDigestBenchmark::CDigestBenchmark (DWORD msMinimum) :
+	m_pbMessage(NULL),
+	m_cbMessage(0),
+	m_msMinimum(msMinimum)
+{
+}
+
+CDigestBenchmark::~CDigestBenchmark ()
+{
+	__delete_array m_pbMessage;
+}
+
+HRESULT CDigestBenchmark::Run (PCSTR pcszName, CMessageDigest* pDigest, SIZE_T cbMessage, UINT cbChunk)
+{
+	return Measure(pcszName, pDigest, NULL, NULL, 0, cbMessage, cbChunk);
+}
+
+HRESULT CDigestBenchmark::RunHmac (PCSTR pcszName, CHmac* pHmac, const BYTE* pcbKey, INT cbKey, SIZE_T cbMessage, UINT cbChunk)
+{
+	return Measure(pcszName, pHmac, pHmac, pcbKey, cbKey, cbMessage, cbChunk);
+}
+
+HRESULT CDigestBenchmark::RunStandardSuite (VOID)
+{
+	HRESULT hr;
+	BYTE rgKey[32];
+	CMd4 md4;
+	CMd5 md5;
+	CSHA1 sha1;
+	CSHA256 sha256;
+	CSHA3 sha3_224(224), sha3_256(256), sha3_384(384), sha3_512(512);
+	CSHA3 keccak256(256, true);
+	CShake shake128(128), shake256(256);
+	CWhirlpool whirlpool;
+	CHmacMd5 hmacMd5;
+	CHmacSHA1 hmacSHA1;
+	CHmacSHA256 hmacSHA256;
+	CHmacSHA3 hmacSHA3(256);
+	CHmacWhirlpool hmacWhirlpool;
+
+	for(INT i = 0; i < ARRAYSIZE(rgKey); i++)
+		rgKey[i] = static_cast<BYTE>(i * 7 + 1);
+
+	Check(RunSizes("MD4", &md4, NULL, NULL, 0));
+	Check(RunSizes("MD5", &md5, NULL, NULL, 0));
+	Check(RunSizes("SHA-1", &sha1, NULL, NULL, 0));
+	Check(RunSizes("SHA-256", &sha256, NULL, NULL, 0));
+	Check(RunSizes("SHA3-224", &sha3_224, NULL, NULL, 0));
+	Check(RunSizes("SHA3-256", &sha3_256, NULL, NULL, 0));
+	Check(RunSizes("SHA3-384", &sha3_384, NULL, NULL, 0));
+	Check(RunSizes("SHA3-512", &sha3_512, NULL, NULL, 0));
+	Check(RunSizes("Keccak-256", &keccak256, NULL, NULL, 0));
+	Check(RunSizes("SHAKE128", &shake128, NULL, NULL, 0));
+	Check(RunSizes("SHAKE256", &shake256, NULL, NULL, 0));
+	Check(RunSizes("Whirlpool", &whirlpool, NULL, NULL, 0));
+
+	Check(RunSizes("HMAC-MD5", &hmacMd5, &hmacMd5, rgKey, ARRAYSIZE(rgKey)));
+	Check(RunSizes("HMAC-SHA-1", &hmacSHA1, &hmacSHA1, rgKey, ARRAYSIZE(rgKey)));
+	Check(RunSizes("HMAC-SHA-256", &hmacSHA256, &hmacSHA256, rgKey, ARRAYSIZE(rgKey)));
+	Check(RunSizes("HMAC-SHA3-256", &hmacSHA3, &hmacSHA3, rgKey, ARRAYSIZE(rgKey)));
+	Check(RunSizes("HMAC-Whirlpool", &hmacWhirlpool, &hmacWhirlpool, rgKey, ARRAYSIZE(rgKey)));
+
+	// The same HMACs again, but reusing the precomputed key state for every message.
+	Check(RunSizes("HMAC-MD5 (keyed)", &hmacMd5, &hmacMd5, NULL, 0));
+	Check(RunSizes("HMAC-SHA-1 (keyed)", &hmacSHA1, &hmacSHA1, NULL, 0));
+	Check(RunSizes("HMAC-SHA-256 (keyed)", &hmacSHA256, &hmacSHA256, NULL, 0));
+	Check(RunSizes("HMAC-SHA3-256 (keyed)", &hmacSHA3, &hmacSHA3, NULL, 0));
+	Check(RunSizes("HMAC-Whirlpool (keyed)", &hmacWhirlpool, &hmacWhirlpool, NULL, 0));
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CDigestBenchmark::Write (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat)
+{
+	return Benchmark::TWrite(pStream, eFormat, c_rgColumns, m_aResults);
+}
+
+HRESULT CDigestBenchmark::EnsureMessage (SIZE_T cbMessage)
+{
+	HRESULT hr = S_FALSE;
+
+	if(cbMessage > m_cbMessage)
+	{
+		PBYTE pbMessage = __new BYTE[cbMessage];
+		CheckAlloc(pbMessage);
+
+		// Fill with a cheap, repeatable pattern so every run hashes the same data.
+		ULONG nSeed = 0x2545F491;
+		for(SIZE_T i = 0; i < cbMessage; i++)
+		{
+			nSeed = nSeed * 1664525 + 1013904223;
+			pbMessage[i] = static_cast<BYTE>(nSeed >> 24);
+		}
+
+		__delete_array m_pbMessage;
+		m_pbMessage = pbMessage;
+		m_cbMessage = cbMessage;
+		hr = S_OK;
+	}
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CDigestBenchmark::Measure (PCSTR pcszName, CMessageDigest* pDigest, CHmac* pHmac, const BYTE* pcbKey, INT cbKey, SIZE_T cbMessage, UINT cbChunk)
+{
+	HRESULT hr;
+	CWorkload workload;
+	BENCHMARK_TIMING timing;
+	DIGEST_BENCHMARK_RESULT* pResult;
+
+	CheckIf(NULL == pDigest || 0 == cbMessage || cbMessage > UINT_MAX, E_INVALIDARG);
+	CheckIf(pDigest->GetDigestSize() > DIGEST_BENCHMARK_MAX_DIGEST, E_UNEXPECTED);
+	Check(EnsureMessage(cbMessage));
+
+	workload.m_pDigest = pDigest;
+	workload.m_pHmac = pHmac;
+	workload.m_pcbKey = pcbKey;
+	workload.m_cbKey = cbKey;
+	workload.m_pcbMessage = m_pbMessage;
+	workload.m_cbMessage = cbMessage;
+	workload.m_cbChunk = cbChunk;
+	Check(Benchmark::Measure(&workload, m_msMinimum, &timing));
+
+	Check(m_aResults.AppendSlot(&pResult));
+	pResult->pcszName = pcszName;
+	pResult->cbMessage = cbMessage;
+	pResult->cbChunk = cbChunk;
+	pResult->cIterations = timing.cIterations;
+
+	{
+		DOUBLE dblBytes = static_cast<DOUBLE>(timing.cIterations) * static_cast<DOUBLE>(cbMessage);
+
+		pResult->dblMBPerSecond = dblBytes / (1024.0 * 1024.0) / timing.dblSeconds;
+		pResult->dblCyclesPerByte = static_cast<DOUBLE>(timing.cCycles) / dblBytes;
+	}
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CDigestBenchmark::RunSizes (PCSTR pcszName, CMessageDigest* pDigest, CHmac* pHmac, const BYTE* pcbKey, INT cbKey)
+{
+	HRESULT hr = S_OK;
+
+	for(SIZE_T cbMessage = DIGEST_BENCHMARK_MIN_MESSAGE; cbMessage <= DIGEST_BENCHMARK_MAX_MESSAGE; cbMessage <<= 2)
+	{
+		Check(Measure(pcszName, pDigest, pHmac, pcbKey, cbKey, cbMessage, 0));
+
+		for(INT i = 0; i < ARRAYSIZE(c_rgStreamChunks); i++)
+		{
+			if(cbMessage > c_rgStreamChunks[i])
+				Check(Measure(pcszName, pDigest, pHmac, pcbKey, cbKey, cbMessage, c_rgStreamChunks[i]));
+		}
+	}
+
+Cleanup:
+	return hr;
+}
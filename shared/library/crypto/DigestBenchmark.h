@@ -0,0 +1,55 @@
+#pragma once
+
+#include "..\Core\Array.h"
+#include "..\Util\Benchmark.h"
+#include "MessageDigest.h"
+
+class CHmac;
+
+// Throughput measurements for the CMessageDigest implementations.  Each configuration
+// is repeated until at least the minimum measuring time has elapsed, and the results
+// can be written to a stream as CSV or JSON so runs can be compared across builds.
+
+struct DIGEST_BENCHMARK_RESULT
+{
+	PCSTR pcszName;
+	SIZE_T cbMessage;
+	UINT cbChunk;				// Zero when the whole message is added in one call
+	ULONGLONG cIterations;
+	DOUBLE dblMBPerSecond;
+	DOUBLE dblCyclesPerByte;	// Zero when no cycle counter is available
+};
+
+class CDigestBenchmark
+{
+private:
+	class CWorkload;
+
+	TArray<DIGEST_BENCHMARK_RESULT> m_aResults;
+	PBYTE m_pbMessage;
+	SIZE_T m_cbMessage;
+	DWORD m_msMinimum;
+
+public:
+	CDigestBenchmark (DWORD msMinimum = 200);
+	~CDigestBenchmark ();
+
+	HRESULT Run (PCSTR pcszName, CMessageDigest* pDigest, SIZE_T cbMessage, UINT cbChunk);
+
+	// With a NULL key, every message restarts from the HMAC's current key state.
+	HRESULT RunHmac (PCSTR pcszName, CHmac* pHmac, const BYTE* pcbKey, INT cbKey, SIZE_T cbMessage, UINT cbChunk);
+
+	// Every digest and HMAC in this directory, 16 bytes to 64 MB, one-shot and streamed
+	HRESULT RunStandardSuite (VOID);
+
+	HRESULT Write (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat);
+
+	inline sysint Length (VOID) const { return m_aResults.Length(); }
+	inline const DIGEST_BENCHMARK_RESULT* GetResult (sysint n) const { return &m_aResults[n]; }
+	inline VOID Clear (VOID) { m_aResults.Clear(); }
+
+private:
+	HRESULT EnsureMessage (SIZE_T cbMessage);
+	HRESULT Measure (PCSTR pcszName, CMessageDigest* pDigest, CHmac* pHmac, const BYTE* pcbKey, INT cbKey, SIZE_T cbMessage, UINT cbChunk);
+	HRESULT RunSizes (PCSTR pcszName, CMessageDigest* pDigest, CHmac* pHmac, const BYTE* pcbKey, INT cbKey);
+};
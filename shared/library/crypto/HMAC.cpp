@@ -23,9 +23,14 @@ VOID CHmac::HmacInitMicrosoft (const BYTE* pcbKey, INT cKey)
 	HmacInitialize(pcbKey, cKey);
 }
 
+VOID CHmac::ResetToKey (VOID)
+{
+	CopyState(m_pHash, m_pInner);
+}
+
 VOID CHmac::Reset (VOID)
 {
-	m_pHash->Reset();
+	ResetToKey();
 }
 
 VOID CHmac::AddData (const BYTE* pcbData, UINT cData)
@@ -38,6 +43,18 @@ UINT CHmac::GetDigestSize (VOID)
 	return m_pHash->GetDigestSize();
 }
 
+VOID CHmac::GetDigest (LPBYTE lpDigest)
+{
+	UINT cbDigest = m_pHash->GetDigestSize();
+
+	m_pHash->GetDigest(lpDigest);
+
+	// The outer hash is finished in its own state, so the message can continue.
+	CopyState(m_pFinal, m_pOuter);
+	m_pFinal->AddData(lpDigest, cbDigest);
+	m_pFinal->GetDigest(lpDigest);
+}
+
 UINT CHmac::GetHexKeySize (VOID)
 {
 	return m_pHash->GetHexKeySize();
@@ -62,33 +79,29 @@ VOID CHmac::GetHexKey (LPSTR lpszKey)
 
 VOID CHmac::HmacInitialize (const BYTE* pcbKey, INT cKey)
 {
-	BYTE kipad[HMAC_PAD_SIZE];
+	BYTE rgPad[HMAC_PAD_SIZE];
 	INT i;
 
-	Assert(cKey <= sizeof(kipad));
+	Assert(cKey <= sizeof(rgPad));
 
-	// Zero from cKey to the end
-	for(i = cKey; i < HMAC_PAD_SIZE; i++)
-	{
-		kipad[i] = 0;
-		m_kopad[i] = 0;
-	}
-
-	// Copy the key data
 	for(i = 0; i < cKey; i++)
-	{
-		kipad[i] = pcbKey[i];
-		m_kopad[i] = pcbKey[i];
-	}
+		rgPad[i] = pcbKey[i] ^ 0x36;
+	for(; i < HMAC_PAD_SIZE; i++)
+		rgPad[i] = 0x36;
 
+	m_pInner->Reset();
+	m_pInner->AddData(rgPad, sizeof(rgPad));
+
+	// Switch from ipad to opad without going back to the key.
 	for(i = 0; i < HMAC_PAD_SIZE; i++)
-	{
-		kipad[i] ^= 0x36;
-		m_kopad[i] ^= 0x5c;
-	}
+		rgPad[i] ^= 0x36 ^ 0x5c;
+
+	m_pOuter->Reset();
+	m_pOuter->AddData(rgPad, sizeof(rgPad));
 
-	Reset();
-	AddData(kipad, sizeof(kipad));
+	SecureZeroMemory(rgPad, sizeof(rgPad));
+
+	ResetToKey();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -98,6 +111,9 @@ VOID CHmac::HmacInitialize (const BYTE* pcbKey, INT cKey)
 CHmacMd5::CHmacMd5 ()
 {
 	m_pHash = &m_md5;
+	m_pInner = &m_md5Inner;
+	m_pOuter = &m_md5Outer;
+	m_pFinal = &m_md5Final;
 }
 
 VOID CHmacMd5::HmacInitRfc2104 (const BYTE* pcbKey, INT cKey)
@@ -118,15 +134,25 @@ VOID CHmacMd5::HmacInitRfc2104 (const BYTE* pcbKey, INT cKey)
 	HmacInitialize(pcbKey, cKey);
 }
 
-VOID CHmacMd5::GetDigest (LPBYTE lpDigest)
+HRESULT CHmacMd5::Clone (__deref_out CHmac** ppHmac)
 {
-	CMd5 Outer;
-
-	m_md5.GetDigest(lpDigest);
+	HRESULT hr;
+	CHmacMd5* pClone = __new CHmacMd5;
+
+	CheckAlloc(pClone);
+	pClone->m_md5 = m_md5;
+	pClone->m_md5Inner = m_md5Inner;
+	pClone->m_md5Outer = m_md5Outer;
+	*ppHmac = pClone;
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
 
-	Outer.AddData(m_kopad, sizeof(m_kopad));
-	Outer.AddData(lpDigest, 16);
-	Outer.GetDigest(lpDigest);
+VOID CHmacMd5::CopyState (CMessageDigest* pDest, const CMessageDigest* pcSrc)
+{
+	*static_cast<CMd5*>(pDest) = *static_cast<const CMd5*>(pcSrc);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -136,6 +162,9 @@ VOID CHmacMd5::GetDigest (LPBYTE lpDigest)
 CHmacSHA1::CHmacSHA1 ()
 {
 	m_pHash = &m_sha1;
+	m_pInner = &m_sha1Inner;
+	m_pOuter = &m_sha1Outer;
+	m_pFinal = &m_sha1Final;
 }
 
 VOID CHmacSHA1::HmacInitRfc2104 (const BYTE* pcbKey, INT cKey)
@@ -156,15 +185,25 @@ VOID CHmacSHA1::HmacInitRfc2104 (const BYTE* pcbKey, INT cKey)
 	HmacInitialize(pcbKey, cKey);
 }
 
-VOID CHmacSHA1::GetDigest (LPBYTE lpDigest)
+HRESULT CHmacSHA1::Clone (__deref_out CHmac** ppHmac)
 {
-	CSHA1 Outer;
-
-	m_sha1.GetDigest(lpDigest);
+	HRESULT hr;
+	CHmacSHA1* pClone = __new CHmacSHA1;
+
+	CheckAlloc(pClone);
+	pClone->m_sha1 = m_sha1;
+	pClone->m_sha1Inner = m_sha1Inner;
+	pClone->m_sha1Outer = m_sha1Outer;
+	*ppHmac = pClone;
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
 
-	Outer.AddData(m_kopad, sizeof(m_kopad));
-	Outer.AddData(lpDigest, 20);
-	Outer.GetDigest(lpDigest);
+VOID CHmacSHA1::CopyState (CMessageDigest* pDest, const CMessageDigest* pcSrc)
+{
+	*static_cast<CSHA1*>(pDest) = *static_cast<const CSHA1*>(pcSrc);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -174,6 +213,9 @@ VOID CHmacSHA1::GetDigest (LPBYTE lpDigest)
 CHmacSHA256::CHmacSHA256 ()
 {
 	m_pHash = &m_sha256;
+	m_pInner = &m_sha256Inner;
+	m_pOuter = &m_sha256Outer;
+	m_pFinal = &m_sha256Final;
 }
 
 VOID CHmacSHA256::HmacInitRfc2104 (const BYTE* pcbKey, INT cKey)
@@ -194,15 +236,25 @@ VOID CHmacSHA256::HmacInitRfc2104 (const BYTE* pcbKey, INT cKey)
 	HmacInitialize(pcbKey, cKey);
 }
 
-VOID CHmacSHA256::GetDigest (LPBYTE lpDigest)
+HRESULT CHmacSHA256::Clone (__deref_out CHmac** ppHmac)
 {
-	CSHA256 Outer;
-
-	m_sha256.GetDigest(lpDigest);
+	HRESULT hr;
+	CHmacSHA256* pClone = __new CHmacSHA256;
+
+	CheckAlloc(pClone);
+	pClone->m_sha256 = m_sha256;
+	pClone->m_sha256Inner = m_sha256Inner;
+	pClone->m_sha256Outer = m_sha256Outer;
+	*ppHmac = pClone;
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
 
-	Outer.AddData(m_kopad, sizeof(m_kopad));
-	Outer.AddData(lpDigest, SHA256_DIGEST_SIZE);
-	Outer.GetDigest(lpDigest);
+VOID CHmacSHA256::CopyState (CMessageDigest* pDest, const CMessageDigest* pcSrc)
+{
+	*static_cast<CSHA256*>(pDest) = *static_cast<const CSHA256*>(pcSrc);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -210,9 +262,15 @@ VOID CHmacSHA256::GetDigest (LPBYTE lpDigest)
 ///////////////////////////////////////////////////////////////////////////////
 
 CHmacSHA3::CHmacSHA3 (UINT nBitSize) :
-	m_sha3(nBitSize)
+	m_sha3(nBitSize),
+	m_sha3Inner(nBitSize),
+	m_sha3Outer(nBitSize),
+	m_sha3Final(nBitSize)
 {
 	m_pHash = &m_sha3;
+	m_pInner = &m_sha3Inner;
+	m_pOuter = &m_sha3Outer;
+	m_pFinal = &m_sha3Final;
 }
 
 VOID CHmacSHA3::HmacInitRfc2104 (const BYTE* pcbKey, INT cKey)
@@ -238,15 +296,25 @@ VOID CHmacSHA3::HmacInitRfc2104 (const BYTE* pcbKey, INT cKey)
 	_freea(pbTempKey);
 }
 
-VOID CHmacSHA3::GetDigest (LPBYTE lpDigest)
+HRESULT CHmacSHA3::Clone (__deref_out CHmac** ppHmac)
 {
-	CSHA3 Outer(m_sha3.GetBitSize());
-
-	m_sha3.GetDigest(lpDigest);
+	HRESULT hr;
+	CHmacSHA3* pClone = __new CHmacSHA3(m_sha3.GetBitSize());
+
+	CheckAlloc(pClone);
+	pClone->m_sha3 = m_sha3;
+	pClone->m_sha3Inner = m_sha3Inner;
+	pClone->m_sha3Outer = m_sha3Outer;
+	*ppHmac = pClone;
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
 
-	Outer.AddData(m_kopad, sizeof(m_kopad));
-	Outer.AddData(lpDigest, m_sha3.GetDigestSize());
-	Outer.GetDigest(lpDigest);
+VOID CHmacSHA3::CopyState (CMessageDigest* pDest, const CMessageDigest* pcSrc)
+{
+	*static_cast<CSHA3*>(pDest) = *static_cast<const CSHA3*>(pcSrc);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -256,6 +324,9 @@ VOID CHmacSHA3::GetDigest (LPBYTE lpDigest)
 CHmacWhirlpool::CHmacWhirlpool ()
 {
 	m_pHash = &m_whirlpool;
+	m_pInner = &m_whirlpoolInner;
+	m_pOuter = &m_whirlpoolOuter;
+	m_pFinal = &m_whirlpoolFinal;
 }
 
 VOID CHmacWhirlpool::HmacInitRfc2104 (const BYTE* pcbKey, INT cKey)
@@ -276,13 +347,23 @@ VOID CHmacWhirlpool::HmacInitRfc2104 (const BYTE* pcbKey, INT cKey)
 	HmacInitialize(pcbKey, cKey);
 }
 
-VOID CHmacWhirlpool::GetDigest (LPBYTE lpDigest)
+HRESULT CHmacWhirlpool::Clone (__deref_out CHmac** ppHmac)
 {
-	CWhirlpool Outer;
-
-	m_whirlpool.GetDigest(lpDigest);
+	HRESULT hr;
+	CHmacWhirlpool* pClone = __new CHmacWhirlpool;
+
+	CheckAlloc(pClone);
+	pClone->m_whirlpool = m_whirlpool;
+	pClone->m_whirlpoolInner = m_whirlpoolInner;
+	pClone->m_whirlpoolOuter = m_whirlpoolOuter;
+	*ppHmac = pClone;
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
 
-	Outer.AddData(m_kopad, sizeof(m_kopad));
-	Outer.AddData(lpDigest, DIGESTBYTES);
-	Outer.GetDigest(lpDigest);
+VOID CHmacWhirlpool::CopyState (CMessageDigest* pDest, const CMessageDigest* pcSrc)
+{
+	*static_cast<CWhirlpool*>(pDest) = *static_cast<const CWhirlpool*>(pcSrc);
 }
@@ -9,103 +9,138 @@
 
 #define	HMAC_PAD_SIZE		64
 
+// The inner and outer hash states are computed once when the key is set, so each
+// message only pays for its own data plus the final outer block.  Like the other
+// digests, GetDigest() doesn't change the message state, so more data can follow it.
+// Call ResetToKey() to start another message with the same key.
+
 class CHmac : public CMessageDigest
 {
 protected:
-	CMessageDigest* m_pHash;
-	BYTE m_kopad[HMAC_PAD_SIZE];
+	CMessageDigest* m_pHash;	// Message currently being hashed
+	CMessageDigest* m_pInner;	// State after the ipad block
+	CMessageDigest* m_pOuter;	// State after the opad block
+	CMessageDigest* m_pFinal;	// Outer hash being finished by GetDigest()
 
 public:
 	CHmac ();
-	~CHmac ();
+	virtual ~CHmac ();
 
 	virtual VOID HmacInitRfc2104 (const BYTE* pcbKey, INT cKey) = 0;
 	VOID HmacInitMicrosoft (const BYTE* pcbKey, INT cKey);
 
+	// Discards any message data and restarts from the precomputed key state
+	VOID ResetToKey (VOID);
+
+	// Creates an HMAC of the same type sharing the key and the current message state
+	virtual HRESULT Clone (__deref_out CHmac** ppHmac) = 0;
+
 	// CMessageDigest
 	virtual VOID Reset (VOID);
 	virtual VOID AddData (const BYTE* pcbData, UINT cData);
 	virtual UINT GetDigestSize (VOID);
+	virtual VOID GetDigest (LPBYTE lpDigest);
 	virtual UINT GetHexKeySize (VOID);
 	virtual VOID GetHexKey (LPSTR lpszKey);
 
 protected:
 	VOID HmacInitialize (const BYTE* pcbKey, INT cKey);
+	virtual VOID CopyState (CMessageDigest* pDest, const CMessageDigest* pcSrc) = 0;
 };
 
 class CHmacMd5 : public CHmac
 {
 private:
 	CMd5 m_md5;
+	CMd5 m_md5Inner;
+	CMd5 m_md5Outer;
+	CMd5 m_md5Final;
 
 public:
 	CHmacMd5 ();
 
 	// CHmac
 	virtual VOID HmacInitRfc2104 (const BYTE* pcbKey, INT cKey);
+	virtual HRESULT Clone (__deref_out CHmac** ppHmac);
 
-	// CMessageDigest
-	virtual VOID GetDigest (LPBYTE lpDigest);
+protected:
+	virtual VOID CopyState (CMessageDigest* pDest, const CMessageDigest* pcSrc);
 };
 
 class CHmacSHA1 : public CHmac
 {
 private:
 	CSHA1 m_sha1;
+	CSHA1 m_sha1Inner;
+	CSHA1 m_sha1Outer;
+	CSHA1 m_sha1Final;
 
 public:
 	CHmacSHA1 ();
 
 	// CHmac
 	virtual VOID HmacInitRfc2104 (const BYTE* pcbKey, INT cKey);
+	virtual HRESULT Clone (__deref_out CHmac** ppHmac);
 
-	// CMessageDigest
-	virtual VOID GetDigest (LPBYTE lpDigest);
+protected:
+	virtual VOID CopyState (CMessageDigest* pDest, const CMessageDigest* pcSrc);
 };
 
 class CHmacSHA256 : public CHmac
 {
 private:
 	CSHA256 m_sha256;
+	CSHA256 m_sha256Inner;
+	CSHA256 m_sha256Outer;
+	CSHA256 m_sha256Final;
 
 public:
 	CHmacSHA256 ();
 
 	// CHmac
 	virtual VOID HmacInitRfc2104 (const BYTE* pcbKey, INT cKey);
+	virtual HRESULT Clone (__deref_out CHmac** ppHmac);
 
-	// CMessageDigest
-	virtual VOID GetDigest (LPBYTE lpDigest);
+protected:
+	virtual VOID CopyState (CMessageDigest* pDest, const CMessageDigest* pcSrc);
 };
 
 class CHmacSHA3 : public CHmac
 {
 private:
 	CSHA3 m_sha3;
+	CSHA3 m_sha3Inner;
+	CSHA3 m_sha3Outer;
+	CSHA3 m_sha3Final;
 
 public:
 	CHmacSHA3 (UINT nBitSize);
 
 	// CHmac
 	virtual VOID HmacInitRfc2104 (const BYTE* pcbKey, INT cKey);
+	virtual HRESULT Clone (__deref_out CHmac** ppHmac);
 
-	// CMessageDigest
-	virtual VOID GetDigest (LPBYTE lpDigest);
+protected:
+	virtual VOID CopyState (CMessageDigest* pDest, const CMessageDigest* pcSrc);
 };
 
 class CHmacWhirlpool : public CHmac
 {
 private:
 	CWhirlpool m_whirlpool;
+	CWhirlpool m_whirlpoolInner;
+	CWhirlpool m_whirlpoolOuter;
+	CWhirlpool m_whirlpoolFinal;
 
 public:
 	CHmacWhirlpool ();
 
 	// CHmac
 	virtual VOID HmacInitRfc2104 (const BYTE* pcbKey, INT cKey);
+	virtual HRESULT Clone (__deref_out CHmac** ppHmac);
 
-	// CMessageDigest
-	virtual VOID GetDigest (LPBYTE lpDigest);
+protected:
+	virtual VOID CopyState (CMessageDigest* pDest, const CMessageDigest* pcSrc);
 };
 
 #endif
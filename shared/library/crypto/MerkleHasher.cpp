@@ -0,0 +1,302 @@
+#include <windows.h>
+#include "..\Core\CoreDefs.h"
+#include "..\Util\WorkerPool.h"
+#include "MerkleHasher.h"
+
+#define	MERKLE_LEAF_PREFIX		0x00
+#define	MERKLE_NODE_PREFIX		0x01
+
+// Chunks read per worker for each batch in HashStream()
+#define	MERKLE_STREAM_BATCH		2
+
+struct MERKLE_JOB
+{
+	CMerkleHasher* pHasher;
+	const BYTE* pcbData;
+	SIZE_T cbData;
+	SIZE_T iFirstChunk;
+};
+
+static VOID AddLargeData (CMessageDigest* pDigest, const BYTE* pcbData, SIZE_T cbData)
+{
+	// AddData() takes a UINT count, so feed very large chunks in pieces.
+	while(0 < cbData)
+	{
+		UINT cbPiece = static_cast<UINT>(min(cbData, 0x40000000));
+		pDigest->AddData(pcbData, cbPiece);
+		pcbData += cbPiece;
+		cbData -= cbPiece;
+	}
+}
+
+static HRESULT ReadFull (ISequentialStream* pStream, PBYTE pbBuffer, SIZE_T cbBuffer)
+{
+	HRESULT hr = S_OK;
+
+	while(0 < cbBuffer)
+	{
+		ULONG cbRead = 0;
+
+		Check(pStream->Read(pbBuffer, static_cast<ULONG>(min(cbBuffer, 0x40000000)), &cbRead));
+		CheckIf(0 == cbRead, HRESULT_FROM_WIN32(ERROR_HANDLE_EOF));
+
+		pbBuffer += cbRead;
+		cbBuffer -= cbRead;
+	}
+
+Cleanup:
+	return hr;
+}
+
+CMerkleHasher::CMerkleHasher () :
+	m_pfnCreate(NULL),
+	m_pvParam(NULL),
+	m_pPool(NULL),
+	m_cbChunk(0),
+	m_cbDigest(0),
+	m_prgDigests(NULL),
+	m_cDigests(0),
+	m_pbRoot(NULL)
+{
+}
+
+CMerkleHasher::~CMerkleHasher ()
+{
+	Clear();
+}
+
+HRESULT CMerkleHasher::Initialize (PFNCREATEDIGEST pfnCreate, PVOID pvParam, SIZE_T cbChunk, __in_opt CWorkerPool* pPool)
+{
+	HRESULT hr;
+
+	CheckIf(NULL == pfnCreate || 0 == cbChunk, E_INVALIDARG);
+
+	Clear();
+
+	m_pfnCreate = pfnCreate;
+	m_pvParam = pvParam;
+	m_pPool = pPool;
+	m_cbChunk = cbChunk;
+
+	// Each worker needs its own digest, since digests hold the running state.
+	m_cDigests = pPool ? pPool->GetWorkerCount() : 1;
+	m_prgDigests = __new CMessageDigest*[m_cDigests];
+	CheckAlloc(m_prgDigests);
+	ZeroMemory(m_prgDigests, sizeof(CMessageDigest*) * m_cDigests);
+
+	for(INT i = 0; i < m_cDigests; i++)
+		Check(pfnCreate(pvParam, m_prgDigests + i));
+
+	m_cbDigest = m_prgDigests[0]->GetDigestSize();
+	m_pbRoot = __new BYTE[m_cbDigest];
+	CheckAlloc(m_pbRoot);
+	ZeroMemory(m_pbRoot, m_cbDigest);
+
+Cleanup:
+	if(FAILED(hr))
+		Clear();
+	return hr;
+}
+
+HRESULT CMerkleHasher::HashBuffer (const BYTE* pcbData, SIZE_T cbData)
+{
+	HRESULT hr;
+	SIZE_T cChunks = max((cbData + m_cbChunk - 1) / m_cbChunk, 1);
+
+	CheckIf(NULL == m_prgDigests, E_UNEXPECTED);
+
+	Check(m_aLeaves.Resize(cChunks * m_cbDigest));
+	Check(HashChunks(pcbData, cbData, 0));
+	Check(ComputeRoot(m_aLeaves.GetItemPtr(0), cChunks, m_pbRoot));
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CMerkleHasher::HashStream (ISequentialStream* pStream, ULONGLONG cbStream)
+{
+	HRESULT hr;
+	PBYTE pbBatch = NULL;
+	SIZE_T cbBatch, iChunk = 0;
+	ULONGLONG cChunks;
+
+	CheckIf(NULL == m_prgDigests, E_UNEXPECTED);
+
+	cChunks = max((cbStream + m_cbChunk - 1) / m_cbChunk, 1);
+	CheckIf(cChunks * m_cbDigest > static_cast<ULONGLONG>(LONG_MAX), E_INVALIDARG);
+	Check(m_aLeaves.Resize(static_cast<sysint>(cChunks * m_cbDigest)));
+
+	cbBatch = m_cbChunk * m_cDigests * MERKLE_STREAM_BATCH;
+	if(cbBatch > cbStream)
+		cbBatch = static_cast<SIZE_T>(cbStream);
+
+	if(0 == cbBatch)
+		Check(HashChunks(NULL, 0, 0));
+	else
+	{
+		pbBatch = __new BYTE[cbBatch];
+		CheckAlloc(pbBatch);
+
+		while(0 < cbStream)
+		{
+			SIZE_T cbRead = static_cast<SIZE_T>(min(cbStream, cbBatch));
+
+			Check(ReadFull(pStream, pbBatch, cbRead));
+			Check(HashChunks(pbBatch, cbRead, iChunk));
+
+			// Every batch except the last is a whole number of chunks.
+			iChunk += cbRead / m_cbChunk;
+			cbStream -= cbRead;
+		}
+	}
+
+	Check(ComputeRoot(m_aLeaves.GetItemPtr(0), static_cast<SIZE_T>(cChunks), m_pbRoot));
+
+Cleanup:
+	__delete_array pbBatch;
+	return hr;
+}
+
+HRESULT CMerkleHasher::VerifyChunk (SIZE_T iChunk, const BYTE* pcbData, SIZE_T cbData)
+{
+	HRESULT hr;
+	PBYTE pbLeaf = NULL;
+
+	CheckIf(iChunk >= GetChunkCount() || cbData > m_cbChunk, E_INVALIDARG);
+
+	pbLeaf = __new BYTE[m_cbDigest];
+	CheckAlloc(pbLeaf);
+
+	HashLeaf(m_prgDigests[0], pcbData, cbData, pbLeaf);
+	hr = (0 == memcmp(pbLeaf, GetChunkDigest(iChunk), m_cbDigest)) ? S_OK : S_FALSE;
+
+Cleanup:
+	__delete_array pbLeaf;
+	return hr;
+}
+
+HRESULT CMerkleHasher::UpdateChunk (SIZE_T iChunk, const BYTE* pcbData, SIZE_T cbData)
+{
+	HRESULT hr;
+
+	CheckIf(iChunk >= GetChunkCount() || cbData > m_cbChunk, E_INVALIDARG);
+
+	HashLeaf(m_prgDigests[0], pcbData, cbData, m_aLeaves.GetItemPtr(iChunk * m_cbDigest));
+	Check(ComputeRoot(m_aLeaves.GetItemPtr(0), GetChunkCount(), m_pbRoot));
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CMerkleHasher::ComputeRoot (const BYTE* pcbLeaves, SIZE_T cLeaves, __out_bcount(GetDigestSize()) PBYTE pbRoot)
+{
+	HRESULT hr;
+	CMessageDigest* pDigest;
+	PBYTE pbLevel = NULL;
+	SIZE_T cNodes = cLeaves;
+
+	CheckIf(NULL == m_prgDigests, E_UNEXPECTED);
+	CheckIf(0 == cLeaves, E_INVALIDARG);
+
+	pDigest = m_prgDigests[0];
+
+	pbLevel = __new BYTE[cLeaves * m_cbDigest];
+	CheckAlloc(pbLevel);
+	CopyMemory(pbLevel, pcbLeaves, cLeaves * m_cbDigest);
+
+	// Combine pairs in place, one level at a time.
+	while(1 < cNodes)
+	{
+		SIZE_T cParents = 0;
+
+		for(SIZE_T i = 0; i < cNodes; i += 2, cParents++)
+		{
+			PBYTE pbParent = pbLevel + cParents * m_cbDigest;
+
+			if(i + 1 < cNodes)
+			{
+				BYTE bPrefix = MERKLE_NODE_PREFIX;
+
+				pDigest->Reset();
+				pDigest->AddData(&bPrefix, sizeof(bPrefix));
+				pDigest->AddData(pbLevel + i * m_cbDigest, m_cbDigest * 2);
+				pDigest->GetDigest(pbParent);
+			}
+			else
+				MoveMemory(pbParent, pbLevel + i * m_cbDigest, m_cbDigest);
+		}
+
+		cNodes = cParents;
+	}
+
+	CopyMemory(pbRoot, pbLevel, m_cbDigest);
+	hr = S_OK;
+
+Cleanup:
+	__delete_array pbLevel;
+	return hr;
+}
+
+VOID CMerkleHasher::Clear (VOID)
+{
+	if(m_prgDigests)
+	{
+		for(INT i = 0; i < m_cDigests; i++)
+			__delete m_prgDigests[i];
+		SafeDeleteArray(m_prgDigests);
+	}
+	m_cDigests = 0;
+	m_cbDigest = 0;
+
+	SafeDeleteArray(m_pbRoot);
+	m_aLeaves.Clear();
+}
+
+VOID CMerkleHasher::HashLeaf (CMessageDigest* pDigest, const BYTE* pcbData, SIZE_T cbData, PBYTE pbLeaf)
+{
+	BYTE bPrefix = MERKLE_LEAF_PREFIX;
+
+	pDigest->Reset();
+	pDigest->AddData(&bPrefix, sizeof(bPrefix));
+	AddLargeData(pDigest, pcbData, cbData);
+	pDigest->GetDigest(pbLeaf);
+}
+
+HRESULT CMerkleHasher::HashChunks (const BYTE* pcbData, SIZE_T cbData, SIZE_T iFirstChunk)
+{
+	HRESULT hr;
+	MERKLE_JOB job;
+	SIZE_T cChunks = max((cbData + m_cbChunk - 1) / m_cbChunk, 1);
+
+	job.pHasher = this;
+	job.pcbData = pcbData;
+	job.cbData = cbData;
+	job.iFirstChunk = iFirstChunk;
+
+	if(m_pPool && 1 < cChunks)
+		Check(m_pPool->ParallelFor(cChunks, _HashChunk, &job));
+	else
+	{
+		for(SIZE_T i = 0; i < cChunks; i++)
+			_HashChunk(&job, i, 0);
+		hr = S_OK;
+	}
+
+Cleanup:
+	return hr;
+}
+
+VOID WINAPI CMerkleHasher::_HashChunk (PVOID pvContext, SIZE_T iItem, INT iWorker)
+{
+	MERKLE_JOB* pJob = reinterpret_cast<MERKLE_JOB*>(pvContext);
+	CMerkleHasher* pThis = pJob->pHasher;
+	SIZE_T cbOffset = iItem * pThis->m_cbChunk;
+	SIZE_T cbChunk = min(pJob->cbData - cbOffset, pThis->m_cbChunk);
+
+	// Empty input is a single empty chunk.
+	if(0 == pJob->cbData)
+		cbChunk = 0;
+
+	pThis->HashLeaf(pThis->m_prgDigests[iWorker], pJob->pcbData + cbOffset, cbChunk,
+		pThis->m_aLeaves.GetItemPtr((pJob->iFirstChunk + iItem) * pThis->m_cbDigest));
+}
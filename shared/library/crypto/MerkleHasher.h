@@ -0,0 +1,75 @@
+#pragma once
+
+#include "..\Core\Array.h"
+#include "MessageDigest.h"
+
+class CWorkerPool;
+
+// Creates a digest instance for one worker.  The caller deletes it.
+typedef HRESULT (WINAPI* PFNCREATEDIGEST)(PVOID pvParam, __deref_out CMessageDigest** ppDigest);
+
+template <typename TDigest>
+HRESULT WINAPI TCreateDigest (PVOID pvParam, __deref_out CMessageDigest** ppDigest)
+{
+	UNREFERENCED_PARAMETER(pvParam);
+
+	*ppDigest = __new TDigest;
+	return *ppDigest ? S_OK : E_OUTOFMEMORY;
+}
+
+// Tree hash over fixed-size chunks.  Leaves are H(0x00 || chunk) and interior nodes
+// are H(0x01 || left || right), as in RFC 6962, and a node without a sibling moves up
+// a level unchanged.  Chunks are hashed concurrently on the worker pool, but the root
+// and chunk digests don't depend on how many workers take part.  Empty input hashes
+// as a single empty chunk.
+
+class CMerkleHasher
+{
+private:
+	PFNCREATEDIGEST m_pfnCreate;
+	PVOID m_pvParam;
+	CWorkerPool* m_pPool;
+	SIZE_T m_cbChunk;
+	UINT m_cbDigest;
+
+	CMessageDigest** m_prgDigests;	// One per worker
+	INT m_cDigests;
+
+	TArray<BYTE> m_aLeaves;			// Chunk digests, in order
+	PBYTE m_pbRoot;
+
+public:
+	CMerkleHasher ();
+	~CMerkleHasher ();
+
+	// pPool may be NULL to hash on the calling thread only.
+	HRESULT Initialize (PFNCREATEDIGEST pfnCreate, PVOID pvParam, SIZE_T cbChunk, __in_opt CWorkerPool* pPool);
+
+	HRESULT HashBuffer (const BYTE* pcbData, SIZE_T cbData);
+
+	// Reads cbStream bytes in batches of chunks, hashing each batch in parallel.
+	HRESULT HashStream (ISequentialStream* pStream, ULONGLONG cbStream);
+
+	inline UINT GetDigestSize (VOID) const { return m_cbDigest; }
+	inline SIZE_T GetChunkSize (VOID) const { return m_cbChunk; }
+	inline SIZE_T GetChunkCount (VOID) const { return m_cbDigest ? m_aLeaves.Length() / m_cbDigest : 0; }
+	inline const BYTE* GetChunkDigest (SIZE_T iChunk) const { return m_aLeaves.GetItemPtr(iChunk * m_cbDigest); }
+	inline const BYTE* GetRootDigest (VOID) const { return m_pbRoot; }
+
+	// Hashes one chunk and compares it with the stored digest.  Returns S_OK when the
+	// chunk matches and S_FALSE when it does not.
+	HRESULT VerifyChunk (SIZE_T iChunk, const BYTE* pcbData, SIZE_T cbData);
+
+	// Replaces one chunk's digest and recomputes the root.
+	HRESULT UpdateChunk (SIZE_T iChunk, const BYTE* pcbData, SIZE_T cbData);
+
+	// Computes the root over a list of chunk digests that were stored elsewhere.
+	HRESULT ComputeRoot (const BYTE* pcbLeaves, SIZE_T cLeaves, __out_bcount(GetDigestSize()) PBYTE pbRoot);
+
+private:
+	VOID Clear (VOID);
+	VOID HashLeaf (CMessageDigest* pDigest, const BYTE* pcbData, SIZE_T cbData, PBYTE pbLeaf);
+	HRESULT HashChunks (const BYTE* pcbData, SIZE_T cbData, SIZE_T iFirstChunk);
+
+	static VOID WINAPI _HashChunk (PVOID pvContext, SIZE_T iItem, INT iWorker);
+};
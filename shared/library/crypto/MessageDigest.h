@@ -4,6 +4,8 @@
 class CMessageDigest
 {
 public:
+	virtual ~CMessageDigest () {}
+
 	virtual VOID Reset (VOID) = 0;
 
 	virtual VOID AddData (const BYTE* pcbData, UINT cData) = 0;
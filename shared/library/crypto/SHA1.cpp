@@ -1,7 +1,15 @@
 #include <windows.h>
 #include "..\Core\Endian.h"
+#include "SHAExtensions.h"
 #include "SHA1.h"
 
+typedef VOID (*PFNSHA1PROCESSBLOCKS)(UINT32 rgState[5], const BYTE* pcbBlocks, SIZE_T cBlocks);
+
+static VOID SHA1SelectProcessBlocks (UINT32 rgState[5], const BYTE* pcbBlocks, SIZE_T cBlocks);
+
+// Replaced by the best implementation for this processor on first use
+static PFNSHA1PROCESSBLOCKS s_pfnProcessBlocks = SHA1SelectProcessBlocks;
+
 CSHA1::CSHA1 ()
 {
 	Reset();
@@ -71,7 +79,7 @@ VOID CSHA1::GetHexKey (LPSTR lpszKey)
 				((((word) << (bits)) & 0xFFFFFFFF) | \
 				((word) >> (32-(bits))))
 
-VOID SHA1ProcessMessageBlock (SHA1_CTX* pKey)
+static VOID SHA1ProcessBlocks (UINT32 rgState[5], const BYTE* pcbBlocks, SIZE_T cBlocks)
 {
 	// Constants defined in SHA-1
 	const unsigned K[] =
@@ -86,119 +94,143 @@ VOID SHA1ProcessMessageBlock (SHA1_CTX* pKey)
 	unsigned W[80];			// Word sequence
 	unsigned A, B, C, D, E;	// Word buffers
 
-	/*
-	 *  Initialize the first 16 words in the array W
-	 */
-	for(t = 0; t < 16; t++)
+	for(; 0 < cBlocks; cBlocks--, pcbBlocks += 64)
 	{
-		W[t] = ((unsigned) pKey->Message_Block[t * 4]) << 24;
-		W[t] |= ((unsigned) pKey->Message_Block[t * 4 + 1]) << 16;
-		W[t] |= ((unsigned) pKey->Message_Block[t * 4 + 2]) << 8;
-		W[t] |= ((unsigned) pKey->Message_Block[t * 4 + 3]);
-	}
+		/*
+		 *  Initialize the first 16 words in the array W
+		 */
+		for(t = 0; t < 16; t++)
+		{
+			W[t] = ((unsigned) pcbBlocks[t * 4]) << 24;
+			W[t] |= ((unsigned) pcbBlocks[t * 4 + 1]) << 16;
+			W[t] |= ((unsigned) pcbBlocks[t * 4 + 2]) << 8;
+			W[t] |= ((unsigned) pcbBlocks[t * 4 + 3]);
+		}
 
-	for(t = 16; t < 80; t++)
-	{
-		W[t] = SHA1CircularShift(1,W[t-3] ^ W[t-8] ^ W[t-14] ^ W[t-16]);
-	}
+		for(t = 16; t < 80; t++)
+		{
+			W[t] = SHA1CircularShift(1,W[t-3] ^ W[t-8] ^ W[t-14] ^ W[t-16]);
+		}
 
-	A = pKey->Message_Digest[0];
-	B = pKey->Message_Digest[1];
-	C = pKey->Message_Digest[2];
-	D = pKey->Message_Digest[3];
-	E = pKey->Message_Digest[4];
+		A = rgState[0];
+		B = rgState[1];
+		C = rgState[2];
+		D = rgState[3];
+		E = rgState[4];
 
-	for(t = 0; t < 20; t++)
-	{
-		temp =  SHA1CircularShift(5,A) +
-				((B & C) | ((~B) & D)) + E + W[t] + K[0];
-		temp &= 0xFFFFFFFF;
-		E = D;
-		D = C;
-		C = SHA1CircularShift(30,B);
-		B = A;
-		A = temp;
-	}
+		for(t = 0; t < 20; t++)
+		{
+			temp =  SHA1CircularShift(5,A) +
+					((B & C) | ((~B) & D)) + E + W[t] + K[0];
+			temp &= 0xFFFFFFFF;
+			E = D;
+			D = C;
+			C = SHA1CircularShift(30,B);
+			B = A;
+			A = temp;
+		}
 
-	for(t = 20; t < 40; t++)
-	{
-		temp = SHA1CircularShift(5,A) + (B ^ C ^ D) + E + W[t] + K[1];
-		temp &= 0xFFFFFFFF;
-		E = D;
-		D = C;
-		C = SHA1CircularShift(30,B);
-		B = A;
-		A = temp;
-	}
+		for(t = 20; t < 40; t++)
+		{
+			temp = SHA1CircularShift(5,A) + (B ^ C ^ D) + E + W[t] + K[1];
+			temp &= 0xFFFFFFFF;
+			E = D;
+			D = C;
+			C = SHA1CircularShift(30,B);
+			B = A;
+			A = temp;
+		}
 
-	for(t = 40; t < 60; t++)
-	{
-		temp = SHA1CircularShift(5,A) +
-			   ((B & C) | (B & D) | (C & D)) + E + W[t] + K[2];
-		temp &= 0xFFFFFFFF;
-		E = D;
-		D = C;
-		C = SHA1CircularShift(30,B);
-		B = A;
-		A = temp;
-	}
+		for(t = 40; t < 60; t++)
+		{
+			temp = SHA1CircularShift(5,A) +
+				   ((B & C) | (B & D) | (C & D)) + E + W[t] + K[2];
+			temp &= 0xFFFFFFFF;
+			E = D;
+			D = C;
+			C = SHA1CircularShift(30,B);
+			B = A;
+			A = temp;
+		}
 
-	for(t = 60; t < 80; t++)
-	{
-		temp = SHA1CircularShift(5,A) + (B ^ C ^ D) + E + W[t] + K[3];
-		temp &= 0xFFFFFFFF;
-		E = D;
-		D = C;
-		C = SHA1CircularShift(30,B);
-		B = A;
-		A = temp;
+		for(t = 60; t < 80; t++)
+		{
+			temp = SHA1CircularShift(5,A) + (B ^ C ^ D) + E + W[t] + K[3];
+			temp &= 0xFFFFFFFF;
+			E = D;
+			D = C;
+			C = SHA1CircularShift(30,B);
+			B = A;
+			A = temp;
+		}
+
+		rgState[0] = (rgState[0] + A) & 0xFFFFFFFF;
+		rgState[1] = (rgState[1] + B) & 0xFFFFFFFF;
+		rgState[2] = (rgState[2] + C) & 0xFFFFFFFF;
+		rgState[3] = (rgState[3] + D) & 0xFFFFFFFF;
+		rgState[4] = (rgState[4] + E) & 0xFFFFFFFF;
 	}
+}
 
-	pKey->Message_Digest[0] =
-						(pKey->Message_Digest[0] + A) & 0xFFFFFFFF;
-	pKey->Message_Digest[1] =
-						(pKey->Message_Digest[1] + B) & 0xFFFFFFFF;
-	pKey->Message_Digest[2] =
-						(pKey->Message_Digest[2] + C) & 0xFFFFFFFF;
-	pKey->Message_Digest[3] =
-						(pKey->Message_Digest[3] + D) & 0xFFFFFFFF;
-	pKey->Message_Digest[4] =
-						(pKey->Message_Digest[4] + E) & 0xFFFFFFFF;
+static VOID SHA1SelectProcessBlocks (UINT32 rgState[5], const BYTE* pcbBlocks, SIZE_T cBlocks)
+{
+#ifdef	CPUFEATURES_SHA
+	if(CPUFeatures::HasSHA())
+		s_pfnProcessBlocks = SHA1ProcessBlocksExt;
+	else
+#endif
+		s_pfnProcessBlocks = SHA1ProcessBlocks;
+
+	s_pfnProcessBlocks(rgState, pcbBlocks, cBlocks);
+}
 
+VOID SHA1ProcessMessageBlock (SHA1_CTX* pKey)
+{
+	s_pfnProcessBlocks(pKey->Message_Digest, pKey->Message_Block, 1);
 	pKey->Message_Block_Index = 0;
 }
 
 VOID CSHA1::Update (SHA1_CTX* pKey, const BYTE* pcbData, UINT cData)
 {
-	while(cData-- && !pKey->Corrupted)
-	{
-		pKey->Message_Block[pKey->Message_Block_Index++] = (*pcbData & 0xFF);
+	UINT64 cBits = (static_cast<UINT64>(pKey->Length_High) << 32) | pKey->Length_Low;
+	UINT n;
+
+	if(pKey->Corrupted)
+		return;
 
-		pKey->Length_Low += 8;
+	/* Message is too long */
+	if(cBits + static_cast<UINT64>(cData) * 8 < cBits)
+	{
+		pKey->Corrupted = 1;
+		return;
+	}
 
-		/* Force it to 32 bits */
-		pKey->Length_Low &= 0xFFFFFFFF;
+	cBits += static_cast<UINT64>(cData) * 8;
+	pKey->Length_Low = static_cast<UINT32>(cBits);
+	pKey->Length_High = static_cast<UINT32>(cBits >> 32);
 
-		if(pKey->Length_Low == 0)
+	while(0 < cData)
+	{
+		if(0 == pKey->Message_Block_Index && 64 <= cData)
 		{
-			pKey->Length_High++;
-
-			/* Force it to 32 bits */
-			pKey->Length_High &= 0xFFFFFFFF;
+			// Whole blocks are hashed directly from the caller's buffer
+			n = cData & ~63;
+			s_pfnProcessBlocks(pKey->Message_Digest, pcbData, n / 64);
+		}
+		else
+		{
+			n = min(cData, 64 - static_cast<UINT>(pKey->Message_Block_Index));
+			CopyMemory(pKey->Message_Block + pKey->Message_Block_Index, pcbData, n);
+			pKey->Message_Block_Index += n;
 
-			if(pKey->Length_High == 0)
+			if(pKey->Message_Block_Index == 64)
 			{
-				/* Message is too long */
-				pKey->Corrupted = 1;
+				SHA1ProcessMessageBlock(pKey);
 			}
 		}
 
-		if(pKey->Message_Block_Index == 64)
-		{
-			SHA1ProcessMessageBlock(pKey);
-		}
-
-		pcbData++;
+		pcbData += n;
+		cData -= n;
 	}
 }
 
@@ -1,7 +1,17 @@
 // https://www.oryx-embedded.com/doc/sha256_8c_source.html
 #include <windows.h>
 #include "..\Core\Endian.h"
+#include "CPUFeatures.h"
 #include "SHA256.h"
+#include "SHA256Multi.h"
+#include "SHAExtensions.h"
+
+typedef VOID (*PFNSHA256PROCESSBLOCKS)(UINT32 rgState[8], const BYTE* pcbBlocks, SIZE_T cBlocks);
+
+static VOID sha256SelectProcessBlocks (UINT32 rgState[8], const BYTE* pcbBlocks, SIZE_T cBlocks);
+
+// Replaced by the best implementation for this processor on first use
+static PFNSHA256PROCESSBLOCKS s_pfnProcessBlocks = sha256SelectProcessBlocks;
 
 // Rotate left operation
 #define	ROL8(a, n) (((a) << (n)) | ((a) >> (8 - (n))))
@@ -47,8 +57,14 @@ static const BYTE padding[64] =
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
 };
 
+// SHA-256 initial hash value
+const UINT32 c_rgSHA256InitialHash[8] =
+{
+	0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
 // SHA-256 constants
-static const UINT32 k[64] =
+const UINT32 c_rgSHA256RoundConstants[64] =
 {
 	0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
 	0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
@@ -73,14 +89,7 @@ CSHA256::~CSHA256 ()
 VOID CSHA256::Reset (VOID)
 {
 	// Set initial hash value
-	m_ctxKey.h[0] = 0x6A09E667;
-	m_ctxKey.h[1] = 0xBB67AE85;
-	m_ctxKey.h[2] = 0x3C6EF372;
-	m_ctxKey.h[3] = 0xA54FF53A;
-	m_ctxKey.h[4] = 0x510E527F;
-	m_ctxKey.h[5] = 0x9B05688C;
-	m_ctxKey.h[6] = 0x1F83D9AB;
-	m_ctxKey.h[7] = 0x5BE0CD19;
+	CopyMemory(m_ctxKey.h, c_rgSHA256InitialHash, sizeof(m_ctxKey.h));
 
 	// Number of bytes in the buffer
 	m_ctxKey.size = 0;
@@ -119,63 +128,125 @@ VOID CSHA256::GetHexKey (LPSTR lpszKey)
 	KeyToHex(Digest, sizeof(Digest), lpszKey);
 }
 
-VOID sha256ProcessBlock (SHA256_CTX* context)
+VOID CSHA256::HashMany (const BYTE** rgpData, const SIZE_T* rgcb, SIZE_T cMessages, BYTE (*rgDigest)[SHA256_DIGEST_SIZE])
+{
+	// A single message gains nothing from the lanes.
+	if(1 < cMessages)
+	{
+#ifdef	CPUFEATURES_AVX2
+		if(CPUFeatures::HasAVX2())
+		{
+			CSHA256x8::HashMany(rgpData, rgcb, cMessages, rgDigest);
+			return;
+		}
+#endif
+
+#ifdef	CPUFEATURES_SSE2
+		if(CPUFeatures::HasSSE2())
+		{
+			CSHA256x4::HashMany(rgpData, rgcb, cMessages, rgDigest);
+			return;
+		}
+#endif
+	}
+
+	for(SIZE_T i = 0; i < cMessages; i++)
+	{
+		SHA256_CTX Key;
+		const BYTE* pcbData = rgpData[i];
+		SIZE_T cbData = rgcb[i];
+
+		CopyMemory(Key.h, c_rgSHA256InitialHash, sizeof(Key.h));
+		Key.size = 0;
+		Key.totalSize = 0;
+
+		// Update() takes a UINT count, so feed very large messages in pieces.
+		while(0 < cbData)
+		{
+			UINT cbChunk = static_cast<UINT>(min(cbData, 0x40000000));
+			Update(&Key, pcbData, cbChunk);
+			pcbData += cbChunk;
+			cbData -= cbChunk;
+		}
+
+		CompleteKey(&Key);
+		CopyMemory(rgDigest[i], Key.digest, SHA256_DIGEST_SIZE);
+		SecureZeroMemory(&Key, sizeof(Key));
+	}
+}
+
+static VOID sha256ProcessBlocks (UINT32 rgState[8], const BYTE* pcbBlocks, SIZE_T cBlocks)
 {
 	UINT32 t;
 	UINT32 temp1;
 	UINT32 temp2;
+	UINT32 w[16];
 
-	//Initialize the 8 working registers
-	UINT32 a = context->h[0];
-	UINT32 b = context->h[1];
-	UINT32 c = context->h[2];
-	UINT32 d = context->h[3];
-	UINT32 e = context->h[4];
-	UINT32 f = context->h[5];
-	UINT32 g = context->h[6];
-	UINT32 h = context->h[7];
-
-	//Process message in 16-word blocks
-	UINT32* w = context->w;
-
-	if(!IsBigEndian())
+	for(; 0 < cBlocks; cBlocks--, pcbBlocks += SHA256_BLOCK_SIZE)
 	{
+		//Initialize the 8 working registers
+		UINT32 a = rgState[0];
+		UINT32 b = rgState[1];
+		UINT32 c = rgState[2];
+		UINT32 d = rgState[3];
+		UINT32 e = rgState[4];
+		UINT32 f = rgState[5];
+		UINT32 g = rgState[6];
+		UINT32 h = rgState[7];
+
 		//Convert from big-endian byte order to host byte order
 		for(t = 0; t < 16; t++)
-			EndianSwap(w[t]);
-	}
+		{
+			w[t] = (static_cast<UINT32>(pcbBlocks[t * 4]) << 24) |
+				(static_cast<UINT32>(pcbBlocks[t * 4 + 1]) << 16) |
+				(static_cast<UINT32>(pcbBlocks[t * 4 + 2]) << 8) |
+				static_cast<UINT32>(pcbBlocks[t * 4 + 3]);
+		}
 
-	// SHA-256 hash computation (alternate method)
-	for(t = 0; t < 64; t++)
-	{
-		// Prepare the message schedule
-		if(t >= 16)
-			W(t) += SIGMA4(W(t + 14)) + W(t + 9) + SIGMA3(W(t + 1));
-
-		// Calculate T1 and T2
-		temp1 = h + SIGMA2(e) + CH(e, f, g) + k[t] + W(t);
-		temp2 = SIGMA1(a) + MAJ(a, b, c);
-
-		// Update the working registers
-		h = g;
-		g = f;
-		f = e;
-		e = d + temp1;
-		d = c;
-		c = b;
-		b = a;
-		a = temp1 + temp2;
+		// SHA-256 hash computation (alternate method)
+		for(t = 0; t < 64; t++)
+		{
+			// Prepare the message schedule
+			if(t >= 16)
+				W(t) += SIGMA4(W(t + 14)) + W(t + 9) + SIGMA3(W(t + 1));
+
+			// Calculate T1 and T2
+			temp1 = h + SIGMA2(e) + CH(e, f, g) + c_rgSHA256RoundConstants[t] + W(t);
+			temp2 = SIGMA1(a) + MAJ(a, b, c);
+
+			// Update the working registers
+			h = g;
+			g = f;
+			f = e;
+			e = d + temp1;
+			d = c;
+			c = b;
+			b = a;
+			a = temp1 + temp2;
+		}
+
+		//Update the hash value
+		rgState[0] += a;
+		rgState[1] += b;
+		rgState[2] += c;
+		rgState[3] += d;
+		rgState[4] += e;
+		rgState[5] += f;
+		rgState[6] += g;
+		rgState[7] += h;
 	}
+}
 
-	//Update the hash value
-	context->h[0] += a;
-	context->h[1] += b;
-	context->h[2] += c;
-	context->h[3] += d;
-	context->h[4] += e;
-	context->h[5] += f;
-	context->h[6] += g;
-	context->h[7] += h;
+static VOID sha256SelectProcessBlocks (UINT32 rgState[8], const BYTE* pcbBlocks, SIZE_T cBlocks)
+{
+#ifdef	CPUFEATURES_SHA
+	if(CPUFeatures::HasSHA())
+		s_pfnProcessBlocks = SHA256ProcessBlocksExt;
+	else
+#endif
+		s_pfnProcessBlocks = sha256ProcessBlocks;
+
+	s_pfnProcessBlocks(rgState, pcbBlocks, cBlocks);
 }
 
 VOID CSHA256::Update (SHA256_CTX* pKey, const BYTE* pcbData, UINT cData)
@@ -185,29 +256,39 @@ VOID CSHA256::Update (SHA256_CTX* pKey, const BYTE* pcbData, UINT cData)
 	//Process the incoming data
 	while(0 < cData)
 	{
-		//The buffer can hold at most 64 bytes
-		n = min(cData, 64 - pKey->size);
+		//Whole blocks are hashed directly from the caller's buffer
+		if(0 == pKey->size && 64 <= cData)
+		{
+			n = cData & ~63;
+			s_pfnProcessBlocks(pKey->h, pcbData, n / 64);
+		}
+		else
+		{
+			//The buffer can hold at most 64 bytes
+			n = min(cData, 64 - pKey->size);
+
+			//Copy the data to the buffer
+			CopyMemory(pKey->buffer + pKey->size, pcbData, n);
+
+			//Update the SHA-256 context
+			pKey->size += n;
 
-		//Copy the data to the buffer
-		CopyMemory(pKey->buffer + pKey->size, pcbData, n);
+			//Process message in 16-word blocks
+			if(64 == pKey->size)
+			{
+				//Transform the 16-word block
+				s_pfnProcessBlocks(pKey->h, pKey->buffer, 1);
+
+				//Empty the buffer
+				pKey->size = 0;
+			}
+		}
 
-		//Update the SHA-256 context
-		pKey->size += n;
 		pKey->totalSize += n;
 		//Advance the data pointer
 		pcbData = pcbData + n;
 		//Remaining bytes to process
 		cData -= n;
-
-		//Process message in 16-word blocks
-		if(64 == pKey->size)
-		{
-			//Transform the 16-word block
-			sha256ProcessBlock(pKey);
-
-			//Empty the buffer
-			pKey->size = 0;
-		}
 	}
 }
 
@@ -239,7 +320,7 @@ VOID CSHA256::CompleteKey (SHA256_CTX* pKey)
 	}
 
 	// Calculate the message digest
-	sha256ProcessBlock(pKey);
+	s_pfnProcessBlocks(pKey->h, pKey->buffer, 1);
 
 	if(!IsBigEndian())
 	{
@@ -8,6 +8,10 @@
 //SHA-256 digest size
 #define	SHA256_DIGEST_SIZE	32
 
+//SHA-256 initial hash value and round constants
+extern const UINT32 c_rgSHA256InitialHash[SHA256_DIGEST_SIZE / 4];
+extern const UINT32 c_rgSHA256RoundConstants[64];
+
 struct SHA256_CTX
 {
 	union
@@ -43,6 +47,9 @@ public:
 	virtual UINT GetHexKeySize (VOID);
 	virtual VOID GetHexKey (LPSTR lpszKey);
 
+	// Hashes independent messages in parallel SIMD lanes when the processor allows it
+	static VOID HashMany (const BYTE** rgpData, const SIZE_T* rgcb, SIZE_T cMessages, BYTE (*rgDigest)[SHA256_DIGEST_SIZE]);
+
 private:
 	static VOID Update (SHA256_CTX* ppKey, const BYTE* pcbData, UINT cData);
 	static VOID CompleteKey (SHA256_CTX* pKey);
@@ -0,0 +1,288 @@
+#include <windows.h>
+#include <stdlib.h>
+#include "SHA256Multi.h"
+
+#ifdef	CPUFEATURES_SSE2
+
+#include <emmintrin.h>
+#ifdef	CPUFEATURES_AVX2
+	#include <immintrin.h>
+#endif
+
+// Tracks the message currently assigned to a lane
+struct SHA256_LANE
+{
+	BOOL fActive;
+	SIZE_T iMessage;
+	const BYTE* pcbData;		// Next whole block of message data
+	SIZE_T cFullBlocks;			// Whole blocks remaining at pcbData
+	UINT iTail;					// Next padded block in rgTail
+	UINT cTailBlocks;			// One or two padded blocks finish every message
+	BYTE rgTail[SHA256_BLOCK_SIZE * 2];
+};
+
+struct SSE2_LANES
+{
+	typedef __m128i VECTOR;
+	enum { LANES = 4 };
+
+	static inline VECTOR Add (VECTOR a, VECTOR b) { return _mm_add_epi32(a, b); }
+	static inline VECTOR Xor (VECTOR a, VECTOR b) { return _mm_xor_si128(a, b); }
+	static inline VECTOR And (VECTOR a, VECTOR b) { return _mm_and_si128(a, b); }
+	static inline VECTOR AndNot (VECTOR a, VECTOR b) { return _mm_andnot_si128(a, b); }
+	static inline VECTOR Or (VECTOR a, VECTOR b) { return _mm_or_si128(a, b); }
+	static inline VECTOR Shr (VECTOR a, INT n) { return _mm_srli_epi32(a, n); }
+	static inline VECTOR Shl (VECTOR a, INT n) { return _mm_slli_epi32(a, n); }
+	static inline VECTOR Set1 (UINT32 n) { return _mm_set1_epi32(static_cast<INT>(n)); }
+	static inline VECTOR Load (const UINT32* pn) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pn)); }
+	static inline VOID Store (UINT32* pn, VECTOR v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(pn), v); }
+
+	// Reads big-endian word t from each lane's block
+	static inline VECTOR Gather (const BYTE* const* rgpBlock, INT t)
+	{
+		return _mm_setr_epi32(
+			_byteswap_ulong(reinterpret_cast<const ULONG*>(rgpBlock[0])[t]),
+			_byteswap_ulong(reinterpret_cast<const ULONG*>(rgpBlock[1])[t]),
+			_byteswap_ulong(reinterpret_cast<const ULONG*>(rgpBlock[2])[t]),
+			_byteswap_ulong(reinterpret_cast<const ULONG*>(rgpBlock[3])[t]));
+	}
+
+	static inline VOID Finish (VOID) {}
+};
+
+#ifdef	CPUFEATURES_AVX2
+
+struct AVX2_LANES
+{
+	typedef __m256i VECTOR;
+	enum { LANES = 8 };
+
+	static inline VECTOR Add (VECTOR a, VECTOR b) { return _mm256_add_epi32(a, b); }
+	static inline VECTOR Xor (VECTOR a, VECTOR b) { return _mm256_xor_si256(a, b); }
+	static inline VECTOR And (VECTOR a, VECTOR b) { return _mm256_and_si256(a, b); }
+	static inline VECTOR AndNot (VECTOR a, VECTOR b) { return _mm256_andnot_si256(a, b); }
+	static inline VECTOR Or (VECTOR a, VECTOR b) { return _mm256_or_si256(a, b); }
+	static inline VECTOR Shr (VECTOR a, INT n) { return _mm256_srli_epi32(a, n); }
+	static inline VECTOR Shl (VECTOR a, INT n) { return _mm256_slli_epi32(a, n); }
+	static inline VECTOR Set1 (UINT32 n) { return _mm256_set1_epi32(static_cast<INT>(n)); }
+	static inline VECTOR Load (const UINT32* pn) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pn)); }
+	static inline VOID Store (UINT32* pn, VECTOR v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(pn), v); }
+
+	// Reads big-endian word t from each lane's block
+	static inline VECTOR Gather (const BYTE* const* rgpBlock, INT t)
+	{
+		return _mm256_setr_epi32(
+			_byteswap_ulong(reinterpret_cast<const ULONG*>(rgpBlock[0])[t]),
+			_byteswap_ulong(reinterpret_cast<const ULONG*>(rgpBlock[1])[t]),
+			_byteswap_ulong(reinterpret_cast<const ULONG*>(rgpBlock[2])[t]),
+			_byteswap_ulong(reinterpret_cast<const ULONG*>(rgpBlock[3])[t]),
+			_byteswap_ulong(reinterpret_cast<const ULONG*>(rgpBlock[4])[t]),
+			_byteswap_ulong(reinterpret_cast<const ULONG*>(rgpBlock[5])[t]),
+			_byteswap_ulong(reinterpret_cast<const ULONG*>(rgpBlock[6])[t]),
+			_byteswap_ulong(reinterpret_cast<const ULONG*>(rgpBlock[7])[t]));
+	}
+
+	// Avoid the AVX to SSE transition penalty in the caller
+	static inline VOID Finish (VOID) { _mm256_zeroupper(); }
+};
+
+#endif
+
+// SHA-256 auxiliary functions, one lane per vector element
+#define	MB_ROR(x, n)		TLanes::Or(TLanes::Shr(x, n), TLanes::Shl(x, 32 - (n)))
+#define	MB_CH(x, y, z)		TLanes::Xor(TLanes::And(x, y), TLanes::AndNot(x, z))
+#define	MB_MAJ(x, y, z)		TLanes::Or(TLanes::And(x, y), TLanes::And(z, TLanes::Or(x, y)))
+#define	MB_SIGMA1(x)		TLanes::Xor(TLanes::Xor(MB_ROR(x, 2), MB_ROR(x, 13)), MB_ROR(x, 22))
+#define	MB_SIGMA2(x)		TLanes::Xor(TLanes::Xor(MB_ROR(x, 6), MB_ROR(x, 11)), MB_ROR(x, 25))
+#define	MB_SIGMA3(x)		TLanes::Xor(TLanes::Xor(MB_ROR(x, 7), MB_ROR(x, 18)), TLanes::Shr(x, 3))
+#define	MB_SIGMA4(x)		TLanes::Xor(TLanes::Xor(MB_ROR(x, 17), MB_ROR(x, 19)), TLanes::Shr(x, 10))
+
+template <typename TLanes>
+static VOID TCompressLanes (UINT32 rgState[8][TLanes::LANES], const BYTE* const* rgpBlock)
+{
+	typedef typename TLanes::VECTOR VECTOR;
+
+	VECTOR w[16];
+	VECTOR a = TLanes::Load(rgState[0]);
+	VECTOR b = TLanes::Load(rgState[1]);
+	VECTOR c = TLanes::Load(rgState[2]);
+	VECTOR d = TLanes::Load(rgState[3]);
+	VECTOR e = TLanes::Load(rgState[4]);
+	VECTOR f = TLanes::Load(rgState[5]);
+	VECTOR g = TLanes::Load(rgState[6]);
+	VECTOR h = TLanes::Load(rgState[7]);
+
+	for(INT t = 0; t < 64; t++)
+	{
+		// Prepare the message schedule in a circular buffer, as CSHA256 does
+		if(t < 16)
+			w[t] = TLanes::Gather(rgpBlock, t);
+		else
+		{
+			w[t & 0x0F] = TLanes::Add(TLanes::Add(w[t & 0x0F], MB_SIGMA4(w[(t + 14) & 0x0F])),
+				TLanes::Add(w[(t + 9) & 0x0F], MB_SIGMA3(w[(t + 1) & 0x0F])));
+		}
+
+		VECTOR temp1 = TLanes::Add(TLanes::Add(h, MB_SIGMA2(e)), TLanes::Add(MB_CH(e, f, g),
+			TLanes::Add(TLanes::Set1(c_rgSHA256RoundConstants[t]), w[t & 0x0F])));
+		VECTOR temp2 = TLanes::Add(MB_SIGMA1(a), MB_MAJ(a, b, c));
+
+		h = g;
+		g = f;
+		f = e;
+		e = TLanes::Add(d, temp1);
+		d = c;
+		c = b;
+		b = a;
+		a = TLanes::Add(temp1, temp2);
+	}
+
+	TLanes::Store(rgState[0], TLanes::Add(TLanes::Load(rgState[0]), a));
+	TLanes::Store(rgState[1], TLanes::Add(TLanes::Load(rgState[1]), b));
+	TLanes::Store(rgState[2], TLanes::Add(TLanes::Load(rgState[2]), c));
+	TLanes::Store(rgState[3], TLanes::Add(TLanes::Load(rgState[3]), d));
+	TLanes::Store(rgState[4], TLanes::Add(TLanes::Load(rgState[4]), e));
+	TLanes::Store(rgState[5], TLanes::Add(TLanes::Load(rgState[5]), f));
+	TLanes::Store(rgState[6], TLanes::Add(TLanes::Load(rgState[6]), g));
+	TLanes::Store(rgState[7], TLanes::Add(TLanes::Load(rgState[7]), h));
+}
+
+static VOID StartLane (SHA256_LANE* pLane, SIZE_T iMessage, const BYTE* pcbData, SIZE_T cbData)
+{
+	SIZE_T cbTail = cbData % SHA256_BLOCK_SIZE;
+	UINT64 cBits = static_cast<UINT64>(cbData) * 8;
+	BYTE* pbLength;
+
+	pLane->fActive = TRUE;
+	pLane->iMessage = iMessage;
+	pLane->pcbData = pcbData;
+	pLane->cFullBlocks = cbData / SHA256_BLOCK_SIZE;
+	pLane->iTail = 0;
+
+	// The remaining bytes, the 0x80 terminator and the 64-bit length need a second
+	// block when the remainder leaves fewer than nine bytes free.
+	pLane->cTailBlocks = (cbTail < 56) ? 1 : 2;
+
+	ZeroMemory(pLane->rgTail, sizeof(pLane->rgTail));
+	CopyMemory(pLane->rgTail, pcbData + (cbData - cbTail), cbTail);
+	pLane->rgTail[cbTail] = 0x80;
+
+	pbLength = pLane->rgTail + pLane->cTailBlocks * SHA256_BLOCK_SIZE - 8;
+	for(INT i = 0; i < 8; i++)
+		pbLength[i] = static_cast<BYTE>(cBits >> (56 - i * 8));
+}
+
+static const BYTE* GetLaneBlock (const SHA256_LANE* pLane)
+{
+	if(0 < pLane->cFullBlocks)
+		return pLane->pcbData;
+	return pLane->rgTail + pLane->iTail * SHA256_BLOCK_SIZE;
+}
+
+// Returns TRUE when the lane has consumed its last block
+static BOOL AdvanceLane (SHA256_LANE* pLane)
+{
+	if(0 < pLane->cFullBlocks)
+	{
+		pLane->pcbData += SHA256_BLOCK_SIZE;
+		pLane->cFullBlocks--;
+		return FALSE;
+	}
+
+	pLane->iTail++;
+	return pLane->iTail == pLane->cTailBlocks;
+}
+
+template <typename TLanes>
+static VOID THashMany (const BYTE** rgpData, const SIZE_T* rgcb, SIZE_T cMessages, BYTE (*rgDigest)[SHA256_DIGEST_SIZE])
+{
+	SHA256_LANE rgLane[TLanes::LANES];
+	UINT32 rgState[8][TLanes::LANES];
+	const BYTE* rgpBlock[TLanes::LANES];
+	BYTE rgIdle[SHA256_BLOCK_SIZE];
+	SIZE_T iNext = 0;
+
+	// Idle lanes compress a dummy block and their results are ignored.
+	ZeroMemory(rgIdle, sizeof(rgIdle));
+	for(INT i = 0; i < TLanes::LANES; i++)
+		rgLane[i].fActive = FALSE;
+
+	for(;;)
+	{
+		INT cActive = 0;
+
+		for(INT i = 0; i < TLanes::LANES; i++)
+		{
+			SHA256_LANE* pLane = rgLane + i;
+
+			if(!pLane->fActive && iNext < cMessages)
+			{
+				StartLane(pLane, iNext, rgpData[iNext], rgcb[iNext]);
+				for(INT n = 0; n < 8; n++)
+					rgState[n][i] = c_rgSHA256InitialHash[n];
+				iNext++;
+			}
+
+			if(pLane->fActive)
+			{
+				rgpBlock[i] = GetLaneBlock(pLane);
+				cActive++;
+			}
+			else
+				rgpBlock[i] = rgIdle;
+		}
+
+		if(0 == cActive)
+			break;
+
+		TCompressLanes<TLanes>(rgState, rgpBlock);
+
+		for(INT i = 0; i < TLanes::LANES; i++)
+		{
+			SHA256_LANE* pLane = rgLane + i;
+
+			if(pLane->fActive && AdvanceLane(pLane))
+			{
+				BYTE* pbDigest = rgDigest[pLane->iMessage];
+				for(INT n = 0; n < 8; n++)
+				{
+					UINT32 nWord = rgState[n][i];
+					pbDigest[n * 4] = static_cast<BYTE>(nWord >> 24);
+					pbDigest[n * 4 + 1] = static_cast<BYTE>(nWord >> 16);
+					pbDigest[n * 4 + 2] = static_cast<BYTE>(nWord >> 8);
+					pbDigest[n * 4 + 3] = static_cast<BYTE>(nWord);
+				}
+				pLane->fActive = FALSE;
+			}
+		}
+	}
+
+	TLanes::Finish();
+
+	SecureZeroMemory(rgLane, sizeof(rgLane));
+	SecureZeroMemory(rgState, sizeof(rgState));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CSHA256x4
+///////////////////////////////////////////////////////////////////////////////
+
+VOID CSHA256x4::HashMany (const BYTE** rgpData, const SIZE_T* rgcb, SIZE_T cMessages, BYTE (*rgDigest)[SHA256_DIGEST_SIZE])
+{
+	THashMany<SSE2_LANES>(rgpData, rgcb, cMessages, rgDigest);
+}
+
+#ifdef	CPUFEATURES_AVX2
+
+///////////////////////////////////////////////////////////////////////////////
+// CSHA256x8
+///////////////////////////////////////////////////////////////////////////////
+
+VOID CSHA256x8::HashMany (const BYTE** rgpData, const SIZE_T* rgcb, SIZE_T cMessages, BYTE (*rgDigest)[SHA256_DIGEST_SIZE])
+{
+	THashMany<AVX2_LANES>(rgpData, rgcb, cMessages, rgDigest);
+}
+
+#endif
+
+#endif
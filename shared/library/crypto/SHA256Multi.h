@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CPUFeatures.h"
+#include "SHA256.h"
+
+// Multi-buffer SHA-256 engines.  Independent messages are assigned to SIMD lanes,
+// and a lane picks up the next message as soon as its current one completes, so
+// messages of different lengths still keep every lane busy.  Each digest is
+// bit-identical to the one CSHA256 produces for the same message.  Callers should
+// normally use CSHA256::HashMany(), which selects the widest supported engine.
+
+#ifdef	CPUFEATURES_SSE2
+
+// Four lanes using SSE2
+class CSHA256x4
+{
+public:
+	static VOID HashMany (const BYTE** rgpData, const SIZE_T* rgcb, SIZE_T cMessages, BYTE (*rgDigest)[SHA256_DIGEST_SIZE]);
+};
+
+#endif
+
+#ifdef	CPUFEATURES_AVX2
+
+// Eight lanes using AVX2
+class CSHA256x8
+{
+public:
+	static VOID HashMany (const BYTE** rgpData, const SIZE_T* rgcb, SIZE_T cMessages, BYTE (*rgDigest)[SHA256_DIGEST_SIZE]);
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include <windows.h>
 #include "Library\Core\CoreDefs.h"
 #include "SHA3.h"
+#include "SHA3Multi.h"
 
 #define	SHA3_ASSERT(x)
 
@@ -9,7 +10,15 @@
  * This flag is used to configure "pure" Keccak, as opposed to NIST SHA3.
  */
 #define	SHA3_USE_KECCAK_FLAG	0x80000000
-#define	SHA3_CW(x)				((x) & (~SHA3_USE_KECCAK_FLAG))
+
+/*
+ * This flag selects the SHAKE domain separation suffix.
+ */
+#define	SHA3_USE_SHAKE_FLAG		0x40000000
+
+#define	SHA3_MODE_FLAGS			(SHA3_USE_KECCAK_FLAG | SHA3_USE_SHAKE_FLAG)
+#define	SHA3_CW(x)				((x) & (~SHA3_MODE_FLAGS))
+#define	SHA3_RATE_BYTES(x)		((SHA3_KECCAK_SPONGE_WORDS - SHA3_CW(x)) * sizeof(ULONGLONG))
 
 #if defined(_MSC_VER)
 	#define	SHA3_CONST(x)		x
@@ -19,7 +28,13 @@
 
 #define	SHA3_ROTL64(x, y)		(((x) << (y)) | ((x) >> ((sizeof(ULONGLONG) * 8) - (y))))
 
-static const ULONGLONG keccakf_rndc[24] =
+#if defined(_MSC_VER)
+	#define	KECCAK_ROL64(x, y)	_rotl64(x, y)
+#else
+	#define	KECCAK_ROL64(x, y)	SHA3_ROTL64(x, y)
+#endif
+
+const ULONGLONG c_rgKeccakRoundConstants[24] =
 {
 	SHA3_CONST(0x0000000000000001UL), SHA3_CONST(0x0000000000008082UL),
 	SHA3_CONST(0x800000000000808aUL), SHA3_CONST(0x8000000080008000UL),
@@ -35,62 +50,175 @@ static const ULONGLONG keccakf_rndc[24] =
 	SHA3_CONST(0x0000000080000001UL), SHA3_CONST(0x8000000080008008UL)
 };
 
-static const unsigned keccakf_rotc[24] =
-{
-	1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14, 27, 41, 56, 8, 25, 43, 62,
-	18, 39, 61, 20, 44
-};
-
-static const unsigned keccakf_piln[24] =
-{
-	10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4, 15, 23, 19, 13, 12, 2, 20,
-	14, 22, 9, 6, 1
-};
+/* One round of Keccak-f[1600] from lanes A into lanes E, named by row (b, g, k, m, s)
+ * and column (a, e, i, o, u).  Lanes be, bi, go, ki, mi and sa are kept complemented
+ * between rounds, which lets Chi get by with a single NOT per row instead of five.
+ */
+#define	KECCAK_ROUND(A, E, nRound) \
+	Ca = A##ba ^ A##ga ^ A##ka ^ A##ma ^ A##sa; \
+	Ce = A##be ^ A##ge ^ A##ke ^ A##me ^ A##se; \
+	Ci = A##bi ^ A##gi ^ A##ki ^ A##mi ^ A##si; \
+	Co = A##bo ^ A##go ^ A##ko ^ A##mo ^ A##so; \
+	Cu = A##bu ^ A##gu ^ A##ku ^ A##mu ^ A##su; \
+	Da = Cu ^ KECCAK_ROL64(Ce, 1); \
+	De = Ca ^ KECCAK_ROL64(Ci, 1); \
+	Di = Ce ^ KECCAK_ROL64(Co, 1); \
+	Do = Ci ^ KECCAK_ROL64(Cu, 1); \
+	Du = Co ^ KECCAK_ROL64(Ca, 1); \
+	Bba = A##ba ^ Da; \
+	Bbe = KECCAK_ROL64(A##ge ^ De, 44); \
+	Bbi = KECCAK_ROL64(A##ki ^ Di, 43); \
+	Bbo = KECCAK_ROL64(A##mo ^ Do, 21); \
+	Bbu = KECCAK_ROL64(A##su ^ Du, 14); \
+	E##ba = Bba ^ (Bbe | Bbi) ^ c_rgKeccakRoundConstants[nRound]; \
+	E##be = Bbe ^ ((~Bbi) | Bbo); \
+	E##bi = Bbi ^ (Bbo & Bbu); \
+	E##bo = Bbo ^ (Bbu | Bba); \
+	E##bu = Bbu ^ (Bba & Bbe); \
+	Bga = KECCAK_ROL64(A##bo ^ Do, 28); \
+	Bge = KECCAK_ROL64(A##gu ^ Du, 20); \
+	Bgi = KECCAK_ROL64(A##ka ^ Da, 3); \
+	Bgo = KECCAK_ROL64(A##me ^ De, 45); \
+	Bgu = KECCAK_ROL64(A##si ^ Di, 61); \
+	E##ga = Bga ^ (Bge | Bgi); \
+	E##ge = Bge ^ (Bgi & Bgo); \
+	E##gi = Bgi ^ (Bgo | (~Bgu)); \
+	E##go = Bgo ^ (Bgu | Bga); \
+	E##gu = Bgu ^ (Bga & Bge); \
+	Bka = KECCAK_ROL64(A##be ^ De, 1); \
+	Bke = KECCAK_ROL64(A##gi ^ Di, 6); \
+	Bki = KECCAK_ROL64(A##ko ^ Do, 25); \
+	Bko = KECCAK_ROL64(A##mu ^ Du, 8); \
+	Bku = KECCAK_ROL64(A##sa ^ Da, 18); \
+	E##ka = Bka ^ (Bke | Bki); \
+	E##ke = Bke ^ (Bki & Bko); \
+	E##ki = Bki ^ ((~Bko) & Bku); \
+	E##ko = (~Bko) ^ (Bku | Bka); \
+	E##ku = Bku ^ (Bka & Bke); \
+	Bma = KECCAK_ROL64(A##bu ^ Du, 27); \
+	Bme = KECCAK_ROL64(A##ga ^ Da, 36); \
+	Bmi = KECCAK_ROL64(A##ke ^ De, 10); \
+	Bmo = KECCAK_ROL64(A##mi ^ Di, 15); \
+	Bmu = KECCAK_ROL64(A##so ^ Do, 56); \
+	E##ma = Bma ^ (Bme & Bmi); \
+	E##me = Bme ^ (Bmi | Bmo); \
+	E##mi = Bmi ^ ((~Bmo) | Bmu); \
+	E##mo = (~Bmo) ^ (Bmu & Bma); \
+	E##mu = Bmu ^ (Bma | Bme); \
+	Bsa = KECCAK_ROL64(A##bi ^ Di, 62); \
+	Bse = KECCAK_ROL64(A##go ^ Do, 55); \
+	Bsi = KECCAK_ROL64(A##ku ^ Du, 39); \
+	Bso = KECCAK_ROL64(A##ma ^ Da, 41); \
+	Bsu = KECCAK_ROL64(A##se ^ De, 2); \
+	E##sa = Bsa ^ ((~Bse) & Bsi); \
+	E##se = (~Bse) ^ (Bsi | Bso); \
+	E##si = Bsi ^ (Bso & Bsu); \
+	E##so = Bso ^ (Bsu | Bsa); \
+	E##su = Bsu ^ (Bsa & Bse);
 
 /* generally called after SHA3_KECCAK_SPONGE_WORDS-m_ctxKey.capacityWords words 
  * are XORed into the state s 
  */
 static void keccakf (ULONGLONG s[25])
 {
-    int i, j, round;
-    ULONGLONG t, bc[5];
-#define KECCAK_ROUNDS 24
-
-    for(round = 0; round < KECCAK_ROUNDS; round++)
-	{
-        /* Theta */
-        for(i = 0; i < 5; i++)
-            bc[i] = s[i] ^ s[i + 5] ^ s[i + 10] ^ s[i + 15] ^ s[i + 20];
-
-        for(i = 0; i < 5; i++)
-		{
-            t = bc[(i + 4) % 5] ^ SHA3_ROTL64(bc[(i + 1) % 5], 1);
-            for(j = 0; j < 25; j += 5)
-                s[j + i] ^= t;
-        }
-
-        /* Rho Pi */
-        t = s[1];
-        for(i = 0; i < 24; i++)
-		{
-            j = keccakf_piln[i];
-            bc[0] = s[j];
-            s[j] = SHA3_ROTL64(t, keccakf_rotc[i]);
-            t = bc[0];
-        }
-
-        /* Chi */
-        for(j = 0; j < 25; j += 5)
-		{
-            for(i = 0; i < 5; i++)
-                bc[i] = s[j + i];
-            for(i = 0; i < 5; i++)
-                s[j + i] ^= (~bc[(i + 1) % 5]) & bc[(i + 2) % 5];
-        }
-
-        /* Iota */
-        s[0] ^= keccakf_rndc[round];
-    }
+	ULONGLONG Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake, Aki,
+		Ako, Aku, Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu;
+	ULONGLONG Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu, Eka, Eke, Eki,
+		Eko, Eku, Ema, Eme, Emi, Emo, Emu, Esa, Ese, Esi, Eso, Esu;
+	ULONGLONG Bba, Bbe, Bbi, Bbo, Bbu, Bga, Bge, Bgi, Bgo, Bgu, Bka, Bke, Bki,
+		Bko, Bku, Bma, Bme, Bmi, Bmo, Bmu, Bsa, Bse, Bsi, Bso, Bsu;
+	ULONGLONG Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du;
+
+	Aba = s[0];
+	Abe = s[1];
+	Abi = s[2];
+	Abo = s[3];
+	Abu = s[4];
+	Aga = s[5];
+	Age = s[6];
+	Agi = s[7];
+	Ago = s[8];
+	Agu = s[9];
+	Aka = s[10];
+	Ake = s[11];
+	Aki = s[12];
+	Ako = s[13];
+	Aku = s[14];
+	Ama = s[15];
+	Ame = s[16];
+	Ami = s[17];
+	Amo = s[18];
+	Amu = s[19];
+	Asa = s[20];
+	Ase = s[21];
+	Asi = s[22];
+	Aso = s[23];
+	Asu = s[24];
+
+	Abe = ~Abe;
+	Abi = ~Abi;
+	Ago = ~Ago;
+	Aki = ~Aki;
+	Ami = ~Ami;
+	Asa = ~Asa;
+
+	KECCAK_ROUND(A, E, 0);
+	KECCAK_ROUND(E, A, 1);
+	KECCAK_ROUND(A, E, 2);
+	KECCAK_ROUND(E, A, 3);
+	KECCAK_ROUND(A, E, 4);
+	KECCAK_ROUND(E, A, 5);
+	KECCAK_ROUND(A, E, 6);
+	KECCAK_ROUND(E, A, 7);
+	KECCAK_ROUND(A, E, 8);
+	KECCAK_ROUND(E, A, 9);
+	KECCAK_ROUND(A, E, 10);
+	KECCAK_ROUND(E, A, 11);
+	KECCAK_ROUND(A, E, 12);
+	KECCAK_ROUND(E, A, 13);
+	KECCAK_ROUND(A, E, 14);
+	KECCAK_ROUND(E, A, 15);
+	KECCAK_ROUND(A, E, 16);
+	KECCAK_ROUND(E, A, 17);
+	KECCAK_ROUND(A, E, 18);
+	KECCAK_ROUND(E, A, 19);
+	KECCAK_ROUND(A, E, 20);
+	KECCAK_ROUND(E, A, 21);
+	KECCAK_ROUND(A, E, 22);
+	KECCAK_ROUND(E, A, 23);
+
+	Abe = ~Abe;
+	Abi = ~Abi;
+	Ago = ~Ago;
+	Aki = ~Aki;
+	Ami = ~Ami;
+	Asa = ~Asa;
+
+	s[0] = Aba;
+	s[1] = Abe;
+	s[2] = Abi;
+	s[3] = Abo;
+	s[4] = Abu;
+	s[5] = Aga;
+	s[6] = Age;
+	s[7] = Agi;
+	s[8] = Ago;
+	s[9] = Agu;
+	s[10] = Aka;
+	s[11] = Ake;
+	s[12] = Aki;
+	s[13] = Ako;
+	s[14] = Aku;
+	s[15] = Ama;
+	s[16] = Ame;
+	s[17] = Ami;
+	s[18] = Amo;
+	s[19] = Amu;
+	s[20] = Asa;
+	s[21] = Ase;
+	s[22] = Asi;
+	s[23] = Aso;
+	s[24] = Asu;
 }
 
 CSHA3::CSHA3 (UINT nBitSize, bool fUseKeccak) :
@@ -107,12 +235,11 @@ CSHA3::~CSHA3 ()
 
 VOID CSHA3::Reset (VOID)
 {
-	bool fUseKeccak = SHA3_USE_KECCAK_FLAG == (m_ctxKey.capacityWords & SHA3_USE_KECCAK_FLAG);
+	UINT nModeFlags = m_ctxKey.capacityWords & SHA3_MODE_FLAGS;
 
 	SecureZeroMemory(&m_ctxKey, sizeof(m_ctxKey));
 	m_ctxKey.capacityWords = 2 * m_nBitSize / (8 * sizeof(ULONGLONG));
-	if(fUseKeccak)
-		m_ctxKey.capacityWords |= SHA3_USE_KECCAK_FLAG;
+	m_ctxKey.capacityWords |= nModeFlags;
 }
 
 VOID CSHA3::AddData (const BYTE* pcbData, UINT cData)
@@ -205,7 +332,12 @@ VOID CSHA3::AddData (const BYTE* pcbData, UINT cData)
 
 UINT CSHA3::GetDigestSize (VOID)
 {
-	switch(m_nBitSize)
+	return DigestSizeFromBits(m_nBitSize);
+}
+
+UINT CSHA3::DigestSizeFromBits (UINT nBitSize)
+{
+	switch(nBitSize)
 	{
 	case 224:
 		return 28;
@@ -239,14 +371,52 @@ VOID CSHA3::GetHexKey (LPSTR lpszKey)
 	KeyToHex(Digest,GetDigestSize(),lpszKey);
 }
 
-VOID CSHA3::Finalize (SHA3_CONTEXT* pctx)
+VOID CSHA3::HashMany (UINT nBitSize, bool fUseKeccak, const BYTE** rgpData, const SIZE_T* rgcb, SIZE_T cMessages, PBYTE pbDigests)
 {
-	/* SHA3_TRACE("called with %d bytes in the buffer", ctxKey.byteIndex); */
+	UINT cbDigest = DigestSizeFromBits(nBitSize);
+
+	// A single message gains nothing from the lanes.
+#ifdef	CPUFEATURES_AVX2
+	if(1 < cMessages && CPUFeatures::HasAVX2())
+	{
+		UINT cbRate = (SHA3_KECCAK_SPONGE_WORDS - 2 * nBitSize / (8 * sizeof(ULONGLONG))) * sizeof(ULONGLONG);
+		CSHA3x4::HashMany(cbRate, fUseKeccak ? 0x01 : 0x06, cbDigest, rgpData, rgcb, cMessages, pbDigests);
+		return;
+	}
+#endif
+
+	CSHA3 sha3(nBitSize, fUseKeccak);
+
+	for(SIZE_T i = 0; i < cMessages; i++)
+	{
+		const BYTE* pcbData = rgpData[i];
+		SIZE_T cbData = rgcb[i];
+
+		sha3.Reset();
+
+		// AddData() takes a UINT count, so feed very large messages in pieces.
+		while(0 < cbData)
+		{
+			UINT cbChunk = static_cast<UINT>(min(cbData, 0x40000000));
+			sha3.AddData(pcbData, cbChunk);
+			pcbData += cbChunk;
+			cbData -= cbChunk;
+		}
+
+		sha3.GetDigest(pbDigests + i * cbDigest);
+	}
+}
 
+/* Appends the domain suffix and the final bit of the padding, then runs the last
+ * permutation.  Output can then be read from the start of the state.
+ */
+static VOID sha3Pad (SHA3_CONTEXT* pctx)
+{
 	/* Append 2-bit suffix 01, per SHA-3 spec. Instead of 1 for padding we
 	 * use 1<<2 below. The 0x02 below corresponds to the suffix 01.
 	 * Overall, we feed 0, then 1, and finally 1 to start padding. Without
-	 * M || 01, we would simply use 1 to start padding. */
+	 * M || 01, we would simply use 1 to start padding.  SHAKE appends the
+	 * suffix 1111 instead. */
 
 	ULONGLONG t;
 
@@ -255,6 +425,11 @@ VOID CSHA3::Finalize (SHA3_CONTEXT* pctx)
 		/* Keccak version */
 		t = (ULONGLONG)(((ULONGLONG) 1) << (pctx->byteIndex * 8));
 	}
+	else if(pctx->capacityWords & SHA3_USE_SHAKE_FLAG)
+	{
+		/* SHAKE version */
+		t = (ULONGLONG)(((ULONGLONG) 0x1F) << (pctx->byteIndex * 8));
+	}
 	else
 	{
 		/* SHA3 version */
@@ -266,6 +441,37 @@ VOID CSHA3::Finalize (SHA3_CONTEXT* pctx)
 	pctx->s[SHA3_KECCAK_SPONGE_WORDS - SHA3_CW(pctx->capacityWords) - 1] ^=
 		SHA3_CONST(0x8000000000000000UL);
 	keccakf(pctx->s);
+}
+
+/* Reads output bytes from a padded state, permuting again whenever a full rate
+ * of output has been consumed.  *piOffset tracks the position within the rate.
+ */
+static VOID sha3Squeeze (SHA3_CONTEXT* pctx, UINT* piOffset, PBYTE pbOutput, SIZE_T cbOutput)
+{
+	UINT cbRate = SHA3_RATE_BYTES(pctx->capacityWords);
+	UINT iOffset = *piOffset;
+
+	while(0 < cbOutput)
+	{
+		if(iOffset == cbRate)
+		{
+			keccakf(pctx->s);
+			iOffset = 0;
+		}
+
+		*pbOutput++ = (BYTE)(pctx->s[iOffset >> 3] >> ((iOffset & 7) * 8));
+		iOffset++;
+		cbOutput--;
+	}
+
+	*piOffset = iOffset;
+}
+
+VOID CSHA3::Finalize (SHA3_CONTEXT* pctx)
+{
+	/* SHA3_TRACE("called with %d bytes in the buffer", ctxKey.byteIndex); */
+
+	sha3Pad(pctx);
 
 	/* Return first bytes of the pctx->s. This conversion is not needed for
 	 * little-endian platforms e.g. wrap with #if !defined(__BYTE_ORDER__)
@@ -291,3 +497,68 @@ VOID CSHA3::Finalize (SHA3_CONTEXT* pctx)
 
 	/* SHA3_TRACE_BUF("Hash: (first 32 bytes)", pctx->sb, 256 / 8); */
 }
+
+///////////////////////////////////////////////////////////////////////////////
+// CShake
+///////////////////////////////////////////////////////////////////////////////
+
+CShake::CShake (UINT nSecurityBits, UINT cbDigest) :
+	CSHA3(nSecurityBits),
+	m_cbDigest(cbDigest ? cbDigest : nSecurityBits / 4)
+{
+	m_ctxKey.capacityWords |= SHA3_USE_SHAKE_FLAG;
+	Reset();
+}
+
+CShake::~CShake ()
+{
+	SecureZeroMemory(&m_ctxSqueeze, sizeof(m_ctxSqueeze));
+}
+
+VOID CShake::Squeeze (PBYTE pbOutput, SIZE_T cbOutput)
+{
+	if(!m_fSqueezing)
+	{
+		CopyMemory(&m_ctxSqueeze, &m_ctxKey, sizeof(m_ctxKey));
+		sha3Pad(&m_ctxSqueeze);
+		m_iSqueeze = 0;
+		m_fSqueezing = TRUE;
+	}
+
+	sha3Squeeze(&m_ctxSqueeze, &m_iSqueeze, pbOutput, cbOutput);
+}
+
+VOID CShake::Reset (VOID)
+{
+	CSHA3::Reset();
+	m_fSqueezing = FALSE;
+}
+
+UINT CShake::GetDigestSize (VOID)
+{
+	return m_cbDigest;
+}
+
+VOID CShake::GetDigest (LPBYTE lpDigest)
+{
+	SHA3_CONTEXT ctxKey;
+	UINT iOffset = 0;
+
+	CopyMemory(&ctxKey, &m_ctxKey, sizeof(m_ctxKey));
+	sha3Pad(&ctxKey);
+	sha3Squeeze(&ctxKey, &iOffset, lpDigest, m_cbDigest);
+	SecureZeroMemory(&ctxKey, sizeof(ctxKey));
+}
+
+VOID CShake::GetHexKey (LPSTR lpszKey)
+{
+	PBYTE pbDigest = __new BYTE[m_cbDigest];
+	if(pbDigest)
+	{
+		GetDigest(pbDigest);
+		KeyToHex(pbDigest, m_cbDigest, lpszKey);
+		__delete_array pbDigest;
+	}
+	else
+		*lpszKey = '\0';
+}
@@ -4,6 +4,12 @@
 
 #define	SHA3_KECCAK_SPONGE_WORDS	(((1600)/8/*bits to byte*/) / sizeof(ULONGLONG))
 
+//Largest sponge rate, which is SHAKE128's
+#define	SHA3_MAX_RATE_BYTES			168
+
+//Keccak-f[1600] round constants
+extern const ULONGLONG c_rgKeccakRoundConstants[24];
+
 struct SHA3_CONTEXT
 {
 	ULONGLONG saved;		/* the portion of the input message that we didn't consume yet */
@@ -42,6 +48,37 @@ public:
 	virtual UINT GetHexKeySize (VOID);
 	virtual VOID GetHexKey (LPSTR lpszKey);
 
+	// Hashes independent messages in parallel SIMD lanes when the processor allows it.
+	// Each digest is written to pbDigests at a stride of the digest size.
+	static VOID HashMany (UINT nBitSize, bool fUseKeccak, const BYTE** rgpData, const SIZE_T* rgcb, SIZE_T cMessages, PBYTE pbDigests);
+
 protected:
 	VOID Finalize (SHA3_CONTEXT* pctx);
+	static UINT DigestSizeFromBits (UINT nBitSize);
+};
+
+// SHAKE128 and SHAKE256 extendable-output functions.  As a CMessageDigest, the digest
+// is the first GetDigestSize() bytes of output.  Squeeze() reads output of any length
+// in sequence, and Reset() must be called before adding data to a new message.
+class CShake : public CSHA3
+{
+protected:
+	SHA3_CONTEXT m_ctxSqueeze;
+	UINT m_cbDigest;
+	UINT m_iSqueeze;		// Next output byte within the rate
+	BOOL m_fSqueezing;
+
+public:
+	// nSecurityBits is 128 or 256; cbDigest defaults to twice the security level.
+	CShake (UINT nSecurityBits, UINT cbDigest = 0);
+	~CShake ();
+
+	VOID Squeeze (PBYTE pbOutput, SIZE_T cbOutput);
+
+	virtual VOID Reset (VOID);
+
+	virtual UINT GetDigestSize (VOID);
+	virtual VOID GetDigest (LPBYTE lpDigest);
+
+	virtual VOID GetHexKey (LPSTR lpszKey);
 };
@@ -0,0 +1,181 @@
+#include <windows.h>
+#include "SHA3Multi.h"
+
+#ifdef	CPUFEATURES_AVX2
+
+#include <immintrin.h>
+
+#define	SHA3_LANES		4
+
+// Tracks the message currently assigned to a lane
+struct SHA3_LANE
+{
+	BOOL fActive;
+	SIZE_T iMessage;
+	const BYTE* pcbData;		// Next whole block of message data
+	SIZE_T cFullBlocks;			// Whole blocks remaining at pcbData
+	BYTE rgTail[SHA3_MAX_RATE_BYTES];
+};
+
+template <INT N>
+static inline __m256i Rol64 (__m256i x)
+{
+	return _mm256_or_si256(_mm256_slli_epi64(x, N), _mm256_srli_epi64(x, 64 - N));
+}
+
+// Keccak-f[1600] applied to four states at once, one per 64-bit lane
+static VOID KeccakF1600x4 (__m256i A[25])
+{
+	__m256i B[25], C[5], D[5];
+
+	for(INT nRound = 0; nRound < 24; nRound++)
+	{
+		// Theta
+		for(INT x = 0; x < 5; x++)
+			C[x] = _mm256_xor_si256(_mm256_xor_si256(_mm256_xor_si256(A[x], A[x + 5]), _mm256_xor_si256(A[x + 10], A[x + 15])), A[x + 20]);
+		for(INT x = 0; x < 5; x++)
+			D[x] = _mm256_xor_si256(C[(x + 4) % 5], Rol64<1>(C[(x + 1) % 5]));
+
+		// Rho and Pi
+		B[0] = _mm256_xor_si256(A[0], D[0]);
+		B[1] = Rol64<44>(_mm256_xor_si256(A[6], D[1]));
+		B[2] = Rol64<43>(_mm256_xor_si256(A[12], D[2]));
+		B[3] = Rol64<21>(_mm256_xor_si256(A[18], D[3]));
+		B[4] = Rol64<14>(_mm256_xor_si256(A[24], D[4]));
+		B[5] = Rol64<28>(_mm256_xor_si256(A[3], D[3]));
+		B[6] = Rol64<20>(_mm256_xor_si256(A[9], D[4]));
+		B[7] = Rol64<3>(_mm256_xor_si256(A[10], D[0]));
+		B[8] = Rol64<45>(_mm256_xor_si256(A[16], D[1]));
+		B[9] = Rol64<61>(_mm256_xor_si256(A[22], D[2]));
+		B[10] = Rol64<1>(_mm256_xor_si256(A[1], D[1]));
+		B[11] = Rol64<6>(_mm256_xor_si256(A[7], D[2]));
+		B[12] = Rol64<25>(_mm256_xor_si256(A[13], D[3]));
+		B[13] = Rol64<8>(_mm256_xor_si256(A[19], D[4]));
+		B[14] = Rol64<18>(_mm256_xor_si256(A[20], D[0]));
+		B[15] = Rol64<27>(_mm256_xor_si256(A[4], D[4]));
+		B[16] = Rol64<36>(_mm256_xor_si256(A[5], D[0]));
+		B[17] = Rol64<10>(_mm256_xor_si256(A[11], D[1]));
+		B[18] = Rol64<15>(_mm256_xor_si256(A[17], D[2]));
+		B[19] = Rol64<56>(_mm256_xor_si256(A[23], D[3]));
+		B[20] = Rol64<62>(_mm256_xor_si256(A[2], D[2]));
+		B[21] = Rol64<55>(_mm256_xor_si256(A[8], D[3]));
+		B[22] = Rol64<39>(_mm256_xor_si256(A[14], D[4]));
+		B[23] = Rol64<41>(_mm256_xor_si256(A[15], D[0]));
+		B[24] = Rol64<2>(_mm256_xor_si256(A[21], D[1]));
+
+		// Chi
+		for(INT y = 0; y < 25; y += 5)
+		{
+			A[y] = _mm256_xor_si256(B[y], _mm256_andnot_si256(B[y + 1], B[y + 2]));
+			A[y + 1] = _mm256_xor_si256(B[y + 1], _mm256_andnot_si256(B[y + 2], B[y + 3]));
+			A[y + 2] = _mm256_xor_si256(B[y + 2], _mm256_andnot_si256(B[y + 3], B[y + 4]));
+			A[y + 3] = _mm256_xor_si256(B[y + 3], _mm256_andnot_si256(B[y + 4], B[y]));
+			A[y + 4] = _mm256_xor_si256(B[y + 4], _mm256_andnot_si256(B[y], B[y + 1]));
+		}
+
+		// Iota
+		A[0] = _mm256_xor_si256(A[0], _mm256_set1_epi64x(static_cast<LONGLONG>(c_rgKeccakRoundConstants[nRound])));
+	}
+}
+
+static VOID StartLane (SHA3_LANE* pLane, SIZE_T iMessage, const BYTE* pcbData, SIZE_T cbData, UINT cbRate, BYTE bSuffix)
+{
+	SIZE_T cbTail = cbData % cbRate;
+
+	pLane->fActive = TRUE;
+	pLane->iMessage = iMessage;
+	pLane->pcbData = pcbData;
+	pLane->cFullBlocks = cbData / cbRate;
+
+	// The remainder is always shorter than the rate, so the suffix and the final
+	// padding bit fit in one block.
+	ZeroMemory(pLane->rgTail, cbRate);
+	CopyMemory(pLane->rgTail, pcbData + (cbData - cbTail), cbTail);
+	pLane->rgTail[cbTail] ^= bSuffix;
+	pLane->rgTail[cbRate - 1] ^= 0x80;
+}
+
+// Returns TRUE when the lane has absorbed its last block
+static BOOL AbsorbLane (SHA3_LANE* pLane, ULONGLONG* pnState, INT iLane, UINT cbRate)
+{
+	const BYTE* pcbBlock = (0 < pLane->cFullBlocks) ? pLane->pcbData : pLane->rgTail;
+	const ULONGLONG* pcnBlock = reinterpret_cast<const ULONGLONG*>(pcbBlock);
+
+	for(UINT n = 0; n < cbRate / sizeof(ULONGLONG); n++)
+		pnState[n * SHA3_LANES + iLane] ^= pcnBlock[n];
+
+	if(0 < pLane->cFullBlocks)
+	{
+		pLane->pcbData += cbRate;
+		pLane->cFullBlocks--;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CSHA3x4
+///////////////////////////////////////////////////////////////////////////////
+
+VOID CSHA3x4::HashMany (UINT cbRate, BYTE bSuffix, UINT cbDigest, const BYTE** rgpData, const SIZE_T* rgcb, SIZE_T cMessages, PBYTE pbDigests)
+{
+	SHA3_LANE rgLane[SHA3_LANES];
+	BOOL rgfFinished[SHA3_LANES];
+	__m256i rgState[SHA3_KECCAK_SPONGE_WORDS];
+	ULONGLONG* pnState = reinterpret_cast<ULONGLONG*>(rgState);
+	SIZE_T iNext = 0;
+
+	// Idle lanes run the permutation over whatever they hold and are ignored.
+	ZeroMemory(rgState, sizeof(rgState));
+	for(INT i = 0; i < SHA3_LANES; i++)
+		rgLane[i].fActive = FALSE;
+
+	for(;;)
+	{
+		INT cActive = 0;
+
+		for(INT i = 0; i < SHA3_LANES; i++)
+		{
+			SHA3_LANE* pLane = rgLane + i;
+
+			if(!pLane->fActive && iNext < cMessages)
+			{
+				StartLane(pLane, iNext, rgpData[iNext], rgcb[iNext], cbRate, bSuffix);
+				for(INT n = 0; n < SHA3_KECCAK_SPONGE_WORDS; n++)
+					pnState[n * SHA3_LANES + i] = 0;
+				iNext++;
+			}
+
+			rgfFinished[i] = FALSE;
+			if(pLane->fActive)
+			{
+				rgfFinished[i] = AbsorbLane(pLane, pnState, i, cbRate);
+				cActive++;
+			}
+		}
+
+		if(0 == cActive)
+			break;
+
+		KeccakF1600x4(rgState);
+
+		for(INT i = 0; i < SHA3_LANES; i++)
+		{
+			if(rgfFinished[i])
+			{
+				PBYTE pbDigest = pbDigests + rgLane[i].iMessage * cbDigest;
+				for(UINT n = 0; n < cbDigest; n++)
+					pbDigest[n] = static_cast<BYTE>(pnState[(n >> 3) * SHA3_LANES + i] >> ((n & 7) * 8));
+				rgLane[i].fActive = FALSE;
+			}
+		}
+	}
+
+	_mm256_zeroupper();
+
+	SecureZeroMemory(rgLane, sizeof(rgLane));
+	SecureZeroMemory(rgState, sizeof(rgState));
+}
+
+#endif
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "CPUFeatures.h"
+#include "SHA3.h"
+
+// Multi-buffer Keccak engine.  Four independent messages are absorbed in the 64-bit
+// lanes of AVX2 registers, and a lane picks up the next message as soon as its
+// current one completes.  Each digest is bit-identical to the one CSHA3 produces for
+// the same message.  Callers should normally use CSHA3::HashMany().
+
+#ifdef	CPUFEATURES_AVX2
+
+// Four lanes using AVX2
+class CSHA3x4
+{
+public:
+	// bSuffix is the domain separation byte (0x06 for SHA3, 0x01 for Keccak, 0x1F for SHAKE).
+	static VOID HashMany (UINT cbRate, BYTE bSuffix, UINT cbDigest, const BYTE** rgpData, const SIZE_T* rgcb, SIZE_T cMessages, PBYTE pbDigests);
+};
+
+#endif
@@ -0,0 +1,457 @@
+#include <windows.h>
+#include "SHA256.h"
+#include "SHAExtensions.h"
+
+#ifdef	CPUFEATURES_SHA
+
+#if defined(_M_IX86) || defined(_M_X64)
+
+#include <immintrin.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// x86 SHA extensions
+///////////////////////////////////////////////////////////////////////////////
+
+VOID SHA1ProcessBlocksExt (UINT32 rgState[5], const BYTE* pcbBlocks, SIZE_T cBlocks)
+{
+	// Reverses all sixteen bytes so that W[0] lands in the highest element
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090A0B0C0D0E0FULL);
+	__m128i abcd, abcdSave, e0, e0Save, e1;
+	__m128i msg0, msg1, msg2, msg3;
+
+	abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgState)), 0x1B);
+	e0 = _mm_set_epi32(static_cast<INT>(rgState[4]), 0, 0, 0);
+
+	while(0 < cBlocks)
+	{
+		abcdSave = abcd;
+		e0Save = e0;
+
+		// Rounds 0-3
+		msg0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pcbBlocks)), mask);
+		e0 = _mm_add_epi32(e0, msg0);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+		// Rounds 4-7
+		msg1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pcbBlocks + 16)), mask);
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+		// Rounds 8-11
+		msg2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pcbBlocks + 32)), mask);
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+
+		// Rounds 12-15
+		msg3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pcbBlocks + 48)), mask);
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+
+		// Rounds 16-19
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+
+		// Rounds 20-23
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		msg3 = _mm_xor_si128(msg3, msg1);
+
+		// Rounds 24-27
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+
+		// Rounds 28-31
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+
+		// Rounds 32-35
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+
+		// Rounds 36-39
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		msg3 = _mm_xor_si128(msg3, msg1);
+
+		// Rounds 40-43
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+
+		// Rounds 44-47
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+
+		// Rounds 48-51
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+
+		// Rounds 52-55
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		msg3 = _mm_xor_si128(msg3, msg1);
+
+		// Rounds 56-59
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+
+		// Rounds 60-63
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+
+		// Rounds 64-67
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+
+		// Rounds 68-71
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+		msg3 = _mm_xor_si128(msg3, msg1);
+
+		// Rounds 72-75
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+		// Rounds 76-79
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+		// Combine the state
+		e0 = _mm_sha1nexte_epu32(e0, e0Save);
+		abcd = _mm_add_epi32(abcd, abcdSave);
+
+		pcbBlocks += 64;
+		cBlocks--;
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(rgState), _mm_shuffle_epi32(abcd, 0x1B));
+	rgState[4] = static_cast<UINT32>(_mm_extract_epi32(e0, 3));
+}
+
+VOID SHA256ProcessBlocksExt (UINT32 rgState[8], const BYTE* pcbBlocks, SIZE_T cBlocks)
+{
+	// Converts each big-endian message word to host order
+	const __m128i mask = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+	__m128i state0, state1, abefSave, cdghSave;
+	__m128i msg, tmp, msg0, msg1, msg2, msg3;
+
+	// The round instructions want the state split as ABEF and CDGH.
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgState)), 0xB1);
+	state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgState + 4)), 0x1B);
+	state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+	while(0 < cBlocks)
+	{
+		abefSave = state0;
+		cdghSave = state1;
+
+		// Rounds 0-3
+		msg0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pcbBlocks)), mask);
+		msg = _mm_add_epi32(msg0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+		// Rounds 4-7
+		msg1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pcbBlocks + 16)), mask);
+		msg = _mm_add_epi32(msg1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 4)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		msg0 = _mm_sha256msg1_epu32(msg0, msg1);
+
+		// Rounds 8-11
+		msg2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pcbBlocks + 32)), mask);
+		msg = _mm_add_epi32(msg2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 8)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		msg1 = _mm_sha256msg1_epu32(msg1, msg2);
+
+		// Rounds 12-15
+		msg3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pcbBlocks + 48)), mask);
+		msg = _mm_add_epi32(msg3, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 12)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		tmp = _mm_alignr_epi8(msg3, msg2, 4);
+		msg0 = _mm_sha256msg2_epu32(_mm_add_epi32(msg0, tmp), msg3);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		msg2 = _mm_sha256msg1_epu32(msg2, msg3);
+
+		// Rounds 16-19
+		msg = _mm_add_epi32(msg0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 16)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		tmp = _mm_alignr_epi8(msg0, msg3, 4);
+		msg1 = _mm_sha256msg2_epu32(_mm_add_epi32(msg1, tmp), msg0);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		msg3 = _mm_sha256msg1_epu32(msg3, msg0);
+
+		// Rounds 20-23
+		msg = _mm_add_epi32(msg1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 20)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		tmp = _mm_alignr_epi8(msg1, msg0, 4);
+		msg2 = _mm_sha256msg2_epu32(_mm_add_epi32(msg2, tmp), msg1);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		msg0 = _mm_sha256msg1_epu32(msg0, msg1);
+
+		// Rounds 24-27
+		msg = _mm_add_epi32(msg2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 24)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		tmp = _mm_alignr_epi8(msg2, msg1, 4);
+		msg3 = _mm_sha256msg2_epu32(_mm_add_epi32(msg3, tmp), msg2);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		msg1 = _mm_sha256msg1_epu32(msg1, msg2);
+
+		// Rounds 28-31
+		msg = _mm_add_epi32(msg3, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 28)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		tmp = _mm_alignr_epi8(msg3, msg2, 4);
+		msg0 = _mm_sha256msg2_epu32(_mm_add_epi32(msg0, tmp), msg3);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		msg2 = _mm_sha256msg1_epu32(msg2, msg3);
+
+		// Rounds 32-35
+		msg = _mm_add_epi32(msg0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 32)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		tmp = _mm_alignr_epi8(msg0, msg3, 4);
+		msg1 = _mm_sha256msg2_epu32(_mm_add_epi32(msg1, tmp), msg0);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		msg3 = _mm_sha256msg1_epu32(msg3, msg0);
+
+		// Rounds 36-39
+		msg = _mm_add_epi32(msg1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 36)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		tmp = _mm_alignr_epi8(msg1, msg0, 4);
+		msg2 = _mm_sha256msg2_epu32(_mm_add_epi32(msg2, tmp), msg1);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		msg0 = _mm_sha256msg1_epu32(msg0, msg1);
+
+		// Rounds 40-43
+		msg = _mm_add_epi32(msg2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 40)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		tmp = _mm_alignr_epi8(msg2, msg1, 4);
+		msg3 = _mm_sha256msg2_epu32(_mm_add_epi32(msg3, tmp), msg2);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		msg1 = _mm_sha256msg1_epu32(msg1, msg2);
+
+		// Rounds 44-47
+		msg = _mm_add_epi32(msg3, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 44)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		tmp = _mm_alignr_epi8(msg3, msg2, 4);
+		msg0 = _mm_sha256msg2_epu32(_mm_add_epi32(msg0, tmp), msg3);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		msg2 = _mm_sha256msg1_epu32(msg2, msg3);
+
+		// Rounds 48-51
+		msg = _mm_add_epi32(msg0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 48)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		tmp = _mm_alignr_epi8(msg0, msg3, 4);
+		msg1 = _mm_sha256msg2_epu32(_mm_add_epi32(msg1, tmp), msg0);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		msg3 = _mm_sha256msg1_epu32(msg3, msg0);
+
+		// Rounds 52-55
+		msg = _mm_add_epi32(msg1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 52)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		tmp = _mm_alignr_epi8(msg1, msg0, 4);
+		msg2 = _mm_sha256msg2_epu32(_mm_add_epi32(msg2, tmp), msg1);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+		// Rounds 56-59
+		msg = _mm_add_epi32(msg2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 56)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		tmp = _mm_alignr_epi8(msg2, msg1, 4);
+		msg3 = _mm_sha256msg2_epu32(_mm_add_epi32(msg3, tmp), msg2);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+		// Rounds 60-63
+		msg = _mm_add_epi32(msg3, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_rgSHA256RoundConstants + 60)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		msg = _mm_shuffle_epi32(msg, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+		// Combine the state
+		state0 = _mm_add_epi32(state0, abefSave);
+		state1 = _mm_add_epi32(state1, cdghSave);
+
+		pcbBlocks += 64;
+		cBlocks--;
+	}
+
+	// Return to ABCD and EFGH order
+	tmp = _mm_shuffle_epi32(state0, 0x1B);
+	state1 = _mm_shuffle_epi32(state1, 0xB1);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(rgState), _mm_blend_epi16(tmp, state1, 0xF0));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(rgState + 4), _mm_alignr_epi8(state1, tmp, 8));
+}
+
+#else
+
+#include <arm64_neon.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// ARMv8 cryptography extensions
+///////////////////////////////////////////////////////////////////////////////
+
+static inline uint32x4_t LoadBigEndian (const BYTE* pcb)
+{
+	return vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(pcb)));
+}
+
+VOID SHA1ProcessBlocksExt (UINT32 rgState[5], const BYTE* pcbBlocks, SIZE_T cBlocks)
+{
+	static const UINT32 c_rgK[4] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+	uint32x4_t abcd = vld1q_u32(rgState);
+	UINT32 e = rgState[4];
+
+	while(0 < cBlocks)
+	{
+		uint32x4_t abcdSave = abcd, msg[4];
+		UINT32 eSave = e;
+
+		for(INT i = 0; i < 4; i++)
+			msg[i] = LoadBigEndian(pcbBlocks + i * 16);
+
+		for(INT g = 0; g < 20; g++)
+		{
+			uint32x4_t wk = vaddq_u32(msg[g & 3], vdupq_n_u32(c_rgK[g / 5]));
+			UINT32 eNext = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+
+			if(g < 5)
+				abcd = vsha1cq_u32(abcd, e, wk);
+			else if(g < 10 || g >= 15)
+				abcd = vsha1pq_u32(abcd, e, wk);
+			else
+				abcd = vsha1mq_u32(abcd, e, wk);
+			e = eNext;
+
+			// Expand the schedule four words ahead of the rounds that use it
+			if(g < 16)
+				msg[g & 3] = vsha1su1q_u32(vsha1su0q_u32(msg[g & 3], msg[(g + 1) & 3], msg[(g + 2) & 3]), msg[(g + 3) & 3]);
+		}
+
+		abcd = vaddq_u32(abcd, abcdSave);
+		e += eSave;
+
+		pcbBlocks += 64;
+		cBlocks--;
+	}
+
+	vst1q_u32(rgState, abcd);
+	rgState[4] = e;
+}
+
+VOID SHA256ProcessBlocksExt (UINT32 rgState[8], const BYTE* pcbBlocks, SIZE_T cBlocks)
+{
+	uint32x4_t state0 = vld1q_u32(rgState);
+	uint32x4_t state1 = vld1q_u32(rgState + 4);
+
+	while(0 < cBlocks)
+	{
+		uint32x4_t abcdSave = state0, efghSave = state1, msg[4];
+
+		for(INT i = 0; i < 4; i++)
+			msg[i] = LoadBigEndian(pcbBlocks + i * 16);
+
+		for(INT g = 0; g < 16; g++)
+		{
+			uint32x4_t wk = vaddq_u32(msg[g & 3], vld1q_u32(c_rgSHA256RoundConstants + g * 4));
+			uint32x4_t tmp = state0;
+
+			state0 = vsha256hq_u32(state0, state1, wk);
+			state1 = vsha256h2q_u32(state1, tmp, wk);
+
+			// Expand the schedule four words ahead of the rounds that use it
+			if(g < 12)
+				msg[g & 3] = vsha256su1q_u32(vsha256su0q_u32(msg[g & 3], msg[(g + 1) & 3]), msg[(g + 2) & 3], msg[(g + 3) & 3]);
+		}
+
+		state0 = vaddq_u32(state0, abcdSave);
+		state1 = vaddq_u32(state1, efghSave);
+
+		pcbBlocks += 64;
+		cBlocks--;
+	}
+
+	vst1q_u32(rgState, state0);
+	vst1q_u32(rgState + 4, state1);
+}
+
+#endif
+
+#endif
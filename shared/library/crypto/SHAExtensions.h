@@ -0,0 +1,15 @@
+#pragma once
+
+#include "CPUFeatures.h"
+
+// Block compression functions built on the x86 SHA extensions (SHA-NI) or the
+// ARMv8 SHA1/SHA2 instructions.  They share the state layout and block format of
+// the portable code in SHA1.cpp and SHA256.cpp, which selects them at run time
+// when CPUFeatures::HasSHA() reports support.
+
+#ifdef	CPUFEATURES_SHA
+
+VOID SHA1ProcessBlocksExt (UINT32 rgState[5], const BYTE* pcbBlocks, SIZE_T cBlocks);
+VOID SHA256ProcessBlocksExt (UINT32 rgState[8], const BYTE* pcbBlocks, SIZE_T cBlocks);
+
+#endif
@@ -0,0 +1,245 @@
+#include <windows.h>
+#include "..\Core\CoreDefs.h"
+#include "..\Util\WorkerPool.h"
+#include "Secp256k1Benchmark.h"
+
+#define	SECP256K1_BENCHMARK_SIGNATURES	4096
+
+#define	CB_HASH							32
+#define	CB_SIGNATURE					64
+#define	CB_ECDSA_KEY					33
+#define	CB_XONLY_KEY					32
+#define	CB_PER_SIGNATURE				(CB_HASH + CB_SIGNATURE + CB_ECDSA_KEY + CB_HASH + CB_SIGNATURE + CB_XONLY_KEY)
+
+// Cheap, repeatable pattern so every run verifies the same signatures
+static VOID FillPattern (ULONG& nSeed, PBYTE pbData, INT cbData)
+{
+	for(INT i = 0; i < cbData; i++)
+	{
+		nSeed = nSeed * 1664525 + 1013904223;
+		pbData[i] = static_cast<BYTE>(nSeed >> 24);
+	}
+}
+
+static const BENCHMARK_COLUMN c_rgColumns[] =
+{
+	{ "scheme", "scheme", BENCHMARK_COLUMN_STRING, offsetof(SECP256K1_BENCHMARK_RESULT, pcszName) },
+	{ "threads", "threads", BENCHMARK_COLUMN_INT, offsetof(SECP256K1_BENCHMARK_RESULT, cThreads) },
+	{ "signatures", "signatures", BENCHMARK_COLUMN_SIZE, offsetof(SECP256K1_BENCHMARK_RESULT, cSignatures) },
+	{ "iterations", "iterations", BENCHMARK_COLUMN_ULONGLONG, offsetof(SECP256K1_BENCHMARK_RESULT, cIterations) },
+	{ "signatures_per_second", "signaturesPerSecond", BENCHMARK_COLUMN_RATE, offsetof(SECP256K1_BENCHMARK_RESULT, dblSignaturesPerSecond) }
+};
+
+// Every signature must verify, so any other result fails the measurement.
+class CSecp256k1Benchmark::CWorkload : public IBenchmarkWorkload
+{
+public:
+	CSecp256k1Verifier* m_pVerifier;
+	const SECP256K1_ECDSA_ITEM* m_prgEcdsa;
+	const SECP256K1_SCHNORR_ITEM* m_prgSchnorr;		// NULL for ECDSA
+	SIZE_T m_cSignatures;
+
+	virtual HRESULT RunBatch (ULONGLONG cIterations);
+};
+
+HRESULT CSecp256k1Benchmark::CWorkload::RunBatch (ULONGLONG cIterations)
+{
+	HRESULT hr = S_OK;
+
+	for(ULONGLONG n = 0; n < cIterations; n++)
+	{
+		if(m_prgSchnorr)
+			hr = m_pVerifier->VerifySchnorr(m_prgSchnorr, m_cSignatures, NULL);
+		else
+			hr = m_pVerifier->VerifyEcdsa(m_prgEcdsa, m_cSignatures, NULL);
+		CheckIf(S_OK != hr, FAILED(hr) ? hr : E_FAIL);
+	}
+
+Cleanup:
+	return hr;
+}
+
+CSecp256k1Benchmark::CSecp256k1Benchmark (DWORD msMinimum) :
+	m_msMinimum(msMinimum),
+	m_pbData(NULL),
+	m_prgEcdsa(NULL),
+	m_prgSchnorr(NULL),
+	m_cSignatures(0)
+{
+}
+
+CSecp256k1Benchmark::~CSecp256k1Benchmark ()
+{
+	FreeData();
+}
+
+HRESULT CSecp256k1Benchmark::Prepare (SIZE_T cSignatures)
+{
+	HRESULT hr;
+	secp256k1_context* pContext = NULL;
+	ULONG nSeed = 0x2545F491;
+	PBYTE pbNext;
+
+	CheckIf(0 == cSignatures, E_INVALIDARG);
+
+	FreeData();
+
+	pContext = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+	CheckAlloc(pContext);
+
+	m_pbData = __new BYTE[cSignatures * CB_PER_SIGNATURE];
+	CheckAlloc(m_pbData);
+	m_prgEcdsa = __new SECP256K1_ECDSA_ITEM[cSignatures];
+	CheckAlloc(m_prgEcdsa);
+	m_prgSchnorr = __new SECP256K1_SCHNORR_ITEM[cSignatures];
+	CheckAlloc(m_prgSchnorr);
+
+	pbNext = m_pbData;
+	for(SIZE_T i = 0; i < cSignatures; i++)
+	{
+		SECP256K1_ECDSA_ITEM* pEcdsa = m_prgEcdsa + i;
+		SECP256K1_SCHNORR_ITEM* pSchnorr = m_prgSchnorr + i;
+		BYTE rgSecret[32];
+		secp256k1_pubkey pubkey;
+		secp256k1_ecdsa_signature sig;
+		secp256k1_keypair keypair;
+		secp256k1_xonly_pubkey xonly;
+		size_t cbKey = CB_ECDSA_KEY;
+
+		do
+		{
+			FillPattern(nSeed, rgSecret, sizeof(rgSecret));
+		} while(!secp256k1_ec_seckey_verify(pContext, rgSecret));
+
+		pEcdsa->pcbHash = pbNext;
+		FillPattern(nSeed, pbNext, CB_HASH);
+		pbNext += CB_HASH;
+
+		CheckIf(!secp256k1_ecdsa_sign(pContext, &sig, pEcdsa->pcbHash, rgSecret, NULL, NULL), E_FAIL);
+		secp256k1_ecdsa_signature_serialize_compact(pContext, pbNext, &sig);
+		pEcdsa->pcbSignature = pbNext;
+		pbNext += CB_SIGNATURE;
+
+		CheckIf(!secp256k1_ec_pubkey_create(pContext, &pubkey, rgSecret), E_FAIL);
+		secp256k1_ec_pubkey_serialize(pContext, pbNext, &cbKey, &pubkey, SECP256K1_EC_COMPRESSED);
+		pEcdsa->pcbPublicKey = pbNext;
+		pEcdsa->cbPublicKey = static_cast<UINT>(cbKey);
+		pbNext += CB_ECDSA_KEY;
+
+		pSchnorr->pcbMessage = pbNext;
+		FillPattern(nSeed, pbNext, CB_HASH);
+		pbNext += CB_HASH;
+
+		CheckIf(!secp256k1_keypair_create(pContext, &keypair, rgSecret), E_FAIL);
+		CheckIf(!secp256k1_schnorrsig_sign(pContext, pbNext, pSchnorr->pcbMessage, &keypair, NULL, NULL), E_FAIL);
+		pSchnorr->pcbSignature = pbNext;
+		pbNext += CB_SIGNATURE;
+
+		CheckIf(!secp256k1_keypair_xonly_pub(pContext, &xonly, NULL, &keypair), E_FAIL);
+		secp256k1_xonly_pubkey_serialize(pContext, pbNext, &xonly);
+		pSchnorr->pcbPublicKey = pbNext;
+		pbNext += CB_XONLY_KEY;
+	}
+
+	m_cSignatures = cSignatures;
+	hr = S_OK;
+
+Cleanup:
+	if(pContext)
+		secp256k1_context_destroy(pContext);
+	if(FAILED(hr))
+		FreeData();
+	return hr;
+}
+
+HRESULT CSecp256k1Benchmark::Run (INT cThreads)
+{
+	HRESULT hr;
+	CWorkerPool pool;
+	CSecp256k1Verifier verifier;
+
+	CheckIf(0 >= cThreads, E_INVALIDARG);
+
+	if(0 == m_cSignatures)
+		Check(Prepare(SECP256K1_BENCHMARK_SIGNATURES));
+
+	if(1 < cThreads)
+	{
+		Check(pool.Initialize(cThreads - 1));
+		Check(verifier.Initialize(&pool));
+	}
+	else
+		Check(verifier.Initialize(NULL));
+
+	Check(Measure("ECDSA", &verifier, FALSE, cThreads));
+
+	verifier.EnableSchnorrBatch(FALSE);
+	Check(Measure("Schnorr", &verifier, TRUE, cThreads));
+
+	verifier.EnableSchnorrBatch(TRUE);
+	Check(Measure("Schnorr (batch)", &verifier, TRUE, cThreads));
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CSecp256k1Benchmark::RunStandardSuite (VOID)
+{
+	HRESULT hr = S_OK;
+	SYSTEM_INFO si;
+	INT cProcessors;
+
+	GetSystemInfo(&si);
+	cProcessors = static_cast<INT>(si.dwNumberOfProcessors);
+
+	for(INT cThreads = 1; ; cThreads <<= 1)
+	{
+		if(cThreads > cProcessors)
+			cThreads = cProcessors;
+
+		Check(Run(cThreads));
+
+		if(cThreads == cProcessors)
+			break;
+	}
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CSecp256k1Benchmark::Write (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat)
+{
+	return Benchmark::TWrite(pStream, eFormat, c_rgColumns, m_aResults);
+}
+
+VOID CSecp256k1Benchmark::FreeData (VOID)
+{
+	SafeDeleteArray(m_prgSchnorr);
+	SafeDeleteArray(m_prgEcdsa);
+	SafeDeleteArray(m_pbData);
+	m_cSignatures = 0;
+}
+
+HRESULT CSecp256k1Benchmark::Measure (PCSTR pcszName, CSecp256k1Verifier* pVerifier, BOOL fSchnorr, INT cThreads)
+{
+	HRESULT hr;
+	CWorkload workload;
+	BENCHMARK_TIMING timing;
+	SECP256K1_BENCHMARK_RESULT* pResult;
+
+	workload.m_pVerifier = pVerifier;
+	workload.m_prgEcdsa = m_prgEcdsa;
+	workload.m_prgSchnorr = fSchnorr ? m_prgSchnorr : NULL;
+	workload.m_cSignatures = m_cSignatures;
+	Check(Benchmark::Measure(&workload, m_msMinimum, &timing));
+
+	Check(m_aResults.AppendSlot(&pResult));
+	pResult->pcszName = pcszName;
+	pResult->cThreads = cThreads;
+	pResult->cSignatures = m_cSignatures;
+	pResult->cIterations = timing.cIterations;
+	pResult->dblSignaturesPerSecond = static_cast<DOUBLE>(timing.cIterations) * static_cast<DOUBLE>(m_cSignatures) / timing.dblSeconds;
+
+Cleanup:
+	return hr;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "..\Core\Array.h"
+#include "..\Util\Benchmark.h"
+#include "Secp256k1Verifier.h"
+
+// Verification throughput of CSecp256k1Verifier for each thread count, in the manner
+// of the library's bench_verify and bench_schnorrsig programs.  A fixed set of
+// signatures is generated once and verified repeatedly until the minimum measuring
+// time has elapsed.
+
+struct SECP256K1_BENCHMARK_RESULT
+{
+	PCSTR pcszName;
+	INT cThreads;
+	SIZE_T cSignatures;
+	ULONGLONG cIterations;
+	DOUBLE dblSignaturesPerSecond;
+};
+
+class CSecp256k1Benchmark
+{
+private:
+	class CWorkload;
+
+	TArray<SECP256K1_BENCHMARK_RESULT> m_aResults;
+	DWORD m_msMinimum;
+
+	PBYTE m_pbData;
+	SECP256K1_ECDSA_ITEM* m_prgEcdsa;
+	SECP256K1_SCHNORR_ITEM* m_prgSchnorr;
+	SIZE_T m_cSignatures;
+
+public:
+	CSecp256k1Benchmark (DWORD msMinimum = 200);
+	~CSecp256k1Benchmark ();
+
+	// Generates cSignatures keys, messages and signatures of each kind.
+	HRESULT Prepare (SIZE_T cSignatures);
+
+	// Measures ECDSA, individual Schnorr and batched Schnorr verification with
+	// cThreads threads, including the calling thread.
+	HRESULT Run (INT cThreads);
+
+	// One thread, then doubling up to the processor count
+	HRESULT RunStandardSuite (VOID);
+
+	HRESULT Write (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat);
+
+	inline sysint Length (VOID) const { return m_aResults.Length(); }
+	inline const SECP256K1_BENCHMARK_RESULT* GetResult (sysint n) const { return &m_aResults[n]; }
+	inline VOID Clear (VOID) { m_aResults.Clear(); }
+
+private:
+	VOID FreeData (VOID);
+	HRESULT Measure (PCSTR pcszName, CSecp256k1Verifier* pVerifier, BOOL fSchnorr, INT cThreads);
+};
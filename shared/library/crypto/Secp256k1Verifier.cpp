@@ -0,0 +1,226 @@
+#include <windows.h>
+#include "..\Core\CoreDefs.h"
+#include "..\Util\WorkerPool.h"
+#include "Secp256k1Verifier.h"
+
+// Items handed to a worker at a time.  This matches the number of signatures the
+// library combines into each batch multiplication.
+#define	SECP256K1_VERIFY_BLOCK		64
+
+// Scratch space for each worker's batch multiplications
+#define	SECP256K1_VERIFY_SCRATCH	(1024 * 1024)
+
+struct SECP256K1_VERIFY_JOB
+{
+	CSecp256k1Verifier* pVerifier;
+	const VOID* pcvItems;
+	SIZE_T cItems;
+	BOOL* prgfValid;
+	BOOL fSchnorr;
+	volatile LONG fAllValid;
+};
+
+CSecp256k1Verifier::CSecp256k1Verifier () :
+	m_pContext(NULL),
+	m_pPool(NULL),
+	m_prgScratch(NULL),
+	m_cScratch(0),
+	m_fBatchSchnorr(TRUE)
+{
+}
+
+CSecp256k1Verifier::~CSecp256k1Verifier ()
+{
+	Clear();
+}
+
+HRESULT CSecp256k1Verifier::Initialize (__in_opt CWorkerPool* pPool)
+{
+	HRESULT hr;
+	INT cWorkers = pPool ? pPool->GetWorkerCount() : 1;
+
+	Clear();
+
+	m_pContext = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+	CheckAlloc(m_pContext);
+
+	m_prgScratch = __new secp256k1_scratch_space*[cWorkers];
+	CheckAlloc(m_prgScratch);
+	ZeroMemory(m_prgScratch, sizeof(secp256k1_scratch_space*) * cWorkers);
+	m_cScratch = cWorkers;
+
+	for(INT i = 0; i < cWorkers; i++)
+	{
+		m_prgScratch[i] = secp256k1_scratch_space_create(m_pContext, SECP256K1_VERIFY_SCRATCH);
+		CheckAlloc(m_prgScratch[i]);
+	}
+
+	m_pPool = pPool;
+	hr = S_OK;
+
+Cleanup:
+	if(FAILED(hr))
+		Clear();
+	return hr;
+}
+
+HRESULT CSecp256k1Verifier::VerifyEcdsa (const SECP256K1_ECDSA_ITEM* prgItems, SIZE_T cItems, __out_ecount_opt(cItems) BOOL* prgfValid)
+{
+	return Verify(prgItems, cItems, prgfValid, FALSE);
+}
+
+HRESULT CSecp256k1Verifier::VerifySchnorr (const SECP256K1_SCHNORR_ITEM* prgItems, SIZE_T cItems, __out_ecount_opt(cItems) BOOL* prgfValid)
+{
+	return Verify(prgItems, cItems, prgfValid, TRUE);
+}
+
+VOID CSecp256k1Verifier::Clear (VOID)
+{
+	if(m_prgScratch)
+	{
+		for(INT i = 0; i < m_cScratch; i++)
+		{
+			if(m_prgScratch[i])
+				secp256k1_scratch_space_destroy(m_pContext, m_prgScratch[i]);
+		}
+		SafeDeleteArray(m_prgScratch);
+	}
+	m_cScratch = 0;
+
+	if(m_pContext)
+	{
+		secp256k1_context_destroy(m_pContext);
+		m_pContext = NULL;
+	}
+
+	m_pPool = NULL;
+}
+
+HRESULT CSecp256k1Verifier::Verify (const VOID* pcvItems, SIZE_T cItems, BOOL* prgfValid, BOOL fSchnorr)
+{
+	HRESULT hr;
+	SECP256K1_VERIFY_JOB job;
+	SIZE_T cBlocks = (cItems + SECP256K1_VERIFY_BLOCK - 1) / SECP256K1_VERIFY_BLOCK;
+
+	CheckIf(NULL == m_pContext, E_UNEXPECTED);
+	CheckIf(NULL == pcvItems && 0 < cItems, E_INVALIDARG);
+
+	job.pVerifier = this;
+	job.pcvItems = pcvItems;
+	job.cItems = cItems;
+	job.prgfValid = prgfValid;
+	job.fSchnorr = fSchnorr;
+	job.fAllValid = TRUE;
+
+	if(m_pPool && 1 < cBlocks)
+		Check(m_pPool->ParallelFor(cBlocks, _VerifyBlock, &job));
+	else
+	{
+		for(SIZE_T i = 0; i < cBlocks; i++)
+			_VerifyBlock(&job, i, 0);
+	}
+
+	hr = job.fAllValid ? S_OK : S_FALSE;
+
+Cleanup:
+	return hr;
+}
+
+VOID CSecp256k1Verifier::VerifyEcdsaBlock (const SECP256K1_ECDSA_ITEM* prgItems, SIZE_T cItems, BOOL* prgfValid, volatile LONG* pfAllValid)
+{
+	for(SIZE_T i = 0; i < cItems; i++)
+	{
+		const SECP256K1_ECDSA_ITEM* pcItem = prgItems + i;
+		secp256k1_pubkey pubkey;
+		secp256k1_ecdsa_signature sig;
+		BOOL fValid = secp256k1_ec_pubkey_parse(m_pContext, &pubkey, pcItem->pcbPublicKey, pcItem->cbPublicKey) &&
+			secp256k1_ecdsa_signature_parse_compact(m_pContext, &sig, pcItem->pcbSignature) &&
+			secp256k1_ecdsa_verify(m_pContext, &sig, pcItem->pcbHash, &pubkey);
+
+		if(prgfValid)
+			prgfValid[i] = fValid;
+
+		if(!fValid)
+		{
+			InterlockedExchange(pfAllValid, FALSE);
+
+			// Without per-item results, one failure settles the answer.
+			if(NULL == prgfValid)
+				break;
+		}
+	}
+}
+
+VOID CSecp256k1Verifier::VerifySchnorrBlock (const SECP256K1_SCHNORR_ITEM* prgItems, SIZE_T cItems, BOOL* prgfValid, volatile LONG* pfAllValid, INT iWorker)
+{
+	secp256k1_xonly_pubkey rgKeys[SECP256K1_VERIFY_BLOCK];
+	const secp256k1_xonly_pubkey* rgpcKeys[SECP256K1_VERIFY_BLOCK];
+	const BYTE* rgpcbSignatures[SECP256K1_VERIFY_BLOCK];
+	const BYTE* rgpcbMessages[SECP256K1_VERIFY_BLOCK];
+	BOOL rgfParsed[SECP256K1_VERIFY_BLOCK];
+	BOOL fAllParsed = TRUE;
+
+	for(SIZE_T i = 0; i < cItems; i++)
+	{
+		rgfParsed[i] = secp256k1_xonly_pubkey_parse(m_pContext, rgKeys + i, prgItems[i].pcbPublicKey);
+		if(!rgfParsed[i])
+			fAllParsed = FALSE;
+
+		rgpcKeys[i] = rgKeys + i;
+		rgpcbSignatures[i] = prgItems[i].pcbSignature;
+		rgpcbMessages[i] = prgItems[i].pcbMessage;
+	}
+
+	if(m_fBatchSchnorr && fAllParsed)
+	{
+		if(secp256k1_schnorrsig_verify_batch(m_pContext, m_prgScratch[iWorker], rgpcbSignatures, rgpcbMessages, rgpcKeys, cItems))
+		{
+			if(prgfValid)
+			{
+				for(SIZE_T i = 0; i < cItems; i++)
+					prgfValid[i] = TRUE;
+			}
+			return;
+		}
+
+		// The batch only says that something failed.  Finding out which
+		// signatures are bad takes individual verification.
+		if(NULL == prgfValid)
+		{
+			InterlockedExchange(pfAllValid, FALSE);
+			return;
+		}
+	}
+
+	for(SIZE_T i = 0; i < cItems; i++)
+	{
+		BOOL fValid = rgfParsed[i] && secp256k1_schnorrsig_verify(m_pContext, rgpcbSignatures[i], rgpcbMessages[i], rgKeys + i);
+
+		if(prgfValid)
+			prgfValid[i] = fValid;
+
+		if(!fValid)
+		{
+			InterlockedExchange(pfAllValid, FALSE);
+			if(NULL == prgfValid)
+				break;
+		}
+	}
+}
+
+VOID WINAPI CSecp256k1Verifier::_VerifyBlock (PVOID pvContext, SIZE_T iItem, INT iWorker)
+{
+	SECP256K1_VERIFY_JOB* pJob = reinterpret_cast<SECP256K1_VERIFY_JOB*>(pvContext);
+	SIZE_T iFirst = iItem * SECP256K1_VERIFY_BLOCK;
+	SIZE_T cItems = min(pJob->cItems - iFirst, SECP256K1_VERIFY_BLOCK);
+	BOOL* prgfValid = pJob->prgfValid ? pJob->prgfValid + iFirst : NULL;
+
+	// When only the overall answer is wanted, stop once any block has failed.
+	if(NULL == prgfValid && !pJob->fAllValid)
+		return;
+
+	if(pJob->fSchnorr)
+		pJob->pVerifier->VerifySchnorrBlock(reinterpret_cast<const SECP256K1_SCHNORR_ITEM*>(pJob->pcvItems) + iFirst, cItems, prgfValid, &pJob->fAllValid, iWorker);
+	else
+		pJob->pVerifier->VerifyEcdsaBlock(reinterpret_cast<const SECP256K1_ECDSA_ITEM*>(pJob->pcvItems) + iFirst, cItems, prgfValid, &pJob->fAllValid);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "secp256k1\include\secp256k1.h"
+#include "secp256k1\include\secp256k1_extrakeys.h"
+#include "secp256k1\include\secp256k1_schnorrsig.h"
+
+class CWorkerPool;
+
+// Signatures are compact (r || s), and high-S ECDSA signatures are rejected, as they
+// are by secp256k1_ecdsa_verify().  Public keys may be compressed or uncompressed.
+struct SECP256K1_ECDSA_ITEM
+{
+	const BYTE* pcbHash;		// 32 bytes
+	const BYTE* pcbSignature;	// 64 bytes
+	const BYTE* pcbPublicKey;
+	UINT cbPublicKey;
+};
+
+// BIP 340 signatures with x-only public keys
+struct SECP256K1_SCHNORR_ITEM
+{
+	const BYTE* pcbMessage;		// 32 bytes
+	const BYTE* pcbSignature;	// 64 bytes
+	const BYTE* pcbPublicKey;	// 32 bytes
+};
+
+// Verifies arrays of secp256k1 signatures.  One verification context is built by
+// Initialize() and shared by every worker, so its precomputed tables are paid for
+// once.  Items are verified in blocks spread over the worker pool, and Schnorr blocks
+// are checked with a single batch verification, falling back to one signature at a
+// time only when a block fails.
+
+class CSecp256k1Verifier
+{
+private:
+	secp256k1_context* m_pContext;
+	CWorkerPool* m_pPool;
+
+	secp256k1_scratch_space** m_prgScratch;	// One per worker
+	INT m_cScratch;
+
+	BOOL m_fBatchSchnorr;
+
+public:
+	CSecp256k1Verifier ();
+	~CSecp256k1Verifier ();
+
+	// pPool may be NULL to verify on the calling thread only.
+	HRESULT Initialize (__in_opt CWorkerPool* pPool);
+
+	// Both return S_OK when every signature is valid and S_FALSE otherwise.  If
+	// prgfValid is provided, it receives the result for each item.
+	HRESULT VerifyEcdsa (const SECP256K1_ECDSA_ITEM* prgItems, SIZE_T cItems, __out_ecount_opt(cItems) BOOL* prgfValid);
+	HRESULT VerifySchnorr (const SECP256K1_SCHNORR_ITEM* prgItems, SIZE_T cItems, __out_ecount_opt(cItems) BOOL* prgfValid);
+
+	// Batch verification is on by default.  Turning it off verifies each Schnorr
+	// signature individually, which is mostly useful for comparing throughput.
+	inline VOID EnableSchnorrBatch (BOOL fEnable) { m_fBatchSchnorr = fEnable; }
+
+	inline const secp256k1_context* GetContext (VOID) const { return m_pContext; }
+	inline INT GetWorkerCount (VOID) const { return m_cScratch; }
+
+private:
+	VOID Clear (VOID);
+	HRESULT Verify (const VOID* pcvItems, SIZE_T cItems, BOOL* prgfValid, BOOL fSchnorr);
+
+	VOID VerifyEcdsaBlock (const SECP256K1_ECDSA_ITEM* prgItems, SIZE_T cItems, BOOL* prgfValid, volatile LONG* pfAllValid);
+	VOID VerifySchnorrBlock (const SECP256K1_SCHNORR_ITEM* prgItems, SIZE_T cItems, BOOL* prgfValid, volatile LONG* pfAllValid, INT iWorker);
+
+	static VOID WINAPI _VerifyBlock (PVOID pvContext, SIZE_T iItem, INT iWorker);
+};
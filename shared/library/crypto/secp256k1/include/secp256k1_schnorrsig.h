@@ -104,6 +104,32 @@ SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorrsig_verify(
     const secp256k1_xonly_pubkey *pubkey
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
 
+/** Verify a batch of Schnorr signatures.
+ *
+ *  Checks all signatures at once with a single multi-scalar multiplication per
+ *  group of signatures, each term weighted by a random scalar derived from the
+ *  inputs. A return value of 1 means every signature is valid; on 0 at least one
+ *  is invalid and the caller must use secp256k1_schnorrsig_verify to find which.
+ *
+ *  Returns: 1: all signatures are valid (or n_sigs is 0)
+ *           0: at least one signature is invalid, or the scratch space was too small
+ *  Args:    ctx: a secp256k1 context object, initialized for verification.
+ *       scratch: scratch space used for the multi-scalar multiplication. May be NULL,
+ *                which falls back to one multiplication per point.
+ *  In:    sig64: array of pointers to 64-byte signatures (cannot be NULL if n_sigs > 0)
+ *         msg32: array of pointers to 32-byte messages (cannot be NULL if n_sigs > 0)
+ *       pubkeys: array of pointers to x-only public keys (cannot be NULL if n_sigs > 0)
+ *        n_sigs: number of signatures in the arrays
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorrsig_verify_batch(
+    const secp256k1_context* ctx,
+    secp256k1_scratch_space *scratch,
+    const unsigned char *const *sig64,
+    const unsigned char *const *msg32,
+    const secp256k1_xonly_pubkey *const *pubkeys,
+    size_t n_sigs
+) SECP256K1_ARG_NONNULL(1);
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,6 +16,12 @@
 /* Set window size for ecmult precomputation */
 #define ECMULT_WINDOW_SIZE 15
 
+/* Define this symbol to enable the extrakeys module */
+#define ENABLE_MODULE_EXTRAKEYS 1
+
+/* Define this symbol to enable the schnorrsig module */
+#define ENABLE_MODULE_SCHNORRSIG 1
+
 #define	UINT32_MAX		0xFFFFFFFF
 
 typedef char int8_t;
@@ -236,4 +236,126 @@ int secp256k1_schnorrsig_verify(const secp256k1_context* ctx, const unsigned cha
            secp256k1_fe_equal_var(&rx, &r.x);
 }
 
+
+/* Number of signatures combined into each multi-scalar multiplication. Two points
+ * are used per signature. */
+#define SECP256K1_SCHNORRSIG_BATCH_SIZE 64
+
+typedef struct {
+    secp256k1_scalar sc[2 * SECP256K1_SCHNORRSIG_BATCH_SIZE];
+    secp256k1_ge pt[2 * SECP256K1_SCHNORRSIG_BATCH_SIZE];
+} secp256k1_schnorrsig_batch_data;
+
+static int secp256k1_schnorrsig_batch_callback(secp256k1_scalar *sc, secp256k1_ge *pt, size_t idx, void *data) {
+    secp256k1_schnorrsig_batch_data *batch = (secp256k1_schnorrsig_batch_data *)data;
+    *sc = batch->sc[idx];
+    *pt = batch->pt[idx];
+    return 1;
+}
+
+/* Verifies up to SECP256K1_SCHNORRSIG_BATCH_SIZE signatures by checking
+ * -(sum a_i*s_i)*G + sum a_i*R_i + sum (a_i*e_i)*P_i == infinity, where a_0 = 1 and
+ * the other a_i are derived by hashing every input of the batch. */
+static int secp256k1_schnorrsig_verify_batch_part(const secp256k1_context* ctx, secp256k1_scratch_space *scratch, const unsigned char *const *sig64, const unsigned char *const *msg32, const secp256k1_xonly_pubkey *const *pubkeys, size_t n_sigs) {
+    static const unsigned char tag[13] = "BIP0340/batch";
+    secp256k1_schnorrsig_batch_data data;
+    secp256k1_sha256 sha;
+    secp256k1_scalar sum_s;
+    secp256k1_gej rj;
+    unsigned char seed[32];
+    unsigned char buf[32];
+    size_t i;
+
+    VERIFY_CHECK(n_sigs <= SECP256K1_SCHNORRSIG_BATCH_SIZE);
+
+    secp256k1_sha256_initialize_tagged(&sha, tag, sizeof(tag));
+    for (i = 0; i < n_sigs; i++) {
+        ARG_CHECK(sig64[i] != NULL);
+        ARG_CHECK(msg32[i] != NULL);
+        ARG_CHECK(pubkeys[i] != NULL);
+        secp256k1_sha256_write(&sha, sig64[i], 64);
+        secp256k1_sha256_write(&sha, msg32[i], 32);
+        secp256k1_sha256_write(&sha, pubkeys[i]->data, sizeof(pubkeys[i]->data));
+    }
+    secp256k1_sha256_finalize(&sha, seed);
+
+    secp256k1_scalar_clear(&sum_s);
+    for (i = 0; i < n_sigs; i++) {
+        secp256k1_scalar s;
+        secp256k1_scalar e;
+        secp256k1_scalar a;
+        secp256k1_fe rx;
+        secp256k1_ge pk;
+        int overflow;
+
+        if (!secp256k1_fe_set_b32(&rx, &sig64[i][0])) {
+            return 0;
+        }
+        if (!secp256k1_ge_set_xo_var(&data.pt[2 * i], &rx, 0)) {
+            return 0;
+        }
+
+        secp256k1_scalar_set_b32(&s, &sig64[i][32], &overflow);
+        if (overflow) {
+            return 0;
+        }
+
+        if (!secp256k1_xonly_pubkey_load(ctx, &pk, pubkeys[i])) {
+            return 0;
+        }
+        data.pt[2 * i + 1] = pk;
+
+        secp256k1_fe_get_b32(buf, &pk.x);
+        secp256k1_schnorrsig_challenge(&e, &sig64[i][0], msg32[i], buf);
+
+        if (i == 0) {
+            a = secp256k1_scalar_one;
+        } else {
+            unsigned char idx[8];
+            size_t j;
+            for (j = 0; j < 8; j++) {
+                idx[j] = (unsigned char)((uint64_t)i >> (8 * j));
+            }
+            secp256k1_sha256_initialize(&sha);
+            secp256k1_sha256_write(&sha, seed, 32);
+            secp256k1_sha256_write(&sha, idx, 8);
+            secp256k1_sha256_finalize(&sha, buf);
+            secp256k1_scalar_set_b32(&a, buf, NULL);
+        }
+
+        secp256k1_scalar_mul(&s, &s, &a);
+        secp256k1_scalar_add(&sum_s, &sum_s, &s);
+        data.sc[2 * i] = a;
+        secp256k1_scalar_mul(&data.sc[2 * i + 1], &e, &a);
+    }
+
+    secp256k1_scalar_negate(&sum_s, &sum_s);
+    if (!secp256k1_ecmult_multi_var(&ctx->error_callback, &ctx->ecmult_ctx, scratch, &rj, &sum_s, secp256k1_schnorrsig_batch_callback, &data, 2 * n_sigs)) {
+        return 0;
+    }
+
+    return secp256k1_gej_is_infinity(&rj);
+}
+
+int secp256k1_schnorrsig_verify_batch(const secp256k1_context* ctx, secp256k1_scratch_space *scratch, const unsigned char *const *sig64, const unsigned char *const *msg32, const secp256k1_xonly_pubkey *const *pubkeys, size_t n_sigs) {
+    size_t i;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(n_sigs == 0 || sig64 != NULL);
+    ARG_CHECK(n_sigs == 0 || msg32 != NULL);
+    ARG_CHECK(n_sigs == 0 || pubkeys != NULL);
+
+    for (i = 0; i < n_sigs; i += SECP256K1_SCHNORRSIG_BATCH_SIZE) {
+        size_t n = n_sigs - i;
+        if (n > SECP256K1_SCHNORRSIG_BATCH_SIZE) {
+            n = SECP256K1_SCHNORRSIG_BATCH_SIZE;
+        }
+        if (!secp256k1_schnorrsig_verify_batch_part(ctx, scratch, &sig64[i], &msg32[i], &pubkeys[i], n)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
 #endif
@@ -1,197 +1,703 @@
 #include <windows.h>
+#include "..\Core\CoreDefs.h"
+#include "JumpPointMap.h"
 #include "AStar2D.h"
 
-CAStar2D::CAStar2D ()
+#define	NODE_CLOSED		HEAP_INDEX_NONE
+#define	NO_PARENT		((ULONG)-1)
+#define	NO_ENTRY		((ULONG)-1)
+
+// Passability stamps hold the generation above a passable bit.
+#define	MAX_GENERATION	0x7FFFFFFF
+
+// The steps for each JUMP_DIRECTION.  These are kept here, rather than shared with
+// CJumpPointMap, so that projects using CAStar2D don't also need JumpPointMap.cpp.
+static const INT c_rgxDirection[JUMP_DIRECTIONS] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+static const INT c_rgyDirection[JUMP_DIRECTIONS] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+static inline INT Sign (INT n)
 {
+	return (n > 0) - (n < 0);
 }
 
-CAStar2D::~CAStar2D ()
+CPathContext::CPathContext () :
+	m_prgNodes(NULL),
+	m_cNodes(0),
+	m_nGeneration(0),
+	m_prgPassable(NULL),
+	m_cPassable(0),
+	m_cExpanded(0)
 {
-	Reset();
 }
 
-HRESULT CAStar2D::PreInit (VOID)
+CPathContext::~CPathContext ()
+{
+	__delete_array m_prgPassable;
+	__delete_array m_prgNodes;
+}
+
+HRESULT CPathContext::Reserve (ULONG cNodes)
+{
+	HRESULT hr = S_FALSE;
+
+	if(cNodes > m_cNodes)
+	{
+		NODE* prgNodes;
+
+		// A larger heap is harmless if the nodes can't be allocated.
+		Check(m_heap.Reserve(cNodes));
+
+		prgNodes = __new NODE[cNodes];
+		CheckAlloc(prgNodes);
+		ZeroMemory(prgNodes, sizeof(NODE) * cNodes);
+
+		__delete_array m_prgNodes;
+		m_prgNodes = prgNodes;
+		m_cNodes = cNodes;
+
+		// The stamps restart with the new nodes.
+		if(m_prgPassable)
+			ZeroMemory(m_prgPassable, sizeof(ULONG) * m_cPassable);
+		m_nGeneration = 0;
+		hr = S_OK;
+	}
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CPathContext::ReservePassable (ULONG cCells)
 {
-	HRESULT hr = S_OK;
+	HRESULT hr = S_FALSE;
 
-	for(INT i = 0; i < 128; i++)
+	if(cCells > m_cPassable)
 	{
-		NODE* pNode = __new NODE;
-		CheckAlloc(pNode);
-		pNode->pNext = NULL;
-		m_listFreeNodes.AppendNode(pNode);
+		ULONG* prgPassable = __new ULONG[cCells];
+		CheckAlloc(prgPassable);
+
+		// Zero never matches a search's generation.
+		ZeroMemory(prgPassable, sizeof(ULONG) * cCells);
+
+		__delete_array m_prgPassable;
+		m_prgPassable = prgPassable;
+		m_cPassable = cCells;
+		hr = S_OK;
 	}
 
 Cleanup:
 	return hr;
 }
 
+VOID CPathContext::Reset (VOID)
+{
+	// Advancing the generation discards every node from the previous search.
+	if(MAX_GENERATION == m_nGeneration)
+	{
+		ZeroMemory(m_prgNodes, sizeof(NODE) * m_cNodes);
+		if(m_prgPassable)
+			ZeroMemory(m_prgPassable, sizeof(ULONG) * m_cPassable);
+		m_nGeneration = 0;
+	}
+	m_nGeneration++;
+
+	m_heap.Clear();
+	m_cExpanded = 0;
+}
+
+VOID CPathContext::AddOpenNode (ULONG nNode, ULONG nParent, INT g, INT h)
+{
+	NODE* pNode = m_prgNodes + nNode;
+
+	pNode->nGeneration = m_nGeneration;
+	pNode->nParent = nParent;
+	pNode->g = g;
+	pNode->h = h;
+
+	// Every cell enters the heap at most once per search, so the heap can't overflow.
+	m_heap.Push(GetHeapOrder(), nNode);
+}
+
+VOID CPathContext::RelaxNode (ULONG nNode, ULONG nParent, INT g, INT h)
+{
+	NODE* pNode = m_prgNodes + nNode;
+
+	if(pNode->nGeneration != m_nGeneration)
+		AddOpenNode(nNode, nParent, g, h);
+	else if(NODE_CLOSED != pNode->iHeap && g < pNode->g)
+	{
+		pNode->g = g;
+		pNode->nParent = nParent;
+		DecreaseNode(nNode);
+	}
+}
+
+HRESULT CPathContext::ResetBuckets (INT cBuckets)
+{
+	HRESULT hr;
+
+	m_aBuckets.Clear();
+	m_aBucketEntries.Clear();
+	Check(m_aBuckets.Resize(cBuckets));
+
+	for(INT i = 0; i < cBuckets; i++)
+		m_aBuckets[i] = NO_ENTRY;
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
+
+// Nodes in the bucket queue aren't in the heap, but their iHeap still has to be
+// something other than NODE_CLOSED until they're taken out.
+HRESULT CPathContext::PushBucket (ULONG nNode, ULONG nParent, INT g)
+{
+	HRESULT hr;
+	NODE* pNode = m_prgNodes + nNode;
+	BUCKET_ENTRY* pEntry;
+
+	Check(m_aBucketEntries.AppendSlot(&pEntry));
+	pEntry->nNode = nNode;
+	pEntry->nNext = m_aBuckets[g];
+	m_aBuckets[g] = static_cast<ULONG>(m_aBucketEntries.Length() - 1);
+
+	pNode->nGeneration = m_nGeneration;
+	pNode->nParent = nParent;
+	pNode->g = g;
+	pNode->h = 0;
+	pNode->iHeap = 0;
+
+Cleanup:
+	return hr;
+}
+
+CAStar2D::CAStar2D () :
+	m_pContext(&m_Context),
+	m_x(0),
+	m_y(0),
+	m_nSize(0),
+	m_eHeuristic(ASTAR_HEURISTIC_MANHATTAN)
+{
+}
+
+CAStar2D::CAStar2D (CPathContext* pContext) :
+	m_pContext(pContext),
+	m_x(0),
+	m_y(0),
+	m_nSize(0),
+	m_eHeuristic(ASTAR_HEURISTIC_MANHATTAN)
+{
+}
+
+HRESULT CAStar2D::PreInit (VOID)
+{
+	// Enough for a small search window.  Larger windows grow the pool on demand.
+	return m_pContext->Reserve(128);
+}
+
 HRESULT CAStar2D::FindPath (INT xFrom, INT yFrom, INT xDest, INT yDest, INT nRange, IAStarCallback2D* pCallback)
 {
 	HRESULT hr;
 	INT xMax = (xFrom + nRange) - 1;
 	INT yMax = (yFrom + nRange) - 1;
+	CPathContext* pContext;
+	NODE* prgNodes;
+
+	CheckIf(0 >= nRange || nRange > 0x7FFF, E_INVALIDARG);
 
 	m_x = xFrom - nRange;
 	m_y = yFrom - nRange;
 	m_nSize = nRange << 1;
 
-	Reset();
-
-	Check(AddOpenNode((ULONG)-1, xFrom, yFrom, 0, MoveDistance(xFrom, yFrom, xDest, yDest)));
+	Check(BeginSearch(xFrom, yFrom, MoveDistance(xFrom, yFrom, xDest, yDest)));
+	pContext = m_pContext;
+	prgNodes = pContext->m_prgNodes;
 
 	for(;;)
 	{
-		NODE* p = *(m_mapOpen.GetValuePtr(0));
-		INT f = p->vItem.g + p->vItem.h;
-		sysint nIndex = 0;
-		ULONG nCurrent;
-
-		// Find the node with the lowest F score.
-		for(sysint i = 1; i < m_mapOpen.Length(); i++)
-		{
-			INT fCompare;
+		// Move the node with the lowest F score from the open heap to the closed set.
+		ULONG nCurrent = pContext->PopHeap();
+		NODE* p = prgNodes + nCurrent;
+		INT xCurrent = m_x + static_cast<INT>(nCurrent % m_nSize);
+		INT yCurrent = m_y + static_cast<INT>(nCurrent / m_nSize);
 
-			p = *(m_mapOpen.GetValuePtr(i));
-			fCompare = p->vItem.g + p->vItem.h;
-
-			if(fCompare < f)
-			{
-				f = fCompare;
-				nIndex = i;
-			}
-		}
-
-		p = *(m_mapOpen.GetValuePtr(nIndex));
-		nCurrent = m_mapOpen.GetKey(nIndex);
-
-		// Switch the current node to the closed list (and remove it from the open list).
-		Check(m_mapClosed.Add(nCurrent, p));
-		SideAssertHr(m_mapOpen.RemoveByIndex(nIndex, NULL));
-
-		if(p->vItem.x == xDest && p->vItem.y == yDest)
+		if(xCurrent == xDest && yCurrent == yDest)
 		{
 			// Found it!
 			break;
 		}
 
 		// For each of the nodes around the current node...
-		INT xEnd = min(p->vItem.x + 1, xMax);
-		INT yEnd = min(p->vItem.y + 1, yMax);
-		for(INT y = max(p->vItem.y - 1, m_y); y <= yEnd; y++)
+		INT xEnd = min(xCurrent + 1, xMax);
+		INT yEnd = min(yCurrent + 1, yMax);
+		for(INT y = max(yCurrent - 1, m_y); y <= yEnd; y++)
 		{
-			for(INT x = max(p->vItem.x - 1, m_x); x <= xEnd; x++)
+			for(INT x = max(xCurrent - 1, m_x); x <= xEnd; x++)
 			{
 				ULONG nNode = CoordToIndex(x, y);
-				NODE* pOpen;
+				NODE* pNode = prgNodes + nNode;
+				INT nValue;
 
-				if(S_OK == m_mapOpen.Find(nNode, &pOpen))	// If it's already on the open list...
+				if(pNode->nGeneration == pContext->m_nGeneration)
 				{
-					INT nValue;
-
-					// If the G score is better from this direction, update the G score and parent.
-					if(GetAndAdjustValue(pCallback, x, y, p, &nValue) && nValue < pOpen->vItem.g)
+					// Ignore if it's on the closed list.  If it's already on the open list,
+					// and the G score is better from this direction, update the G score and parent.
+					if(NODE_CLOSED != pNode->iHeap && GetAndAdjustValue(pCallback, x, y, xCurrent, yCurrent, p->g, &nValue) && nValue < pNode->g)
 					{
-						pOpen->vItem.g = nValue;
-						pOpen->vItem.nParent = nCurrent;
+						pNode->g = nValue;
+						pNode->nParent = nCurrent;
+						pContext->DecreaseNode(nNode);
 					}
 				}
-				else if(!m_mapClosed.HasItem(nNode))		// Ignore if it's on the closed list.
+				else if(GetAndAdjustValue(pCallback, x, y, xCurrent, yCurrent, p->g, &nValue))
 				{
-					INT nValue;
-
 					// If we can get a value for this path, then add the node to the open list.
-					if(GetAndAdjustValue(pCallback, x, y, p, &nValue))
-					{
-						Check(AddOpenNode(nCurrent, x, y, nValue, MoveDistance(x, y, xDest, yDest)));
-					}
+					pContext->AddOpenNode(nNode, nCurrent, nValue, MoveDistance(x, y, xDest, yDest));
 				}
 			}
 		}
 
-		CheckIf(0 == m_mapOpen.Length(), HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+		CheckIf(0 == pContext->m_heap.Length(), HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
 	}
 
+	hr = S_OK;
+
 Cleanup:
 	return hr;
 }
 
-HRESULT CAStar2D::GetPath (INT xDest, INT yDest, TArray<POINT>* paPath)
+HRESULT CAStar2D::FindPath (INT xFrom, INT yFrom, INT xDest, INT yDest, INT nRange, IAStarCostGrid* pGrid)
 {
 	HRESULT hr;
-	NODE* p;
-	POINT pt;
-	ULONG nIndex = CoordToIndex(xDest, yDest);
+	ASTAR_COST_GRID grid;
+
+	Check(pGrid->GetCostGrid(&grid));
+	if(S_OK == hr)
+		Check(FindPathOnGrid(xFrom, yFrom, xDest, yDest, nRange, &grid));
+	else
+		Check(FindPath(xFrom, yFrom, xDest, yDest, nRange, static_cast<IAStarCallback2D*>(pGrid)));
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CAStar2D::FindPathJPS (INT xFrom, INT yFrom, INT xDest, INT yDest, INT nRange, IAStarCallback2D* pCallback)
+{
+	HRESULT hr;
+	ULONG cCells;
+	CPathContext* pContext;
+
+	CheckIf(0 >= nRange || nRange > 0x7FFF, E_INVALIDARG);
+
+	m_x = xFrom - nRange;
+	m_y = yFrom - nRange;
+	m_nSize = nRange << 1;
+
+	cCells = static_cast<ULONG>(m_nSize) * static_cast<ULONG>(m_nSize);
+	Check(m_pContext->ReservePassable(cCells));
+
+	Check(BeginSearch(xFrom, yFrom, OctileDistance(xFrom, yFrom, xDest, yDest)));
+	CheckIf(!IsPassable(pCallback, xFrom, yFrom), E_INVALIDARG);
+	CheckIf(!IsPassable(pCallback, xDest, yDest), HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+	pContext = m_pContext;
 
 	for(;;)
 	{
-		Check(m_mapClosed.Find(nIndex, &p));
-		pt.x = p->vItem.x;
-		pt.y = p->vItem.y;
-		Check(paPath->Append(&pt));
-		nIndex = p->vItem.nParent;
-		CheckIf((ULONG)-1 == nIndex, S_OK);
+		ULONG nCurrent = pContext->PopHeap();
+		NODE* p = pContext->m_prgNodes + nCurrent;
+		INT xCurrent = m_x + static_cast<INT>(nCurrent % m_nSize);
+		INT yCurrent = m_y + static_cast<INT>(nCurrent / m_nSize);
+		INT rgxDir[JUMP_DIRECTIONS], rgyDir[JUMP_DIRECTIONS];
+		INT cDirs = 0;
+
+		if(xCurrent == xDest && yCurrent == yDest)
+			break;
+
+		// Prune the directions to those that can't be reached more cheaply through the parent.
+		if(NO_PARENT == p->nParent)
+		{
+			for(INT i = 0; i < JUMP_DIRECTIONS; i++)
+			{
+				rgxDir[i] = c_rgxDirection[i];
+				rgyDir[i] = c_rgyDirection[i];
+			}
+			cDirs = JUMP_DIRECTIONS;
+		}
+		else
+		{
+			INT dx = Sign(xCurrent - (m_x + static_cast<INT>(p->nParent % m_nSize)));
+			INT dy = Sign(yCurrent - (m_y + static_cast<INT>(p->nParent / m_nSize)));
+
+			rgxDir[cDirs] = dx; rgyDir[cDirs++] = dy;
+			if(dx && dy)
+			{
+				rgxDir[cDirs] = dx; rgyDir[cDirs++] = 0;
+				rgxDir[cDirs] = 0; rgyDir[cDirs++] = dy;
+			}
+			else
+			{
+				// A side cell is forced when the cell behind it is blocked.
+				for(INT nSide = -1; nSide <= 1; nSide += 2)
+				{
+					INT xSide = dx ? xCurrent : xCurrent + nSide;
+					INT ySide = dx ? yCurrent + nSide : yCurrent;
+
+					if(IsPassable(pCallback, xSide, ySide) && !IsPassable(pCallback, xSide - dx, ySide - dy))
+					{
+						rgxDir[cDirs] = xSide - xCurrent; rgyDir[cDirs++] = ySide - yCurrent;
+						rgxDir[cDirs] = dx ? dx : nSide; rgyDir[cDirs++] = dy ? dy : nSide;
+					}
+				}
+			}
+		}
+
+		for(INT i = 0; i < cDirs; i++)
+		{
+			INT xJump, yJump;
+
+			if(Jump(pCallback, xCurrent, yCurrent, rgxDir[i], rgyDir[i], xDest, yDest, &xJump, &yJump))
+				pContext->RelaxNode(CoordToIndex(xJump, yJump), nCurrent, p->g + OctileDistance(xCurrent, yCurrent, xJump, yJump), OctileDistance(xJump, yJump, xDest, yDest));
+		}
+
+		CheckIf(0 == pContext->m_heap.Length(), HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
 	}
 
+	hr = S_OK;
+
 Cleanup:
 	return hr;
 }
 
-VOID CAStar2D::Reset (VOID)
+HRESULT CAStar2D::FindPathJPS (INT xFrom, INT yFrom, INT xDest, INT yDest, const CJumpPointMap* pMap)
 {
-	NODE* p;
+	HRESULT hr;
+	CPathContext* pContext;
+
+	CheckIf(NULL == pMap || !pMap->IsPassable(xFrom, yFrom), E_INVALIDARG);
+	CheckIf(!pMap->IsPassable(xDest, yDest), HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+
+	m_x = pMap->GetX();
+	m_y = pMap->GetY();
+	m_nSize = max(pMap->GetWidth(), pMap->GetHeight());
+
+	Check(BeginSearch(xFrom, yFrom, OctileDistance(xFrom, yFrom, xDest, yDest)));
+	pContext = m_pContext;
 
-	for(sysint i = m_mapOpen.Length() - 1; i >= 0; i--)
+	for(;;)
 	{
-		SideAssertHr(m_mapOpen.RemoveByIndex(i, &p));
-		p->pNext = NULL;
-		m_listFreeNodes.AppendNode(p);
+		ULONG nCurrent = pContext->PopHeap();
+		NODE* p = pContext->m_prgNodes + nCurrent;
+		INT xCurrent = m_x + static_cast<INT>(nCurrent % m_nSize);
+		INT yCurrent = m_y + static_cast<INT>(nCurrent / m_nSize);
+		INT nFirst, cDirs;
+
+		if(xCurrent == xDest && yCurrent == yDest)
+			break;
+
+		// From the start every direction is open.  After a straight move, the move
+		// and both sides (with their diagonals) are tried, and after a diagonal move,
+		// the diagonal and its two components.
+		if(NO_PARENT == p->nParent)
+		{
+			nFirst = 0;
+			cDirs = JUMP_DIRECTIONS;
+		}
+		else
+		{
+			INT dx = Sign(xCurrent - (m_x + static_cast<INT>(p->nParent % m_nSize)));
+			INT dy = Sign(yCurrent - (m_y + static_cast<INT>(p->nParent / m_nSize)));
+			INT nDirection = 0;
+
+			while(c_rgxDirection[nDirection] != dx || c_rgyDirection[nDirection] != dy)
+				nDirection++;
+
+			if(dx && dy)
+			{
+				nFirst = nDirection + JUMP_DIRECTIONS - 1;
+				cDirs = 3;
+			}
+			else
+			{
+				nFirst = nDirection + JUMP_DIRECTIONS - 2;
+				cDirs = 5;
+			}
+		}
+
+		for(INT i = 0; i < cDirs; i++)
+		{
+			INT nDirection = (nFirst + i) % JUMP_DIRECTIONS;
+			INT dx = c_rgxDirection[nDirection];
+			INT dy = c_rgyDirection[nDirection];
+			INT nJump = pMap->GetJump(xCurrent, yCurrent, nDirection);
+			INT xToDest = xDest - xCurrent, yToDest = yDest - yCurrent;
+			INT cSteps = 0;
+
+			if(dx && dy)
+			{
+				// Stop where the destination's row or column is crossed.
+				if(Sign(xToDest) == dx && Sign(yToDest) == dy)
+				{
+					INT cToDest = min(abs(xToDest), abs(yToDest));
+					if(cToDest <= abs(nJump))
+						cSteps = cToDest;
+				}
+			}
+			else if((dx ? yToDest : xToDest) == 0 && Sign(dx ? xToDest : yToDest) == (dx ? dx : dy))
+			{
+				// Stop on the destination when it lies on this line.
+				INT cToDest = abs(dx ? xToDest : yToDest);
+				if(cToDest <= abs(nJump))
+					cSteps = cToDest;
+			}
+
+			if(0 == cSteps && 0 < nJump)
+				cSteps = nJump;
+
+			if(0 < cSteps)
+			{
+				INT xJump = xCurrent + dx * cSteps;
+				INT yJump = yCurrent + dy * cSteps;
+				pContext->RelaxNode(CoordToIndex(xJump, yJump), nCurrent, p->g + cSteps * ((dx && dy) ? DIAGONAL_MOVEMENT_COST : ADJACENT_MOVEMENT_COST), OctileDistance(xJump, yJump, xDest, yDest));
+			}
+		}
+
+		CheckIf(0 == pContext->m_heap.Length(), HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
 	}
 
-	for(sysint i = m_mapClosed.Length() - 1; i >= 0; i--)
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
+
+// The same search as FindPath(), visiting neighbours in the same order, but reading
+// the costs from the grid.  The window is clipped to the grid once, so the neighbour
+// loop needs no calls and no bounds checks beyond the clipped rectangle.
+HRESULT CAStar2D::FindPathOnGrid (INT xFrom, INT yFrom, INT xDest, INT yDest, INT nRange, const ASTAR_COST_GRID* pcGrid)
+{
+	HRESULT hr;
+	INT xMin, yMin, xMax, yMax;
+	CPathContext* pContext;
+	NODE* prgNodes;
+
+	CheckIf(0 >= nRange || nRange > 0x7FFF, E_INVALIDARG);
+	CheckIf(NULL == pcGrid->pcnCosts || 0 > pcGrid->xSize || 0 > pcGrid->ySize || pcGrid->cStride < pcGrid->xSize, E_INVALIDARG);
+
+	m_x = xFrom - nRange;
+	m_y = yFrom - nRange;
+	m_nSize = nRange << 1;
+
+	xMin = max(m_x, pcGrid->x);
+	yMin = max(m_y, pcGrid->y);
+	xMax = min((xFrom + nRange) - 1, pcGrid->x + pcGrid->xSize - 1);
+	yMax = min((yFrom + nRange) - 1, pcGrid->y + pcGrid->ySize - 1);
+
+	Check(BeginSearch(xFrom, yFrom, MoveDistance(xFrom, yFrom, xDest, yDest)));
+	pContext = m_pContext;
+	prgNodes = pContext->m_prgNodes;
+
+	for(;;)
 	{
-		SideAssertHr(m_mapClosed.RemoveByIndex(i, &p));
-		p->pNext = NULL;
-		m_listFreeNodes.AppendNode(p);
+		ULONG nCurrent = pContext->PopHeap();
+		NODE* p = prgNodes + nCurrent;
+		INT xCurrent = m_x + static_cast<INT>(nCurrent % m_nSize);
+		INT yCurrent = m_y + static_cast<INT>(nCurrent / m_nSize);
+
+		if(xCurrent == xDest && yCurrent == yDest)
+			break;
+
+		INT xStart = max(xCurrent - 1, xMin), xEnd = min(xCurrent + 1, xMax);
+		INT yEnd = min(yCurrent + 1, yMax);
+		for(INT y = max(yCurrent - 1, yMin); y <= yEnd; y++)
+		{
+			const INT* pcnRow = pcGrid->pcnCosts + (y - pcGrid->y) * pcGrid->cStride;
+			ULONG nRow = static_cast<ULONG>(y - m_y) * static_cast<ULONG>(m_nSize);
+
+			for(INT x = xStart; x <= xEnd; x++)
+			{
+				ULONG nNode = nRow + (x - m_x);
+				NODE* pNode = prgNodes + nNode;
+				INT nValue = pcnRow[x - pcGrid->x];
+
+				if(0 > nValue)
+					continue;
+
+				nValue += p->g + ((x == xCurrent || y == yCurrent) ? ADJACENT_MOVEMENT_COST : DIAGONAL_MOVEMENT_COST);
+
+				if(pNode->nGeneration == pContext->m_nGeneration)
+				{
+					if(NODE_CLOSED != pNode->iHeap && nValue < pNode->g)
+					{
+						pNode->g = nValue;
+						pNode->nParent = nCurrent;
+						pContext->DecreaseNode(nNode);
+					}
+				}
+				else
+					pContext->AddOpenNode(nNode, nCurrent, nValue, MoveDistance(x, y, xDest, yDest));
+			}
+		}
+
+		CheckIf(0 == pContext->m_heap.Length(), HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
 	}
+
+	hr = S_OK;
+
+Cleanup:
+	return hr;
 }
 
-HRESULT CAStar2D::AddOpenNode (ULONG nParent, INT x, INT y, INT g, INT h)
+// Dijkstra's search with a bucket for every cost up to the budget.  Steps always cost
+// at least ADJACENT_MOVEMENT_COST, so a bucket never gains entries while it's being
+// emptied, and the window only has to reach nBudget / ADJACENT_MOVEMENT_COST cells.
+HRESULT CAStar2D::ComputeReachable (INT xFrom, INT yFrom, INT nBudget, IAStarCallback2D* pCallback, TArray<POINT>* paReachable)
 {
 	HRESULT hr;
-	ULONG nIndex = CoordToIndex(x, y);
-	NODE* pNode = m_listFreeNodes.UnlinkHead();
+	INT nRange, xMax, yMax;
+	CPathContext* pContext = m_pContext;
+	NODE* prgNodes;
+
+	CheckIf(NULL == pCallback || NULL == paReachable || 0 > nBudget, E_INVALIDARG);
+	nRange = nBudget / ADJACENT_MOVEMENT_COST + 1;
+	CheckIf(nRange > 0x7FFF, E_INVALIDARG);
+
+	m_x = xFrom - nRange;
+	m_y = yFrom - nRange;
+	m_nSize = nRange << 1;
+	xMax = (xFrom + nRange) - 1;
+	yMax = (yFrom + nRange) - 1;
+
+	Check(pContext->Reserve(static_cast<ULONG>(m_nSize) * static_cast<ULONG>(m_nSize)));
+	pContext->Reset();
+	prgNodes = pContext->m_prgNodes;
 
-	if(NULL == pNode)
+	Check(pContext->ResetBuckets(nBudget + 1));
+	Check(pContext->PushBucket(CoordToIndex(xFrom, yFrom), NO_PARENT, 0));
+
+	for(INT nCost = 0; nCost <= nBudget; nCost++)
 	{
-		pNode = __new NODE;
-		CheckAlloc(pNode);
-		pNode->pNext = NULL;
+		ULONG nEntry = pContext->m_aBuckets[nCost];
+
+		while(NO_ENTRY != nEntry)
+		{
+			ULONG nCurrent = pContext->m_aBucketEntries[nEntry].nNode;
+			NODE* p = prgNodes + nCurrent;
+			POINT ptCurrent;
+
+			nEntry = pContext->m_aBucketEntries[nEntry].nNext;
+			if(NODE_CLOSED == p->iHeap || p->g != nCost)
+				continue;
+
+			p->iHeap = NODE_CLOSED;
+			pContext->m_cExpanded++;
+
+			ptCurrent.x = m_x + static_cast<INT>(nCurrent % m_nSize);
+			ptCurrent.y = m_y + static_cast<INT>(nCurrent / m_nSize);
+			Check(paReachable->Append(&ptCurrent));
+
+			INT xEnd = min(ptCurrent.x + 1, xMax);
+			INT yEnd = min(ptCurrent.y + 1, yMax);
+			for(INT y = max(ptCurrent.y - 1, m_y); y <= yEnd; y++)
+			{
+				for(INT x = max(ptCurrent.x - 1, m_x); x <= xEnd; x++)
+				{
+					ULONG nNode = CoordToIndex(x, y);
+					NODE* pNode = prgNodes + nNode;
+					INT nValue;
+
+					if(pNode->nGeneration == pContext->m_nGeneration && NODE_CLOSED == pNode->iHeap)
+						continue;
+
+					if(!pCallback->GetPathValue(x, y, ptCurrent.x, ptCurrent.y, &nValue))
+						continue;
+
+					nValue = nCost + max(nValue, 0) + ((x == ptCurrent.x || y == ptCurrent.y) ? ADJACENT_MOVEMENT_COST : DIAGONAL_MOVEMENT_COST);
+					if(nValue <= nBudget && (pNode->nGeneration != pContext->m_nGeneration || nValue < pNode->g))
+						Check(pContext->PushBucket(nNode, nCurrent, nValue));
+				}
+			}
+		}
 	}
 
-	hr = m_mapOpen.Add(nIndex, pNode);
-	if(FAILED(hr))
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CAStar2D::GetPath (INT xDest, INT yDest, TArray<POINT>* paPath)
+{
+	HRESULT hr;
+	ULONG nIndex;
+	POINT pt;
+
+	CheckIf(xDest < m_x || yDest < m_y || xDest >= m_x + m_nSize || yDest >= m_y + m_nSize, HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+	nIndex = CoordToIndex(xDest, yDest);
+
+	for(;;)
 	{
-		m_listFreeNodes.AppendNode(pNode);
-		Check(hr);
+		NODE* p = m_pContext->m_prgNodes + nIndex;
+		INT xParent, yParent;
+
+		CheckIf(p->nGeneration != m_pContext->m_nGeneration || NODE_CLOSED != p->iHeap, HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+		pt.x = m_x + static_cast<INT>(nIndex % m_nSize);
+		pt.y = m_y + static_cast<INT>(nIndex / m_nSize);
+		Check(paPath->Append(&pt));
+		nIndex = p->nParent;
+		CheckIf(NO_PARENT == nIndex, S_OK);
+
+		// Fill in the straight or diagonal run between jump points.
+		xParent = m_x + static_cast<INT>(nIndex % m_nSize);
+		yParent = m_y + static_cast<INT>(nIndex / m_nSize);
+		for(;;)
+		{
+			pt.x += Sign(xParent - pt.x);
+			pt.y += Sign(yParent - pt.y);
+			if(pt.x == xParent && pt.y == yParent)
+				break;
+			Check(paPath->Append(&pt));
+		}
 	}
 
-	pNode->vItem.nParent = nParent;
-	pNode->vItem.x = x;
-	pNode->vItem.y = y;
-	pNode->vItem.g = g;
-	pNode->vItem.h = h;
+Cleanup:
+	return hr;
+}
+
+HRESULT CAStar2D::GetPathCost (INT xDest, INT yDest, __out INT* pnCost)
+{
+	HRESULT hr;
+	NODE* p;
+
+	CheckIf(xDest < m_x || yDest < m_y || xDest >= m_x + m_nSize || yDest >= m_y + m_nSize, HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+
+	p = m_pContext->m_prgNodes + CoordToIndex(xDest, yDest);
+	CheckIf(p->nGeneration != m_pContext->m_nGeneration || NODE_CLOSED != p->iHeap, HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+
+	*pnCost = p->g;
+	hr = S_OK;
 
 Cleanup:
 	return hr;
 }
 
-BOOL CAStar2D::GetAndAdjustValue (IAStarCallback2D* pCallback, INT x, INT y, NODE* p, __out INT* pnValue)
+HRESULT CAStar2D::BeginSearch (INT xFrom, INT yFrom, INT h)
 {
-	if(pCallback->GetPathValue(x, y, p->vItem.x, p->vItem.y, pnValue))
+	HRESULT hr;
+
+	Check(m_pContext->Reserve(static_cast<ULONG>(m_nSize) * static_cast<ULONG>(m_nSize)));
+	m_pContext->Reset();
+	m_pContext->AddOpenNode(CoordToIndex(xFrom, yFrom), NO_PARENT, 0, h);
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
+
+BOOL CAStar2D::GetAndAdjustValue (IAStarCallback2D* pCallback, INT x, INT y, INT xFrom, INT yFrom, INT g, __out INT* pnValue)
+{
+	if(pCallback->GetPathValue(x, y, xFrom, yFrom, pnValue))
 	{
-		*pnValue += p->vItem.g;
-		if(x == p->vItem.x || y == p->vItem.y)
+		*pnValue += g;
+		if(x == xFrom || y == yFrom)
 			*pnValue += ADJACENT_MOVEMENT_COST;
 		else
 			*pnValue += DIAGONAL_MOVEMENT_COST;
@@ -199,3 +705,66 @@ BOOL CAStar2D::GetAndAdjustValue (IAStarCallback2D* pCallback, INT x, INT y, NOD
 	}
 	return FALSE;
 }
+
+BOOL CAStar2D::IsPassable (IAStarCallback2D* pCallback, INT x, INT y)
+{
+	ULONG* pnStamp;
+
+	if(x < m_x || y < m_y || x >= m_x + m_nSize || y >= m_y + m_nSize)
+		return FALSE;
+
+	// Each cell is only asked about once per search.
+	pnStamp = m_pContext->m_prgPassable + CoordToIndex(x, y);
+	if((*pnStamp >> 1) != m_pContext->m_nGeneration)
+	{
+		INT nValue;
+		*pnStamp = (m_pContext->m_nGeneration << 1) | (pCallback->GetPathValue(x, y, x, y, &nValue) ? 1 : 0);
+	}
+
+	return *pnStamp & 1;
+}
+
+// Walks from (x, y) in one direction until reaching the destination, a cell with a
+// forced neighbour, or a blocked cell.  Diagonal walks also stop where a straight walk
+// along either component would find something.
+BOOL CAStar2D::Jump (IAStarCallback2D* pCallback, INT x, INT y, INT dx, INT dy, INT xDest, INT yDest, __out INT* pxJump, __out INT* pyJump)
+{
+	for(;;)
+	{
+		INT xTemp, yTemp;
+
+		if(dx && dy && (!IsPassable(pCallback, x + dx, y) || !IsPassable(pCallback, x, y + dy)))
+			return FALSE;
+
+		x += dx;
+		y += dy;
+
+		if(!IsPassable(pCallback, x, y))
+			return FALSE;
+
+		if(x == xDest && y == yDest)
+			break;
+
+		if(dx && dy)
+		{
+			if(Jump(pCallback, x, y, dx, 0, xDest, yDest, &xTemp, &yTemp) || Jump(pCallback, x, y, 0, dy, xDest, yDest, &xTemp, &yTemp))
+				break;
+		}
+		else if(dx)
+		{
+			if((IsPassable(pCallback, x, y + 1) && !IsPassable(pCallback, x - dx, y + 1)) ||
+				(IsPassable(pCallback, x, y - 1) && !IsPassable(pCallback, x - dx, y - 1)))
+				break;
+		}
+		else
+		{
+			if((IsPassable(pCallback, x + 1, y) && !IsPassable(pCallback, x + 1, y - dy)) ||
+				(IsPassable(pCallback, x - 1, y) && !IsPassable(pCallback, x - 1, y - dy)))
+				break;
+		}
+	}
+
+	*pxJump = x;
+	*pyJump = y;
+	return TRUE;
+}
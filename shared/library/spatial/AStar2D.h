@@ -1,50 +1,209 @@
 #pragma once
 
-#include "..\Core\Map.h"
-#include "..\Core\List.h"
+#include "..\Core\Array.h"
+#include "IndexedHeap.h"
 
 #define	ADJACENT_MOVEMENT_COST				10
 #define	DIAGONAL_MOVEMENT_COST				14
 #define	DISTANCE_ESTIMATE_MULTIPLIER		ADJACENT_MOVEMENT_COST
 
+// Exact cost over open ground with straight and diagonal steps, which never overestimates
+// the cost of a path and so keeps searches with diagonal steps optimal
+inline INT OctileDistance (INT x, INT y, INT xDest, INT yDest)
+{
+	INT dx = abs(x - xDest), dy = abs(y - yDest);
+	return ADJACENT_MOVEMENT_COST * max(dx, dy) + (DIAGONAL_MOVEMENT_COST - ADJACENT_MOVEMENT_COST) * min(dx, dy);
+}
+
+// Distance estimate used by FindPath()
+enum ASTAR_HEURISTIC
+{
+	ASTAR_HEURISTIC_MANHATTAN,		// Expands fewer nodes, but overestimates diagonal moves
+	ASTAR_HEURISTIC_OCTILE			// OctileDistance(), so the cheapest path is always found
+};
+
 interface IAStarCallback2D
 {
 	virtual BOOL GetPathValue (INT x, INT y, INT xFrom, INT yFrom, __out INT* pnValue) = 0;
 };
 
-class CAStar2D
+// Contiguous costs for a block of cells.  A cell's cost is the value GetPathValue()
+// would report for entering it, whatever the direction, and negative costs are blocked.
+struct ASTAR_COST_GRID
 {
+	const INT* pcnCosts;		// Cost of the cell at (x, y)
+	INT x, y;
+	INT xSize, ySize;
+	INT cStride;				// Costs from one row to the next
+};
+
+// Callbacks that can hand CAStar2D their costs in bulk, either from their own live
+// storage or from a snapshot (see CCostGridSnapshot).  Cells outside the grid are
+// blocked.  GetCostGrid() returns S_FALSE when no grid is available, and the search
+// then uses GetPathValue() instead.
+interface IAStarCostGrid : IAStarCallback2D
+{
+	virtual HRESULT GetCostGrid (__out ASTAR_COST_GRID* pGrid) = 0;
+};
+
+class CJumpPointMap;
+
+// The node pool and open heap used by CAStar2D searches.  A search only touches the
+// nodes it reaches, and starting the next search is a generation bump, so one context
+// can serve many searches per frame without allocating or clearing anything once it
+// has grown to the largest search window.  Several CAStar2D objects may share one
+// context, but only the most recent search's path can be read back from it.
+
+class CPathContext
+{
+	friend class CAStar2D;
+
 private:
-	struct PATHDATA
+	// One node for every cell of the search window.  A node only belongs to the
+	// current search when its generation matches m_nGeneration.
+	struct NODE
 	{
+		ULONG nGeneration;
 		ULONG nParent;
-		INT x, y;
 		INT g, h;
+		LONG iHeap;		// Position in the open heap, or NODE_CLOSED
 	};
 
-	TList<PATHDATA> m_listFreeNodes;
+	NODE* m_prgNodes;
+	ULONG m_cNodes;
+	ULONG m_nGeneration;
 
-	typedef TList<PATHDATA>::LIST_NODE NODE;
+	// Open heap of node indexes, ordered by F and then by index
+	CIndexedHeap m_heap;
+
+	// Cached passability for jump point searches, stamped like the nodes
+	ULONG* m_prgPassable;
+	ULONG m_cPassable;
+
+	// Bucket queue for reachability searches, with one list of entries for each cost
+	// up to the budget.  An entry is skipped if its node has since moved to a cheaper
+	// bucket.
+	struct BUCKET_ENTRY
+	{
+		ULONG nNode;
+		ULONG nNext;
+	};
+
+	TArray<ULONG> m_aBuckets;
+	TArray<BUCKET_ENTRY> m_aBucketEntries;
+
+	ULONG m_cExpanded;
+
+public:
+	CPathContext ();
+	~CPathContext ();
+
+	// Grows the pool to hold windows of cNodes cells.  The pool never shrinks.
+	HRESULT Reserve (ULONG cNodes);
+
+	inline ULONG GetCapacity (VOID) const { return m_cNodes; }
+
+	// Nodes taken from the open set by the last search
+	inline ULONG GetExpandedCount (VOID) const { return m_cExpanded; }
+
+private:
+	HRESULT ReservePassable (ULONG cCells);
+	VOID Reset (VOID);
 
-	TMap<ULONG, NODE*> m_mapClosed;
-	TMap<ULONG, NODE*> m_mapOpen;
+	VOID AddOpenNode (ULONG nNode, ULONG nParent, INT g, INT h);
+	VOID RelaxNode (ULONG nNode, ULONG nParent, INT g, INT h);
+
+	HRESULT ResetBuckets (INT cBuckets);
+	HRESULT PushBucket (ULONG nNode, ULONG nParent, INT g);
+
+	inline TAStarHeapOrder<NODE> GetHeapOrder (VOID)
+	{
+		TAStarHeapOrder<NODE> order = { m_prgNodes };
+		return order;
+	}
+
+	inline ULONG PopHeap (VOID)
+	{
+		m_cExpanded++;
+		return m_heap.Pop(GetHeapOrder());
+	}
+
+	// Restores the heap after an open node's g has been lowered.
+	inline VOID DecreaseNode (ULONG nNode) { m_heap.Decrease(GetHeapOrder(), nNode); }
+};
+
+class CAStar2D
+{
+private:
+	typedef CPathContext::NODE NODE;
+
+	CPathContext m_Context;
+	CPathContext* m_pContext;
 
 	INT m_x, m_y;
 	INT m_nSize;
 
+	ASTAR_HEURISTIC m_eHeuristic;
+
 public:
 	CAStar2D ();
-	~CAStar2D ();
+
+	// Searches with a long-lived context instead of the object's own.
+	CAStar2D (CPathContext* pContext);
 
 	HRESULT PreInit (VOID);
+
+	// ASTAR_HEURISTIC_MANHATTAN unless changed
+	inline VOID SetHeuristic (ASTAR_HEURISTIC eHeuristic) { m_eHeuristic = eHeuristic; }
+
 	HRESULT FindPath (INT xFrom, INT yFrom, INT xDest, INT yDest, INT nRange, IAStarCallback2D* pCallback);
+
+	// Reads the costs straight from the grid when one is available, which finds the
+	// same paths as the callback without a virtual call for every neighbour.
+	HRESULT FindPath (INT xFrom, INT yFrom, INT xDest, INT yDest, INT nRange, IAStarCostGrid* pGrid);
+
+	// Jump point search for uniform-cost grids.  A cell is either passable or blocked,
+	// as reported by pCallback->GetPathValue() with the cell passed as its own origin,
+	// and the value reported is ignored.  Steps cost ADJACENT_MOVEMENT_COST or
+	// DIAGONAL_MOVEMENT_COST, and diagonal steps need both adjacent cells passable.
+	// A blocked start fails with E_INVALIDARG, like the CJumpPointMap overload.
+	HRESULT FindPathJPS (INT xFrom, INT yFrom, INT xDest, INT yDest, INT nRange, IAStarCallback2D* pCallback);
+
+	// The same search using the precomputed jump distances of a CJumpPointMap (JPS+).
+	// The search window is the map's region.
+	HRESULT FindPathJPS (INT xFrom, INT yFrom, INT xDest, INT yDest, const CJumpPointMap* pMap);
+
+	// Finds every cell that can be reached from the start for at most nBudget, using
+	// the same step costs as FindPath().  The cells are appended to paReachable in order
+	// of cost, starting with the start itself, and GetPath() and GetPathCost() can then
+	// be used for any of them.  Negative values from the callback count as zero.
+	HRESULT ComputeReachable (INT xFrom, INT yFrom, INT nBudget, IAStarCallback2D* pCallback, TArray<POINT>* paReachable);
+
+	// Jump point paths include every cell between the jump points.
 	HRESULT GetPath (INT xDest, INT yDest, TArray<POINT>* paPath);
 
+	// Cost of the path found by the last search, including the values reported by the callback
+	HRESULT GetPathCost (INT xDest, INT yDest, __out INT* pnCost);
+
+	// Nodes taken from the open set by the last search
+	inline ULONG GetExpandedCount (VOID) const { return m_pContext->m_cExpanded; }
+
+	inline CPathContext* GetContext (VOID) { return m_pContext; }
+
 private:
-	VOID Reset (VOID);
-	HRESULT AddOpenNode (ULONG nParent, INT x, INT y, INT g, INT h);
-	BOOL GetAndAdjustValue (IAStarCallback2D* pCallback, INT x, INT y, NODE* p, __out INT* pnValue);
+	HRESULT BeginSearch (INT xFrom, INT yFrom, INT h);
+	HRESULT FindPathOnGrid (INT xFrom, INT yFrom, INT xDest, INT yDest, INT nRange, const ASTAR_COST_GRID* pcGrid);
+	BOOL GetAndAdjustValue (IAStarCallback2D* pCallback, INT x, INT y, INT xFrom, INT yFrom, INT g, __out INT* pnValue);
+
+	BOOL IsPassable (IAStarCallback2D* pCallback, INT x, INT y);
+	BOOL Jump (IAStarCallback2D* pCallback, INT x, INT y, INT dx, INT dy, INT xDest, INT yDest, __out INT* pxJump, __out INT* pyJump);
+
+	inline INT MoveDistance (INT x, INT y, INT xDest, INT yDest)
+	{
+		if(ASTAR_HEURISTIC_OCTILE == m_eHeuristic)
+			return OctileDistance(x, y, xDest, yDest);
+		return abs(x - xDest) * DISTANCE_ESTIMATE_MULTIPLIER + abs(y - yDest) * DISTANCE_ESTIMATE_MULTIPLIER;
+	}
 
-	inline INT MoveDistance (INT x, INT y, INT xDest, INT yDest) { return abs(x - xDest) * DISTANCE_ESTIMATE_MULTIPLIER + abs(y - yDest) * DISTANCE_ESTIMATE_MULTIPLIER; }
 	inline ULONG CoordToIndex (INT x, INT y) { return (y - m_y) * m_nSize + (x - m_x); }
 };
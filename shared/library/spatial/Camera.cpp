@@ -3,7 +3,8 @@
 #include <gl\gl.h>
 #include "Camera.h"
 
-CCamera::CCamera (const CCamera& cameraSource)
+CCamera::CCamera (const CCamera& cameraSource) :
+	m_transform(cameraSource.m_transform)
 {
 	// No need to call Init() - everything's being explicitly copied.
 
@@ -13,6 +14,11 @@ CCamera::CCamera (const CCamera& cameraSource)
 	m_dblDirRadians = cameraSource.m_dblDirRadians;
 
 	m_dblPoint = cameraSource.m_dblPoint;
+
+	m_dblViewPoint = cameraSource.m_dblViewPoint;
+	m_rViewLook = cameraSource.m_rViewLook;
+	m_rViewDirection = cameraSource.m_rViewDirection;
+	m_fViewValid = cameraSource.m_fViewValid;
 }
 
 CCamera::CCamera (DOUBLE x, DOUBLE y, DOUBLE z)
@@ -119,6 +125,40 @@ VOID CCamera::Raise (FLOAT fAddPosition)
 	m_dblPoint.y += fAddPosition;
 }
 
+VOID CCamera::SetProjection (FLOAT rFieldOfView, FLOAT rAspect, FLOAT rNear, FLOAT rFar)
+{
+	m_transform.SetPerspective(rFieldOfView, rAspect, rNear, rFar);
+}
+
+VOID CCamera::SetViewport (INT x, INT y, INT xSize, INT ySize)
+{
+	m_transform.SetViewport(x, y, xSize, ySize);
+}
+
+const FLOAT* CCamera::GetViewMatrix (VOID)
+{
+	UpdateView();
+	return m_transform.GetView();
+}
+
+const FLOAT* CCamera::GetViewProjectionMatrix (VOID)
+{
+	UpdateView();
+	return m_transform.GetViewProjection();
+}
+
+SIZE_T CCamera::ProjectPoints (const FPOINT* prgPoints, __out_ecount(cPoints) POINT* prgScreen, SIZE_T cPoints)
+{
+	UpdateView();
+	return m_transform.ProjectPoints(prgPoints, prgScreen, cPoints);
+}
+
+SIZE_T CCamera::UnprojectPoints (const POINT* prgScreen, FLOAT yPlane, __out_ecount(cPoints) FPOINT* prgWorld, SIZE_T cPoints)
+{
+	UpdateView();
+	return m_transform.UnprojectPoints(prgScreen, yPlane, prgWorld, cPoints);
+}
+
 //
 
 VOID CCamera::Init (VOID)
@@ -127,4 +167,18 @@ VOID CCamera::Init (VOID)
 	m_rLook = 0.0f;
 	m_rDirection = 0.0f;
 	m_dblDirRadians = 0.0;
+	m_fViewValid = FALSE;
+}
+
+VOID CCamera::UpdateView (VOID)
+{
+	if(!m_fViewValid || m_rViewLook != m_rLook || m_rViewDirection != m_rDirection ||
+		m_dblViewPoint.x != m_dblPoint.x || m_dblViewPoint.y != m_dblPoint.y || m_dblViewPoint.z != m_dblPoint.z)
+	{
+		m_transform.SetView(m_dblPoint.x, m_dblPoint.y, m_dblPoint.z, -m_rLook, m_rDirection);
+		m_dblViewPoint = m_dblPoint;
+		m_rViewLook = m_rLook;
+		m_rViewDirection = m_rDirection;
+		m_fViewValid = TRUE;
+	}
 }
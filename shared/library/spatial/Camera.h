@@ -2,6 +2,7 @@
 #define	_H_CAMERA
 
 #include "Geometry.h"
+#include "ViewTransform.h"
 
 class CCamera
 {
@@ -13,6 +14,15 @@ public:
 
 	BOOL m_bFixedLook;
 
+private:
+	// The fields above are public, so the cached view remembers what it was built from
+	// instead of relying on every change to mark it dirty.
+	CViewTransform m_transform;
+	DPOINT m_dblViewPoint;
+	FLOAT m_rViewLook;
+	FLOAT m_rViewDirection;
+	BOOL m_fViewValid;
+
 public:
 	CCamera (const CCamera& cameraSource);
 	CCamera (DOUBLE x, DOUBLE y, DOUBLE z);
@@ -39,8 +49,22 @@ public:
 	VOID MoveBackward (FLOAT rVelocity);
 	VOID Raise (FLOAT fAddPosition);
 
+	// Projection and viewport for the CPU transforms, matching the values given to
+	// gluPerspective() and glViewport().  They don't change the OpenGL state.
+	VOID SetProjection (FLOAT rFieldOfView, FLOAT rAspect, FLOAT rNear, FLOAT rFar);
+	VOID SetViewport (INT x, INT y, INT xSize, INT ySize);
+
+	// The matrix SetPerspective() applies, and the projection times that matrix
+	const FLOAT* GetViewMatrix (VOID);
+	const FLOAT* GetViewProjectionMatrix (VOID);
+
+	// See CViewTransform::ProjectPoints() and CViewTransform::UnprojectPoints().
+	SIZE_T ProjectPoints (const FPOINT* prgPoints, __out_ecount(cPoints) POINT* prgScreen, SIZE_T cPoints);
+	SIZE_T UnprojectPoints (const POINT* prgScreen, FLOAT yPlane, __out_ecount(cPoints) FPOINT* prgWorld, SIZE_T cPoints);
+
 private:
 	VOID Init (VOID);
+	VOID UpdateView (VOID);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include <windows.h>
+#include "..\Core\CoreDefs.h"
+#include "CostGridSnapshot.h"
+
+CCostGridSnapshot::CCostGridSnapshot () :
+	m_prgnCosts(NULL),
+	m_x(0),
+	m_y(0),
+	m_xSize(0),
+	m_ySize(0)
+{
+}
+
+CCostGridSnapshot::~CCostGridSnapshot ()
+{
+	Clear();
+}
+
+HRESULT CCostGridSnapshot::Capture (INT x, INT y, INT xSize, INT ySize, IAStarCallback2D* pCallback)
+{
+	HRESULT hr;
+
+	CheckIf(NULL == pCallback || 0 >= xSize || 0 >= ySize, E_INVALIDARG);
+
+	if(xSize * ySize != m_xSize * m_ySize)
+	{
+		Clear();
+		m_prgnCosts = __new INT[xSize * ySize];
+		CheckAlloc(m_prgnCosts);
+	}
+
+	m_x = x;
+	m_y = y;
+	m_xSize = xSize;
+	m_ySize = ySize;
+	Update(x, y, xSize, ySize, pCallback);
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
+
+VOID CCostGridSnapshot::Update (INT x, INT y, INT xSize, INT ySize, IAStarCallback2D* pCallback)
+{
+	INT xEnd = min(x + xSize, m_x + m_xSize);
+	INT yEnd = min(y + ySize, m_y + m_ySize);
+
+	for(INT yCell = max(y, m_y); yCell < yEnd; yCell++)
+	{
+		INT* prgnRow = m_prgnCosts + (yCell - m_y) * m_xSize;
+
+		for(INT xCell = max(x, m_x); xCell < xEnd; xCell++)
+		{
+			INT nValue;
+
+			if(!pCallback->GetPathValue(xCell, yCell, xCell, yCell, &nValue) || 0 > nValue)
+				nValue = -1;
+			prgnRow[xCell - m_x] = nValue;
+		}
+	}
+}
+
+BOOL CCostGridSnapshot::GetPathValue (INT x, INT y, INT xFrom, INT yFrom, __out INT* pnValue)
+{
+	INT nValue;
+
+	if(x < m_x || y < m_y || x >= m_x + m_xSize || y >= m_y + m_ySize)
+		return FALSE;
+
+	nValue = m_prgnCosts[(y - m_y) * m_xSize + (x - m_x)];
+	if(0 > nValue)
+		return FALSE;
+
+	*pnValue = nValue;
+	return TRUE;
+}
+
+HRESULT CCostGridSnapshot::GetCostGrid (__out ASTAR_COST_GRID* pGrid)
+{
+	if(NULL == m_prgnCosts)
+		return S_FALSE;
+
+	pGrid->pcnCosts = m_prgnCosts;
+	pGrid->x = m_x;
+	pGrid->y = m_y;
+	pGrid->xSize = m_xSize;
+	pGrid->ySize = m_ySize;
+	pGrid->cStride = m_xSize;
+	return S_OK;
+}
+
+VOID CCostGridSnapshot::Clear (VOID)
+{
+	SafeDeleteArray(m_prgnCosts);
+	m_xSize = 0;
+	m_ySize = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "AStar2D.h"
+
+// A copy of a callback's costs over a fixed region, for callbacks that don't keep
+// their costs in a grid of their own.  Each cell is read once, as
+// pCallback->GetPathValue() reports it with the cell passed as its own origin, so the
+// snapshot only suits costs that don't depend on the direction of the step.  Capture()
+// must be called again, or Update() for the changed cells, when the costs change.
+
+class CCostGridSnapshot : public IAStarCostGrid
+{
+private:
+	INT* m_prgnCosts;
+	INT m_x, m_y;
+	INT m_xSize, m_ySize;
+
+public:
+	CCostGridSnapshot ();
+	~CCostGridSnapshot ();
+
+	HRESULT Capture (INT x, INT y, INT xSize, INT ySize, IAStarCallback2D* pCallback);
+	VOID Update (INT x, INT y, INT xSize, INT ySize, IAStarCallback2D* pCallback);
+
+	// IAStarCallback2D
+	virtual BOOL GetPathValue (INT x, INT y, INT xFrom, INT yFrom, __out INT* pnValue);
+
+	// IAStarCostGrid
+	virtual HRESULT GetCostGrid (__out ASTAR_COST_GRID* pGrid);
+
+private:
+	VOID Clear (VOID);
+};
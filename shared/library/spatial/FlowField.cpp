@@ -0,0 +1,308 @@
+#include <windows.h>
+#include "..\Core\CoreDefs.h"
+#include "FlowField.h"
+
+#define	NOT_IN_HEAP			HEAP_INDEX_NONE
+#define	INVALIDATED			-2
+
+CFlowField::CFlowField () :
+	m_pGrid(NULL),
+	m_prgnDistance(NULL),
+	m_pbDirection(NULL),
+	m_prgHeapIndex(NULL),
+	m_cCells(0)
+{
+	ZeroMemory(&m_grid, sizeof(m_grid));
+}
+
+CFlowField::~CFlowField ()
+{
+	Clear();
+}
+
+HRESULT CFlowField::Compute (IAStarCostGrid* pGrid, const POINT* prgptTargets, INT cTargets)
+{
+	HRESULT hr;
+
+	CheckIf(NULL == pGrid || 0 > cTargets || (0 < cTargets && NULL == prgptTargets), E_INVALIDARG);
+
+	Clear();
+
+	Check(pGrid->GetCostGrid(&m_grid));
+	CheckIf(S_OK != hr, E_NOTIMPL);
+	CheckIf(0 >= m_grid.xSize || 0 >= m_grid.ySize || m_grid.cStride < m_grid.xSize, E_INVALIDARG);
+	m_pGrid = pGrid;
+
+	for(INT i = 0; i < cTargets; i++)
+		Check(m_aTargets.Append(prgptTargets + i));
+
+	Check(Allocate());
+	Reset();
+
+Cleanup:
+	if(FAILED(hr))
+		Clear();
+	return hr;
+}
+
+HRESULT CFlowField::Update (INT x, INT y, INT xSize, INT ySize)
+{
+	HRESULT hr;
+	ASTAR_COST_GRID grid;
+	INT xMax, yMax;
+
+	CheckIf(NULL == m_pGrid, E_UNEXPECTED);
+	CheckIf(0 > xSize || 0 > ySize, E_INVALIDARG);
+
+	Check(m_pGrid->GetCostGrid(&grid));
+	CheckIf(S_OK != hr, E_NOTIMPL);
+
+	if(grid.x != m_grid.x || grid.y != m_grid.y || grid.xSize != m_grid.xSize || grid.ySize != m_grid.ySize)
+	{
+		CheckIf(0 >= grid.xSize || 0 >= grid.ySize || grid.cStride < grid.xSize, E_INVALIDARG);
+		m_grid = grid;
+		Check(Allocate());
+		Reset();
+		goto Cleanup;
+	}
+	m_grid = grid;
+
+	xMax = min(x + xSize, m_grid.x + m_grid.xSize);
+	yMax = min(y + ySize, m_grid.y + m_grid.ySize);
+	x = max(x, m_grid.x);
+	y = max(y, m_grid.y);
+
+	// Every changed cell is searched again, along with every cell whose path entered
+	// one of them.  The rest of the field still holds the cost of a real path.
+	m_aInvalid.Clear();
+	for(INT yCell = y; yCell < yMax; yCell++)
+	{
+		for(INT xCell = x; xCell < xMax; xCell++)
+		{
+			ULONG nCell = CoordToIndex(xCell, yCell);
+
+			if(INVALIDATED != m_prgHeapIndex[nCell])
+			{
+				Invalidate(nCell);
+				Check(m_aInvalid.Append(nCell));
+			}
+		}
+	}
+
+	for(sysint i = 0; i < m_aInvalid.Length(); i++)
+	{
+		ULONG nCell = m_aInvalid[i];
+		INT xCell = m_grid.x + static_cast<INT>(nCell % m_grid.xSize);
+		INT yCell = m_grid.y + static_cast<INT>(nCell / m_grid.xSize);
+
+		for(INT nDirection = 0; nDirection < JUMP_DIRECTIONS; nDirection++)
+		{
+			INT xNext = xCell + CJumpPointMap::c_rgxDirection[nDirection];
+			INT yNext = yCell + CJumpPointMap::c_rgyDirection[nDirection];
+			ULONG nNext;
+
+			if(!IsInside(xNext, yNext))
+				continue;
+
+			nNext = CoordToIndex(xNext, yNext);
+			if(INVALIDATED != m_prgHeapIndex[nNext] && ((nDirection + JUMP_DIRECTIONS / 2) & 7) == m_pbDirection[nNext])
+			{
+				Invalidate(nNext);
+				Check(m_aInvalid.Append(nNext));
+			}
+		}
+	}
+
+	// Seed each cleared cell from its best neighbour that still has a distance.  The
+	// search then also carries any lowered costs out past the cleared cells.
+	for(sysint i = 0; i < m_aInvalid.Length(); i++)
+	{
+		ULONG nCell = m_aInvalid[i];
+		INT xCell = m_grid.x + static_cast<INT>(nCell % m_grid.xSize);
+		INT yCell = m_grid.y + static_cast<INT>(nCell / m_grid.xSize);
+
+		m_prgHeapIndex[nCell] = NOT_IN_HEAP;
+		if(0 > GetCost(xCell, yCell))
+			continue;
+
+		if(FLOW_TARGET == m_pbDirection[nCell])
+		{
+			Relax(nCell, 0, FLOW_TARGET);
+			continue;
+		}
+
+		for(INT nDirection = 0; nDirection < JUMP_DIRECTIONS; nDirection++)
+		{
+			INT xNext = xCell + CJumpPointMap::c_rgxDirection[nDirection];
+			INT yNext = yCell + CJumpPointMap::c_rgyDirection[nDirection];
+			INT nDistance;
+
+			if(!IsInside(xNext, yNext))
+				continue;
+
+			nDistance = m_prgnDistance[CoordToIndex(xNext, yNext)];
+			if(FLOW_UNREACHABLE != nDistance)
+				Relax(nCell, nDistance + GetCost(xNext, yNext) + ((nDirection & 1) ? DIAGONAL_MOVEMENT_COST : ADJACENT_MOVEMENT_COST), static_cast<BYTE>(nDirection));
+		}
+	}
+
+	Search();
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
+
+INT CFlowField::GetDistance (INT x, INT y) const
+{
+	if(NULL == m_prgnDistance || !IsInside(x, y))
+		return FLOW_UNREACHABLE;
+	return m_prgnDistance[CoordToIndex(x, y)];
+}
+
+BYTE CFlowField::GetDirection (INT x, INT y) const
+{
+	if(NULL == m_pbDirection || !IsInside(x, y))
+		return FLOW_NONE;
+	return m_pbDirection[CoordToIndex(x, y)];
+}
+
+HRESULT CFlowField::GetPath (INT x, INT y, TArray<POINT>* paPath) const
+{
+	HRESULT hr = S_OK;
+	POINT pt = { x, y };
+
+	CheckIf(FLOW_UNREACHABLE == GetDistance(x, y), HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+
+	// Distances fall with every step, so the walk can't take more steps than there are cells.
+	for(ULONG i = 0; i < m_cCells; i++)
+	{
+		BYTE bDirection = m_pbDirection[CoordToIndex(pt.x, pt.y)];
+
+		Check(paPath->Append(&pt));
+		CheckIf(FLOW_TARGET == bDirection, S_OK);
+		CheckIf(JUMP_DIRECTIONS <= bDirection, E_UNEXPECTED);
+
+		pt.x += CJumpPointMap::c_rgxDirection[bDirection];
+		pt.y += CJumpPointMap::c_rgyDirection[bDirection];
+	}
+
+	hr = E_UNEXPECTED;
+
+Cleanup:
+	return hr;
+}
+
+VOID CFlowField::Clear (VOID)
+{
+	SafeDeleteArray(m_prgnDistance);
+	SafeDeleteArray(m_pbDirection);
+	SafeDeleteArray(m_prgHeapIndex);
+	m_heap.Free();
+	m_cCells = 0;
+	m_pGrid = NULL;
+	ZeroMemory(&m_grid, sizeof(m_grid));
+	m_aTargets.Clear();
+	m_aInvalid.Clear();
+}
+
+HRESULT CFlowField::Allocate (VOID)
+{
+	HRESULT hr = S_OK;
+	ULONG cCells = static_cast<ULONG>(m_grid.xSize) * static_cast<ULONG>(m_grid.ySize);
+
+	if(cCells != m_cCells)
+	{
+		SafeDeleteArray(m_prgnDistance);
+		SafeDeleteArray(m_pbDirection);
+		SafeDeleteArray(m_prgHeapIndex);
+		m_cCells = 0;
+
+		m_prgnDistance = __new INT[cCells];
+		CheckAlloc(m_prgnDistance);
+		m_pbDirection = __new BYTE[cCells];
+		CheckAlloc(m_pbDirection);
+		m_prgHeapIndex = __new LONG[cCells];
+		CheckAlloc(m_prgHeapIndex);
+		Check(m_heap.Reserve(cCells));
+		m_cCells = cCells;
+	}
+
+Cleanup:
+	return hr;
+}
+
+VOID CFlowField::Reset (VOID)
+{
+	for(ULONG i = 0; i < m_cCells; i++)
+	{
+		m_prgnDistance[i] = FLOW_UNREACHABLE;
+		m_pbDirection[i] = FLOW_NONE;
+		m_prgHeapIndex[i] = NOT_IN_HEAP;
+	}
+	m_heap.Clear();
+
+	// Blocked targets keep their mark, so they take effect if they're opened later.
+	for(sysint i = 0; i < m_aTargets.Length(); i++)
+	{
+		const POINT& pt = m_aTargets[i];
+
+		if(IsInside(pt.x, pt.y))
+		{
+			ULONG nCell = CoordToIndex(pt.x, pt.y);
+
+			m_pbDirection[nCell] = FLOW_TARGET;
+			if(0 <= GetCost(pt.x, pt.y))
+				Relax(nCell, 0, FLOW_TARGET);
+		}
+	}
+
+	Search();
+}
+
+// Searching backwards from the targets, a cell's neighbour reaches it by paying the
+// cell's own cost, and then points back at it.
+VOID CFlowField::Search (VOID)
+{
+	while(0 < m_heap.Length())
+	{
+		ULONG nCell = m_heap.Pop(GetHeapOrder());
+		INT xCell = m_grid.x + static_cast<INT>(nCell % m_grid.xSize);
+		INT yCell = m_grid.y + static_cast<INT>(nCell / m_grid.xSize);
+		INT nStep = m_prgnDistance[nCell] + GetCost(xCell, yCell);
+
+		for(INT nDirection = 0; nDirection < JUMP_DIRECTIONS; nDirection++)
+		{
+			INT xNext = xCell + CJumpPointMap::c_rgxDirection[nDirection];
+			INT yNext = yCell + CJumpPointMap::c_rgyDirection[nDirection];
+
+			if(!IsInside(xNext, yNext) || 0 > GetCost(xNext, yNext))
+				continue;
+
+			Relax(CoordToIndex(xNext, yNext), nStep + ((nDirection & 1) ? DIAGONAL_MOVEMENT_COST : ADJACENT_MOVEMENT_COST),
+				static_cast<BYTE>((nDirection + JUMP_DIRECTIONS / 2) & 7));
+		}
+	}
+}
+
+VOID CFlowField::Invalidate (ULONG nCell)
+{
+	m_prgnDistance[nCell] = FLOW_UNREACHABLE;
+	if(FLOW_TARGET != m_pbDirection[nCell])
+		m_pbDirection[nCell] = FLOW_NONE;
+	m_prgHeapIndex[nCell] = INVALIDATED;
+}
+
+VOID CFlowField::Relax (ULONG nCell, INT nDistance, BYTE bDirection)
+{
+	if(nDistance < m_prgnDistance[nCell])
+	{
+		m_prgnDistance[nCell] = nDistance;
+		m_pbDirection[nCell] = bDirection;
+
+		if(0 > m_prgHeapIndex[nCell])
+			m_heap.Push(GetHeapOrder(), nCell);
+		else
+			m_heap.Decrease(GetHeapOrder(), nCell);
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "AStar2D.h"
+#include "JumpPointMap.h"
+#include "IndexedHeap.h"
+
+#define	FLOW_UNREACHABLE		0x7FFFFFFF
+
+// Direction values beyond the JUMP_DIRECTION range
+#define	FLOW_TARGET				0xFE
+#define	FLOW_NONE				0xFF
+
+// Distances to the nearest of a set of targets for every cell of a cost grid, from one
+// multi-source Dijkstra search run backwards from the targets.  Costs follow CAStar2D:
+// a step costs ADJACENT_MOVEMENT_COST or DIAGONAL_MOVEMENT_COST plus the grid's cost for
+// the cell being entered.  Each cell also stores the JUMP_DIRECTION of its next step,
+// so any number of units can follow the field toward the targets without searching.
+//
+// When a few costs change, Update() only clears the cells whose paths entered the
+// changed cells and searches again from the cells around them.
+
+class CFlowField
+{
+private:
+	// Orders cells by distance, and then by index
+	struct HEAP_ORDER
+	{
+		const INT* prgnDistance;
+		LONG* prgHeapIndex;
+
+		inline BOOL HeapLess (ULONG nA, ULONG nB) const
+		{
+			return prgnDistance[nA] < prgnDistance[nB] || (prgnDistance[nA] == prgnDistance[nB] && nA < nB);
+		}
+
+		inline LONG& HeapIndex (ULONG n) const { return prgHeapIndex[n]; }
+	};
+
+	IAStarCostGrid* m_pGrid;
+	ASTAR_COST_GRID m_grid;
+
+	INT* m_prgnDistance;
+	PBYTE m_pbDirection;
+	LONG* m_prgHeapIndex;	// Position in the open heap, or negative
+	ULONG m_cCells;
+
+	// Open heap of cell indexes
+	CIndexedHeap m_heap;
+
+	TArray<POINT> m_aTargets;
+	TArray<ULONG> m_aInvalid;
+
+public:
+	CFlowField ();
+	~CFlowField ();
+
+	// The grid must be available as contiguous costs, and the field covers the grid.
+	HRESULT Compute (IAStarCostGrid* pGrid, const POINT* prgptTargets, INT cTargets);
+
+	// Reads the grid again after the costs of the given cells have changed.  If the
+	// grid has moved or changed size, the whole field is computed again.
+	HRESULT Update (INT x, INT y, INT xSize, INT ySize);
+
+	// FLOW_UNREACHABLE for blocked cells, cells outside the grid, and cells with no
+	// path to any target
+	INT GetDistance (INT x, INT y) const;
+
+	// A JUMP_DIRECTION, FLOW_TARGET or FLOW_NONE
+	BYTE GetDirection (INT x, INT y) const;
+
+	// Appends the cells from (x, y) to its target by following the directions.
+	HRESULT GetPath (INT x, INT y, TArray<POINT>* paPath) const;
+
+private:
+	VOID Clear (VOID);
+	HRESULT Allocate (VOID);
+	VOID Reset (VOID);
+	VOID Search (VOID);
+	VOID Invalidate (ULONG nCell);
+	VOID Relax (ULONG nCell, INT nDistance, BYTE bDirection);
+
+	inline HEAP_ORDER GetHeapOrder (VOID)
+	{
+		HEAP_ORDER order = { m_prgnDistance, m_prgHeapIndex };
+		return order;
+	}
+
+	inline BOOL IsInside (INT x, INT y) const
+	{
+		return x >= m_grid.x && y >= m_grid.y && x < m_grid.x + m_grid.xSize && y < m_grid.y + m_grid.ySize;
+	}
+
+	inline ULONG CoordToIndex (INT x, INT y) const { return (y - m_grid.y) * m_grid.xSize + (x - m_grid.x); }
+	inline INT GetCost (INT x, INT y) const { return m_grid.pcnCosts[(y - m_grid.y) * m_grid.cStride + (x - m_grid.x)]; }
+};
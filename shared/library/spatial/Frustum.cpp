@@ -2,8 +2,13 @@
 #include <math.h>
 #include <windows.h>
 #include <gl\gl.h>
+#include "..\Core\CoreDefs.h"
 #include "Frustum.h"
 
+#ifdef	CORE_SSE2
+	#include <emmintrin.h>
+#endif
+
 CFrustum::CFrustum ()
 {
 }
@@ -16,11 +21,17 @@ VOID CFrustum::Update (VOID)
 {
 	FLOAT Projection[16];
 	FLOAT ModelView[16];
-	FLOAT Clipping[16];
 
 	glGetFloatv(GL_PROJECTION_MATRIX,Projection);
 	glGetFloatv(GL_MODELVIEW_MATRIX,ModelView);
 
+	Update(Projection, ModelView);
+}
+
+VOID CFrustum::Update (const FLOAT* Projection, const FLOAT* ModelView)
+{
+	FLOAT Clipping[16];
+
 	// Now that we have our modelview and projection matrix,
 	// if we combine these 2 matrices, it will give us our
 	// clipping planes.  To combine 2 matrices, multiply them.
@@ -234,6 +245,62 @@ BOOL CFrustum::SphereInFrustumDistance (FLOAT x, FLOAT y, FLOAT z, FLOAT radius,
 	return TRUE;
 }
 
+VOID CFrustum::CullBoxes (const FBOX* pcBoxes, SIZE_T cBoxes, __out_ecount(cBoxes) BYTE* pbVisible)
+{
+	SIZE_T n = 0;
+
+#ifdef	CORE_SSE2
+	// Spread the fields of four boxes across six registers, and then each plane only
+	// has to test the three registers holding its farthest corner.
+	for(; n + 4 <= cBoxes; n += 4)
+	{
+		const FLOAT* pcfBoxes = reinterpret_cast<const FLOAT*>(pcBoxes + n);
+		__m128 rgField[6];
+		__m128 Inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		INT nInside;
+
+		for(INT i = 0; i < 6; i++)
+			rgField[i] = _mm_setr_ps(pcfBoxes[i], pcfBoxes[i + 6], pcfBoxes[i + 12], pcfBoxes[i + 18]);
+
+		for(INT i = 0; i < 6; i++)
+		{
+			__m128 Distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(m_Frustum[i][0]), rgField[m_rgbFarCorner[i][0]]),
+				_mm_mul_ps(_mm_set1_ps(m_Frustum[i][1]), rgField[m_rgbFarCorner[i][1]])),
+				_mm_mul_ps(_mm_set1_ps(m_Frustum[i][2]), rgField[m_rgbFarCorner[i][2]])),
+				_mm_set1_ps(m_Frustum[i][3]));
+
+			Inside = _mm_and_ps(Inside, _mm_cmpgt_ps(Distance, _mm_setzero_ps()));
+			if(0 == _mm_movemask_ps(Inside))
+				break;
+		}
+
+		nInside = _mm_movemask_ps(Inside);
+		pbVisible[n] = static_cast<BYTE>(nInside & 1);
+		pbVisible[n + 1] = static_cast<BYTE>((nInside >> 1) & 1);
+		pbVisible[n + 2] = static_cast<BYTE>((nInside >> 2) & 1);
+		pbVisible[n + 3] = static_cast<BYTE>((nInside >> 3) & 1);
+	}
+#endif
+
+	for(; n < cBoxes; n++)
+	{
+		const FLOAT* pcfBox = reinterpret_cast<const FLOAT*>(pcBoxes + n);
+		BYTE fVisible = TRUE;
+
+		for(INT i = 0; i < 6; i++)
+		{
+			if(m_Frustum[i][0] * pcfBox[m_rgbFarCorner[i][0]] + m_Frustum[i][1] * pcfBox[m_rgbFarCorner[i][1]] + m_Frustum[i][2] * pcfBox[m_rgbFarCorner[i][2]] + m_Frustum[i][3] <= 0)
+			{
+				fVisible = FALSE;
+				break;
+			}
+		}
+
+		pbVisible[n] = fVisible;
+	}
+}
+
 FLOAT CFrustum::Get (INT nPlane, INT nValue)
 {
 	return m_Frustum[nPlane][nValue];
@@ -282,6 +349,15 @@ VOID CFrustum::CalculateFrustumSides (FLOAT* Clipping)
 	m_Frustum[FR_NEAR][2] = Clipping[11] + Clipping[10];
 	m_Frustum[FR_NEAR][3] = Clipping[15] + Clipping[14];
 	NormalizePlane(m_Frustum[FR_NEAR]);
+
+	// The corner of a box farthest along each normal takes the maximum of each axis
+	// where the normal is positive and the minimum elsewhere.
+	for(INT i = 0; i < 6; i++)
+	{
+		m_rgbFarCorner[i][0] = 0 <= m_Frustum[i][0] ? 3 : 0;
+		m_rgbFarCorner[i][1] = 0 <= m_Frustum[i][1] ? 4 : 1;
+		m_rgbFarCorner[i][2] = 0 <= m_Frustum[i][2] ? 5 : 2;
+	}
 }
 
 VOID CFrustum::NormalizePlane (FLOAT* fPlane)
@@ -8,11 +8,17 @@
 #define	FR_FAR			4
 #define	FR_NEAR			5
 
+#include "GeometryTypes.h"
+
 class CFrustum
 {
 private:
 	FLOAT m_Frustum[6][4];
 
+	// For each plane, the FBOX fields (as FLOAT offsets) of the corner farthest along
+	// the plane's normal.  A box is outside the plane when that corner is.
+	BYTE m_rgbFarCorner[6][3];
+
 public:
 	CFrustum ();
 	~CFrustum ();
@@ -20,6 +26,9 @@ public:
 	VOID Update (VOID);
 	VOID UpdateFast (VOID);
 
+	// Builds the frustum from column-major matrices, without asking OpenGL for them.
+	VOID Update (const FLOAT* Projection, const FLOAT* ModelView);
+
 	BOOL PointInFrustum (FLOAT x, FLOAT y, FLOAT z);
 	BOOL SphereInFrustum (FLOAT x, FLOAT y, FLOAT z, FLOAT radius);
 	BOOL CubeInFrustum (FLOAT x, FLOAT y, FLOAT z, FLOAT size);
@@ -27,6 +36,10 @@ public:
 
 	BOOL SphereInFrustumDistance (FLOAT x, FLOAT y, FLOAT z, FLOAT radius, __out FLOAT& rDistance);
 
+	// Sets pbVisible[n] to TRUE or FALSE for each box, with the same answers as
+	// RectInFrustum().  Four boxes are tested at a time when SSE2 is available.
+	VOID CullBoxes (const FBOX* pcBoxes, SIZE_T cBoxes, __out_ecount(cBoxes) BYTE* pbVisible);
+
 	FLOAT Get (INT nPlane, INT nValue);
 
 protected:
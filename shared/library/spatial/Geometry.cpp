@@ -1,8 +1,63 @@
 #include <math.h>
 #include <float.h>
 #include <windows.h>
+#include "..\Core\CoreDefs.h"
 #include "Geometry.h"
 
+#ifdef	CORE_SSE2
+	#include <emmintrin.h>
+#endif
+
+// Pi / 2 split into three parts (Cody and Waite) so the angle can be reduced without
+// losing the low bits of the remainder.
+#define	SINCOS_2_OVER_PI		0.636619772367581343f
+#define	SINCOS_PI_OVER_2_A		1.5703125f
+#define	SINCOS_PI_OVER_2_B		4.837512969970703125e-4f
+#define	SINCOS_PI_OVER_2_C		7.54978995489188216e-8f
+
+// Minimax coefficients for sin and cos over [-pi / 4, pi / 4] (from Cephes)
+#define	SINCOS_SIN_0			-1.9515295891e-4f
+#define	SINCOS_SIN_1			8.3321608736e-3f
+#define	SINCOS_SIN_2			1.6666654611e-1f
+#define	SINCOS_COS_0			2.443315711809948e-5f
+#define	SINCOS_COS_1			1.388731625493765e-3f
+#define	SINCOS_COS_2			4.166664568298827e-2f
+
+#ifdef	CORE_SSE2
+// Reduces each angle to nQuadrant * pi / 2 + r, with |r| <= pi / 4, evaluates both
+// polynomials on r, then swaps sin and cos for odd quadrants and sets the signs.
+static inline VOID SinCos4 (__m128 mmRadians, __out __m128* pmmSin, __out __m128* pmmCos)
+{
+	const __m128i mmOne = _mm_set1_epi32(1);
+	const __m128i mmTwo = _mm_set1_epi32(2);
+
+	__m128 mmQuadrant = _mm_mul_ps(mmRadians, _mm_set1_ps(SINCOS_2_OVER_PI));
+	__m128 mmHalf = _mm_or_ps(_mm_set1_ps(0.5f), _mm_and_ps(mmQuadrant, _mm_set1_ps(-0.0f)));
+	__m128i mmnQuadrant = _mm_cvttps_epi32(_mm_add_ps(mmQuadrant, mmHalf));
+	__m128 q = _mm_cvtepi32_ps(mmnQuadrant);
+	__m128 r = _mm_sub_ps(mmRadians, _mm_mul_ps(q, _mm_set1_ps(SINCOS_PI_OVER_2_A)));
+	r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(SINCOS_PI_OVER_2_B)));
+	r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(SINCOS_PI_OVER_2_C)));
+	__m128 z = _mm_mul_ps(r, r);
+
+	__m128 mmSin = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SINCOS_SIN_0), z), _mm_set1_ps(SINCOS_SIN_1));
+	mmSin = _mm_sub_ps(_mm_mul_ps(mmSin, z), _mm_set1_ps(SINCOS_SIN_2));
+	mmSin = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(mmSin, z), r), r);
+
+	__m128 mmCos = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(SINCOS_COS_0), z), _mm_set1_ps(SINCOS_COS_1));
+	mmCos = _mm_add_ps(_mm_mul_ps(mmCos, z), _mm_set1_ps(SINCOS_COS_2));
+	mmCos = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(mmCos, z), z), _mm_mul_ps(_mm_set1_ps(0.5f), z));
+	mmCos = _mm_add_ps(mmCos, _mm_set1_ps(1.0f));
+
+	__m128 mmSwap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(mmnQuadrant, mmOne), mmOne));
+	__m128 mmSinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(mmnQuadrant, mmTwo), 30));
+	__m128 mmCosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(mmnQuadrant, mmOne), mmTwo), 30));
+
+	*pmmSin = _mm_xor_ps(_mm_or_ps(_mm_and_ps(mmSwap, mmCos), _mm_andnot_ps(mmSwap, mmSin)), mmSinSign);
+	*pmmCos = _mm_xor_ps(_mm_or_ps(_mm_and_ps(mmSwap, mmSin), _mm_andnot_ps(mmSwap, mmCos)), mmCosSign);
+}
+#endif
+
 namespace Geometry
 {
 	DOUBLE dPI = 3.1415926535;
@@ -16,6 +71,7 @@ namespace Geometry
 
 	FLOAT lutSin[360 * 10];
 	FLOAT lutCos[360 * 10];
+	FLOAT lutSinFixed[FIXED_SIN_TABLE_SIZE + 1];
 
 	const DOUBLE SQRT_2 = 1.4142135623730950488;
 	const DOUBLE SQRT_3 = 1.7320508075688772935;
@@ -28,6 +84,60 @@ namespace Geometry
 			lutSin[i] = sinf(r);
 			lutCos[i] = cosf(r);
 		}
+
+		for(INT i = 0; i < ARRAYSIZE(lutSinFixed); i++)
+			lutSinFixed[i] = static_cast<FLOAT>(sin(static_cast<DOUBLE>(i) * (6.283185307179586 / FIXED_SIN_TABLE_SIZE)));
+	}
+
+	VOID WINAPI FastSinCos (FLOAT rRadians, __out FLOAT* prSin, __out FLOAT* prCos)
+	{
+#ifdef	CORE_SSE2
+		// The vector kernel on one lane is branchless, which matters because the
+		// quadrant of each angle is usually unpredictable.
+		__m128 mmSin, mmCos;
+
+		SinCos4(_mm_set_ss(rRadians), &mmSin, &mmCos);
+		_mm_store_ss(prSin, mmSin);
+		_mm_store_ss(prCos, mmCos);
+#else
+		// Reduce to rRadians = nQuadrant * pi / 2 + r, with |r| <= pi / 4.
+		FLOAT rQuadrant = rRadians * SINCOS_2_OVER_PI;
+		INT nQuadrant = static_cast<INT>(rQuadrant + (0 > rQuadrant ? -0.5f : 0.5f));
+		FLOAT q = static_cast<FLOAT>(nQuadrant);
+		FLOAT r = ((rRadians - q * SINCOS_PI_OVER_2_A) - q * SINCOS_PI_OVER_2_B) - q * SINCOS_PI_OVER_2_C;
+		FLOAT z = r * r;
+		FLOAT rSin = ((SINCOS_SIN_0 * z + SINCOS_SIN_1) * z - SINCOS_SIN_2) * z * r + r;
+		FLOAT rCos = ((SINCOS_COS_0 * z - SINCOS_COS_1) * z + SINCOS_COS_2) * z * z - 0.5f * z + 1.0f;
+
+		// Odd quadrants swap sin and cos, then the signs follow the quadrant.
+		if(nQuadrant & 1)
+		{
+			FLOAT rSwap = rSin;
+			rSin = rCos;
+			rCos = rSwap;
+		}
+		*prSin = (nQuadrant & 2) ? -rSin : rSin;
+		*prCos = ((nQuadrant + 1) & 2) ? -rCos : rCos;
+#endif
+	}
+
+	VOID WINAPI FastSinCosArray (const FLOAT* prgRadians, SIZE_T cAngles, __out_ecount(cAngles) FLOAT* prgSin, __out_ecount(cAngles) FLOAT* prgCos)
+	{
+		SIZE_T i = 0;
+
+#ifdef	CORE_SSE2
+		for(; i + 4 <= cAngles; i += 4)
+		{
+			__m128 mmSin, mmCos;
+
+			SinCos4(_mm_loadu_ps(prgRadians + i), &mmSin, &mmCos);
+			_mm_storeu_ps(prgSin + i, mmSin);
+			_mm_storeu_ps(prgCos + i, mmCos);
+		}
+#endif
+
+		for(; i < cAngles; i++)
+			FastSinCos(prgRadians[i], prgSin + i, prgCos + i);
 	}
 
 	VOID WINAPI LutRotatePoint (PFPOINT lpPoint, FLOAT fDegrees)
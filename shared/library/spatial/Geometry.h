@@ -1,8 +1,20 @@
 #ifndef	_H_GEOMETRY
 #define	_H_GEOMETRY
 
+#include <math.h>
 #include "GeometryTypes.h"
 
+// Binary angles, where a full turn is 65536 so angles wrap around for free with
+// unsigned arithmetic.  One unit is about 0.0055 degrees.
+typedef WORD FIXED_ANGLE;
+
+#define	FIXED_ANGLE_QUARTER_TURN	0x4000
+#define	FIXED_ANGLE_HALF_TURN		0x8000
+
+// Entries in lutSinFixed, which has one extra entry so interpolation never wraps
+#define	FIXED_SIN_TABLE_BITS		10
+#define	FIXED_SIN_TABLE_SIZE		(1 << FIXED_SIN_TABLE_BITS)
+
 namespace Geometry
 {
 	extern DOUBLE dPI;
@@ -19,6 +31,7 @@ namespace Geometry
 
 	extern FLOAT lutSin[360 * 10];
 	extern FLOAT lutCos[360 * 10];
+	extern FLOAT lutSinFixed[FIXED_SIN_TABLE_SIZE + 1];
 
 	template <typename T>
 	inline T TRadiansConversion (VOID)
@@ -59,16 +72,85 @@ namespace Geometry
 
 	inline FLOAT LutSin (DOUBLE rDegrees)
 	{
-		INT nDegreesIndex = (INT)(rDegrees * 10.0) % ARRAYSIZE(lutSin);
-		return 0 <= nDegreesIndex ? lutSin[nDegreesIndex] : lutSin[nDegreesIndex + ARRAYSIZE(lutSin)];
+		INT nDegreesIndex = (INT)(rDegrees * 10.0) % (INT)ARRAYSIZE(lutSin);
+		return 0 <= nDegreesIndex ? lutSin[nDegreesIndex] : lutSin[nDegreesIndex + (INT)ARRAYSIZE(lutSin)];
 	}
 
 	inline FLOAT LutCos (DOUBLE rDegrees)
 	{
-		INT nDegreesIndex = (INT)(rDegrees * 10.0) % ARRAYSIZE(lutCos);
-		return 0 <= nDegreesIndex ? lutCos[nDegreesIndex] : lutCos[nDegreesIndex + ARRAYSIZE(lutCos)];
+		INT nDegreesIndex = (INT)(rDegrees * 10.0) % (INT)ARRAYSIZE(lutCos);
+		return 0 <= nDegreesIndex ? lutCos[nDegreesIndex] : lutCos[nDegreesIndex + (INT)ARRAYSIZE(lutCos)];
+	}
+
+	// Converting a float outside the range of an INT is undefined, so whole turns are
+	// removed first.  Infinities and NaN give zero.
+	inline FIXED_ANGLE FixedAngleFromUnits (FLOAT rUnits)
+	{
+		rUnits = fmodf(rUnits, 65536.0f);
+		return fabsf(rUnits) < 65536.0f ? static_cast<FIXED_ANGLE>(static_cast<INT>(rUnits)) : 0;
+	}
+
+	inline FIXED_ANGLE FixedAngleFromDegrees (FLOAT rDegrees)
+	{
+		return FixedAngleFromUnits(rDegrees * (65536.0f / 360.0f));
 	}
 
+	inline FIXED_ANGLE FixedAngleFromRadians (FLOAT rRadians)
+	{
+		return FixedAngleFromUnits(rRadians * (65536.0f / 6.28318530718f));
+	}
+
+	inline FLOAT FixedAngleToDegrees (FIXED_ANGLE nAngle)
+	{
+		return static_cast<FLOAT>(nAngle) * (360.0f / 65536.0f);
+	}
+
+	inline FLOAT FixedAngleToRadians (FIXED_ANGLE nAngle)
+	{
+		return static_cast<FLOAT>(nAngle) * (6.28318530718f / 65536.0f);
+	}
+
+	// Linear interpolation between the FIXED_SIN_TABLE_SIZE entries of lutSinFixed.
+	// The error is below 5e-6, on top of the angle's own rounding to a FIXED_ANGLE.
+	inline FLOAT FixedSin (FIXED_ANGLE nAngle)
+	{
+		INT nIndex = nAngle >> (16 - FIXED_SIN_TABLE_BITS);
+		FLOAT rFraction = static_cast<FLOAT>(nAngle & ((1 << (16 - FIXED_SIN_TABLE_BITS)) - 1)) * (1.0f / (1 << (16 - FIXED_SIN_TABLE_BITS)));
+		return lutSinFixed[nIndex] + (lutSinFixed[nIndex + 1] - lutSinFixed[nIndex]) * rFraction;
+	}
+
+	inline FLOAT FixedCos (FIXED_ANGLE nAngle)
+	{
+		return FixedSin(static_cast<FIXED_ANGLE>(nAngle + FIXED_ANGLE_QUARTER_TURN));
+	}
+
+	// Interpolated versions of LutSin() and LutCos() that read lutSinFixed with the
+	// full precision of rDegrees, for an error below 5e-6.
+	inline FLOAT LutSinInterpolated (FLOAT rDegrees)
+	{
+		FLOAT rPosition = rDegrees * (FIXED_SIN_TABLE_SIZE / 360.0f);
+		INT nFloor = static_cast<INT>(rPosition);
+		if(static_cast<FLOAT>(nFloor) > rPosition)
+			nFloor--;
+
+		INT nIndex = nFloor & (FIXED_SIN_TABLE_SIZE - 1);
+		return lutSinFixed[nIndex] + (lutSinFixed[nIndex + 1] - lutSinFixed[nIndex]) * (rPosition - static_cast<FLOAT>(nFloor));
+	}
+
+	inline FLOAT LutCosInterpolated (FLOAT rDegrees)
+	{
+		return LutSinInterpolated(rDegrees + 90.0f);
+	}
+
+	// Minimax polynomials after reducing the angle to within 45 degrees of an axis.
+	// The absolute error is at most 2.5e-7 for |rRadians| up to 8192, compared with
+	// sinf() and cosf(), and no tables are used.
+	VOID WINAPI FastSinCos (FLOAT rRadians, __out FLOAT* prSin, __out FLOAT* prCos);
+
+	// FastSinCos() for an array of angles, four at a time with SSE2 when available.
+	// The results match FastSinCos() for every angle.
+	VOID WINAPI FastSinCosArray (const FLOAT* prgRadians, SIZE_T cAngles, __out_ecount(cAngles) FLOAT* prgSin, __out_ecount(cAngles) FLOAT* prgCos);
+
 	VOID WINAPI InitializeTables (VOID);
 	VOID WINAPI LutRotatePoint (PFPOINT lpPoint, FLOAT fDegrees);
 	VOID WINAPI LutRotatePointAround (PFPOINT lpPoint, PFPOINT lpCenter, FLOAT fDegrees);
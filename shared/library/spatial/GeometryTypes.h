@@ -57,6 +57,12 @@ typedef struct
 	FLOAT bottom;
 } FRECT, *PFRECT;
 
+typedef struct
+{
+	FLOAT xMin, yMin, zMin;
+	FLOAT xMax, yMax, zMax;
+} FBOX, *PFBOX;
+
 typedef struct
 {
 	FLOAT red;
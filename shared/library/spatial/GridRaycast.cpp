@@ -0,0 +1,281 @@
+#include <windows.h>
+#include <math.h>
+#include <float.h>
+#include "..\Core\CoreDefs.h"
+#include "GridRaycast.h"
+
+// Stops a ray at the first opaque cell.
+class COpacityRay : public IGridRaycastCallback
+{
+private:
+	IGridOpacity* m_pGrid;
+
+public:
+	COpacityRay (IGridOpacity* pGrid) : m_pGrid(pGrid) {}
+
+	virtual BOOL VisitCell (INT x, INT y, FLOAT tEnter)
+	{
+		return m_pGrid->IsOpaque(x, y);
+	}
+};
+
+struct FOV_SCAN
+{
+	IGridOpacity* pGrid;
+	INT x, y;
+	INT nRadius;
+	PBYTE pbVisible;
+};
+
+// Maps an octant's (column, row) into grid offsets, one column per octant.
+static const INT c_rgxx[8] = { 1, 0, 0, -1, -1, 0, 0, 1 };
+static const INT c_rgxy[8] = { 0, 1, -1, 0, 0, -1, 1, 0 };
+static const INT c_rgyx[8] = { 0, 1, 1, 0, 0, -1, -1, 0 };
+static const INT c_rgyy[8] = { 1, 0, 0, 1, -1, 0, 0, -1 };
+
+static inline VOID MarkVisible (const FOV_SCAN& scan, INT xOffset, INT yOffset)
+{
+	SIZE_T n = static_cast<SIZE_T>(yOffset + scan.nRadius) * (scan.nRadius * 2 + 1) + (xOffset + scan.nRadius);
+	scan.pbVisible[n >> 3] |= static_cast<BYTE>(1 << (n & 7));
+}
+
+// Scans one octant row by row, between two slopes measured from the viewer.  Each
+// run of opaque cells narrows the light for the rows behind it, and the part of the
+// row before the run is scanned further by recursion.
+static VOID CastLight (const FOV_SCAN& scan, INT nRow, FLOAT rStart, FLOAT rEnd, INT nOctant)
+{
+	INT nRadiusSquared = scan.nRadius * scan.nRadius;
+	FLOAT rNextStart = rStart;
+
+	if(rStart < rEnd)
+		return;
+
+	for(INT j = nRow; j <= scan.nRadius; j++)
+	{
+		INT dy = -j;
+		BOOL fBlocked = FALSE;
+
+		for(INT dx = -j; dx <= 0; dx++)
+		{
+			FLOAT rLeft = (dx - 0.5f) / (dy + 0.5f);
+			FLOAT rRight = (dx + 0.5f) / (dy - 0.5f);
+			INT xOffset, yOffset;
+			BOOL fOpaque;
+
+			if(rStart < rRight)
+				continue;
+			if(rEnd > rLeft)
+				break;
+
+			xOffset = dx * c_rgxx[nOctant] + dy * c_rgxy[nOctant];
+			yOffset = dx * c_rgyx[nOctant] + dy * c_rgyy[nOctant];
+			if(dx * dx + dy * dy <= nRadiusSquared)
+				MarkVisible(scan, xOffset, yOffset);
+
+			fOpaque = scan.pGrid->IsOpaque(scan.x + xOffset, scan.y + yOffset);
+			if(fBlocked)
+			{
+				if(fOpaque)
+					rNextStart = rRight;
+				else
+				{
+					fBlocked = FALSE;
+					rStart = rNextStart;
+				}
+			}
+			else if(fOpaque && j < scan.nRadius)
+			{
+				fBlocked = TRUE;
+				CastLight(scan, j + 1, rStart, rLeft, nOctant);
+				rNextStart = rRight;
+			}
+		}
+
+		if(fBlocked)
+			break;
+	}
+}
+
+namespace GridRaycast
+{
+	HRESULT WINAPI Cast (FLOAT x, FLOAT y, FLOAT dx, FLOAT dy, FLOAT tMax, IGridRaycastCallback* pCallback,
+		__out_opt POINT* pptCell, __out_opt FLOAT* ptHit)
+	{
+		HRESULT hr;
+		INT xCell = static_cast<INT>(floorf(x)), yCell = static_cast<INT>(floorf(y));
+		INT xStep = 0, yStep = 0;
+		FLOAT tNextX = FLT_MAX, tNextY = FLT_MAX;
+		FLOAT tDeltaX = 0, tDeltaY = 0;
+		FLOAT t = 0;
+
+		CheckIf(NULL == pCallback || 0 > tMax, E_INVALIDARG);
+
+		// tNext is where the ray crosses the next cell boundary along each axis, and
+		// tDelta is how far apart those boundaries are.
+		if(0 < dx)
+		{
+			xStep = 1;
+			tDeltaX = 1.0f / dx;
+			tNextX = (static_cast<FLOAT>(xCell) + 1.0f - x) * tDeltaX;
+		}
+		else if(0 > dx)
+		{
+			xStep = -1;
+			tDeltaX = -1.0f / dx;
+			tNextX = (x - static_cast<FLOAT>(xCell)) * tDeltaX;
+		}
+
+		if(0 < dy)
+		{
+			yStep = 1;
+			tDeltaY = 1.0f / dy;
+			tNextY = (static_cast<FLOAT>(yCell) + 1.0f - y) * tDeltaY;
+		}
+		else if(0 > dy)
+		{
+			yStep = -1;
+			tDeltaY = -1.0f / dy;
+			tNextY = (y - static_cast<FLOAT>(yCell)) * tDeltaY;
+		}
+
+		for(;;)
+		{
+			if(pCallback->VisitCell(xCell, yCell, t))
+			{
+				hr = S_OK;
+				break;
+			}
+
+			// Ties step along x first, which is what visits the cell beside a corner.
+			if(tNextX <= tNextY)
+			{
+				if(0 == xStep || tNextX > tMax)
+				{
+					t = tMax;
+					hr = S_FALSE;
+					break;
+				}
+				t = tNextX;
+				xCell += xStep;
+				tNextX += tDeltaX;
+			}
+			else
+			{
+				if(tNextY > tMax)
+				{
+					t = tMax;
+					hr = S_FALSE;
+					break;
+				}
+				t = tNextY;
+				yCell += yStep;
+				tNextY += tDeltaY;
+			}
+		}
+
+		if(pptCell)
+		{
+			pptCell->x = xCell;
+			pptCell->y = yCell;
+		}
+		if(ptHit)
+			*ptHit = t;
+
+	Cleanup:
+		return hr;
+	}
+
+	HRESULT WINAPI CastBatch (const GRID_RAY* prgRays, SIZE_T cRays, IGridOpacity* pGrid, __out_ecount(cRays) GRID_RAY_HIT* prgHits)
+	{
+		HRESULT hr = S_OK;
+		COpacityRay ray(pGrid);
+
+		CheckIf(NULL == pGrid || (NULL == prgRays && 0 < cRays), E_INVALIDARG);
+
+		for(SIZE_T i = 0; i < cRays; i++)
+		{
+			const GRID_RAY& gr = prgRays[i];
+			GRID_RAY_HIT& hit = prgHits[i];
+			POINT ptCell;
+
+			Check(Cast(gr.x, gr.y, gr.dx, gr.dy, gr.tMax, &ray, &ptCell, &hit.t));
+			hit.x = ptCell.x;
+			hit.y = ptCell.y;
+			hit.fHit = (S_OK == hr);
+		}
+
+		hr = S_OK;
+
+	Cleanup:
+		return hr;
+	}
+
+	BOOL WINAPI HasLineOfSight (INT xFrom, INT yFrom, INT xTo, INT yTo, IGridOpacity* pGrid)
+	{
+		LONGLONG dx = xTo > xFrom ? static_cast<LONGLONG>(xTo) - xFrom : static_cast<LONGLONG>(xFrom) - xTo;
+		LONGLONG dy = yTo > yFrom ? static_cast<LONGLONG>(yTo) - yFrom : static_cast<LONGLONG>(yFrom) - yTo;
+		INT xStep = xTo > xFrom ? 1 : -1, yStep = yTo > yFrom ? 1 : -1;
+		LONGLONG cStepsX = 0, cStepsY = 0;
+		INT x = xFrom, y = yFrom;
+
+		// Measured in half cells from the starting center, the segment's next x boundary
+		// is at (2 * cStepsX + 1) / (2 * dx) of its length and its next y boundary is at
+		// (2 * cStepsY + 1) / (2 * dy), so crossing them multiplied out needs no division.
+		while(cStepsX < dx || cStepsY < dy)
+		{
+			LONGLONG nCrossX = (2 * cStepsX + 1) * dy;
+			LONGLONG nCrossY = (2 * cStepsY + 1) * dx;
+
+			if(nCrossX == nCrossY)
+			{
+				if(pGrid->IsOpaque(x + xStep, y) && pGrid->IsOpaque(x, y + yStep))
+					return FALSE;
+				x += xStep;
+				y += yStep;
+				cStepsX++;
+				cStepsY++;
+			}
+			else if(nCrossX < nCrossY)
+			{
+				x += xStep;
+				cStepsX++;
+			}
+			else
+			{
+				y += yStep;
+				cStepsY++;
+			}
+
+			if(x == xTo && y == yTo)
+				break;
+			if(pGrid->IsOpaque(x, y))
+				return FALSE;
+		}
+
+		return TRUE;
+	}
+
+	HRESULT WINAPI ComputeFieldOfView (INT x, INT y, INT nRadius, IGridOpacity* pGrid, __out_bcount(cbVisible) PBYTE pbVisible, SIZE_T cbVisible)
+	{
+		HRESULT hr = S_OK;
+		FOV_SCAN scan;
+
+		CheckIf(NULL == pGrid || NULL == pbVisible || 0 > nRadius, E_INVALIDARG);
+		CheckIf(cbVisible < GetFieldOfViewSize(nRadius), E_INVALIDARG);
+
+		ZeroMemory(pbVisible, GetFieldOfViewSize(nRadius));
+
+		scan.pGrid = pGrid;
+		scan.x = x;
+		scan.y = y;
+		scan.nRadius = nRadius;
+		scan.pbVisible = pbVisible;
+
+		MarkVisible(scan, 0, 0);
+		for(INT nOctant = 0; nOctant < ARRAYSIZE(c_rgxx); nOctant++)
+			CastLight(scan, 1, 1.0f, 0.0f, nOctant);
+
+	Cleanup:
+		return hr;
+	}
+}
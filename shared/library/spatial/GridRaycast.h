@@ -0,0 +1,73 @@
+#pragma once
+
+// Ray walking, line of sight and field of view over a grid of unit cells, where cell
+// (x, y) covers [x, x + 1) by [y, y + 1) and cell centers sit at (x + 0.5, y + 0.5).
+// Nothing here allocates, so these can run any number of times per frame.
+
+interface IGridOpacity
+{
+	virtual BOOL IsOpaque (INT x, INT y) = 0;
+};
+
+interface IGridRaycastCallback
+{
+	// Called for every cell the ray enters, starting with the cell that holds its
+	// origin, where tEnter is zero.  Return TRUE to stop the ray in this cell.
+	virtual BOOL VisitCell (INT x, INT y, FLOAT tEnter) = 0;
+};
+
+struct GRID_RAY
+{
+	FLOAT x, y;				// Origin
+	FLOAT dx, dy;			// Direction, which doesn't need to be normalized
+	FLOAT tMax;				// The ray ends at (x + dx * tMax, y + dy * tMax)
+};
+
+struct GRID_RAY_HIT
+{
+	INT x, y;				// The opaque cell, or the last cell walked on a miss
+	FLOAT t;				// Where the ray entered the opaque cell, or tMax on a miss
+	BOOL fHit;
+};
+
+namespace GridRaycast
+{
+	// Walks the cells along a ray in order (Amanatides and Woo).  When the ray crosses
+	// exactly through a corner, the cell beside it along x is visited before the cell
+	// across it, so a ray never slips between two diagonal cells unseen.  Returns S_OK
+	// with the stopping cell and its tEnter if the callback stopped the ray, or S_FALSE
+	// with the last cell walked and tMax if the ray ran out.
+	HRESULT WINAPI Cast (FLOAT x, FLOAT y, FLOAT dx, FLOAT dy, FLOAT tMax, IGridRaycastCallback* pCallback,
+		__out_opt POINT* pptCell, __out_opt FLOAT* ptHit);
+
+	// Casts each ray until it enters an opaque cell.  The origin's own cell counts.
+	HRESULT WINAPI CastBatch (const GRID_RAY* prgRays, SIZE_T cRays, IGridOpacity* pGrid, __out_ecount(cRays) GRID_RAY_HIT* prgHits);
+
+	// Tests the segment between the two cell centers with exact integer stepping, so the
+	// answer is the same in both directions.  Neither end cell is tested, and a segment
+	// that passes exactly through a corner is only blocked if both cells beside the
+	// corner are opaque.
+	BOOL WINAPI HasLineOfSight (INT xFrom, INT yFrom, INT xTo, INT yTo, IGridOpacity* pGrid);
+
+	// Marks the cells visible from (x, y) within nRadius by recursive shadowcasting.
+	// Opaque cells are visible but hide what's behind them.  The bitset covers the square
+	// of side 2 * nRadius + 1 centered on (x, y), one bit per cell in row order; see
+	// GetFieldOfViewSize() and IsInFieldOfView().
+	HRESULT WINAPI ComputeFieldOfView (INT x, INT y, INT nRadius, IGridOpacity* pGrid, __out_bcount(cbVisible) PBYTE pbVisible, SIZE_T cbVisible);
+
+	inline SIZE_T GetFieldOfViewSize (INT nRadius)
+	{
+		SIZE_T nSide = static_cast<SIZE_T>(nRadius) * 2 + 1;
+		return (nSide * nSide + 7) / 8;
+	}
+
+	// xOffset and yOffset are relative to the viewer.
+	inline BOOL IsInFieldOfView (const BYTE* pbVisible, INT nRadius, INT xOffset, INT yOffset)
+	{
+		if(xOffset < -nRadius || xOffset > nRadius || yOffset < -nRadius || yOffset > nRadius)
+			return FALSE;
+
+		SIZE_T n = static_cast<SIZE_T>(yOffset + nRadius) * (nRadius * 2 + 1) + (xOffset + nRadius);
+		return 0 != (pbVisible[n >> 3] & (1 << (n & 7)));
+	}
+}
@@ -0,0 +1,675 @@
+#include <windows.h>
+#include "..\Core\CoreDefs.h"
+#include "HierarchicalPathfinder.h"
+
+#define	NODE_CLOSED		HEAP_INDEX_NONE
+#define	NO_PARENT		((ULONG)-1)
+
+BOOL CHierarchicalPathfinder::CClusterCallback::GetPathValue (INT x, INT y, INT xFrom, INT yFrom, __out INT* pnValue)
+{
+	if(x < m_xMin || y < m_yMin || x > m_xMax || y > m_yMax)
+		return FALSE;
+	return m_pCallback->GetPathValue(x, y, xFrom, yFrom, pnValue);
+}
+
+CHierarchicalPathfinder::CHierarchicalPathfinder () :
+	m_pCallback(NULL),
+	m_x(0),
+	m_y(0),
+	m_xSize(0),
+	m_ySize(0),
+	m_nClusterSize(0),
+	m_xClusters(0),
+	m_yClusters(0),
+	m_prgClusters(NULL),
+	m_fDirty(FALSE),
+	m_cEntrances(0),
+	m_prgOwners(NULL),
+	m_prgNodes(NULL),
+	m_cAllocated(0),
+	m_nGeneration(0)
+{
+	m_cluster.m_pCallback = NULL;
+
+	// The entrance costs feed the abstract search, so they must be the cheapest paths.
+	m_astar.SetHeuristic(ASTAR_HEURISTIC_OCTILE);
+}
+
+CHierarchicalPathfinder::~CHierarchicalPathfinder ()
+{
+	Clear();
+}
+
+HRESULT CHierarchicalPathfinder::Initialize (INT x, INT y, INT xSize, INT ySize, INT nClusterSize, IAStarCallback2D* pCallback)
+{
+	HRESULT hr;
+
+	CheckIf(NULL == pCallback || 0 >= xSize || 0 >= ySize, E_INVALIDARG);
+	CheckIf(2 > nClusterSize || nClusterSize > 0x3FFF, E_INVALIDARG);
+
+	Clear();
+
+	m_pCallback = pCallback;
+	m_cluster.m_pCallback = pCallback;
+	m_x = x;
+	m_y = y;
+	m_xSize = xSize;
+	m_ySize = ySize;
+	m_nClusterSize = nClusterSize;
+	m_xClusters = (xSize + nClusterSize - 1) / nClusterSize;
+	m_yClusters = (ySize + nClusterSize - 1) / nClusterSize;
+
+	m_prgClusters = __new CLUSTER[m_xClusters * m_yClusters];
+	CheckAlloc(m_prgClusters);
+
+	for(INT yCluster = 0; yCluster < m_yClusters; yCluster++)
+	{
+		for(INT xCluster = 0; xCluster < m_xClusters; xCluster++)
+		{
+			CLUSTER* pCluster = m_prgClusters + yCluster * m_xClusters + xCluster;
+
+			pCluster->x = x + xCluster * nClusterSize;
+			pCluster->y = y + yCluster * nClusterSize;
+			pCluster->xSize = min(nClusterSize, x + xSize - pCluster->x);
+			pCluster->ySize = min(nClusterSize, y + ySize - pCluster->y);
+			pCluster->fDirty = TRUE;
+			pCluster->nFirstNode = 0;
+		}
+	}
+
+	m_fDirty = TRUE;
+	Check(Update());
+
+Cleanup:
+	if(FAILED(hr))
+		Clear();
+	return hr;
+}
+
+VOID CHierarchicalPathfinder::Invalidate (INT x, INT y, INT xSize, INT ySize)
+{
+	if(NULL == m_prgClusters || 0 >= xSize || 0 >= ySize)
+		return;
+
+	// A changed cell on a cluster's edge can move the entrances shared with the
+	// neighbour across that edge, and a changed corner cell can also move the entrance
+	// shared with the diagonal neighbour.
+	MarkClusters(x - 1, y - 1, x + xSize, y + ySize);
+}
+
+HRESULT CHierarchicalPathfinder::Update (VOID)
+{
+	HRESULT hr = S_FALSE;
+
+	if(m_fDirty)
+	{
+		INT cClusters = m_xClusters * m_yClusters;
+
+		for(INT i = 0; i < cClusters; i++)
+		{
+			CLUSTER* pCluster = m_prgClusters + i;
+
+			if(pCluster->fDirty)
+			{
+				Check(RebuildCluster(pCluster));
+				pCluster->fDirty = FALSE;
+			}
+		}
+
+		Check(RenumberNodes());
+		m_fDirty = FALSE;
+		hr = S_OK;
+	}
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CHierarchicalPathfinder::FindPath (INT xFrom, INT yFrom, INT xDest, INT yDest)
+{
+	HRESULT hr;
+	CLUSTER* pStart;
+	CLUSTER* pDest;
+	INT nDirect = HPA_NO_PATH;
+
+	CheckIf(NULL == m_prgClusters, E_UNEXPECTED);
+	CheckIf(!IsInside(xFrom, yFrom) || !IsInside(xDest, yDest), E_INVALIDARG);
+
+	m_aWaypoints.Clear();
+	Check(Update());
+
+	pStart = GetCluster(xFrom, yFrom);
+	pDest = GetCluster(xDest, yDest);
+
+	// Connect the start and the destination to the entrances of their clusters.
+	m_aStartCosts.Clear();
+	Check(m_aStartCosts.Resize(pStart->aEntrances.Length()));
+	for(sysint i = 0; i < pStart->aEntrances.Length(); i++)
+	{
+		const ENTRANCE& entrance = pStart->aEntrances[i];
+		Check(FindClusterPath(pStart, pStart, xFrom, yFrom, entrance.x, entrance.y, &m_aStartCosts[i]));
+	}
+
+	m_aDestCosts.Clear();
+	Check(m_aDestCosts.Resize(pDest->aEntrances.Length()));
+	for(sysint i = 0; i < pDest->aEntrances.Length(); i++)
+	{
+		const ENTRANCE& entrance = pDest->aEntrances[i];
+		Check(FindClusterPath(pDest, pDest, entrance.x, entrance.y, xDest, yDest, &m_aDestCosts[i]));
+	}
+
+	// Between the same or neighbouring clusters, a direct path competes with the
+	// abstract graph, which avoids long detours through entrances on short trips.
+	if(abs(pStart->x - pDest->x) <= m_nClusterSize && abs(pStart->y - pDest->y) <= m_nClusterSize)
+		Check(FindClusterPath(pStart, pDest, xFrom, yFrom, xDest, yDest, &nDirect));
+
+	Check(SearchAbstract(xFrom, yFrom, xDest, yDest, nDirect));
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CHierarchicalPathfinder::RefineSegment (sysint nSegment, TArray<POINT>* paPath)
+{
+	HRESULT hr;
+	POINT ptFrom, ptTo;
+	CLUSTER* pFrom;
+	CLUSTER* pTo;
+
+	CheckIf(0 > nSegment || nSegment + 1 >= m_aWaypoints.Length(), E_INVALIDARG);
+
+	ptFrom = m_aWaypoints[nSegment];
+	ptTo = m_aWaypoints[nSegment + 1];
+
+	pFrom = GetCluster(ptFrom.x, ptFrom.y);
+	pTo = GetCluster(ptTo.x, ptTo.y);
+
+	if(pFrom != pTo && IsLinked(ptFrom.x, ptFrom.y, ptTo.x, ptTo.y))
+	{
+		// Steps between entrances of neighbouring clusters
+		Check(paPath->Append(&ptTo));
+		Check(paPath->Append(&ptFrom));
+	}
+	else
+	{
+		INT nCost;
+
+		// The cells may have changed since the abstract search.
+		Check(FindClusterPath(pFrom, pTo, ptFrom.x, ptFrom.y, ptTo.x, ptTo.y, &nCost));
+		CheckIf(HPA_NO_PATH == nCost, HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+		Check(m_astar.GetPath(ptTo.x, ptTo.y, paPath));
+	}
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CHierarchicalPathfinder::GetPath (TArray<POINT>* paPath)
+{
+	HRESULT hr;
+	TArray<POINT> aSegment;
+
+	CheckIf(2 > m_aWaypoints.Length(), HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+
+	for(sysint nSegment = m_aWaypoints.Length() - 2; nSegment >= 0; nSegment--)
+	{
+		aSegment.Clear();
+		Check(RefineSegment(nSegment, &aSegment));
+
+		// Each segment ends where the one appended before it started.
+		for(sysint i = (nSegment == m_aWaypoints.Length() - 2) ? 0 : 1; i < aSegment.Length(); i++)
+			Check(paPath->Append(aSegment[i]));
+	}
+
+Cleanup:
+	return hr;
+}
+
+VOID CHierarchicalPathfinder::Clear (VOID)
+{
+	SafeDeleteArray(m_prgClusters);
+	SafeDeleteArray(m_prgOwners);
+	SafeDeleteArray(m_prgNodes);
+	m_heap.Free();
+	m_cAllocated = 0;
+	m_cEntrances = 0;
+	m_xClusters = 0;
+	m_yClusters = 0;
+	m_fDirty = FALSE;
+	m_aWaypoints.Clear();
+}
+
+HRESULT CHierarchicalPathfinder::RebuildCluster (CLUSTER* pCluster)
+{
+	HRESULT hr;
+	INT xMax = pCluster->x + pCluster->xSize - 1;
+	INT yMax = pCluster->y + pCluster->ySize - 1;
+	sysint cEntrances;
+
+	pCluster->aEntrances.Clear();
+	pCluster->aCosts.Clear();
+
+	if(xMax + 1 < m_x + m_xSize)
+		Check(AddBorder(pCluster, xMax, pCluster->y, xMax + 1, pCluster->y, 0, 1, pCluster->ySize));
+	if(pCluster->x > m_x)
+		Check(AddBorder(pCluster, pCluster->x, pCluster->y, pCluster->x - 1, pCluster->y, 0, 1, pCluster->ySize));
+	if(yMax + 1 < m_y + m_ySize)
+		Check(AddBorder(pCluster, pCluster->x, yMax, pCluster->x, yMax + 1, 1, 0, pCluster->xSize));
+	if(pCluster->y > m_y)
+		Check(AddBorder(pCluster, pCluster->x, pCluster->y, pCluster->x, pCluster->y - 1, 1, 0, pCluster->xSize));
+
+	// Corners that can only be cut diagonally
+	if(xMax + 1 < m_x + m_xSize && yMax + 1 < m_y + m_ySize && IsDiagonalOnly(xMax, yMax, xMax + 1, yMax + 1))
+		Check(AddEntrance(pCluster, xMax, yMax, xMax + 1, yMax + 1));
+	if(pCluster->x > m_x && yMax + 1 < m_y + m_ySize && IsDiagonalOnly(pCluster->x, yMax, pCluster->x - 1, yMax + 1))
+		Check(AddEntrance(pCluster, pCluster->x, yMax, pCluster->x - 1, yMax + 1));
+	if(xMax + 1 < m_x + m_xSize && pCluster->y > m_y && IsDiagonalOnly(xMax, pCluster->y, xMax + 1, pCluster->y - 1))
+		Check(AddEntrance(pCluster, xMax, pCluster->y, xMax + 1, pCluster->y - 1));
+	if(pCluster->x > m_x && pCluster->y > m_y && IsDiagonalOnly(pCluster->x, pCluster->y, pCluster->x - 1, pCluster->y - 1))
+		Check(AddEntrance(pCluster, pCluster->x, pCluster->y, pCluster->x - 1, pCluster->y - 1));
+
+	cEntrances = pCluster->aEntrances.Length();
+	Check(pCluster->aCosts.Resize(cEntrances * cEntrances));
+
+	for(sysint i = 0; i < cEntrances; i++)
+	{
+		const ENTRANCE& from = pCluster->aEntrances[i];
+
+		for(sysint j = 0; j < cEntrances; j++)
+		{
+			const ENTRANCE& to = pCluster->aEntrances[j];
+
+			if(i == j)
+				pCluster->aCosts[i * cEntrances + j] = 0;
+			else
+				Check(FindClusterPath(pCluster, pCluster, from.x, from.y, to.x, to.y, &pCluster->aCosts[i * cEntrances + j]));
+		}
+	}
+
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
+
+// Scans one border, where (dx, dy) steps along the border.  Both clusters sharing the
+// border scan it in the same order, so they choose the same entrances.
+HRESULT CHierarchicalPathfinder::AddBorder (CLUSTER* pCluster, INT xInside, INT yInside, INT xOutside, INT yOutside, INT dx, INT dy, INT cCells)
+{
+	HRESULT hr = S_OK;
+	INT nRun = -1;
+
+	for(INT n = 0; n <= cCells; n++)
+	{
+		BOOL fOpen = n < cCells && IsCrossable(xInside + dx * n, yInside + dy * n, xOutside + dx * n, yOutside + dy * n);
+
+		if(fOpen)
+		{
+			if(0 > nRun)
+				nRun = n;
+		}
+		else if(0 <= nRun)
+		{
+			INT cRun = n - nRun;
+
+			if(cRun < HPA_WIDE_ENTRANCE)
+			{
+				INT nMiddle = nRun + cRun / 2;
+				Check(AddEntrance(pCluster, xInside + dx * nMiddle, yInside + dy * nMiddle, xOutside + dx * nMiddle, yOutside + dy * nMiddle));
+			}
+			else
+			{
+				Check(AddEntrance(pCluster, xInside + dx * nRun, yInside + dy * nRun, xOutside + dx * nRun, yOutside + dy * nRun));
+				Check(AddEntrance(pCluster, xInside + dx * (n - 1), yInside + dy * (n - 1), xOutside + dx * (n - 1), yOutside + dy * (n - 1)));
+			}
+
+			nRun = -1;
+		}
+	}
+
+	// Diagonal steps across the border only need entrances when neither straight
+	// route around them is open.
+	for(INT n = 0; n + 1 < cCells; n++)
+	{
+		INT xA = xInside + dx * n, yA = yInside + dy * n;
+		INT xB = xOutside + dx * (n + 1), yB = yOutside + dy * (n + 1);
+
+		if(IsDiagonalOnly(xA, yA, xB, yB))
+			Check(AddEntrance(pCluster, xA, yA, xB, yB));
+
+		xA += dx; yA += dy;
+		xB -= dx; yB -= dy;
+
+		if(IsDiagonalOnly(xA, yA, xB, yB))
+			Check(AddEntrance(pCluster, xA, yA, xB, yB));
+	}
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CHierarchicalPathfinder::AddEntrance (CLUSTER* pCluster, INT xInside, INT yInside, INT xOutside, INT yOutside)
+{
+	HRESULT hr;
+	ENTRANCE* pEntrance = NULL;
+	INT nValue;
+
+	// A corner cell can be an entrance on two borders.
+	for(sysint i = 0; i < pCluster->aEntrances.Length(); i++)
+	{
+		ENTRANCE* pCheck = pCluster->aEntrances.GetItemPtr(i);
+		if(pCheck->x == xInside && pCheck->y == yInside)
+		{
+			pEntrance = pCheck;
+			break;
+		}
+	}
+
+	if(NULL == pEntrance)
+	{
+		Check(pCluster->aEntrances.AppendSlot(&pEntrance));
+		pEntrance->x = xInside;
+		pEntrance->y = yInside;
+		pEntrance->cLinks = 0;
+	}
+
+	// The crossing may only be possible in the other direction.
+	if(m_pCallback->GetPathValue(xOutside, yOutside, xInside, yInside, &nValue))
+	{
+		LINK* pLink;
+
+		CheckIf(ARRAYSIZE(pEntrance->rgLinks) == pEntrance->cLinks, E_UNEXPECTED);
+		pLink = pEntrance->rgLinks + pEntrance->cLinks++;
+
+		pLink->x = xOutside;
+		pLink->y = yOutside;
+		pLink->nCost = nValue + ((xInside == xOutside || yInside == yOutside) ? ADJACENT_MOVEMENT_COST : DIAGONAL_MOVEMENT_COST);
+	}
+
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CHierarchicalPathfinder::RenumberNodes (VOID)
+{
+	HRESULT hr;
+	INT cClusters = m_xClusters * m_yClusters;
+	ULONG cEntrances = 0;
+
+	for(INT i = 0; i < cClusters; i++)
+	{
+		m_prgClusters[i].nFirstNode = cEntrances;
+		cEntrances += static_cast<ULONG>(m_prgClusters[i].aEntrances.Length());
+	}
+
+	// Room for the start and destination nodes
+	if(cEntrances + 2 > m_cAllocated)
+	{
+		ULONG cAllocate = cEntrances + 2;
+
+		SafeDeleteArray(m_prgOwners);
+		SafeDeleteArray(m_prgNodes);
+		m_cAllocated = 0;
+
+		m_prgOwners = __new ULONG[cAllocate];
+		CheckAlloc(m_prgOwners);
+		m_prgNodes = __new ABSTRACT_NODE[cAllocate];
+		CheckAlloc(m_prgNodes);
+		Check(m_heap.Reserve(cAllocate));
+
+		ZeroMemory(m_prgNodes, sizeof(ABSTRACT_NODE) * cAllocate);
+		m_cAllocated = cAllocate;
+		m_nGeneration = 0;
+	}
+
+	for(INT i = 0; i < cClusters; i++)
+	{
+		ULONG nNode = m_prgClusters[i].nFirstNode;
+		for(sysint n = 0; n < m_prgClusters[i].aEntrances.Length(); n++)
+			m_prgOwners[nNode++] = static_cast<ULONG>(i);
+	}
+
+	m_cEntrances = cEntrances;
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
+
+// Searches the cells of one cluster, or of two neighbouring clusters.
+HRESULT CHierarchicalPathfinder::FindClusterPath (const CLUSTER* pFrom, const CLUSTER* pTo, INT xFrom, INT yFrom, INT xDest, INT yDest, __out INT* pnCost)
+{
+	HRESULT hr;
+
+	m_cluster.m_xMin = min(pFrom->x, pTo->x);
+	m_cluster.m_yMin = min(pFrom->y, pTo->y);
+	m_cluster.m_xMax = max(pFrom->x + pFrom->xSize, pTo->x + pTo->xSize) - 1;
+	m_cluster.m_yMax = max(pFrom->y + pFrom->ySize, pTo->y + pTo->ySize) - 1;
+
+	// A window of the cluster size around any cell of a cluster covers the cluster,
+	// and twice that covers its neighbours.
+	hr = m_astar.FindPath(xFrom, yFrom, xDest, yDest, pFrom == pTo ? m_nClusterSize : m_nClusterSize * 2, &m_cluster);
+	if(HRESULT_FROM_WIN32(ERROR_NOT_FOUND) == hr)
+	{
+		*pnCost = HPA_NO_PATH;
+		hr = S_FALSE;
+	}
+	else
+	{
+		Check(hr);
+		Check(m_astar.GetPathCost(xDest, yDest, pnCost));
+	}
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CHierarchicalPathfinder::SearchAbstract (INT xFrom, INT yFrom, INT xDest, INT yDest, INT nDirect)
+{
+	HRESULT hr;
+	ULONG iStart = m_cEntrances, iDest = m_cEntrances + 1;
+	CLUSTER* pStart = GetCluster(xFrom, yFrom);
+	CLUSTER* pDest = GetCluster(xDest, yDest);
+	POINT pt;
+
+	if(0 == ++m_nGeneration)
+	{
+		ZeroMemory(m_prgNodes, sizeof(ABSTRACT_NODE) * m_cAllocated);
+		m_nGeneration = 1;
+	}
+	m_heap.Clear();
+
+	RelaxNode(iStart, NO_PARENT, 0, xFrom, yFrom, xDest, yDest);
+
+	for(;;)
+	{
+		ULONG nCurrent;
+		INT g;
+
+		CheckIf(0 == m_heap.Length(), HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+
+		nCurrent = m_heap.Pop(GetHeapOrder());
+		if(iDest == nCurrent)
+			break;
+
+		g = m_prgNodes[nCurrent].g;
+
+		if(iStart == nCurrent)
+		{
+			for(sysint i = 0; i < m_aStartCosts.Length(); i++)
+			{
+				if(HPA_NO_PATH != m_aStartCosts[i])
+				{
+					const ENTRANCE& entrance = pStart->aEntrances[i];
+					RelaxNode(pStart->nFirstNode + static_cast<ULONG>(i), nCurrent, m_aStartCosts[i], entrance.x, entrance.y, xDest, yDest);
+				}
+			}
+
+			if(HPA_NO_PATH != nDirect)
+				RelaxNode(iDest, nCurrent, nDirect, xDest, yDest, xDest, yDest);
+		}
+		else
+		{
+			CLUSTER* pCluster = m_prgClusters + m_prgOwners[nCurrent];
+			sysint cEntrances = pCluster->aEntrances.Length();
+			sysint nEntrance = static_cast<sysint>(nCurrent - pCluster->nFirstNode);
+			const ENTRANCE& entrance = pCluster->aEntrances[nEntrance];
+			const INT* prgCosts = pCluster->aCosts.GetItemPtr(nEntrance * cEntrances);
+
+			for(sysint i = 0; i < cEntrances; i++)
+			{
+				if(i != nEntrance && HPA_NO_PATH != prgCosts[i])
+				{
+					const ENTRANCE& to = pCluster->aEntrances[i];
+					RelaxNode(pCluster->nFirstNode + static_cast<ULONG>(i), nCurrent, g + prgCosts[i], to.x, to.y, xDest, yDest);
+				}
+			}
+
+			if(pCluster == pDest && HPA_NO_PATH != m_aDestCosts[nEntrance])
+				RelaxNode(iDest, nCurrent, g + m_aDestCosts[nEntrance], xDest, yDest, xDest, yDest);
+
+			for(INT n = 0; n < entrance.cLinks; n++)
+			{
+				const LINK& link = entrance.rgLinks[n];
+				CLUSTER* pOther = GetCluster(link.x, link.y);
+
+				for(sysint i = 0; i < pOther->aEntrances.Length(); i++)
+				{
+					const ENTRANCE& to = pOther->aEntrances[i];
+					if(to.x == link.x && to.y == link.y)
+					{
+						RelaxNode(pOther->nFirstNode + static_cast<ULONG>(i), nCurrent, g + link.nCost, to.x, to.y, xDest, yDest);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	// Collect the waypoints from the destination back, then put them in order.
+	for(ULONG nNode = iDest; NO_PARENT != nNode; nNode = m_prgNodes[nNode].nParent)
+	{
+		if(iDest == nNode)
+		{
+			pt.x = xDest;
+			pt.y = yDest;
+		}
+		else if(iStart == nNode)
+		{
+			pt.x = xFrom;
+			pt.y = yFrom;
+		}
+		else
+		{
+			const CLUSTER* pCluster = m_prgClusters + m_prgOwners[nNode];
+			const ENTRANCE& entrance = pCluster->aEntrances[nNode - pCluster->nFirstNode];
+			pt.x = entrance.x;
+			pt.y = entrance.y;
+		}
+		Check(m_aWaypoints.Append(&pt));
+	}
+
+	for(sysint i = 0, j = m_aWaypoints.Length() - 1; i < j; i++, j--)
+	{
+		pt = m_aWaypoints[i];
+		m_aWaypoints[i] = m_aWaypoints[j];
+		m_aWaypoints[j] = pt;
+	}
+
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
+
+VOID CHierarchicalPathfinder::RelaxNode (ULONG nNode, ULONG nParent, INT g, INT xNode, INT yNode, INT xDest, INT yDest)
+{
+	ABSTRACT_NODE* pNode = m_prgNodes + nNode;
+
+	if(pNode->nGeneration != m_nGeneration)
+	{
+		pNode->nGeneration = m_nGeneration;
+		pNode->nParent = nParent;
+		pNode->g = g;
+		pNode->h = OctileDistance(xNode, yNode, xDest, yDest);
+
+		// Every node enters the heap at most once per search.
+		m_heap.Push(GetHeapOrder(), nNode);
+	}
+	else if(NODE_CLOSED != pNode->iHeap && g < pNode->g)
+	{
+		pNode->g = g;
+		pNode->nParent = nParent;
+		m_heap.Decrease(GetHeapOrder(), nNode);
+	}
+}
+
+// The callback only judges the cell being entered, so both cells are first checked
+// with themselves as the origin, like CJumpPointMap::Build().
+BOOL CHierarchicalPathfinder::IsCrossable (INT xA, INT yA, INT xB, INT yB)
+{
+	INT nValue;
+
+	if(!m_pCallback->GetPathValue(xA, yA, xA, yA, &nValue) || !m_pCallback->GetPathValue(xB, yB, xB, yB, &nValue))
+		return FALSE;
+
+	return m_pCallback->GetPathValue(xB, yB, xA, yA, &nValue) || m_pCallback->GetPathValue(xA, yA, xB, yB, &nValue);
+}
+
+// A diagonal crossing that could also be made with two straight steps, through either
+// of the cells beside it, is already covered by the straight crossings' entrances.
+BOOL CHierarchicalPathfinder::IsDiagonalOnly (INT xA, INT yA, INT xB, INT yB)
+{
+	if(!IsCrossable(xA, yA, xB, yB))
+		return FALSE;
+
+	if(IsCrossable(xA, yA, xB, yA) && IsCrossable(xB, yA, xB, yB))
+		return FALSE;
+
+	return !(IsCrossable(xA, yA, xA, yB) && IsCrossable(xA, yB, xB, yB));
+}
+
+// Only the links found while building the entrances are known to be single steps
+// that the callback allows.
+BOOL CHierarchicalPathfinder::IsLinked (INT xFrom, INT yFrom, INT xTo, INT yTo)
+{
+	const CLUSTER* pCluster = GetCluster(xFrom, yFrom);
+
+	for(sysint i = 0; i < pCluster->aEntrances.Length(); i++)
+	{
+		const ENTRANCE& entrance = pCluster->aEntrances[i];
+
+		if(entrance.x == xFrom && entrance.y == yFrom)
+		{
+			for(INT n = 0; n < entrance.cLinks; n++)
+			{
+				if(entrance.rgLinks[n].x == xTo && entrance.rgLinks[n].y == yTo)
+					return TRUE;
+			}
+			break;
+		}
+	}
+
+	return FALSE;
+}
+
+VOID CHierarchicalPathfinder::MarkClusters (INT xMin, INT yMin, INT xMax, INT yMax)
+{
+	xMin = max(xMin, m_x) - m_x;
+	yMin = max(yMin, m_y) - m_y;
+	xMax = min(xMax, m_x + m_xSize - 1) - m_x;
+	yMax = min(yMax, m_y + m_ySize - 1) - m_y;
+
+	if(xMin > xMax || yMin > yMax)
+		return;
+
+	for(INT yCluster = yMin / m_nClusterSize; yCluster <= yMax / m_nClusterSize; yCluster++)
+	{
+		for(INT xCluster = xMin / m_nClusterSize; xCluster <= xMax / m_nClusterSize; xCluster++)
+			m_prgClusters[yCluster * m_xClusters + xCluster].fDirty = TRUE;
+	}
+
+	m_fDirty = TRUE;
+}
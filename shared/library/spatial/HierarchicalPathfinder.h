@@ -0,0 +1,154 @@
+#pragma once
+
+#include "AStar2D.h"
+
+// Narrow runs of open border cells get one entrance in the middle, and wider runs get
+// one at each end.
+#define	HPA_WIDE_ENTRANCE		6
+
+#define	HPA_NO_PATH				-1
+
+// Hierarchical path-finding (HPA*) over a fixed region.  The region is split into
+// square clusters, and the cost between every pair of entrances on a cluster's borders
+// is found with CAStar2D searches that stay inside the cluster.  Long searches run over
+// this abstract graph, and each segment of the result is only turned back into cells
+// when RefineSegment() or GetPath() asks for it.  Trips between neighbouring clusters
+// also try a direct search.  Paths are usually within about ten percent of the best
+// cost, but aren't guaranteed to be optimal.
+//
+// Crossings that the callback only allows diagonally, along a border or across a
+// cluster's corner, get entrances of their own.  Steps between passable neighbours on
+// the same side of a border are assumed to be allowed.
+//
+// When cells change, Invalidate() marks the clusters whose entrances or costs could be
+// affected, and they are rebuilt before the next search.
+
+class CHierarchicalPathfinder
+{
+private:
+	// Limits searches to the cells of one cluster, or of two neighbouring clusters
+	class CClusterCallback : public IAStarCallback2D
+	{
+	public:
+		IAStarCallback2D* m_pCallback;
+		INT m_xMin, m_yMin, m_xMax, m_yMax;
+
+		virtual BOOL GetPathValue (INT x, INT y, INT xFrom, INT yFrom, __out INT* pnValue);
+	};
+
+	// A straight or diagonal step from an entrance into a neighbouring cluster
+	struct LINK
+	{
+		INT x, y;
+		INT nCost;
+	};
+
+	struct ENTRANCE
+	{
+		INT x, y;
+		INT cLinks;
+		LINK rgLinks[5];	// A corner cell can cross two borders and the corner
+	};
+
+	struct CLUSTER
+	{
+		INT x, y, xSize, ySize;
+		BOOL fDirty;
+		ULONG nFirstNode;
+		TArray<ENTRANCE> aEntrances;
+		TArray<INT> aCosts;			// Entrance to entrance, row-major, or HPA_NO_PATH
+	};
+
+	struct ABSTRACT_NODE
+	{
+		ULONG nGeneration;
+		ULONG nParent;
+		INT g, h;
+		LONG iHeap;
+	};
+
+	IAStarCallback2D* m_pCallback;
+	INT m_x, m_y, m_xSize, m_ySize;
+	INT m_nClusterSize;
+	INT m_xClusters, m_yClusters;
+	CLUSTER* m_prgClusters;
+	BOOL m_fDirty;
+
+	// Every entrance is an abstract node, numbered from its cluster's nFirstNode, and the
+	// start and destination of a search follow the entrances.
+	ULONG m_cEntrances;
+	ULONG* m_prgOwners;
+	ABSTRACT_NODE* m_prgNodes;
+	CIndexedHeap m_heap;
+	ULONG m_cAllocated;
+	ULONG m_nGeneration;
+
+	// Costs from the start to each entrance of its cluster, and from each entrance of
+	// the destination's cluster to the destination
+	TArray<INT> m_aStartCosts;
+	TArray<INT> m_aDestCosts;
+
+	TArray<POINT> m_aWaypoints;
+	CAStar2D m_astar;
+	CClusterCallback m_cluster;
+
+public:
+	CHierarchicalPathfinder ();
+	~CHierarchicalPathfinder ();
+
+	HRESULT Initialize (INT x, INT y, INT xSize, INT ySize, INT nClusterSize, IAStarCallback2D* pCallback);
+
+	// Marks the clusters affected by changes to the given cells.
+	VOID Invalidate (INT x, INT y, INT xSize, INT ySize);
+
+	// Rebuilds any invalidated clusters.  FindPath() calls this automatically.
+	HRESULT Update (VOID);
+
+	HRESULT FindPath (INT xFrom, INT yFrom, INT xDest, INT yDest);
+
+	// The abstract path from the last search runs from the start, through the
+	// entrances it uses, to the destination.  Segment n joins waypoints n and n + 1.
+	inline sysint GetWaypointCount (VOID) const { return m_aWaypoints.Length(); }
+	inline const POINT& GetWaypoint (sysint n) const { return m_aWaypoints[n]; }
+
+	// Appends the cells of one segment, from its end back to its start, like
+	// CAStar2D::GetPath().
+	HRESULT RefineSegment (sysint nSegment, TArray<POINT>* paPath);
+
+	// Appends the cells of the whole path, from the destination back to the start.
+	HRESULT GetPath (TArray<POINT>* paPath);
+
+	inline INT GetClusterSize (VOID) const { return m_nClusterSize; }
+	inline INT GetClusterCount (VOID) const { return m_xClusters * m_yClusters; }
+	inline ULONG GetEntranceCount (VOID) const { return m_cEntrances; }
+
+private:
+	VOID Clear (VOID);
+	HRESULT RebuildCluster (CLUSTER* pCluster);
+	HRESULT AddBorder (CLUSTER* pCluster, INT xInside, INT yInside, INT xOutside, INT yOutside, INT dx, INT dy, INT cCells);
+	HRESULT AddEntrance (CLUSTER* pCluster, INT xInside, INT yInside, INT xOutside, INT yOutside);
+	HRESULT RenumberNodes (VOID);
+	HRESULT FindClusterPath (const CLUSTER* pFrom, const CLUSTER* pTo, INT xFrom, INT yFrom, INT xDest, INT yDest, __out INT* pnCost);
+	HRESULT SearchAbstract (INT xFrom, INT yFrom, INT xDest, INT yDest, INT nDirect);
+	VOID RelaxNode (ULONG nNode, ULONG nParent, INT g, INT xNode, INT yNode, INT xDest, INT yDest);
+	BOOL IsCrossable (INT xA, INT yA, INT xB, INT yB);
+	BOOL IsDiagonalOnly (INT xA, INT yA, INT xB, INT yB);
+	BOOL IsLinked (INT xFrom, INT yFrom, INT xTo, INT yTo);
+	VOID MarkClusters (INT xMin, INT yMin, INT xMax, INT yMax);
+
+	inline TAStarHeapOrder<ABSTRACT_NODE> GetHeapOrder (VOID)
+	{
+		TAStarHeapOrder<ABSTRACT_NODE> order = { m_prgNodes };
+		return order;
+	}
+
+	inline CLUSTER* GetCluster (INT x, INT y)
+	{
+		return m_prgClusters + ((y - m_y) / m_nClusterSize) * m_xClusters + (x - m_x) / m_nClusterSize;
+	}
+
+	inline BOOL IsInside (INT x, INT y) const
+	{
+		return x >= m_x && y >= m_y && x < m_x + m_xSize && y < m_y + m_ySize;
+	}
+};
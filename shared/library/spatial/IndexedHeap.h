@@ -0,0 +1,169 @@
+#pragma once
+
+// Position of an item that isn't in the heap
+#define	HEAP_INDEX_NONE		-1
+
+// Binary min-heap of item indexes for searches that lower an item's key while it's
+// queued.  The keys, and each item's position in the heap, stay with the caller's own
+// items and are reached through an order object passed to every call:
+//
+//	BOOL HeapLess (ULONG nA, ULONG nB) const		// Item nA comes out before nB
+//	LONG& HeapIndex (ULONG n) const					// Item n's position in the heap
+//
+// Pop() sets the removed item's position to HEAP_INDEX_NONE.
+
+class CIndexedHeap
+{
+private:
+	ULONG* m_prgHeap;
+	ULONG m_cHeap;
+	ULONG m_cMaxHeap;
+
+public:
+	CIndexedHeap () :
+		m_prgHeap(NULL),
+		m_cHeap(0),
+		m_cMaxHeap(0)
+	{
+	}
+
+	~CIndexedHeap ()
+	{
+		__delete_array m_prgHeap;
+	}
+
+	// Grows the heap to hold cItems items, and empties it.  The heap never shrinks.
+	HRESULT Reserve (ULONG cItems)
+	{
+		HRESULT hr = S_FALSE;
+
+		if(cItems > m_cMaxHeap)
+		{
+			ULONG* prgHeap = __new ULONG[cItems];
+			CheckAlloc(prgHeap);
+
+			__delete_array m_prgHeap;
+			m_prgHeap = prgHeap;
+			m_cMaxHeap = cItems;
+			hr = S_OK;
+		}
+
+		m_cHeap = 0;
+
+	Cleanup:
+		return hr;
+	}
+
+	VOID Free (VOID)
+	{
+		SafeDeleteArray(m_prgHeap);
+		m_cHeap = 0;
+		m_cMaxHeap = 0;
+	}
+
+	inline VOID Clear (VOID) { m_cHeap = 0; }
+	inline ULONG Length (VOID) const { return m_cHeap; }
+
+	// The item must not already be in the heap, and each item can only be pushed once
+	// between calls to Clear() unless it has been popped.
+	template <typename TOrder>
+	VOID Push (const TOrder& order, ULONG nItem)
+	{
+		Assert(m_cHeap < m_cMaxHeap);
+
+		order.HeapIndex(nItem) = static_cast<LONG>(m_cHeap);
+		m_prgHeap[m_cHeap++] = nItem;
+		SiftUp(order, m_cHeap - 1);
+	}
+
+	// Restores the order after a queued item's key has been lowered.
+	template <typename TOrder>
+	VOID Decrease (const TOrder& order, ULONG nItem)
+	{
+		SiftUp(order, static_cast<ULONG>(order.HeapIndex(nItem)));
+	}
+
+	template <typename TOrder>
+	ULONG Pop (const TOrder& order)
+	{
+		ULONG nTop = m_prgHeap[0];
+
+		order.HeapIndex(nTop) = HEAP_INDEX_NONE;
+		if(0 < --m_cHeap)
+		{
+			m_prgHeap[0] = m_prgHeap[m_cHeap];
+			order.HeapIndex(m_prgHeap[0]) = 0;
+			SiftDown(order, 0);
+		}
+
+		return nTop;
+	}
+
+private:
+	template <typename TOrder>
+	VOID SiftUp (const TOrder& order, ULONG iHeap)
+	{
+		ULONG nItem = m_prgHeap[iHeap];
+
+		while(0 < iHeap)
+		{
+			ULONG iParent = (iHeap - 1) >> 1;
+			ULONG nParent = m_prgHeap[iParent];
+
+			if(!order.HeapLess(nItem, nParent))
+				break;
+
+			m_prgHeap[iHeap] = nParent;
+			order.HeapIndex(nParent) = static_cast<LONG>(iHeap);
+			iHeap = iParent;
+		}
+
+		m_prgHeap[iHeap] = nItem;
+		order.HeapIndex(nItem) = static_cast<LONG>(iHeap);
+	}
+
+	template <typename TOrder>
+	VOID SiftDown (const TOrder& order, ULONG iHeap)
+	{
+		ULONG nItem = m_prgHeap[iHeap];
+
+		for(;;)
+		{
+			ULONG iChild = (iHeap << 1) + 1;
+			ULONG nChild;
+
+			if(iChild >= m_cHeap)
+				break;
+
+			nChild = m_prgHeap[iChild];
+			if(iChild + 1 < m_cHeap && order.HeapLess(m_prgHeap[iChild + 1], nChild))
+				nChild = m_prgHeap[++iChild];
+
+			if(!order.HeapLess(nChild, nItem))
+				break;
+
+			m_prgHeap[iHeap] = nChild;
+			order.HeapIndex(nChild) = static_cast<LONG>(iHeap);
+			iHeap = iChild;
+		}
+
+		m_prgHeap[iHeap] = nItem;
+		order.HeapIndex(nItem) = static_cast<LONG>(iHeap);
+	}
+};
+
+// Orders A* nodes, which have g, h and iHeap members, by F and then by index.
+template <typename TNode>
+struct TAStarHeapOrder
+{
+	TNode* prgNodes;
+
+	inline BOOL HeapLess (ULONG nA, ULONG nB) const
+	{
+		INT fA = prgNodes[nA].g + prgNodes[nA].h;
+		INT fB = prgNodes[nB].g + prgNodes[nB].h;
+		return fA < fB || (fA == fB && nA < nB);
+	}
+
+	inline LONG& HeapIndex (ULONG n) const { return prgNodes[n].iHeap; }
+};
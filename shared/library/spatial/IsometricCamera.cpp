@@ -3,7 +3,8 @@
 #include <gl\gl.h>
 #include "IsometricCamera.h"
 
-CIsometricCamera::CIsometricCamera (const CIsometricCamera& cameraSource)
+CIsometricCamera::CIsometricCamera (const CIsometricCamera& cameraSource) :
+	m_transform(cameraSource.m_transform)
 {
 	m_yRise = cameraSource.m_yRise;
 	m_zRun = cameraSource.m_zRun;
@@ -12,6 +13,7 @@ CIsometricCamera::CIsometricCamera (const CIsometricCamera& cameraSource)
 	m_rTurnRate = 1.0f;
 	CopyMemory(&m_dblPoint, &cameraSource.m_dblPoint, sizeof(DPOINT));
 	m_dblDirRadians = cameraSource.m_dblDirRadians;
+	m_fViewDirty = TRUE;
 }
 
 CIsometricCamera::CIsometricCamera ()
@@ -23,6 +25,7 @@ CIsometricCamera::CIsometricCamera ()
 	m_rTurnRate = 1.0f;
 	ZeroMemory(&m_dblPoint, sizeof(DPOINT));
 	m_dblDirRadians = 0.0;
+	m_fViewDirty = TRUE;
 }
 
 CIsometricCamera::~CIsometricCamera ()
@@ -34,6 +37,7 @@ VOID CIsometricCamera::SetPosition (DOUBLE xObj, DOUBLE yObj, DOUBLE zObj)
 	m_dblPoint.x = xObj;
 	m_dblPoint.y = yObj;
 	m_dblPoint.z = zObj;
+	m_fViewDirty = TRUE;
 }
 
 VOID CIsometricCamera::GetPosition (DOUBLE& xObj, DOUBLE& yObj, DOUBLE& zObj)
@@ -70,6 +74,7 @@ VOID CIsometricCamera::SetOffset (FLOAT yRise, FLOAT zRun)
 		m_rLook = 90.0f;
 	else
 		m_rLook = Geometry::RadiansDblToDegreesFlt(atan((DOUBLE)m_yRise / (DOUBLE)m_zRun));
+	m_fViewDirty = TRUE;
 }
 
 VOID CIsometricCamera::SetOffsetByAngle (FLOAT rDegrees, FLOAT rDistance)
@@ -92,6 +97,7 @@ VOID CIsometricCamera::SetOffsetByAngle (FLOAT rDegrees, FLOAT rDistance)
 	}
 
 	m_rLook = rDegrees;
+	m_fViewDirty = TRUE;
 }
 
 VOID CIsometricCamera::GetOffset (FLOAT& yRise, FLOAT& zRun)
@@ -133,6 +139,7 @@ VOID CIsometricCamera::SetTurnAngle (FLOAT rAngle)
 		rAngle -= 360.0f;
 	m_rDirection = rAngle;
 	m_dblDirRadians = Geometry::TDegreesToRadians<DOUBLE, FLOAT>(rAngle);
+	m_fViewDirty = TRUE;
 }
 
 FLOAT CIsometricCamera::GetTurnAngle (VOID)
@@ -144,17 +151,20 @@ VOID CIsometricCamera::MoveForward (FLOAT rVelocity)
 {
 	m_dblPoint.x += sin(m_dblDirRadians) * rVelocity;
 	m_dblPoint.z -= cos(m_dblDirRadians) * rVelocity;
+	m_fViewDirty = TRUE;
 }
 
 VOID CIsometricCamera::MoveBackward (FLOAT rVelocity)
 {
 	m_dblPoint.x -= sin(m_dblDirRadians) * rVelocity;
 	m_dblPoint.z += cos(m_dblDirRadians) * rVelocity;
+	m_fViewDirty = TRUE;
 }
 
 VOID CIsometricCamera::Raise (FLOAT fAddPosition)
 {
 	m_dblPoint.y += fAddPosition;
+	m_fViewDirty = TRUE;
 }
 
 VOID CIsometricCamera::GetLookAtPoint (FLOAT rDistance, __out DPOINT& dblLookAt)
@@ -178,3 +188,52 @@ VOID CIsometricCamera::GetLookAtPoint (FLOAT rDistance, __out DPOINT& dblLookAt)
 	dblLookAt.y -= rDistance * sin(dblAngleX);
 	dblLookAt.z -= rDistance * dblCosAngleX * dblCosAngleY;
 }
+
+VOID CIsometricCamera::SetProjection (FLOAT rFieldOfView, FLOAT rAspect, FLOAT rNear, FLOAT rFar)
+{
+	m_transform.SetPerspective(rFieldOfView, rAspect, rNear, rFar);
+}
+
+VOID CIsometricCamera::SetViewport (INT x, INT y, INT xSize, INT ySize)
+{
+	m_transform.SetViewport(x, y, xSize, ySize);
+}
+
+const FLOAT* CIsometricCamera::GetViewMatrix (VOID)
+{
+	UpdateView();
+	return m_transform.GetView();
+}
+
+const FLOAT* CIsometricCamera::GetViewProjectionMatrix (VOID)
+{
+	UpdateView();
+	return m_transform.GetViewProjection();
+}
+
+SIZE_T CIsometricCamera::ProjectPoints (const FPOINT* prgPoints, __out_ecount(cPoints) POINT* prgScreen, SIZE_T cPoints)
+{
+	UpdateView();
+	return m_transform.ProjectPoints(prgPoints, prgScreen, cPoints);
+}
+
+SIZE_T CIsometricCamera::UnprojectPoints (const POINT* prgScreen, FLOAT yPlane, __out_ecount(cPoints) FPOINT* prgWorld, SIZE_T cPoints)
+{
+	UpdateView();
+	return m_transform.UnprojectPoints(prgScreen, yPlane, prgWorld, cPoints);
+}
+
+VOID CIsometricCamera::UpdateView (VOID)
+{
+	if(m_fViewDirty)
+	{
+		// The same rotations and translation as SetPerspective()
+		DOUBLE dblNegDirRadians = -m_dblDirRadians;
+		DOUBLE dblRun = (DOUBLE)m_zRun;
+		DOUBLE xCameraOffset = sin(dblNegDirRadians) * dblRun;
+		DOUBLE zCameraOffset = cos(dblNegDirRadians) * dblRun;
+
+		m_transform.SetView(m_dblPoint.x + xCameraOffset, m_dblPoint.y + m_yRise, m_dblPoint.z + zCameraOffset, m_rLook, m_rDirection);
+		m_fViewDirty = FALSE;
+	}
+}
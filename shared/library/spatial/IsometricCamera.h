@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Geometry.h"
+#include "ViewTransform.h"
 
 class CIsometricCamera
 {
@@ -13,6 +14,10 @@ protected:
 
 	FLOAT m_yRise, m_zRun;
 
+	// Every change to the fields above marks the cached view dirty.
+	CViewTransform m_transform;
+	BOOL m_fViewDirty;
+
 public:
 	CIsometricCamera (const CIsometricCamera& cameraSource);
 	CIsometricCamera ();
@@ -47,4 +52,20 @@ public:
 	VOID Raise (FLOAT fAddPosition);
 
 	VOID GetLookAtPoint (FLOAT rDistance, __out DPOINT& dblLookAt);
+
+	// Projection and viewport for the CPU transforms, matching the values given to
+	// gluPerspective() and glViewport().  They don't change the OpenGL state.
+	VOID SetProjection (FLOAT rFieldOfView, FLOAT rAspect, FLOAT rNear, FLOAT rFar);
+	VOID SetViewport (INT x, INT y, INT xSize, INT ySize);
+
+	// The matrix SetPerspective() applies, and the projection times that matrix
+	const FLOAT* GetViewMatrix (VOID);
+	const FLOAT* GetViewProjectionMatrix (VOID);
+
+	// See CViewTransform::ProjectPoints() and CViewTransform::UnprojectPoints().
+	SIZE_T ProjectPoints (const FPOINT* prgPoints, __out_ecount(cPoints) POINT* prgScreen, SIZE_T cPoints);
+	SIZE_T UnprojectPoints (const POINT* prgScreen, FLOAT yPlane, __out_ecount(cPoints) FPOINT* prgWorld, SIZE_T cPoints);
+
+protected:
+	VOID UpdateView (VOID);
 };
@@ -0,0 +1,130 @@
+#include <windows.h>
+#include "..\Core\CoreDefs.h"
+#include "JumpPointMap.h"
+
+const INT CJumpPointMap::c_rgxDirection[JUMP_DIRECTIONS] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+const INT CJumpPointMap::c_rgyDirection[JUMP_DIRECTIONS] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+CJumpPointMap::CJumpPointMap () :
+	m_x(0),
+	m_y(0),
+	m_xSize(0),
+	m_ySize(0),
+	m_pbPassable(NULL),
+	m_prgJumps(NULL)
+{
+}
+
+CJumpPointMap::~CJumpPointMap ()
+{
+	Clear();
+}
+
+HRESULT CJumpPointMap::Build (INT x, INT y, INT xSize, INT ySize, IAStarCallback2D* pCallback)
+{
+	HRESULT hr;
+	SIZE_T cCells;
+
+	CheckIf(0 >= xSize || 0 >= ySize || xSize > SHRT_MAX || ySize > SHRT_MAX, E_INVALIDARG);
+
+	Clear();
+
+	cCells = static_cast<SIZE_T>(xSize) * static_cast<SIZE_T>(ySize);
+	m_pbPassable = __new BYTE[cCells];
+	CheckAlloc(m_pbPassable);
+	m_prgJumps = __new SHORT[cCells * JUMP_DIRECTIONS];
+	CheckAlloc(m_prgJumps);
+
+	m_x = x;
+	m_y = y;
+	m_xSize = xSize;
+	m_ySize = ySize;
+
+	for(INT yCell = 0; yCell < ySize; yCell++)
+	{
+		for(INT xCell = 0; xCell < xSize; xCell++)
+		{
+			INT nValue;
+			m_pbPassable[yCell * xSize + xCell] = pCallback->GetPathValue(x + xCell, y + yCell, x + xCell, y + yCell, &nValue) ? 1 : 0;
+		}
+	}
+
+	// The diagonal distances depend on the straight distances.
+	for(INT nDirection = JUMP_EAST; nDirection < JUMP_DIRECTIONS; nDirection += 2)
+		ComputeDirection(nDirection);
+	for(INT nDirection = JUMP_SOUTHEAST; nDirection < JUMP_DIRECTIONS; nDirection += 2)
+		ComputeDirection(nDirection);
+
+	hr = S_OK;
+
+Cleanup:
+	if(FAILED(hr))
+		Clear();
+	return hr;
+}
+
+VOID CJumpPointMap::Clear (VOID)
+{
+	SafeDeleteArray(m_prgJumps);
+	SafeDeleteArray(m_pbPassable);
+	m_xSize = 0;
+	m_ySize = 0;
+}
+
+// A cell reached by a straight move is a jump point when it has a forced neighbour,
+// which is a passable side cell whose counterpart behind the move is blocked.
+BOOL CJumpPointMap::IsStraightJumpPoint (INT x, INT y, INT dx, INT dy) const
+{
+	if(dx)
+	{
+		return (IsPassable(x, y + 1) && !IsPassable(x - dx, y + 1)) ||
+			(IsPassable(x, y - 1) && !IsPassable(x - dx, y - 1));
+	}
+
+	return (IsPassable(x + 1, y) && !IsPassable(x + 1, y - dy)) ||
+		(IsPassable(x - 1, y) && !IsPassable(x - 1, y - dy));
+}
+
+VOID CJumpPointMap::ComputeDirection (INT nDirection)
+{
+	INT dx = c_rgxDirection[nDirection];
+	INT dy = c_rgyDirection[nDirection];
+	INT xStart = dx > 0 ? m_xSize - 1 : 0, xEnd = dx > 0 ? -1 : m_xSize, xStep = dx > 0 ? -1 : 1;
+	INT yStart = dy > 0 ? m_ySize - 1 : 0, yEnd = dy > 0 ? -1 : m_ySize, yStep = dy > 0 ? -1 : 1;
+
+	// Cells are visited so that the next cell in the direction is always done first,
+	// which lets each distance extend its neighbour's.
+	for(INT yCell = yStart; yCell != yEnd; yCell += yStep)
+	{
+		for(INT xCell = xStart; xCell != xEnd; xCell += xStep)
+		{
+			INT x = m_x + xCell, y = m_y + yCell;
+			INT xNext = x + dx, yNext = y + dy;
+			SHORT* pnJump = m_prgJumps + (yCell * m_xSize + xCell) * JUMP_DIRECTIONS + nDirection;
+
+			if(!IsPassable(xNext, yNext) || (dx && dy && (!IsPassable(xNext, y) || !IsPassable(x, yNext))))
+				*pnJump = 0;
+			else
+			{
+				BOOL fJumpPoint;
+				INT nNext = GetJump(xNext, yNext, nDirection);
+
+				if(dx && dy)
+				{
+					// Diagonal moves stop where a straight jump along either component finds something.
+					fJumpPoint = 0 < GetJump(xNext, yNext, dx > 0 ? JUMP_EAST : JUMP_WEST) ||
+						0 < GetJump(xNext, yNext, dy > 0 ? JUMP_SOUTH : JUMP_NORTH);
+				}
+				else
+					fJumpPoint = IsStraightJumpPoint(xNext, yNext, dx, dy);
+
+				if(fJumpPoint)
+					*pnJump = 1;
+				else if(0 < nNext)
+					*pnJump = static_cast<SHORT>(nNext + 1);
+				else
+					*pnJump = static_cast<SHORT>(nNext - 1);
+			}
+		}
+	}
+}
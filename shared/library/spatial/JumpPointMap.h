@@ -0,0 +1,67 @@
+#pragma once
+
+#include "AStar2D.h"
+
+// Directions used by the jump tables, clockwise from east.  North is toward -y.
+enum JUMP_DIRECTION
+{
+	JUMP_EAST,
+	JUMP_SOUTHEAST,
+	JUMP_SOUTH,
+	JUMP_SOUTHWEST,
+	JUMP_WEST,
+	JUMP_NORTHWEST,
+	JUMP_NORTH,
+	JUMP_NORTHEAST,
+	JUMP_DIRECTIONS
+};
+
+// Precomputed jump distances (JPS+) for a fixed, uniform-cost region.  For every
+// passable cell and direction, a positive value is the number of steps to the next jump
+// point, and zero or a negative value is the number of steps that can be taken before
+// reaching a wall.  Diagonal steps are only allowed when both of the adjacent cells are
+// passable, matching CAStar2D::FindPathJPS().  Build() must be called again whenever
+// the passability of the region changes.
+
+class CJumpPointMap
+{
+private:
+	INT m_x, m_y;
+	INT m_xSize, m_ySize;
+	PBYTE m_pbPassable;
+	SHORT* m_prgJumps;		// JUMP_DIRECTIONS entries per cell
+
+public:
+	static const INT c_rgxDirection[JUMP_DIRECTIONS];
+	static const INT c_rgyDirection[JUMP_DIRECTIONS];
+
+public:
+	CJumpPointMap ();
+	~CJumpPointMap ();
+
+	// Each cell is passable when pCallback->GetPathValue() accepts it, with the cell
+	// passed as its own origin.  The value reported is ignored.
+	HRESULT Build (INT x, INT y, INT xSize, INT ySize, IAStarCallback2D* pCallback);
+
+	inline INT GetX (VOID) const { return m_x; }
+	inline INT GetY (VOID) const { return m_y; }
+	inline INT GetWidth (VOID) const { return m_xSize; }
+	inline INT GetHeight (VOID) const { return m_ySize; }
+
+	inline BOOL IsPassable (INT x, INT y) const
+	{
+		x -= m_x;
+		y -= m_y;
+		return x >= 0 && y >= 0 && x < m_xSize && y < m_ySize && m_pbPassable[y * m_xSize + x];
+	}
+
+	inline INT GetJump (INT x, INT y, INT nDirection) const
+	{
+		return m_prgJumps[((y - m_y) * m_xSize + (x - m_x)) * JUMP_DIRECTIONS + nDirection];
+	}
+
+private:
+	VOID Clear (VOID);
+	BOOL IsStraightJumpPoint (INT x, INT y, INT dx, INT dy) const;
+	VOID ComputeDirection (INT nDirection);
+};
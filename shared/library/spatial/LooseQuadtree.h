@@ -0,0 +1,415 @@
+#pragma once
+
+#include <math.h>
+#include "SpatialQuery.h"
+
+#define	LOOSE_QUADTREE_MAX_DEPTH	10
+
+// Quadtree over a fixed world rectangle, with every level stored as a full grid of
+// nodes.  Each node's bounds are loosened to twice its size, so an item always lives in
+// exactly one node: the deepest one at least as large as the item, found from the item's
+// center without searching.  Items whose centers lie outside the world stay at the root,
+// and the root is always searched.  Items are plain values, usually pointers, and are
+// identified by the handle returned from Insert().
+
+template<typename T, typename TRect = DBLRECT, typename TCoord = DOUBLE>
+class TLooseQuadtree
+{
+private:
+	struct ENTRY
+	{
+		TRect rc;
+		T value;
+		LONG iNode;			// -1 when the entry is free
+		sysint nNext;		// Next entry in the node, or the next free entry
+		sysint nPrev;
+	};
+
+	struct NODE
+	{
+		sysint nFirst;
+		sysint cItems;		// Items in this node and all of its descendants
+	};
+
+	TRect m_rcWorld;
+	INT m_nMaxDepth;
+	NODE* m_prgNodes;
+	LONG m_cNodes;
+
+	TArray<ENTRY> m_aEntries;
+	sysint m_nFreeEntry;
+
+public:
+	TLooseQuadtree () :
+		m_nMaxDepth(0),
+		m_prgNodes(NULL),
+		m_cNodes(0),
+		m_nFreeEntry(-1)
+	{
+		ZeroMemory(&m_rcWorld, sizeof(m_rcWorld));
+	}
+
+	~TLooseQuadtree ()
+	{
+		__delete_array m_prgNodes;
+	}
+
+	// Level n has 4^n nodes, so a depth of 8 uses about 87,000 nodes.
+	HRESULT Initialize (const TRect& rcWorld, INT nMaxDepth)
+	{
+		HRESULT hr;
+
+		CheckIf(rcWorld.left >= rcWorld.right || rcWorld.top >= rcWorld.bottom, E_INVALIDARG);
+		CheckIf(0 > nMaxDepth || nMaxDepth > LOOSE_QUADTREE_MAX_DEPTH, E_INVALIDARG);
+
+		__delete_array m_prgNodes;
+		m_cNodes = LevelOffset(nMaxDepth + 1);
+		m_prgNodes = __new NODE[m_cNodes];
+		CheckAlloc(m_prgNodes);
+
+		m_rcWorld = rcWorld;
+		m_nMaxDepth = nMaxDepth;
+		Clear();
+		hr = S_OK;
+
+	Cleanup:
+		if(FAILED(hr))
+			m_cNodes = 0;
+		return hr;
+	}
+
+	VOID Clear (VOID)
+	{
+		for(LONG i = 0; i < m_cNodes; i++)
+		{
+			m_prgNodes[i].nFirst = -1;
+			m_prgNodes[i].cItems = 0;
+		}
+
+		m_aEntries.Clear();
+		m_nFreeEntry = -1;
+	}
+
+	inline sysint Length (VOID) const { return m_prgNodes ? m_prgNodes[0].cItems : 0; }
+
+	HRESULT Insert (const TRect& rc, const T& value, __out sysint* pnHandle)
+	{
+		HRESULT hr;
+		sysint nEntry;
+		ENTRY* pEntry;
+
+		CheckIf(NULL == m_prgNodes, E_UNEXPECTED);
+		CheckIf(rc.left > rc.right || rc.top > rc.bottom, E_INVALIDARG);
+
+		if(-1 != m_nFreeEntry)
+		{
+			nEntry = m_nFreeEntry;
+			pEntry = &m_aEntries[nEntry];
+			m_nFreeEntry = pEntry->nNext;
+		}
+		else
+		{
+			nEntry = m_aEntries.Length();
+			Check(m_aEntries.AppendSlot(&pEntry));
+		}
+
+		pEntry->rc = rc;
+		pEntry->value = value;
+		Link(nEntry, FindNode(rc));
+		*pnHandle = nEntry;
+
+	Cleanup:
+		return hr;
+	}
+
+	HRESULT Move (sysint nHandle, const TRect& rc)
+	{
+		HRESULT hr;
+		LONG iNode;
+
+		CheckIf(!IsHandle(nHandle), E_INVALIDARG);
+		CheckIf(rc.left > rc.right || rc.top > rc.bottom, E_INVALIDARG);
+
+		iNode = FindNode(rc);
+		if(iNode != m_aEntries[nHandle].iNode)
+		{
+			Unlink(nHandle);
+			Link(nHandle, iNode);
+		}
+		m_aEntries[nHandle].rc = rc;
+		hr = S_OK;
+
+	Cleanup:
+		return hr;
+	}
+
+	HRESULT Remove (sysint nHandle)
+	{
+		HRESULT hr;
+
+		CheckIf(!IsHandle(nHandle), E_INVALIDARG);
+
+		Unlink(nHandle);
+		m_aEntries[nHandle].iNode = -1;
+		m_aEntries[nHandle].nNext = m_nFreeEntry;
+		m_nFreeEntry = nHandle;
+		hr = S_OK;
+
+	Cleanup:
+		return hr;
+	}
+
+	inline const TRect& GetRect (sysint nHandle) const { return m_aEntries[nHandle].rc; }
+	inline const T& GetValue (sysint nHandle) const { return m_aEntries[nHandle].value; }
+
+	// Appends every item whose rectangle contains the point.
+	HRESULT FindAt (TCoord x, TCoord y, TArray<T>* paItems)
+	{
+		TRect rc;
+
+		rc.left = rc.right = x;
+		rc.top = rc.bottom = y;
+		return FindInRect(rc, paItems);
+	}
+
+	// Appends every item whose rectangle overlaps rc.
+	HRESULT FindInRect (const TRect& rc, TArray<T>* paItems)
+	{
+		HRESULT hr = S_OK;
+
+		CheckIf(NULL == m_prgNodes, E_UNEXPECTED);
+		if(rc.left <= rc.right && rc.top <= rc.bottom)
+			Check(SearchRect(0, 0, 0, rc, paItems));
+
+	Cleanup:
+		return hr;
+	}
+
+	// Appends up to cNearest items, closest first, measured from the point to the
+	// nearest point of each item's rectangle.
+	HRESULT FindNearest (TCoord x, TCoord y, sysint cNearest, TArray<T>* paItems)
+	{
+		HRESULT hr = S_OK;
+		TSpatialNearest<T, TCoord> nearest(cNearest);
+
+		CheckIf(NULL == m_prgNodes || 0 > cNearest, E_INVALIDARG);
+		if(0 < cNearest && 0 < Length())
+		{
+			Check(SearchNearest(0, 0, 0, x, y, &nearest));
+			Check(nearest.CopyTo(paItems));
+		}
+
+	Cleanup:
+		return hr;
+	}
+
+private:
+	// Nodes above level n
+	static inline LONG LevelOffset (INT nDepth)
+	{
+		return ((1 << (nDepth << 1)) - 1) / 3;
+	}
+
+	inline LONG NodeIndex (INT nDepth, INT xNode, INT yNode) const
+	{
+		return LevelOffset(nDepth) + (yNode << nDepth) + xNode;
+	}
+
+	inline BOOL IsHandle (sysint nHandle) const
+	{
+		return 0 <= nHandle && nHandle < m_aEntries.Length() && -1 != m_aEntries[nHandle].iNode;
+	}
+
+	// The node's own quarter of its parent, widened by half its size on every side
+	VOID GetLooseBounds (INT nDepth, INT xNode, INT yNode, __out TRect* prc) const
+	{
+		TCoord Width = (m_rcWorld.right - m_rcWorld.left) / static_cast<TCoord>(1 << nDepth);
+		TCoord Height = (m_rcWorld.bottom - m_rcWorld.top) / static_cast<TCoord>(1 << nDepth);
+
+		prc->left = m_rcWorld.left + Width * static_cast<TCoord>(xNode) - Width / 2;
+		prc->top = m_rcWorld.top + Height * static_cast<TCoord>(yNode) - Height / 2;
+		prc->right = prc->left + Width * 2;
+		prc->bottom = prc->top + Height * 2;
+	}
+
+	LONG FindNode (const TRect& rc) const
+	{
+		TCoord x = rc.left + (rc.right - rc.left) / 2;
+		TCoord y = rc.top + (rc.bottom - rc.top) / 2;
+		TCoord WorldWidth = m_rcWorld.right - m_rcWorld.left;
+		TCoord WorldHeight = m_rcWorld.bottom - m_rcWorld.top;
+		INT nDepth = m_nMaxDepth;
+
+		if(x < m_rcWorld.left || x > m_rcWorld.right || y < m_rcWorld.top || y > m_rcWorld.bottom)
+			return 0;
+
+		// An item no larger than a node fits within the loose bounds of the node holding its center.
+		while(0 < nDepth && (rc.right - rc.left > WorldWidth / static_cast<TCoord>(1 << nDepth) || rc.bottom - rc.top > WorldHeight / static_cast<TCoord>(1 << nDepth)))
+			nDepth--;
+
+		INT cNodes = 1 << nDepth;
+		INT xNode = static_cast<INT>(static_cast<DOUBLE>(x - m_rcWorld.left) * cNodes / static_cast<DOUBLE>(WorldWidth));
+		INT yNode = static_cast<INT>(static_cast<DOUBLE>(y - m_rcWorld.top) * cNodes / static_cast<DOUBLE>(WorldHeight));
+
+		xNode = min(max(xNode, 0), cNodes - 1);
+		yNode = min(max(yNode, 0), cNodes - 1);
+
+		// Rounding can leave an item just outside the bounds that searches will test, so
+		// move it up until the bounds hold it.
+		while(0 < nDepth)
+		{
+			TRect rcLoose;
+
+			GetLooseBounds(nDepth, xNode, yNode, &rcLoose);
+			if(rcLoose.left <= rc.left && rc.right <= rcLoose.right && rcLoose.top <= rc.top && rc.bottom <= rcLoose.bottom)
+				break;
+
+			nDepth--;
+			xNode >>= 1;
+			yNode >>= 1;
+		}
+
+		return NodeIndex(nDepth, xNode, yNode);
+	}
+
+	VOID Link (sysint nEntry, LONG iNode)
+	{
+		ENTRY* pEntry = &m_aEntries[nEntry];
+		NODE* pNode = m_prgNodes + iNode;
+
+		pEntry->iNode = iNode;
+		pEntry->nPrev = -1;
+		pEntry->nNext = pNode->nFirst;
+		if(-1 != pNode->nFirst)
+			m_aEntries[pNode->nFirst].nPrev = nEntry;
+		pNode->nFirst = nEntry;
+
+		UpdateCounts(iNode, 1);
+	}
+
+	VOID Unlink (sysint nEntry)
+	{
+		ENTRY* pEntry = &m_aEntries[nEntry];
+
+		if(-1 != pEntry->nPrev)
+			m_aEntries[pEntry->nPrev].nNext = pEntry->nNext;
+		else
+			m_prgNodes[pEntry->iNode].nFirst = pEntry->nNext;
+		if(-1 != pEntry->nNext)
+			m_aEntries[pEntry->nNext].nPrev = pEntry->nPrev;
+
+		UpdateCounts(pEntry->iNode, -1);
+	}
+
+	// Adds cChange to the node and every ancestor.
+	VOID UpdateCounts (LONG iNode, sysint cChange)
+	{
+		INT nDepth = 0;
+
+		while(iNode >= LevelOffset(nDepth + 1))
+			nDepth++;
+
+		INT nPosition = iNode - LevelOffset(nDepth);
+		INT xNode = nPosition & ((1 << nDepth) - 1);
+		INT yNode = nPosition >> nDepth;
+
+		for(;;)
+		{
+			m_prgNodes[NodeIndex(nDepth, xNode, yNode)].cItems += cChange;
+			if(0 == nDepth)
+				break;
+			nDepth--;
+			xNode >>= 1;
+			yNode >>= 1;
+		}
+	}
+
+	HRESULT SearchRect (INT nDepth, INT xNode, INT yNode, const TRect& rc, TArray<T>* paItems)
+	{
+		HRESULT hr = S_OK;
+		const NODE* pNode = m_prgNodes + NodeIndex(nDepth, xNode, yNode);
+
+		for(sysint nEntry = pNode->nFirst; -1 != nEntry; nEntry = m_aEntries[nEntry].nNext)
+		{
+			const ENTRY& entry = m_aEntries[nEntry];
+
+			if(SpatialQuery::RectsOverlap(entry.rc, rc))
+				Check(paItems->Append(entry.value));
+		}
+
+		if(nDepth < m_nMaxDepth)
+		{
+			for(INT i = 0; i < 4; i++)
+			{
+				INT xChild = (xNode << 1) + (i & 1);
+				INT yChild = (yNode << 1) + (i >> 1);
+				TRect rcLoose;
+
+				if(0 == m_prgNodes[NodeIndex(nDepth + 1, xChild, yChild)].cItems)
+					continue;
+
+				GetLooseBounds(nDepth + 1, xChild, yChild, &rcLoose);
+				if(SpatialQuery::RectsOverlap(rcLoose, rc))
+					Check(SearchRect(nDepth + 1, xChild, yChild, rc, paItems));
+			}
+		}
+
+	Cleanup:
+		return hr;
+	}
+
+	// Children are visited nearest first, and skipped once they can't beat the results.
+	HRESULT SearchNearest (INT nDepth, INT xNode, INT yNode, TCoord x, TCoord y, TSpatialNearest<T, TCoord>* pNearest)
+	{
+		HRESULT hr = S_OK;
+		const NODE* pNode = m_prgNodes + NodeIndex(nDepth, xNode, yNode);
+
+		for(sysint nEntry = pNode->nFirst; -1 != nEntry; nEntry = m_aEntries[nEntry].nNext)
+		{
+			const ENTRY& entry = m_aEntries[nEntry];
+			Check(pNearest->Offer(SpatialQuery::DistanceSquared(entry.rc, x, y), entry.value));
+		}
+
+		if(nDepth < m_nMaxDepth)
+		{
+			TCoord rgDistance[4];
+			INT rgChild[4];
+			INT cChildren = 0;
+
+			for(INT i = 0; i < 4; i++)
+			{
+				INT xChild = (xNode << 1) + (i & 1);
+				INT yChild = (yNode << 1) + (i >> 1);
+				TRect rcLoose;
+				TCoord Distance;
+				INT n;
+
+				if(0 == m_prgNodes[NodeIndex(nDepth + 1, xChild, yChild)].cItems)
+					continue;
+
+				GetLooseBounds(nDepth + 1, xChild, yChild, &rcLoose);
+				Distance = SpatialQuery::DistanceSquared(rcLoose, x, y);
+
+				for(n = cChildren; 0 < n && Distance < rgDistance[n - 1]; n--)
+				{
+					rgDistance[n] = rgDistance[n - 1];
+					rgChild[n] = rgChild[n - 1];
+				}
+				rgDistance[n] = Distance;
+				rgChild[n] = i;
+				cChildren++;
+			}
+
+			for(INT i = 0; i < cChildren; i++)
+			{
+				if(pNearest->IsFull() && rgDistance[i] >= pNearest->GetWorst())
+					break;
+
+				Check(SearchNearest(nDepth + 1, (xNode << 1) + (rgChild[i] & 1), (yNode << 1) + (rgChild[i] >> 1), x, y, pNearest));
+			}
+		}
+
+	Cleanup:
+		return hr;
+	}
+};
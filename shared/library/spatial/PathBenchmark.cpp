@@ -0,0 +1,226 @@
+#include <windows.h>
+#include "..\Core\CoreDefs.h"
+#include "PathBenchmark.h"
+
+// The combat screen's map, and the search range it passes to CAStar2D
+#define	PATH_BENCHMARK_COMBAT_WIDTH		32
+#define	PATH_BENCHMARK_COMBAT_HEIGHT	32
+#define	PATH_BENCHMARK_COMBAT_RANGE		64
+#define	PATH_BENCHMARK_COMBAT_BLOCKED	15
+#define	PATH_BENCHMARK_QUERIES			10000
+
+// Cheap, repeatable pattern so every run searches the same grid
+static inline ULONG NextPattern (ULONG& nSeed)
+{
+	nSeed = nSeed * 1664525 + 1013904223;
+	return nSeed >> 8;
+}
+
+static const BENCHMARK_COLUMN c_rgColumns[] =
+{
+	{ "search", "search", BENCHMARK_COLUMN_STRING, offsetof(PATH_BENCHMARK_RESULT, pcszName) },
+	{ "width", "width", BENCHMARK_COLUMN_INT, offsetof(PATH_BENCHMARK_RESULT, xSize) },
+	{ "height", "height", BENCHMARK_COLUMN_INT, offsetof(PATH_BENCHMARK_RESULT, ySize) },
+	{ "queries", "queries", BENCHMARK_COLUMN_SIZE, offsetof(PATH_BENCHMARK_RESULT, cQueries) },
+	{ "iterations", "iterations", BENCHMARK_COLUMN_ULONGLONG, offsetof(PATH_BENCHMARK_RESULT, cIterations) },
+	{ "queries_per_second", "queriesPerSecond", BENCHMARK_COLUMN_RATE, offsetof(PATH_BENCHMARK_RESULT, dblQueriesPerSecond) }
+};
+
+class CPathBenchmark::CWorkload : public IBenchmarkWorkload
+{
+public:
+	CPathBenchmark* m_pBenchmark;
+	MODE m_eMode;
+	CPathContext m_context;
+
+	virtual HRESULT RunBatch (ULONGLONG cIterations);
+};
+
+HRESULT CPathBenchmark::CWorkload::RunBatch (ULONGLONG cIterations)
+{
+	HRESULT hr = S_OK;
+
+	for(ULONGLONG n = 0; n < cIterations; n++)
+		Check(m_pBenchmark->SearchAll(m_eMode, &m_context));
+
+Cleanup:
+	return hr;
+}
+
+BOOL CPathBenchmark::CGridCallback::GetPathValue (INT x, INT y, INT xFrom, INT yFrom, __out INT* pnValue)
+{
+	if(x < 0 || y < 0 || x >= m_xSize || y >= m_ySize || 0 > m_pcnCosts[y * m_xSize + x])
+		return FALSE;
+
+	*pnValue = m_pcnCosts[y * m_xSize + x];
+	return TRUE;
+}
+
+HRESULT CPathBenchmark::CGridCallback::GetCostGrid (__out ASTAR_COST_GRID* pGrid)
+{
+	pGrid->pcnCosts = m_pcnCosts;
+	pGrid->x = 0;
+	pGrid->y = 0;
+	pGrid->xSize = m_xSize;
+	pGrid->ySize = m_ySize;
+	pGrid->cStride = m_xSize;
+	return S_OK;
+}
+
+CPathBenchmark::CPathBenchmark (DWORD msMinimum) :
+	m_msMinimum(msMinimum),
+	m_prgnCosts(NULL),
+	m_prgQueries(NULL),
+	m_cQueries(0),
+	m_nRange(0)
+{
+	m_callback.m_pcnCosts = NULL;
+	m_callback.m_xSize = 0;
+	m_callback.m_ySize = 0;
+}
+
+CPathBenchmark::~CPathBenchmark ()
+{
+	FreeData();
+}
+
+HRESULT CPathBenchmark::Prepare (INT xSize, INT ySize, INT nBlockedPercent, SIZE_T cQueries, INT nRange)
+{
+	HRESULT hr;
+	ULONG nSeed = 0x2545F491;
+	INT cCells;
+
+	CheckIf(0 >= xSize || 0 >= ySize || 0 > nBlockedPercent || nBlockedPercent >= 100, E_INVALIDARG);
+	CheckIf(0 == cQueries || 0 >= nRange || nRange > 0x7FFF, E_INVALIDARG);
+
+	FreeData();
+
+	cCells = xSize * ySize;
+	m_prgnCosts = __new INT[cCells];
+	CheckAlloc(m_prgnCosts);
+	m_prgQueries = __new POINT[cQueries * 2];
+	CheckAlloc(m_prgQueries);
+
+	for(INT i = 0; i < cCells; i++)
+		m_prgnCosts[i] = static_cast<INT>(NextPattern(nSeed) % 100) < nBlockedPercent ? -1 : 1;
+
+	for(SIZE_T i = 0; i < cQueries * 2; i++)
+	{
+		POINT* pt = m_prgQueries + i;
+
+		do
+		{
+			pt->x = static_cast<INT>(NextPattern(nSeed) % xSize);
+			pt->y = static_cast<INT>(NextPattern(nSeed) % ySize);
+		} while(0 > m_prgnCosts[pt->y * xSize + pt->x]);
+	}
+
+	m_callback.m_pcnCosts = m_prgnCosts;
+	m_callback.m_xSize = xSize;
+	m_callback.m_ySize = ySize;
+	m_cQueries = cQueries;
+	m_nRange = nRange;
+	hr = S_OK;
+
+Cleanup:
+	if(FAILED(hr))
+		FreeData();
+	return hr;
+}
+
+HRESULT CPathBenchmark::Run (VOID)
+{
+	HRESULT hr;
+
+	if(0 == m_cQueries)
+		Check(Prepare(PATH_BENCHMARK_COMBAT_WIDTH, PATH_BENCHMARK_COMBAT_HEIGHT, PATH_BENCHMARK_COMBAT_BLOCKED, PATH_BENCHMARK_QUERIES, PATH_BENCHMARK_COMBAT_RANGE));
+
+	Check(Measure("CAStar2D per query", MODE_NEW_SEARCH));
+	Check(Measure("CPathContext", MODE_CONTEXT));
+	Check(Measure("CPathContext (cost grid)", MODE_COST_GRID));
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CPathBenchmark::RunStandardSuite (VOID)
+{
+	HRESULT hr;
+
+	Check(Prepare(PATH_BENCHMARK_COMBAT_WIDTH, PATH_BENCHMARK_COMBAT_HEIGHT, PATH_BENCHMARK_COMBAT_BLOCKED, PATH_BENCHMARK_QUERIES, PATH_BENCHMARK_COMBAT_RANGE));
+	Check(Run());
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CPathBenchmark::Write (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat)
+{
+	return Benchmark::TWrite(pStream, eFormat, c_rgColumns, m_aResults);
+}
+
+VOID CPathBenchmark::FreeData (VOID)
+{
+	SafeDeleteArray(m_prgQueries);
+	SafeDeleteArray(m_prgnCosts);
+	m_cQueries = 0;
+}
+
+HRESULT CPathBenchmark::SearchAll (MODE eMode, CPathContext* pContext)
+{
+	HRESULT hr = S_OK;
+
+	for(SIZE_T i = 0; i < m_cQueries; i++)
+	{
+		const POINT* pcptFrom = m_prgQueries + i * 2;
+		const POINT* pcptDest = pcptFrom + 1;
+
+		// Unreachable destinations are part of the workload.
+		if(MODE_NEW_SEARCH == eMode)
+		{
+			CAStar2D aStar;
+
+			Check(aStar.PreInit());
+			hr = aStar.FindPath(pcptFrom->x, pcptFrom->y, pcptDest->x, pcptDest->y, m_nRange, static_cast<IAStarCallback2D*>(&m_callback));
+		}
+		else if(MODE_CONTEXT == eMode)
+		{
+			CAStar2D aStar(pContext);
+			hr = aStar.FindPath(pcptFrom->x, pcptFrom->y, pcptDest->x, pcptDest->y, m_nRange, static_cast<IAStarCallback2D*>(&m_callback));
+		}
+		else
+		{
+			CAStar2D aStar(pContext);
+			hr = aStar.FindPath(pcptFrom->x, pcptFrom->y, pcptDest->x, pcptDest->y, m_nRange, static_cast<IAStarCostGrid*>(&m_callback));
+		}
+		CheckIf(FAILED(hr) && HRESULT_FROM_WIN32(ERROR_NOT_FOUND) != hr, hr);
+	}
+
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CPathBenchmark::Measure (PCSTR pcszName, MODE eMode)
+{
+	HRESULT hr;
+	CWorkload workload;
+	BENCHMARK_TIMING timing;
+	PATH_BENCHMARK_RESULT* pResult;
+
+	workload.m_pBenchmark = this;
+	workload.m_eMode = eMode;
+	Check(Benchmark::Measure(&workload, m_msMinimum, &timing));
+
+	Check(m_aResults.AppendSlot(&pResult));
+	pResult->pcszName = pcszName;
+	pResult->xSize = m_callback.m_xSize;
+	pResult->ySize = m_callback.m_ySize;
+	pResult->cQueries = m_cQueries;
+	pResult->cIterations = timing.cIterations;
+	pResult->dblQueriesPerSecond = static_cast<DOUBLE>(timing.cIterations) * static_cast<DOUBLE>(m_cQueries) / timing.dblSeconds;
+
+Cleanup:
+	return hr;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "..\Core\Array.h"
+#include "..\Util\Benchmark.h"
+#include "AStar2D.h"
+
+// Query throughput of CAStar2D on a fixed grid.  A repeatable set of obstacles and
+// start and destination pairs is generated once, and the whole set is searched
+// repeatedly until the minimum measuring time has elapsed.
+
+struct PATH_BENCHMARK_RESULT
+{
+	PCSTR pcszName;
+	INT xSize, ySize;
+	SIZE_T cQueries;
+	ULONGLONG cIterations;
+	DOUBLE dblQueriesPerSecond;
+};
+
+class CPathBenchmark
+{
+private:
+	enum MODE
+	{
+		MODE_NEW_SEARCH,		// A new CAStar2D for every query, like the combat screen used
+		MODE_CONTEXT,			// One CPathContext for every query
+		MODE_COST_GRID			// One CPathContext, reading the costs as a live grid
+	};
+
+	class CWorkload;
+
+	// Cells outside the grid are blocked.
+	class CGridCallback : public IAStarCostGrid
+	{
+	public:
+		const INT* m_pcnCosts;
+		INT m_xSize, m_ySize;
+
+		virtual BOOL GetPathValue (INT x, INT y, INT xFrom, INT yFrom, __out INT* pnValue);
+		virtual HRESULT GetCostGrid (__out ASTAR_COST_GRID* pGrid);
+	};
+
+	TArray<PATH_BENCHMARK_RESULT> m_aResults;
+	DWORD m_msMinimum;
+
+	INT* m_prgnCosts;
+	POINT* m_prgQueries;		// Start and destination for each query
+	SIZE_T m_cQueries;
+	INT m_nRange;
+	CGridCallback m_callback;
+
+public:
+	CPathBenchmark (DWORD msMinimum = 200);
+	~CPathBenchmark ();
+
+	// Blocks about nBlockedPercent of the cells and picks cQueries open start and
+	// destination pairs.  Searches use a window of nRange cells around the start.
+	HRESULT Prepare (INT xSize, INT ySize, INT nBlockedPercent, SIZE_T cQueries, INT nRange);
+
+	// Measures the prepared queries with and without a long-lived CPathContext, and
+	// through the callback and the cost grid.
+	HRESULT Run (VOID);
+
+	// 10,000 queries on a combat-sized map, with the combat screen's search range
+	HRESULT RunStandardSuite (VOID);
+
+	HRESULT Write (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat);
+
+	inline sysint Length (VOID) const { return m_aResults.Length(); }
+	inline const PATH_BENCHMARK_RESULT* GetResult (sysint n) const { return &m_aResults[n]; }
+	inline VOID Clear (VOID) { m_aResults.Clear(); }
+
+private:
+	VOID FreeData (VOID);
+	HRESULT SearchAll (MODE eMode, CPathContext* pContext);
+	HRESULT Measure (PCSTR pcszName, MODE eMode);
+};
@@ -0,0 +1,210 @@
+#include <windows.h>
+#include "..\Core\CoreDefs.h"
+#include "ProjectionBenchmark.h"
+
+#define	PROJECTION_BENCHMARK_TILES			64
+#define	PROJECTION_BENCHMARK_WIDTH			1280
+#define	PROJECTION_BENCHMARK_HEIGHT			720
+
+// An isometric view like the games use, looking down at 45 degrees
+#define	PROJECTION_BENCHMARK_LOOK			45.0f
+#define	PROJECTION_BENCHMARK_DISTANCE		40.0f
+#define	PROJECTION_BENCHMARK_TURN			30.0f
+#define	PROJECTION_BENCHMARK_FOV			45.0f
+
+static const BENCHMARK_COLUMN c_rgColumns[] =
+{
+	{ "transform", "transform", BENCHMARK_COLUMN_STRING, offsetof(PROJECTION_BENCHMARK_RESULT, pcszName) },
+	{ "points", "points", BENCHMARK_COLUMN_SIZE, offsetof(PROJECTION_BENCHMARK_RESULT, cPoints) },
+	{ "iterations", "iterations", BENCHMARK_COLUMN_ULONGLONG, offsetof(PROJECTION_BENCHMARK_RESULT, cIterations) },
+	{ "points_per_second", "pointsPerSecond", BENCHMARK_COLUMN_RATE, offsetof(PROJECTION_BENCHMARK_RESULT, dblPointsPerSecond) }
+};
+
+class CProjectionBenchmark::CWorkload : public IBenchmarkWorkload
+{
+public:
+	CProjectionBenchmark* m_pBenchmark;
+	MODE m_eMode;
+
+	virtual HRESULT RunBatch (ULONGLONG cIterations);
+};
+
+HRESULT CProjectionBenchmark::CWorkload::RunBatch (ULONGLONG cIterations)
+{
+	for(ULONGLONG n = 0; n < cIterations; n++)
+		m_pBenchmark->TransformAll(m_eMode);
+	return S_OK;
+}
+
+CProjectionBenchmark::CProjectionBenchmark (DWORD msMinimum) :
+	m_msMinimum(msMinimum),
+	m_prgWorld(NULL),
+	m_prgScreen(NULL),
+	m_prgPicked(NULL),
+	m_cPoints(0)
+{
+}
+
+CProjectionBenchmark::~CProjectionBenchmark ()
+{
+	FreeData();
+}
+
+HRESULT CProjectionBenchmark::Prepare (INT nTiles, INT xViewport, INT yViewport)
+{
+	HRESULT hr;
+	SIZE_T cPoints;
+	INT nSide;
+
+	CheckIf(0 >= nTiles || nTiles > 0x7FFF || 0 >= xViewport || 0 >= yViewport, E_INVALIDARG);
+
+	FreeData();
+
+	nSide = nTiles + 1;
+	cPoints = static_cast<SIZE_T>(nSide) * nSide;
+	m_prgWorld = __new FPOINT[cPoints];
+	CheckAlloc(m_prgWorld);
+	m_prgScreen = __new POINT[cPoints];
+	CheckAlloc(m_prgScreen);
+	m_prgPicked = __new FPOINT[cPoints];
+	CheckAlloc(m_prgPicked);
+
+	// Tile corners on the ground, and the same number of pixels spread over the viewport
+	for(INT y = 0; y < nSide; y++)
+	{
+		for(INT x = 0; x < nSide; x++)
+		{
+			SIZE_T n = static_cast<SIZE_T>(y) * nSide + x;
+
+			m_prgWorld[n].x = static_cast<FLOAT>(x);
+			m_prgWorld[n].y = 0.0f;
+			m_prgWorld[n].z = static_cast<FLOAT>(y);
+
+			m_prgScreen[n].x = x * (xViewport - 1) / nTiles;
+			m_prgScreen[n].y = y * (yViewport - 1) / nTiles;
+		}
+	}
+
+	m_camera.SetPosition(nTiles / 2.0, 0.0, nTiles / 2.0);
+	m_camera.SetOffsetByAngle(PROJECTION_BENCHMARK_LOOK, PROJECTION_BENCHMARK_DISTANCE);
+	m_camera.SetTurnAngle(PROJECTION_BENCHMARK_TURN);
+	m_camera.SetProjection(PROJECTION_BENCHMARK_FOV, static_cast<FLOAT>(xViewport) / static_cast<FLOAT>(yViewport), 0.1f, 1000.0f);
+	m_camera.SetViewport(0, 0, xViewport, yViewport);
+
+	m_cPoints = cPoints;
+	hr = S_OK;
+
+Cleanup:
+	if(FAILED(hr))
+		FreeData();
+	return hr;
+}
+
+HRESULT CProjectionBenchmark::Run (VOID)
+{
+	HRESULT hr;
+
+	if(0 == m_cPoints)
+		Check(Prepare(PROJECTION_BENCHMARK_TILES, PROJECTION_BENCHMARK_WIDTH, PROJECTION_BENCHMARK_HEIGHT));
+
+	Check(Measure("ProjectPoints (rebuilt view)", MODE_PROJECT_REBUILD));
+	Check(Measure("ProjectPoints (single)", MODE_PROJECT_SINGLE));
+	Check(Measure("ProjectPoints (batch)", MODE_PROJECT_BATCH));
+	Check(Measure("UnprojectPoints (single)", MODE_UNPROJECT_SINGLE));
+	Check(Measure("UnprojectPoints (batch)", MODE_UNPROJECT_BATCH));
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CProjectionBenchmark::RunStandardSuite (VOID)
+{
+	HRESULT hr;
+
+	Check(Prepare(PROJECTION_BENCHMARK_TILES, PROJECTION_BENCHMARK_WIDTH, PROJECTION_BENCHMARK_HEIGHT));
+	Check(Run());
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CProjectionBenchmark::Write (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat)
+{
+	return Benchmark::TWrite(pStream, eFormat, c_rgColumns, m_aResults);
+}
+
+VOID CProjectionBenchmark::FreeData (VOID)
+{
+	SafeDeleteArray(m_prgPicked);
+	SafeDeleteArray(m_prgScreen);
+	SafeDeleteArray(m_prgWorld);
+	m_cPoints = 0;
+}
+
+VOID CProjectionBenchmark::TransformAll (MODE eMode)
+{
+	switch(eMode)
+	{
+	case MODE_PROJECT_REBUILD:
+		for(SIZE_T i = 0; i < m_cPoints; i++)
+		{
+			DOUBLE x, y, z;
+
+			// Setting the same position still marks the view dirty.
+			m_camera.GetPosition(x, y, z);
+			m_camera.SetPosition(x, y, z);
+			m_camera.ProjectPoints(m_prgWorld + i, m_prgScreen + i, 1);
+		}
+		break;
+	case MODE_PROJECT_SINGLE:
+		for(SIZE_T i = 0; i < m_cPoints; i++)
+			m_camera.ProjectPoints(m_prgWorld + i, m_prgScreen + i, 1);
+		break;
+	case MODE_PROJECT_BATCH:
+		m_camera.ProjectPoints(m_prgWorld, m_prgScreen, m_cPoints);
+		break;
+	case MODE_UNPROJECT_SINGLE:
+		for(SIZE_T i = 0; i < m_cPoints; i++)
+			m_camera.UnprojectPoints(m_prgScreen + i, 0.0f, m_prgPicked + i, 1);
+		break;
+	case MODE_UNPROJECT_BATCH:
+		m_camera.UnprojectPoints(m_prgScreen, 0.0f, m_prgPicked, m_cPoints);
+		break;
+	}
+}
+
+HRESULT CProjectionBenchmark::Measure (PCSTR pcszName, MODE eMode)
+{
+	HRESULT hr;
+	CWorkload workload;
+	BENCHMARK_TIMING timing;
+	PROJECTION_BENCHMARK_RESULT* pResult;
+
+	// Unprojecting reads the screen points, so they are projected once beforehand
+	// to keep every mode working from the same data.
+	m_camera.ProjectPoints(m_prgWorld, m_prgScreen, m_cPoints);
+	if(MODE_UNPROJECT_SINGLE == eMode || MODE_UNPROJECT_BATCH == eMode)
+	{
+		for(SIZE_T i = 0; i < m_cPoints; i++)
+		{
+			if(VIEW_POINT_BEHIND == m_prgScreen[i].x)
+			{
+				m_prgScreen[i].x = 0;
+				m_prgScreen[i].y = 0;
+			}
+		}
+	}
+
+	workload.m_pBenchmark = this;
+	workload.m_eMode = eMode;
+	Check(Benchmark::Measure(&workload, m_msMinimum, &timing));
+
+	Check(m_aResults.AppendSlot(&pResult));
+	pResult->pcszName = pcszName;
+	pResult->cPoints = m_cPoints;
+	pResult->cIterations = timing.cIterations;
+	pResult->dblPointsPerSecond = static_cast<DOUBLE>(timing.cIterations) * static_cast<DOUBLE>(m_cPoints) / timing.dblSeconds;
+
+Cleanup:
+	return hr;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "..\Core\Array.h"
+#include "..\Util\Benchmark.h"
+#include "IsometricCamera.h"
+
+// Throughput of CIsometricCamera's batch transforms against calling them one point at
+// a time.  The points are the tile corners of a square map around the camera, and the
+// screen points are a grid of pixels across the viewport.  Each set is transformed
+// repeatedly until the minimum measuring time has elapsed.
+
+struct PROJECTION_BENCHMARK_RESULT
+{
+	PCSTR pcszName;
+	SIZE_T cPoints;
+	ULONGLONG cIterations;
+	DOUBLE dblPointsPerSecond;
+};
+
+class CProjectionBenchmark
+{
+private:
+	enum MODE
+	{
+		MODE_PROJECT_REBUILD,		// One point per call, with the view changed before each call
+		MODE_PROJECT_SINGLE,		// One point per call
+		MODE_PROJECT_BATCH,
+		MODE_UNPROJECT_SINGLE,
+		MODE_UNPROJECT_BATCH
+	};
+
+	class CWorkload;
+
+	TArray<PROJECTION_BENCHMARK_RESULT> m_aResults;
+	DWORD m_msMinimum;
+
+	CIsometricCamera m_camera;
+	FPOINT* m_prgWorld;
+	POINT* m_prgScreen;
+	FPOINT* m_prgPicked;
+	SIZE_T m_cPoints;
+
+public:
+	CProjectionBenchmark (DWORD msMinimum = 200);
+	~CProjectionBenchmark ();
+
+	// Places the camera over the middle of a map of nTiles by nTiles, with a
+	// viewport of xViewport by yViewport pixels.
+	HRESULT Prepare (INT nTiles, INT xViewport, INT yViewport);
+
+	HRESULT Run (VOID);
+
+	// A 64 by 64 tile map in a 1280 by 720 viewport
+	HRESULT RunStandardSuite (VOID);
+
+	HRESULT Write (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat);
+
+	inline sysint Length (VOID) const { return m_aResults.Length(); }
+	inline const PROJECTION_BENCHMARK_RESULT* GetResult (sysint n) const { return &m_aResults[n]; }
+	inline VOID Clear (VOID) { m_aResults.Clear(); }
+
+private:
+	VOID FreeData (VOID);
+	VOID TransformAll (MODE eMode);
+	HRESULT Measure (PCSTR pcszName, MODE eMode);
+};
@@ -0,0 +1,548 @@
+#pragma once
+
+#include <math.h>
+#include "SpatialQuery.h"
+
+#define	SPATIAL_GRID_NO_REF		-1
+#define	SPATIAL_GRID_MAX_CELLS	256		// Cells an item can be listed in
+
+// Uniform grid of square cells over an unbounded plane, hashed into a fixed number of
+// buckets.  Each item is listed in every cell its rectangle touches, so the cell size
+// should be around the size of a typical item.  Items that would touch more than
+// SPATIAL_GRID_MAX_CELLS cells are kept in an overflow list instead, which every query
+// checks.  Items are plain values, usually pointers, and are identified by the handle
+// returned from Insert().
+
+template<typename T, typename TRect = DBLRECT, typename TCoord = DOUBLE>
+class TSpatialGrid
+{
+private:
+	struct ENTRY
+	{
+		TRect rc;
+		T value;
+		INT xMin, yMin, xMax, yMax;		// Cells touched by rc
+		ULONG nStamp;					// Last query that reported this entry
+		BOOL fUsed;
+		sysint nNextFree;
+		sysint iOverflow;				// Position in m_aOverflow, or -1 if listed in cells
+	};
+
+	// One cell's reference to an entry, linked from the cell's bucket
+	struct CELL_REF
+	{
+		INT x, y;
+		sysint nEntry;
+		LONG iNext;
+	};
+
+	TCoord m_CellSize;
+	LONG* m_prgBuckets;
+	ULONG m_nBucketMask;
+
+	TArray<ENTRY> m_aEntries;
+	sysint m_nFreeEntry;
+	sysint m_cItems;
+
+	TArray<CELL_REF> m_aRefs;
+	LONG m_iFreeRef;
+
+	TArray<sysint> m_aOverflow;
+
+	ULONG m_nStamp;
+
+	// Every cell that has ever held an item lies within these bounds.
+	INT m_xCellMin, m_yCellMin, m_xCellMax, m_yCellMax;
+
+public:
+	TSpatialGrid () :
+		m_CellSize(0),
+		m_prgBuckets(NULL),
+		m_nBucketMask(0),
+		m_nFreeEntry(-1),
+		m_cItems(0),
+		m_iFreeRef(SPATIAL_GRID_NO_REF),
+		m_nStamp(0),
+		m_xCellMin(INT_MAX),
+		m_yCellMin(INT_MAX),
+		m_xCellMax(INT_MIN),
+		m_yCellMax(INT_MIN)
+	{
+	}
+
+	~TSpatialGrid ()
+	{
+		__delete_array m_prgBuckets;
+	}
+
+	// The bucket count is rounded up to a power of two.
+	HRESULT Initialize (TCoord CellSize, ULONG cBuckets)
+	{
+		HRESULT hr;
+		ULONG cRounded = 1;
+
+		CheckIf(0 >= CellSize || 0 == cBuckets || cBuckets > 0x10000000, E_INVALIDARG);
+
+		while(cRounded < cBuckets)
+			cRounded <<= 1;
+
+		__delete_array m_prgBuckets;
+		m_prgBuckets = __new LONG[cRounded];
+		CheckAlloc(m_prgBuckets);
+
+		m_CellSize = CellSize;
+		m_nBucketMask = cRounded - 1;
+		Clear();
+		hr = S_OK;
+
+	Cleanup:
+		return hr;
+	}
+
+	VOID Clear (VOID)
+	{
+		for(ULONG i = 0; i <= m_nBucketMask && m_prgBuckets; i++)
+			m_prgBuckets[i] = SPATIAL_GRID_NO_REF;
+
+		m_aEntries.Clear();
+		m_aRefs.Clear();
+		m_aOverflow.Clear();
+		m_nFreeEntry = -1;
+		m_iFreeRef = SPATIAL_GRID_NO_REF;
+		m_cItems = 0;
+		m_xCellMin = m_yCellMin = INT_MAX;
+		m_xCellMax = m_yCellMax = INT_MIN;
+	}
+
+	inline sysint Length (VOID) const { return m_cItems; }
+
+	HRESULT Insert (const TRect& rc, const T& value, __out sysint* pnHandle)
+	{
+		HRESULT hr;
+		sysint nEntry;
+		ENTRY* pEntry;
+
+		CheckIf(NULL == m_prgBuckets, E_UNEXPECTED);
+		CheckIf(rc.left > rc.right || rc.top > rc.bottom, E_INVALIDARG);
+
+		if(-1 != m_nFreeEntry)
+		{
+			nEntry = m_nFreeEntry;
+			pEntry = &m_aEntries[nEntry];
+			m_nFreeEntry = pEntry->nNextFree;
+		}
+		else
+		{
+			nEntry = m_aEntries.Length();
+			Check(m_aEntries.AppendSlot(&pEntry));
+		}
+
+		pEntry->rc = rc;
+		pEntry->value = value;
+		pEntry->nStamp = 0;
+		pEntry->fUsed = TRUE;
+		pEntry->nNextFree = -1;
+		pEntry->iOverflow = -1;
+		GetCellSpan(rc, &pEntry->xMin, &pEntry->yMin, &pEntry->xMax, &pEntry->yMax);
+		m_cItems++;
+
+		hr = AddRefs(nEntry);
+		if(FAILED(hr))
+		{
+			FreeEntry(nEntry);
+			goto Cleanup;
+		}
+
+		*pnHandle = nEntry;
+
+	Cleanup:
+		return hr;
+	}
+
+	// The item is removed if its new cells can't be allocated.
+	HRESULT Move (sysint nHandle, const TRect& rc)
+	{
+		HRESULT hr = S_OK;
+		ENTRY* pEntry;
+		INT xMin, yMin, xMax, yMax;
+
+		CheckIf(!IsHandle(nHandle), E_INVALIDARG);
+		CheckIf(rc.left > rc.right || rc.top > rc.bottom, E_INVALIDARG);
+
+		pEntry = &m_aEntries[nHandle];
+		GetCellSpan(rc, &xMin, &yMin, &xMax, &yMax);
+
+		if(xMin != pEntry->xMin || yMin != pEntry->yMin || xMax != pEntry->xMax || yMax != pEntry->yMax)
+		{
+			RemoveRefs(nHandle);
+			pEntry->xMin = xMin;
+			pEntry->yMin = yMin;
+			pEntry->xMax = xMax;
+			pEntry->yMax = yMax;
+
+			hr = AddRefs(nHandle);
+			if(FAILED(hr))
+			{
+				FreeEntry(nHandle);
+				goto Cleanup;
+			}
+		}
+
+		m_aEntries[nHandle].rc = rc;
+
+	Cleanup:
+		return hr;
+	}
+
+	HRESULT Remove (sysint nHandle)
+	{
+		HRESULT hr;
+
+		CheckIf(!IsHandle(nHandle), E_INVALIDARG);
+
+		RemoveRefs(nHandle);
+		FreeEntry(nHandle);
+		hr = S_OK;
+
+	Cleanup:
+		return hr;
+	}
+
+	inline const TRect& GetRect (sysint nHandle) const { return m_aEntries[nHandle].rc; }
+	inline const T& GetValue (sysint nHandle) const { return m_aEntries[nHandle].value; }
+
+	// Appends every item whose rectangle contains the point.
+	HRESULT FindAt (TCoord x, TCoord y, TArray<T>* paItems)
+	{
+		TRect rc;
+
+		rc.left = rc.right = x;
+		rc.top = rc.bottom = y;
+		return FindInRect(rc, paItems);
+	}
+
+	// Appends every item whose rectangle overlaps rc.
+	HRESULT FindInRect (const TRect& rc, TArray<T>* paItems)
+	{
+		HRESULT hr = S_OK;
+		INT xMin, yMin, xMax, yMax;
+
+		CheckIf(NULL == m_prgBuckets, E_UNEXPECTED);
+		if(0 == m_cItems || rc.left > rc.right || rc.top > rc.bottom)
+			goto Cleanup;
+
+		for(sysint i = 0; i < m_aOverflow.Length(); i++)
+		{
+			const ENTRY& entry = m_aEntries[m_aOverflow[i]];
+
+			if(SpatialQuery::RectsOverlap(entry.rc, rc))
+				Check(paItems->Append(entry.value));
+		}
+
+		GetCellSpan(rc, &xMin, &yMin, &xMax, &yMax);
+		xMin = max(xMin, m_xCellMin);
+		yMin = max(yMin, m_yCellMin);
+		xMax = min(xMax, m_xCellMax);
+		yMax = min(yMax, m_yCellMax);
+		if(xMin > xMax || yMin > yMax)
+			goto Cleanup;
+
+		// Large queries are cheaper as a scan of the entries than a walk of the cells.
+		if(CountCells(xMin, yMin, xMax, yMax) > m_aEntries.Length())
+		{
+			for(sysint i = 0; i < m_aEntries.Length(); i++)
+			{
+				const ENTRY& entry = m_aEntries[i];
+
+				if(entry.fUsed && -1 == entry.iOverflow && SpatialQuery::RectsOverlap(entry.rc, rc))
+					Check(paItems->Append(entry.value));
+			}
+			goto Cleanup;
+		}
+
+		NextStamp();
+		for(INT y = yMin; y <= yMax; y++)
+		{
+			for(INT x = xMin; x <= xMax; x++)
+			{
+				for(LONG iRef = m_prgBuckets[HashCell(x, y)]; SPATIAL_GRID_NO_REF != iRef; iRef = m_aRefs[iRef].iNext)
+				{
+					const CELL_REF& ref = m_aRefs[iRef];
+					ENTRY* pEntry;
+
+					if(ref.x != x || ref.y != y)
+						continue;
+
+					pEntry = &m_aEntries[ref.nEntry];
+					if(pEntry->nStamp == m_nStamp)
+						continue;
+
+					pEntry->nStamp = m_nStamp;
+					if(SpatialQuery::RectsOverlap(pEntry->rc, rc))
+						Check(paItems->Append(pEntry->value));
+				}
+			}
+		}
+
+	Cleanup:
+		return hr;
+	}
+
+	// Appends up to cNearest items, closest first, measured from the point to the
+	// nearest point of each item's rectangle.  Rings of cells are searched outward
+	// until no unseen item could be closer than the ones already found.
+	HRESULT FindNearest (TCoord x, TCoord y, sysint cNearest, TArray<T>* paItems)
+	{
+		HRESULT hr = S_OK;
+		TSpatialNearest<T, TCoord> nearest(cNearest);
+		INT xCell, yCell, nFirstRing;
+		sysint cSeen = 0;
+
+		CheckIf(NULL == m_prgBuckets || 0 > cNearest, E_INVALIDARG);
+		if(0 == cNearest || 0 == m_cItems)
+			goto Cleanup;
+
+		for(sysint i = 0; i < m_aOverflow.Length(); i++)
+		{
+			const ENTRY& entry = m_aEntries[m_aOverflow[i]];
+
+			cSeen++;
+			Check(nearest.Offer(SpatialQuery::DistanceSquared(entry.rc, x, y), entry.value));
+		}
+
+		// The cells only need searching for items that are listed in them.
+		if(cSeen < m_cItems)
+		{
+			xCell = CellFromCoord(x);
+			yCell = CellFromCoord(y);
+			NextStamp();
+
+			// Rings that can't reach the occupied cells are skipped.
+			nFirstRing = max(max(m_xCellMin - xCell, xCell - m_xCellMax), max(m_yCellMin - yCell, yCell - m_yCellMax));
+
+			for(INT nRing = max(nFirstRing, 0); ; nRing++)
+			{
+				INT xMin = xCell - nRing, xMax = xCell + nRing;
+				INT yMin = yCell - nRing, yMax = yCell + nRing;
+
+				for(INT yRing = max(yMin, m_yCellMin); yRing <= min(yMax, m_yCellMax); yRing++)
+				{
+					// Only the first and last rows are walked in full.
+					if(yRing == yMin || yRing == yMax)
+					{
+						for(INT xRing = max(xMin, m_xCellMin); xRing <= min(xMax, m_xCellMax); xRing++)
+							Check(OfferCell(xRing, yRing, x, y, &nearest, &cSeen));
+					}
+					else
+					{
+						if(xMin >= m_xCellMin)
+							Check(OfferCell(xMin, yRing, x, y, &nearest, &cSeen));
+						if(xMax <= m_xCellMax)
+							Check(OfferCell(xMax, yRing, x, y, &nearest, &cSeen));
+					}
+				}
+
+				if(cSeen == m_cItems)
+					break;
+				if(xMin <= m_xCellMin && yMin <= m_yCellMin && xMax >= m_xCellMax && yMax >= m_yCellMax)
+					break;
+
+				// Anything unseen lies entirely outside the rings searched so far.
+				if(nearest.IsFull())
+				{
+					TCoord Bound = min(min(x - static_cast<TCoord>(xMin) * m_CellSize, static_cast<TCoord>(xMax + 1) * m_CellSize - x),
+						min(y - static_cast<TCoord>(yMin) * m_CellSize, static_cast<TCoord>(yMax + 1) * m_CellSize - y));
+
+					if(nearest.GetWorst() <= Bound * Bound)
+						break;
+				}
+			}
+		}
+
+		Check(nearest.CopyTo(paItems));
+
+	Cleanup:
+		return hr;
+	}
+
+private:
+	inline BOOL IsHandle (sysint nHandle) const
+	{
+		return 0 <= nHandle && nHandle < m_aEntries.Length() && m_aEntries[nHandle].fUsed;
+	}
+
+	inline INT CellFromCoord (TCoord v) const
+	{
+		DOUBLE dblCell = floor(static_cast<DOUBLE>(v) / static_cast<DOUBLE>(m_CellSize));
+
+		if(dblCell < static_cast<DOUBLE>(INT_MIN / 2))
+			return INT_MIN / 2;
+		if(dblCell > static_cast<DOUBLE>(INT_MAX / 2))
+			return INT_MAX / 2;
+		return static_cast<INT>(dblCell);
+	}
+
+	static inline LONGLONG CountCells (INT xMin, INT yMin, INT xMax, INT yMax)
+	{
+		return (static_cast<LONGLONG>(xMax) - xMin + 1) * (static_cast<LONGLONG>(yMax) - yMin + 1);
+	}
+
+	inline VOID GetCellSpan (const TRect& rc, __out INT* pxMin, __out INT* pyMin, __out INT* pxMax, __out INT* pyMax) const
+	{
+		*pxMin = CellFromCoord(rc.left);
+		*pyMin = CellFromCoord(rc.top);
+		*pxMax = CellFromCoord(rc.right);
+		*pyMax = CellFromCoord(rc.bottom);
+	}
+
+	inline ULONG HashCell (INT x, INT y) const
+	{
+		return ((static_cast<ULONG>(x) * 0x8DA6B343) ^ (static_cast<ULONG>(y) * 0xD8163841)) & m_nBucketMask;
+	}
+
+	HRESULT OfferCell (INT xCell, INT yCell, TCoord x, TCoord y, TSpatialNearest<T, TCoord>* pNearest, sysint* pcSeen)
+	{
+		HRESULT hr = S_OK;
+
+		for(LONG iRef = m_prgBuckets[HashCell(xCell, yCell)]; SPATIAL_GRID_NO_REF != iRef; iRef = m_aRefs[iRef].iNext)
+		{
+			const CELL_REF& ref = m_aRefs[iRef];
+			ENTRY* pEntry;
+
+			if(ref.x != xCell || ref.y != yCell)
+				continue;
+
+			pEntry = &m_aEntries[ref.nEntry];
+			if(pEntry->nStamp == m_nStamp)
+				continue;
+
+			pEntry->nStamp = m_nStamp;
+			(*pcSeen)++;
+			Check(pNearest->Offer(SpatialQuery::DistanceSquared(pEntry->rc, x, y), pEntry->value));
+		}
+
+	Cleanup:
+		return hr;
+	}
+
+	VOID NextStamp (VOID)
+	{
+		// Clear every stamp when the counter wraps, so no entry looks already visited.
+		if(0 == ++m_nStamp)
+		{
+			for(sysint i = 0; i < m_aEntries.Length(); i++)
+				m_aEntries[i].nStamp = 0;
+			m_nStamp = 1;
+		}
+	}
+
+	HRESULT AddRefs (sysint nEntry)
+	{
+		HRESULT hr = S_OK;
+		ENTRY* pEntry = &m_aEntries[nEntry];
+		INT xMin = pEntry->xMin, yMin = pEntry->yMin, xMax = pEntry->xMax, yMax = pEntry->yMax;
+
+		if(CountCells(xMin, yMin, xMax, yMax) > SPATIAL_GRID_MAX_CELLS)
+		{
+			Check(m_aOverflow.Append(nEntry));
+			pEntry->iOverflow = m_aOverflow.Length() - 1;
+			goto Cleanup;
+		}
+
+		for(INT y = yMin; y <= yMax; y++)
+		{
+			for(INT x = xMin; x <= xMax; x++)
+			{
+				ULONG nBucket = HashCell(x, y);
+				LONG iRef;
+				CELL_REF* pRef;
+
+				if(SPATIAL_GRID_NO_REF != m_iFreeRef)
+				{
+					iRef = m_iFreeRef;
+					pRef = &m_aRefs[iRef];
+					m_iFreeRef = pRef->iNext;
+				}
+				else
+				{
+					iRef = static_cast<LONG>(m_aRefs.Length());
+					hr = m_aRefs.AppendSlot(&pRef);
+					if(FAILED(hr))
+					{
+						// Cells that were never reached are simply not found.
+						RemoveRefs(nEntry);
+						goto Cleanup;
+					}
+				}
+
+				pRef->x = x;
+				pRef->y = y;
+				pRef->nEntry = nEntry;
+				pRef->iNext = m_prgBuckets[nBucket];
+				m_prgBuckets[nBucket] = iRef;
+			}
+		}
+
+		m_xCellMin = min(m_xCellMin, xMin);
+		m_yCellMin = min(m_yCellMin, yMin);
+		m_xCellMax = max(m_xCellMax, xMax);
+		m_yCellMax = max(m_yCellMax, yMax);
+
+	Cleanup:
+		return hr;
+	}
+
+	VOID RemoveRefs (sysint nEntry)
+	{
+		ENTRY& entry = m_aEntries[nEntry];
+
+		if(-1 != entry.iOverflow)
+		{
+			sysint nLast;
+
+			// The last overflow item takes this one's place.
+			m_aOverflow.Remove(m_aOverflow.Length() - 1, &nLast);
+			if(nLast != nEntry)
+			{
+				m_aOverflow[entry.iOverflow] = nLast;
+				m_aEntries[nLast].iOverflow = entry.iOverflow;
+			}
+			entry.iOverflow = -1;
+			return;
+		}
+
+		for(INT y = entry.yMin; y <= entry.yMax; y++)
+		{
+			for(INT x = entry.xMin; x <= entry.xMax; x++)
+			{
+				LONG* piRef = m_prgBuckets + HashCell(x, y);
+
+				while(SPATIAL_GRID_NO_REF != *piRef)
+				{
+					CELL_REF* pRef = &m_aRefs[*piRef];
+
+					if(pRef->nEntry == nEntry && pRef->x == x && pRef->y == y)
+					{
+						LONG iRef = *piRef;
+
+						*piRef = pRef->iNext;
+						pRef->iNext = m_iFreeRef;
+						m_iFreeRef = iRef;
+						break;
+					}
+					piRef = &pRef->iNext;
+				}
+			}
+		}
+	}
+
+	VOID FreeEntry (sysint nEntry)
+	{
+		ENTRY* pEntry = &m_aEntries[nEntry];
+
+		pEntry->fUsed = FALSE;
+		pEntry->nNextFree = m_nFreeEntry;
+		m_nFreeEntry = nEntry;
+		m_cItems--;
+	}
+};
@@ -0,0 +1,281 @@
+#include <windows.h>
+#include "..\Core\CoreDefs.h"
+#include "SpatialIndexBenchmark.h"
+
+#define	SPATIAL_BENCHMARK_ITEMS			10000
+#define	SPATIAL_BENCHMARK_QUERIES		10000
+#define	SPATIAL_BENCHMARK_WORLD			1000.0
+#define	SPATIAL_BENCHMARK_ITEM_SIZE		8.0
+#define	SPATIAL_BENCHMARK_QUERY_SIZE	32.0
+#define	SPATIAL_BENCHMARK_NEAREST		8
+#define	SPATIAL_BENCHMARK_LARGE_ITEMS	1000000
+#define	SPATIAL_BENCHMARK_LARGE_WORLD	10000.0
+#define	SPATIAL_BENCHMARK_LINEAR_LIMIT	100000
+#define	SPATIAL_BENCHMARK_RAY_LENGTH	4.0f		// In multiples of the direction, which is up to half the query size
+
+// Cheap, repeatable pattern so every run uses the same rectangles
+static inline DOUBLE NextPattern (ULONG& nSeed)
+{
+	nSeed = nSeed * 1664525 + 1013904223;
+	return static_cast<DOUBLE>(nSeed >> 8) / static_cast<DOUBLE>(1 << 24);
+}
+
+static VOID RandomRect (ULONG& nSeed, DOUBLE dblWorldSize, DOUBLE dblMaxSize, __out DBLRECT* prc)
+{
+	prc->left = NextPattern(nSeed) * dblWorldSize;
+	prc->top = NextPattern(nSeed) * dblWorldSize;
+	prc->right = prc->left + NextPattern(nSeed) * dblMaxSize;
+	prc->bottom = prc->top + NextPattern(nSeed) * dblMaxSize;
+}
+
+static const BENCHMARK_COLUMN c_rgColumns[] =
+{
+	{ "index", "index", BENCHMARK_COLUMN_STRING, offsetof(SPATIAL_INDEX_BENCHMARK_RESULT, pcszName) },
+	{ "items", "items", BENCHMARK_COLUMN_SIZE, offsetof(SPATIAL_INDEX_BENCHMARK_RESULT, cItems) },
+	{ "queries", "queries", BENCHMARK_COLUMN_SIZE, offsetof(SPATIAL_INDEX_BENCHMARK_RESULT, cQueries) },
+	{ "iterations", "iterations", BENCHMARK_COLUMN_ULONGLONG, offsetof(SPATIAL_INDEX_BENCHMARK_RESULT, cIterations) },
+	{ "queries_per_second", "queriesPerSecond", BENCHMARK_COLUMN_RATE, offsetof(SPATIAL_INDEX_BENCHMARK_RESULT, dblQueriesPerSecond) }
+};
+
+class CSpatialIndexBenchmark::CWorkload : public IBenchmarkWorkload
+{
+public:
+	CSpatialIndexBenchmark* m_pBenchmark;
+	MODE m_eMode;
+
+	virtual HRESULT RunBatch (ULONGLONG cIterations);
+};
+
+HRESULT CSpatialIndexBenchmark::CWorkload::RunBatch (ULONGLONG cIterations)
+{
+	HRESULT hr = S_OK;
+
+	for(ULONGLONG n = 0; n < cIterations; n++)
+		Check(m_pBenchmark->QueryAll(m_eMode));
+
+Cleanup:
+	return hr;
+}
+
+CSpatialIndexBenchmark::CSpatialIndexBenchmark (DWORD msMinimum) :
+	m_msMinimum(msMinimum),
+	m_prgItems(NULL),
+	m_cItems(0),
+	m_prgQueries(NULL),
+	m_cQueries(0)
+{
+}
+
+CSpatialIndexBenchmark::~CSpatialIndexBenchmark ()
+{
+	FreeData();
+}
+
+HRESULT CSpatialIndexBenchmark::Prepare (SIZE_T cItems, SIZE_T cQueries, DOUBLE dblWorldSize, DOUBLE dblItemSize, DOUBLE dblQuerySize)
+{
+	HRESULT hr;
+	ULONG nSeed = 0x6C078965;
+	DBLRECT rcWorld;
+	FRECT* prgRects = NULL;
+
+	CheckIf(0 == cItems || 0 == cQueries || ULONG_MAX < cItems, E_INVALIDARG);
+	CheckIf(0 >= dblWorldSize || 0 > dblItemSize || 0 > dblQuerySize, E_INVALIDARG);
+
+	FreeData();
+
+	m_prgItems = __new DBLRECT[cItems];
+	CheckAlloc(m_prgItems);
+	m_prgQueries = __new DBLRECT[cQueries];
+	CheckAlloc(m_prgQueries);
+
+	for(SIZE_T i = 0; i < cItems; i++)
+		RandomRect(nSeed, dblWorldSize, dblItemSize, m_prgItems + i);
+	for(SIZE_T i = 0; i < cQueries; i++)
+		RandomRect(nSeed, dblWorldSize, dblQuerySize, m_prgQueries + i);
+
+	// Cells about the size of the items, with roughly one bucket per item
+	Check(m_grid.Initialize(max(dblItemSize, dblWorldSize / 1024), static_cast<ULONG>(min(cItems, static_cast<SIZE_T>(0x1000000)))));
+
+	rcWorld.left = 0;
+	rcWorld.top = 0;
+	rcWorld.right = dblWorldSize;
+	rcWorld.bottom = dblWorldSize;
+	Check(m_quadtree.Initialize(rcWorld, 8));
+
+	for(SIZE_T i = 0; i < cItems; i++)
+	{
+		sysint nHandle;
+
+		Check(m_grid.Insert(m_prgItems[i], i, &nHandle));
+		Check(m_quadtree.Insert(m_prgItems[i], i, &nHandle));
+	}
+
+	prgRects = __new FRECT[cItems];
+	CheckAlloc(prgRects);
+	for(SIZE_T i = 0; i < cItems; i++)
+	{
+		prgRects[i].left = static_cast<FLOAT>(m_prgItems[i].left);
+		prgRects[i].top = static_cast<FLOAT>(m_prgItems[i].top);
+		prgRects[i].right = static_cast<FLOAT>(m_prgItems[i].right);
+		prgRects[i].bottom = static_cast<FLOAT>(m_prgItems[i].bottom);
+	}
+	Check(m_rtree.Build(prgRects, static_cast<ULONG>(cItems)));
+
+	m_cItems = cItems;
+	m_cQueries = cQueries;
+
+Cleanup:
+	__delete_array prgRects;
+	if(FAILED(hr))
+		FreeData();
+	return hr;
+}
+
+HRESULT CSpatialIndexBenchmark::Run (VOID)
+{
+	HRESULT hr;
+
+	if(0 == m_cQueries)
+		Check(Prepare(SPATIAL_BENCHMARK_ITEMS, SPATIAL_BENCHMARK_QUERIES, SPATIAL_BENCHMARK_WORLD, SPATIAL_BENCHMARK_ITEM_SIZE, SPATIAL_BENCHMARK_QUERY_SIZE));
+
+	if(SPATIAL_BENCHMARK_LINEAR_LIMIT >= m_cItems)
+		Check(Measure("Linear scan (rect)", MODE_LINEAR_RECT));
+	Check(Measure("TSpatialGrid (rect)", MODE_GRID_RECT));
+	Check(Measure("TLooseQuadtree (rect)", MODE_QUADTREE_RECT));
+	Check(Measure("CStaticRTree (rect)", MODE_RTREE_RECT));
+	Check(Measure("TSpatialGrid (nearest)", MODE_GRID_NEAREST));
+	Check(Measure("TLooseQuadtree (nearest)", MODE_QUADTREE_NEAREST));
+	Check(Measure("CStaticRTree (ray)", MODE_RTREE_RAY));
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CSpatialIndexBenchmark::RunStandardSuite (VOID)
+{
+	HRESULT hr;
+
+	Check(Prepare(SPATIAL_BENCHMARK_ITEMS, SPATIAL_BENCHMARK_QUERIES, SPATIAL_BENCHMARK_WORLD, SPATIAL_BENCHMARK_ITEM_SIZE, SPATIAL_BENCHMARK_QUERY_SIZE));
+	Check(Run());
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CSpatialIndexBenchmark::RunLargeSuite (VOID)
+{
+	HRESULT hr;
+
+	Check(Prepare(SPATIAL_BENCHMARK_LARGE_ITEMS, SPATIAL_BENCHMARK_QUERIES, SPATIAL_BENCHMARK_LARGE_WORLD, SPATIAL_BENCHMARK_ITEM_SIZE, SPATIAL_BENCHMARK_QUERY_SIZE));
+	Check(Run());
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CSpatialIndexBenchmark::Write (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat)
+{
+	return Benchmark::TWrite(pStream, eFormat, c_rgColumns, m_aResults);
+}
+
+VOID CSpatialIndexBenchmark::FreeData (VOID)
+{
+	SafeDeleteArray(m_prgQueries);
+	SafeDeleteArray(m_prgItems);
+	m_grid.Clear();
+	m_quadtree.Clear();
+	m_rtree.Clear();
+	m_cItems = 0;
+	m_cQueries = 0;
+}
+
+HRESULT CSpatialIndexBenchmark::QueryAll (MODE eMode)
+{
+	HRESULT hr = S_OK;
+
+	for(SIZE_T i = 0; i < m_cQueries; i++)
+	{
+		const DBLRECT& rcQuery = m_prgQueries[i];
+		DOUBLE x = rcQuery.left + (rcQuery.right - rcQuery.left) / 2;
+		DOUBLE y = rcQuery.top + (rcQuery.bottom - rcQuery.top) / 2;
+
+		m_aFound.Clear();
+		switch(eMode)
+		{
+		case MODE_LINEAR_RECT:
+			for(SIZE_T n = 0; n < m_cItems; n++)
+			{
+				if(SpatialQuery::RectsOverlap(m_prgItems[n], rcQuery))
+					Check(m_aFound.Append(n));
+			}
+			break;
+		case MODE_GRID_RECT:
+			Check(m_grid.FindInRect(rcQuery, &m_aFound));
+			break;
+		case MODE_GRID_NEAREST:
+			Check(m_grid.FindNearest(x, y, SPATIAL_BENCHMARK_NEAREST, &m_aFound));
+			break;
+		case MODE_QUADTREE_RECT:
+			Check(m_quadtree.FindInRect(rcQuery, &m_aFound));
+			break;
+		case MODE_QUADTREE_NEAREST:
+			Check(m_quadtree.FindNearest(x, y, SPATIAL_BENCHMARK_NEAREST, &m_aFound));
+			break;
+		case MODE_RTREE_RECT:
+			{
+				FRECT rc;
+
+				rc.left = static_cast<FLOAT>(rcQuery.left);
+				rc.top = static_cast<FLOAT>(rcQuery.top);
+				rc.right = static_cast<FLOAT>(rcQuery.right);
+				rc.bottom = static_cast<FLOAT>(rcQuery.bottom);
+
+				m_aHits.Clear();
+				Check(m_rtree.FindInRect(rc, &m_aHits));
+			}
+			break;
+		case MODE_RTREE_RAY:
+			{
+				// The direction comes from the query's own size, so rays point every which way.
+				FLOAT dx = static_cast<FLOAT>(rcQuery.right - x);
+				FLOAT dy = static_cast<FLOAT>(rcQuery.bottom - y);
+				ULONG nItem;
+				FLOAT t;
+
+				if(0 == (i & 1)) dx = -dx;
+				if(0 == (i & 2)) dy = -dy;
+
+				hr = m_rtree.Raycast(static_cast<FLOAT>(x), static_cast<FLOAT>(y), dx, dy, SPATIAL_BENCHMARK_RAY_LENGTH, &nItem, &t);
+				if(HRESULT_FROM_WIN32(ERROR_NOT_FOUND) == hr)
+					hr = S_OK;
+				Check(hr);
+			}
+			break;
+		}
+	}
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CSpatialIndexBenchmark::Measure (PCSTR pcszName, MODE eMode)
+{
+	HRESULT hr;
+	CWorkload workload;
+	BENCHMARK_TIMING timing;
+	SPATIAL_INDEX_BENCHMARK_RESULT* pResult;
+
+	workload.m_pBenchmark = this;
+	workload.m_eMode = eMode;
+	Check(Benchmark::Measure(&workload, m_msMinimum, &timing));
+
+	Check(m_aResults.AppendSlot(&pResult));
+	pResult->pcszName = pcszName;
+	pResult->cItems = m_cItems;
+	pResult->cQueries = m_cQueries;
+	pResult->cIterations = timing.cIterations;
+	pResult->dblQueriesPerSecond = static_cast<DOUBLE>(timing.cIterations) * static_cast<DOUBLE>(m_cQueries) / timing.dblSeconds;
+
+Cleanup:
+	return hr;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "..\Core\Array.h"
+#include "..\Util\Benchmark.h"
+#include "SpatialGrid.h"
+#include "LooseQuadtree.h"
+#include "StaticRTree.h"
+
+// Query throughput of the 2D spatial indexes against a linear scan of the same items.
+// A repeatable set of small rectangles and query rectangles is generated once, and the
+// whole set of queries is run repeatedly until the minimum measuring time has elapsed.
+
+struct SPATIAL_INDEX_BENCHMARK_RESULT
+{
+	PCSTR pcszName;
+	SIZE_T cItems;
+	SIZE_T cQueries;
+	ULONGLONG cIterations;
+	DOUBLE dblQueriesPerSecond;
+};
+
+class CSpatialIndexBenchmark
+{
+private:
+	enum MODE
+	{
+		MODE_LINEAR_RECT,		// Every item tested against every query
+		MODE_GRID_RECT,
+		MODE_GRID_NEAREST,
+		MODE_QUADTREE_RECT,
+		MODE_QUADTREE_NEAREST,
+		MODE_RTREE_RECT,
+		MODE_RTREE_RAY			// Nearest hit along a short segment from each query's center
+	};
+
+	class CWorkload;
+
+	TArray<SPATIAL_INDEX_BENCHMARK_RESULT> m_aResults;
+	DWORD m_msMinimum;
+
+	DBLRECT* m_prgItems;
+	SIZE_T m_cItems;
+	DBLRECT* m_prgQueries;
+	SIZE_T m_cQueries;
+
+	TSpatialGrid<SIZE_T> m_grid;
+	TLooseQuadtree<SIZE_T> m_quadtree;
+	CStaticRTree m_rtree;
+	TArray<SIZE_T> m_aFound;
+	TArray<ULONG> m_aHits;
+
+public:
+	CSpatialIndexBenchmark (DWORD msMinimum = 200);
+	~CSpatialIndexBenchmark ();
+
+	// Scatters cItems rectangles of up to dblItemSize across a square world of
+	// dblWorldSize, and picks cQueries rectangles of up to dblQuerySize.
+	HRESULT Prepare (SIZE_T cItems, SIZE_T cQueries, DOUBLE dblWorldSize, DOUBLE dblItemSize, DOUBLE dblQuerySize);
+
+	// Measures rectangle queries with each index and with a linear scan, eight-nearest
+	// queries from the center of each query rectangle, and raycasts against the R-tree.
+	// The linear scan is skipped for more than 100,000 items.
+	HRESULT Run (VOID);
+
+	// 10,000 sprite-sized items and 10,000 queries in a 1,000 unit world
+	HRESULT RunStandardSuite (VOID);
+
+	// 1,000,000 items at the same density, in a 10,000 unit world
+	HRESULT RunLargeSuite (VOID);
+
+	HRESULT Write (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat);
+
+	inline sysint Length (VOID) const { return m_aResults.Length(); }
+	inline const SPATIAL_INDEX_BENCHMARK_RESULT* GetResult (sysint n) const { return &m_aResults[n]; }
+	inline VOID Clear (VOID) { m_aResults.Clear(); }
+
+private:
+	VOID FreeData (VOID);
+	HRESULT QueryAll (MODE eMode);
+	HRESULT Measure (PCSTR pcszName, MODE eMode);
+};
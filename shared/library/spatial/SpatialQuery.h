@@ -0,0 +1,92 @@
+#pragma once
+
+#include "..\Core\Array.h"
+#include "GeometryTypes.h"
+
+// Helpers shared by the 2D spatial indexes.  TRect is DBLRECT or FRECT, with TCoord
+// matching its fields.  Rectangles are closed: a point on an edge is inside, and two
+// rectangles that only share an edge overlap.
+
+namespace SpatialQuery
+{
+	template<typename TRect>
+	inline BOOL RectsOverlap (const TRect& rcA, const TRect& rcB)
+	{
+		return rcA.left <= rcB.right && rcB.left <= rcA.right && rcA.top <= rcB.bottom && rcB.top <= rcA.bottom;
+	}
+
+	template<typename TRect, typename TCoord>
+	inline BOOL RectContains (const TRect& rc, TCoord x, TCoord y)
+	{
+		return rc.left <= x && x <= rc.right && rc.top <= y && y <= rc.bottom;
+	}
+
+	// Squared distance from the point to the nearest point of the rectangle
+	template<typename TRect, typename TCoord>
+	inline TCoord DistanceSquared (const TRect& rc, TCoord x, TCoord y)
+	{
+		TCoord dx = x < rc.left ? rc.left - x : (x > rc.right ? x - rc.right : 0);
+		TCoord dy = y < rc.top ? rc.top - y : (y > rc.bottom ? y - rc.bottom : 0);
+		return dx * dx + dy * dy;
+	}
+}
+
+// The nearest items found so far by a k-nearest search, closest first
+template<typename T, typename TCoord>
+class TSpatialNearest
+{
+private:
+	struct CANDIDATE
+	{
+		TCoord DistanceSquared;
+		T value;
+	};
+
+	TArray<CANDIDATE> m_aCandidates;
+	sysint m_cMax;
+
+public:
+	TSpatialNearest (sysint cMax) : m_cMax(cMax) {}
+
+	inline BOOL IsFull (VOID) const { return m_aCandidates.Length() == m_cMax; }
+	inline TCoord GetWorst (VOID) const { return m_aCandidates[m_aCandidates.Length() - 1].DistanceSquared; }
+
+	// Keeps the item if it's closer than the worst candidate, or if there's still room.
+	HRESULT Offer (TCoord DistanceSquared, const T& value)
+	{
+		HRESULT hr = S_FALSE;
+		sysint n = m_aCandidates.Length();
+
+		if(IsFull())
+		{
+			if(DistanceSquared >= GetWorst())
+				goto Cleanup;
+			m_aCandidates.Remove(--n, NULL);
+		}
+
+		while(0 < n && DistanceSquared < m_aCandidates[n - 1].DistanceSquared)
+			n--;
+
+		{
+			CANDIDATE candidate;
+
+			candidate.DistanceSquared = DistanceSquared;
+			candidate.value = value;
+			Check(m_aCandidates.InsertAt(candidate, n));
+		}
+
+	Cleanup:
+		return hr;
+	}
+
+	HRESULT CopyTo (TArray<T>* paItems) const
+	{
+		HRESULT hr = S_OK;
+
+		for(sysint i = 0; i < m_aCandidates.Length(); i++)
+			Check(paItems->Append(m_aCandidates[i].value));
+
+	Cleanup:
+		return hr;
+	}
+};
@@ -0,0 +1,394 @@
+#include <windows.h>
+#include <math.h>
+#include "..\Core\CoreDefs.h"
+#include "..\Sorting.h"
+#include "StaticRTree.h"
+
+CStaticRTree::CStaticRTree () :
+	m_prgNodes(NULL),
+	m_cNodes(0),
+	m_cLeaves(0),
+	m_nHeight(0),
+	m_prgRects(NULL),
+	m_prgItems(NULL),
+	m_cItems(0)
+{
+}
+
+CStaticRTree::~CStaticRTree ()
+{
+	Clear();
+}
+
+HRESULT CStaticRTree::Build (const FRECT* prgRects, ULONG cRects)
+{
+	HRESULT hr = S_OK;
+	BUILD_ENTRY* prgEntries = NULL;
+	NODE* prgPacked = NULL;
+	ULONG cNodes = 0, cLevel, nLevel, cPrevious;
+	INT nHeight = 0;
+
+	CheckIf(NULL == prgRects && 0 < cRects, E_INVALIDARG);
+
+	Clear();
+	if(0 == cRects)
+		goto Cleanup;
+
+	for(ULONG i = 0; i < cRects; i++)
+		CheckIf(prgRects[i].left > prgRects[i].right || prgRects[i].top > prgRects[i].bottom, E_INVALIDARG);
+
+	// Count the nodes of every level so the whole tree fits in one allocation.
+	cLevel = cRects;
+	do
+	{
+		cLevel = (cLevel + RTREE_NODE_SIZE - 1) / RTREE_NODE_SIZE;
+		cNodes += cLevel;
+		nHeight++;
+	} while(1 < cLevel);
+	CheckIf(RTREE_MAX_HEIGHT < nHeight, E_INVALIDARG);
+
+	m_prgNodes = __new NODE[cNodes];
+	CheckAlloc(m_prgNodes);
+	m_prgRects = __new FRECT[cRects];
+	CheckAlloc(m_prgRects);
+	m_prgItems = __new ULONG[cRects];
+	CheckAlloc(m_prgItems);
+	prgEntries = __new BUILD_ENTRY[cRects];
+	CheckAlloc(prgEntries);
+
+	for(ULONG i = 0; i < cRects; i++)
+	{
+		BUILD_ENTRY& entry = prgEntries[i];
+
+		entry.rc = prgRects[i];
+		entry.x = (entry.rc.left + entry.rc.right) / 2;
+		entry.y = (entry.rc.top + entry.rc.bottom) / 2;
+		entry.n = i;
+	}
+
+	SortTiles(prgEntries, cRects);
+	for(ULONG i = 0; i < cRects; i++)
+	{
+		m_prgRects[i] = prgEntries[i].rc;
+		m_prgItems[i] = prgEntries[i].n;
+	}
+
+	// Each level is packed from the one below it, starting with the rectangles.
+	// Packing reorders the nodes of the level below, which only the new level
+	// refers to, so every parent's children end up next to each other.
+	nLevel = 0;
+	cPrevious = cRects;
+	for(INT nDepth = 0; nDepth < nHeight; nDepth++)
+	{
+		ULONG nFirst = nLevel + (0 == nDepth ? 0 : cPrevious);
+
+		if(0 < nDepth)
+		{
+			for(ULONG i = 0; i < cPrevious; i++)
+			{
+				BUILD_ENTRY& entry = prgEntries[i];
+
+				entry.rc = m_prgNodes[nLevel + i].rcBounds;
+				entry.x = (entry.rc.left + entry.rc.right) / 2;
+				entry.y = (entry.rc.top + entry.rc.bottom) / 2;
+				entry.n = nLevel + i;
+			}
+
+			SortTiles(prgEntries, cPrevious);
+
+			if(NULL == prgPacked)
+			{
+				prgPacked = __new NODE[m_cLeaves];
+				CheckAlloc(prgPacked);
+			}
+			for(ULONG i = 0; i < cPrevious; i++)
+				prgPacked[i] = m_prgNodes[prgEntries[i].n];
+			CopyMemory(m_prgNodes + nLevel, prgPacked, cPrevious * sizeof(NODE));
+		}
+
+		cLevel = 0;
+		for(ULONG i = 0; i < cPrevious; i += RTREE_NODE_SIZE)
+		{
+			NODE& node = m_prgNodes[nFirst + cLevel++];
+
+			node.nFirst = (0 == nDepth ? 0 : nLevel) + i;
+			node.cChildren = min(cPrevious - i, RTREE_NODE_SIZE);
+			node.rcBounds = prgEntries[i].rc;
+			for(ULONG n = 1; n < node.cChildren; n++)
+			{
+				const FRECT& rc = prgEntries[i + n].rc;
+
+				if(node.rcBounds.left > rc.left) node.rcBounds.left = rc.left;
+				if(node.rcBounds.top > rc.top) node.rcBounds.top = rc.top;
+				if(node.rcBounds.right < rc.right) node.rcBounds.right = rc.right;
+				if(node.rcBounds.bottom < rc.bottom) node.rcBounds.bottom = rc.bottom;
+			}
+		}
+
+		if(0 == nDepth)
+			m_cLeaves = cLevel;
+		nLevel = nFirst;
+		cPrevious = cLevel;
+	}
+
+	m_cNodes = cNodes;
+	m_nHeight = nHeight;
+	m_cItems = cRects;
+
+Cleanup:
+	__delete_array prgPacked;
+	__delete_array prgEntries;
+	if(FAILED(hr))
+		Clear();
+	return hr;
+}
+
+VOID CStaticRTree::Clear (VOID)
+{
+	SafeDeleteArray(m_prgNodes);
+	SafeDeleteArray(m_prgRects);
+	SafeDeleteArray(m_prgItems);
+	m_cNodes = 0;
+	m_cLeaves = 0;
+	m_nHeight = 0;
+	m_cItems = 0;
+}
+
+HRESULT CStaticRTree::FindInRect (const FRECT& rc, TArray<ULONG>* paItems) const
+{
+	HRESULT hr = S_OK;
+	ULONG rgStack[RTREE_STACK_SIZE];
+	INT cStack = 0;
+
+	if(0 == m_cNodes || !RectsOverlap(m_prgNodes[m_cNodes - 1].rcBounds, rc))
+		goto Cleanup;
+
+	rgStack[cStack++] = m_cNodes - 1;
+	while(0 < cStack)
+	{
+		const NODE& node = m_prgNodes[rgStack[--cStack]];
+		ULONG nEnd = node.nFirst + node.cChildren;
+
+		if(rgStack[cStack] < m_cLeaves)
+		{
+			for(ULONG n = node.nFirst; n < nEnd; n++)
+			{
+				if(RectsOverlap(m_prgRects[n], rc))
+					Check(paItems->Append(m_prgItems[n]));
+			}
+		}
+		else
+		{
+			for(ULONG n = node.nFirst; n < nEnd; n++)
+			{
+				if(RectsOverlap(m_prgNodes[n].rcBounds, rc))
+					rgStack[cStack++] = n;
+			}
+		}
+	}
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CStaticRTree::FindRayHits (FLOAT x, FLOAT y, FLOAT dx, FLOAT dy, FLOAT tMax, TArray<ULONG>* paItems) const
+{
+	HRESULT hr = S_OK;
+	ULONG rgStack[RTREE_STACK_SIZE];
+	INT cStack = 0;
+	RAY ray;
+	FLOAT t;
+
+	InitializeRay(x, y, dx, dy, &ray);
+	if(0 == m_cNodes || !IntersectRay(m_prgNodes[m_cNodes - 1].rcBounds, ray, tMax, &t))
+		goto Cleanup;
+
+	rgStack[cStack++] = m_cNodes - 1;
+	while(0 < cStack)
+	{
+		const NODE& node = m_prgNodes[rgStack[--cStack]];
+		ULONG nEnd = node.nFirst + node.cChildren;
+
+		if(rgStack[cStack] < m_cLeaves)
+		{
+			for(ULONG n = node.nFirst; n < nEnd; n++)
+			{
+				if(IntersectRay(m_prgRects[n], ray, tMax, &t))
+					Check(paItems->Append(m_prgItems[n]));
+			}
+		}
+		else
+		{
+			for(ULONG n = node.nFirst; n < nEnd; n++)
+			{
+				if(IntersectRay(m_prgNodes[n].rcBounds, ray, tMax, &t))
+					rgStack[cStack++] = n;
+			}
+		}
+	}
+
+Cleanup:
+	return hr;
+}
+
+HRESULT CStaticRTree::Raycast (FLOAT x, FLOAT y, FLOAT dx, FLOAT dy, FLOAT tMax, __out ULONG* pnItem, __out FLOAT* ptHit) const
+{
+	HRESULT hr;
+	ULONG rgStack[RTREE_STACK_SIZE];
+	FLOAT rgEnter[RTREE_STACK_SIZE];
+	INT cStack = 0;
+	ULONG nBest = 0;
+	BOOL fHit = FALSE;
+	RAY ray;
+	FLOAT t;
+
+	InitializeRay(x, y, dx, dy, &ray);
+	if(0 < m_cNodes && IntersectRay(m_prgNodes[m_cNodes - 1].rcBounds, ray, tMax, &t))
+	{
+		rgStack[0] = m_cNodes - 1;
+		rgEnter[0] = t;
+		cStack = 1;
+	}
+
+	// Children are pushed farthest first so the nearest is searched next, and every
+	// hit shortens the segment, which prunes whatever is still waiting behind it.
+	while(0 < cStack)
+	{
+		cStack--;
+		if(rgEnter[cStack] > tMax)
+			continue;
+
+		const NODE& node = m_prgNodes[rgStack[cStack]];
+		ULONG nEnd = node.nFirst + node.cChildren;
+
+		if(rgStack[cStack] < m_cLeaves)
+		{
+			for(ULONG n = node.nFirst; n < nEnd; n++)
+			{
+				if(!IntersectRay(m_prgRects[n], ray, tMax, &t))
+					continue;
+
+				// Ties go to the lowest index, so the result doesn't depend on the packing.
+				if(fHit && t == tMax && m_prgItems[n] > m_prgItems[nBest])
+					continue;
+
+				tMax = t;
+				nBest = n;
+				fHit = TRUE;
+			}
+		}
+		else
+		{
+			INT nBase = cStack;
+
+			for(ULONG n = node.nFirst; n < nEnd; n++)
+			{
+				INT nSlot;
+
+				if(!IntersectRay(m_prgNodes[n].rcBounds, ray, tMax, &t))
+					continue;
+
+				// Insertion sort on entry distance, farthest at the bottom.
+				for(nSlot = cStack; nSlot > nBase && rgEnter[nSlot - 1] < t; nSlot--)
+				{
+					rgStack[nSlot] = rgStack[nSlot - 1];
+					rgEnter[nSlot] = rgEnter[nSlot - 1];
+				}
+				rgStack[nSlot] = n;
+				rgEnter[nSlot] = t;
+				cStack++;
+			}
+		}
+	}
+
+	CheckIf(!fHit, HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+	*pnItem = m_prgItems[nBest];
+	*ptHit = tMax;
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
+
+VOID CStaticRTree::SortTiles (BUILD_ENTRY* prgEntries, ULONG cEntries)
+{
+	ULONG cNodes = (cEntries + RTREE_NODE_SIZE - 1) / RTREE_NODE_SIZE;
+	ULONG cSlices = static_cast<ULONG>(ceil(sqrt(static_cast<DOUBLE>(cNodes))));
+	ULONG cPerSlice = cSlices * RTREE_NODE_SIZE;
+
+	Sorting::TQuickSort(prgEntries, cEntries, CompareX, NULL);
+	for(ULONG i = 0; i < cEntries; i += cPerSlice)
+		Sorting::TQuickSort(prgEntries + i, min(cEntries - i, cPerSlice), CompareY, NULL);
+}
+
+INT WINAPI CStaticRTree::CompareX (BUILD_ENTRY* plhEntry, BUILD_ENTRY* prhEntry, PVOID pParam)
+{
+	if(plhEntry->x < prhEntry->x)
+		return -1;
+	if(plhEntry->x > prhEntry->x)
+		return 1;
+	return 0;
+}
+
+INT WINAPI CStaticRTree::CompareY (BUILD_ENTRY* plhEntry, BUILD_ENTRY* prhEntry, PVOID pParam)
+{
+	if(plhEntry->y < prhEntry->y)
+		return -1;
+	if(plhEntry->y > prhEntry->y)
+		return 1;
+	return 0;
+}
+
+VOID CStaticRTree::InitializeRay (FLOAT x, FLOAT y, FLOAT dx, FLOAT dy, __out RAY* pRay)
+{
+	pRay->x = x;
+	pRay->y = y;
+	pRay->dx = dx;
+	pRay->dy = dy;
+	pRay->dxInverse = 0 == dx ? 0.0f : 1.0f / dx;
+	pRay->dyInverse = 0 == dy ? 0.0f : 1.0f / dy;
+}
+
+// Slab test, clipped to [0, tMax].  An axis the ray doesn't move along only
+// needs its starting coordinate to be inside the rectangle.
+BOOL CStaticRTree::IntersectRay (const FRECT& rc, const RAY& ray, FLOAT tMax, __out FLOAT* ptEnter)
+{
+	FLOAT tEnter = 0, tExit = tMax;
+
+	if(0 == ray.dx)
+	{
+		if(ray.x < rc.left || ray.x > rc.right)
+			return FALSE;
+	}
+	else
+	{
+		FLOAT t1 = (rc.left - ray.x) * ray.dxInverse;
+		FLOAT t2 = (rc.right - ray.x) * ray.dxInverse;
+
+		if(t1 > t2) { FLOAT t = t1; t1 = t2; t2 = t; }
+		if(tEnter < t1) tEnter = t1;
+		if(tExit > t2) tExit = t2;
+		if(tEnter > tExit)
+			return FALSE;
+	}
+
+	if(0 == ray.dy)
+	{
+		if(ray.y < rc.top || ray.y > rc.bottom)
+			return FALSE;
+	}
+	else
+	{
+		FLOAT t1 = (rc.top - ray.y) * ray.dyInverse;
+		FLOAT t2 = (rc.bottom - ray.y) * ray.dyInverse;
+
+		if(t1 > t2) { FLOAT t = t1; t1 = t2; t2 = t; }
+		if(tEnter < t1) tEnter = t1;
+		if(tExit > t2) tExit = t2;
+		if(tEnter > tExit)
+			return FALSE;
+	}
+
+	*ptEnter = tEnter;
+	return TRUE;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "..\Core\Array.h"
+#include "GeometryTypes.h"
+
+#define	RTREE_NODE_SIZE			16
+#define	RTREE_MAX_HEIGHT		8
+
+// Every level of the tree can leave RTREE_NODE_SIZE - 1 siblings waiting on the stack.
+#define	RTREE_STACK_SIZE		(RTREE_MAX_HEIGHT * (RTREE_NODE_SIZE - 1) + 1)
+
+// Read-only R-tree for rectangles that never change, such as level geometry and the
+// collision solids of a generated region.  Build() packs the rectangles with
+// Sort-Tile-Recursive bulk loading: they're sorted into vertical slices by center x,
+// each slice is sorted by center y, and runs of RTREE_NODE_SIZE become the leaves,
+// which are packed the same way to form each level above.  Nodes live in one flat
+// array with each node's children stored together, and the rectangles are copied in
+// leaf order.  Queries walk a fixed stack and report the caller's rectangle indexes.
+// Rectangles are closed, like those of the other spatial indexes (see SpatialQuery.h).
+
+class CStaticRTree
+{
+private:
+	struct NODE
+	{
+		FRECT rcBounds;
+		ULONG nFirst;		// First child node, or first rectangle for a leaf
+		ULONG cChildren;
+	};
+
+	struct BUILD_ENTRY
+	{
+		FRECT rc;
+		FLOAT x, y;			// Center
+		ULONG n;			// Caller's rectangle, or node being packed
+	};
+
+	struct RAY
+	{
+		FLOAT x, y;
+		FLOAT dx, dy;
+		FLOAT dxInverse, dyInverse;
+	};
+
+	NODE* m_prgNodes;
+	ULONG m_cNodes;
+	ULONG m_cLeaves;		// Leaves come first in m_prgNodes, and the root is last.
+	INT m_nHeight;
+
+	FRECT* m_prgRects;		// In leaf order
+	ULONG* m_prgItems;		// Caller's index for each of m_prgRects
+	ULONG m_cItems;
+
+public:
+	CStaticRTree ();
+	~CStaticRTree ();
+
+	HRESULT Build (const FRECT* prgRects, ULONG cRects);
+	VOID Clear (VOID);
+
+	inline ULONG GetItemCount (VOID) const { return m_cItems; }
+	inline ULONG GetNodeCount (VOID) const { return m_cNodes; }
+	inline INT GetHeight (VOID) const { return m_nHeight; }
+
+	// Appends the index of every rectangle that overlaps rc.
+	HRESULT FindInRect (const FRECT& rc, TArray<ULONG>* paItems) const;
+
+	// Appends the index of every rectangle touched by the segment from (x, y) to
+	// (x + dx * tMax, y + dy * tMax), in no particular order.
+	HRESULT FindRayHits (FLOAT x, FLOAT y, FLOAT dx, FLOAT dy, FLOAT tMax, TArray<ULONG>* paItems) const;
+
+	// Finds the rectangle the segment enters first.  The hit is at (x + dx * t, y + dy * t),
+	// and t is zero when the segment starts inside the rectangle.  Returns
+	// HRESULT_FROM_WIN32(ERROR_NOT_FOUND) if nothing is hit.
+	HRESULT Raycast (FLOAT x, FLOAT y, FLOAT dx, FLOAT dy, FLOAT tMax, __out ULONG* pnItem, __out FLOAT* ptHit) const;
+
+private:
+	static VOID SortTiles (BUILD_ENTRY* prgEntries, ULONG cEntries);
+	static INT WINAPI CompareX (BUILD_ENTRY* plhEntry, BUILD_ENTRY* prhEntry, PVOID pParam);
+	static INT WINAPI CompareY (BUILD_ENTRY* plhEntry, BUILD_ENTRY* prhEntry, PVOID pParam);
+
+	static VOID InitializeRay (FLOAT x, FLOAT y, FLOAT dx, FLOAT dy, __out RAY* pRay);
+	static BOOL IntersectRay (const FRECT& rc, const RAY& ray, FLOAT tMax, __out FLOAT* ptEnter);
+
+	static inline BOOL RectsOverlap (const FRECT& rcA, const FRECT& rcB)
+	{
+		return rcA.left <= rcB.right && rcB.left <= rcA.right && rcA.top <= rcB.bottom && rcB.top <= rcA.bottom;
+	}
+};
@@ -0,0 +1,451 @@
+#include <windows.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include "..\Core\CoreDefs.h"
+#include "ViewTransform.h"
+
+#ifdef	CORE_SSE2
+	#include <emmintrin.h>
+#endif
+
+// Screen coordinates are clamped to this before being converted to integers.
+#define	VIEW_SCREEN_LIMIT		1.0e9f
+
+// Everything the batch kernels need from the view, four lanes of input at a time
+struct PROJECT_PARAMS
+{
+	const FLOAT* prgMatrix;
+	FLOAT xCenter, yCenter;			// Center of the viewport
+	FLOAT xHalf, yHalf;				// Half the viewport size
+};
+
+struct UNPROJECT_PARAMS
+{
+	const FLOAT* prgInverse;
+	FLOAT xScale, yScale;			// Pixels to normalized device coordinates
+	FLOAT xOffset, yOffset;
+	FLOAT yPlane;
+};
+
+#ifdef	CORE_SSE2
+
+static inline __m128 Transform4 (const FLOAT* m, INT nRow, __m128 x, __m128 y, __m128 z)
+{
+	__m128 mmResult = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[nRow]), x), _mm_mul_ps(_mm_set1_ps(m[4 + nRow]), y));
+	return _mm_add_ps(_mm_add_ps(mmResult, _mm_mul_ps(_mm_set1_ps(m[8 + nRow]), z)), _mm_set1_ps(m[12 + nRow]));
+}
+
+// Rounds halves up, like floorf(r + 0.5f) in the scalar code, rather than to even as
+// _mm_cvtps_epi32() would.  SSE2 has no floor, so the sum is truncated and then moved
+// down one wherever truncating went up.
+static inline __m128i ScreenRound4 (__m128 r)
+{
+	__m128 mmHalfUp = _mm_add_ps(r, _mm_set1_ps(0.5f));
+	__m128i mmTruncated = _mm_cvttps_epi32(mmHalfUp);
+	return _mm_add_epi32(mmTruncated, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(mmTruncated), mmHalfUp)));
+}
+
+static INT Project4 (const PROJECT_PARAMS& params, const FLOAT* prgx, const FLOAT* prgy, const FLOAT* prgz, __out_ecount(4) LONG* prgxScreen, __out_ecount(4) LONG* prgyScreen)
+{
+	__m128 x = _mm_loadu_ps(prgx), y = _mm_loadu_ps(prgy), z = _mm_loadu_ps(prgz);
+	__m128 mmClipX = Transform4(params.prgMatrix, 0, x, y, z);
+	__m128 mmClipY = Transform4(params.prgMatrix, 1, x, y, z);
+	__m128 mmClipW = Transform4(params.prgMatrix, 3, x, y, z);
+	__m128 mmFront = _mm_cmpgt_ps(mmClipW, _mm_setzero_ps());
+	__m128 mmLimit = _mm_set1_ps(VIEW_SCREEN_LIMIT);
+	__m128 mmNegLimit = _mm_set1_ps(-VIEW_SCREEN_LIMIT);
+
+	// Points behind the camera would divide by zero or a negative w, so their w is
+	// replaced before dividing and their results are discarded.
+	__m128 mmInvW = _mm_div_ps(_mm_set1_ps(1.0f), _mm_or_ps(_mm_and_ps(mmFront, mmClipW), _mm_andnot_ps(mmFront, _mm_set1_ps(1.0f))));
+	__m128 mmScreenX = _mm_add_ps(_mm_set1_ps(params.xCenter), _mm_mul_ps(_mm_mul_ps(mmClipX, mmInvW), _mm_set1_ps(params.xHalf)));
+	__m128 mmScreenY = _mm_sub_ps(_mm_set1_ps(params.yCenter), _mm_mul_ps(_mm_mul_ps(mmClipY, mmInvW), _mm_set1_ps(params.yHalf)));
+	mmScreenX = _mm_max_ps(_mm_min_ps(mmScreenX, mmLimit), mmNegLimit);
+	mmScreenY = _mm_max_ps(_mm_min_ps(mmScreenY, mmLimit), mmNegLimit);
+
+	__m128i mmFrontMask = _mm_castps_si128(mmFront);
+	__m128i mmBehind = _mm_andnot_si128(mmFrontMask, _mm_set1_epi32(VIEW_POINT_BEHIND));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(prgxScreen), _mm_or_si128(_mm_and_si128(mmFrontMask, ScreenRound4(mmScreenX)), mmBehind));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(prgyScreen), _mm_or_si128(_mm_and_si128(mmFrontMask, ScreenRound4(mmScreenY)), mmBehind));
+
+	INT nMask = _mm_movemask_ps(mmFront);
+	return (nMask & 1) + ((nMask >> 1) & 1) + ((nMask >> 2) & 1) + ((nMask >> 3) & 1);
+}
+
+static INT Unproject4 (const UNPROJECT_PARAMS& params, const LONG* prgxScreen, const LONG* prgyScreen, __out_ecount(4) FLOAT* prgx, __out_ecount(4) FLOAT* prgy, __out_ecount(4) FLOAT* prgz)
+{
+	const FLOAT* m = params.prgInverse;
+	__m128 mmOne = _mm_set1_ps(1.0f);
+	__m128 x = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(prgxScreen))), _mm_set1_ps(params.xScale)), _mm_set1_ps(params.xOffset));
+	__m128 y = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(prgyScreen))), _mm_set1_ps(params.yScale)), _mm_set1_ps(params.yOffset));
+
+	// The view ray runs from the near plane (z = -1) to the far plane (z = 1).
+	__m128 mmNear[4], mmFar[4];
+	for(INT nRow = 0; nRow < 4; nRow++)
+	{
+		__m128 mmBase = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[nRow]), x), _mm_mul_ps(_mm_set1_ps(m[4 + nRow]), y)), _mm_set1_ps(m[12 + nRow]));
+		mmNear[nRow] = _mm_sub_ps(mmBase, _mm_set1_ps(m[8 + nRow]));
+		mmFar[nRow] = _mm_add_ps(mmBase, _mm_set1_ps(m[8 + nRow]));
+	}
+
+	__m128 mmNearInvW = _mm_div_ps(mmOne, mmNear[3]);
+	__m128 mmFarInvW = _mm_div_ps(mmOne, mmFar[3]);
+	__m128 mmNearX = _mm_mul_ps(mmNear[0], mmNearInvW), mmNearY = _mm_mul_ps(mmNear[1], mmNearInvW), mmNearZ = _mm_mul_ps(mmNear[2], mmNearInvW);
+	__m128 mmDirX = _mm_sub_ps(_mm_mul_ps(mmFar[0], mmFarInvW), mmNearX);
+	__m128 mmDirY = _mm_sub_ps(_mm_mul_ps(mmFar[1], mmFarInvW), mmNearY);
+	__m128 mmDirZ = _mm_sub_ps(_mm_mul_ps(mmFar[2], mmFarInvW), mmNearZ);
+
+	__m128 mmHasDir = _mm_cmpneq_ps(mmDirY, _mm_setzero_ps());
+	__m128 t = _mm_div_ps(_mm_sub_ps(_mm_set1_ps(params.yPlane), mmNearY), _mm_or_ps(_mm_and_ps(mmHasDir, mmDirY), _mm_andnot_ps(mmHasDir, mmOne)));
+	__m128 mmHit = _mm_and_ps(mmHasDir, _mm_cmpge_ps(t, _mm_setzero_ps()));
+	__m128 mmMiss = _mm_andnot_ps(mmHit, _mm_set1_ps(FLT_MAX));
+
+	_mm_storeu_ps(prgx, _mm_or_ps(_mm_and_ps(mmHit, _mm_add_ps(mmNearX, _mm_mul_ps(mmDirX, t))), mmMiss));
+	_mm_storeu_ps(prgy, _mm_or_ps(_mm_and_ps(mmHit, _mm_set1_ps(params.yPlane)), mmMiss));
+	_mm_storeu_ps(prgz, _mm_or_ps(_mm_and_ps(mmHit, _mm_add_ps(mmNearZ, _mm_mul_ps(mmDirZ, t))), mmMiss));
+
+	INT nMask = _mm_movemask_ps(mmHit);
+	return (nMask & 1) + ((nMask >> 1) & 1) + ((nMask >> 2) & 1) + ((nMask >> 3) & 1);
+}
+
+#else
+
+static inline LONG ScreenRound (FLOAT r)
+{
+	if(r > VIEW_SCREEN_LIMIT)
+		r = VIEW_SCREEN_LIMIT;
+	else if(r < -VIEW_SCREEN_LIMIT)
+		r = -VIEW_SCREEN_LIMIT;
+	return static_cast<LONG>(floorf(r + 0.5f));
+}
+
+static INT Project4 (const PROJECT_PARAMS& params, const FLOAT* prgx, const FLOAT* prgy, const FLOAT* prgz, __out_ecount(4) LONG* prgxScreen, __out_ecount(4) LONG* prgyScreen)
+{
+	const FLOAT* m = params.prgMatrix;
+	INT cFront = 0;
+
+	for(INT i = 0; i < 4; i++)
+	{
+		FLOAT w = m[3] * prgx[i] + m[7] * prgy[i] + m[11] * prgz[i] + m[15];
+
+		if(0 < w)
+		{
+			FLOAT xClip = m[0] * prgx[i] + m[4] * prgy[i] + m[8] * prgz[i] + m[12];
+			FLOAT yClip = m[1] * prgx[i] + m[5] * prgy[i] + m[9] * prgz[i] + m[13];
+			FLOAT rInvW = 1.0f / w;
+
+			// Same operations in the same order as the SSE2 version, so both give the same pixels.
+			prgxScreen[i] = ScreenRound(params.xCenter + xClip * rInvW * params.xHalf);
+			prgyScreen[i] = ScreenRound(params.yCenter - yClip * rInvW * params.yHalf);
+			cFront++;
+		}
+		else
+		{
+			prgxScreen[i] = VIEW_POINT_BEHIND;
+			prgyScreen[i] = VIEW_POINT_BEHIND;
+		}
+	}
+
+	return cFront;
+}
+
+static INT Unproject4 (const UNPROJECT_PARAMS& params, const LONG* prgxScreen, const LONG* prgyScreen, __out_ecount(4) FLOAT* prgx, __out_ecount(4) FLOAT* prgy, __out_ecount(4) FLOAT* prgz)
+{
+	const FLOAT* m = params.prgInverse;
+	INT cHits = 0;
+
+	for(INT i = 0; i < 4; i++)
+	{
+		FLOAT x = static_cast<FLOAT>(prgxScreen[i]) * params.xScale + params.xOffset;
+		FLOAT y = static_cast<FLOAT>(prgyScreen[i]) * params.yScale + params.yOffset;
+		FLOAT rgNear[4], rgFar[4];
+
+		// The view ray runs from the near plane (z = -1) to the far plane (z = 1).
+		for(INT nRow = 0; nRow < 4; nRow++)
+		{
+			FLOAT rBase = m[nRow] * x + m[4 + nRow] * y + m[12 + nRow];
+			rgNear[nRow] = rBase - m[8 + nRow];
+			rgFar[nRow] = rBase + m[8 + nRow];
+		}
+
+		FLOAT xNear = rgNear[0] / rgNear[3], yNear = rgNear[1] / rgNear[3], zNear = rgNear[2] / rgNear[3];
+		FLOAT xDir = rgFar[0] / rgFar[3] - xNear, yDir = rgFar[1] / rgFar[3] - yNear, zDir = rgFar[2] / rgFar[3] - zNear;
+		FLOAT t = 0 != yDir ? (params.yPlane - yNear) / yDir : -1.0f;
+
+		if(0 <= t)
+		{
+			prgx[i] = xNear + xDir * t;
+			prgy[i] = params.yPlane;
+			prgz[i] = zNear + zDir * t;
+			cHits++;
+		}
+		else
+		{
+			prgx[i] = FLT_MAX;
+			prgy[i] = FLT_MAX;
+			prgz[i] = FLT_MAX;
+		}
+	}
+
+	return cHits;
+}
+
+#endif
+
+CViewTransform::CViewTransform () :
+	m_fCombinedDirty(FALSE),
+	m_fInverseDirty(FALSE),
+	m_fInvertible(TRUE),
+	m_xViewport(0),
+	m_yViewport(0),
+	m_xViewportSize(0),
+	m_yViewportSize(0)
+{
+	SetIdentity(m_rgView);
+	SetIdentity(m_rgProjection);
+	SetIdentity(m_rgViewProjection);
+	SetIdentity(m_rgInverse);
+}
+
+CViewTransform::~CViewTransform ()
+{
+}
+
+VOID CViewTransform::SetPerspective (FLOAT rFieldOfView, FLOAT rAspect, FLOAT rNear, FLOAT rFar)
+{
+	DOUBLE f = 1.0 / tan(static_cast<DOUBLE>(rFieldOfView) * 3.14159265358979323846 / 360.0);
+
+	ZeroMemory(m_rgProjection, sizeof(m_rgProjection));
+	m_rgProjection[0] = static_cast<FLOAT>(f / rAspect);
+	m_rgProjection[5] = static_cast<FLOAT>(f);
+	m_rgProjection[10] = (rFar + rNear) / (rNear - rFar);
+	m_rgProjection[11] = -1.0f;
+	m_rgProjection[14] = 2.0f * rFar * rNear / (rNear - rFar);
+
+	m_fCombinedDirty = TRUE;
+	m_fInverseDirty = TRUE;
+}
+
+VOID CViewTransform::SetViewport (INT x, INT y, INT xSize, INT ySize)
+{
+	m_xViewport = x;
+	m_yViewport = y;
+	m_xViewportSize = xSize;
+	m_yViewportSize = ySize;
+}
+
+VOID CViewTransform::SetView (DOUBLE x, DOUBLE y, DOUBLE z, FLOAT rPitch, FLOAT rYaw)
+{
+	DOUBLE dblPitch = static_cast<DOUBLE>(rPitch) * 3.14159265358979323846 / 180.0;
+	DOUBLE dblYaw = static_cast<DOUBLE>(rYaw) * 3.14159265358979323846 / 180.0;
+	DOUBLE sp = sin(dblPitch), cp = cos(dblPitch);
+	DOUBLE sy = sin(dblYaw), cy = cos(dblYaw);
+
+	// The rotation is Rx(rPitch) * Ry(rYaw), stored by columns.
+	DOUBLE rgRotation[9] =
+	{
+		cy, sp * sy, -cp * sy,
+		0.0, cp, sp,
+		sy, -sp * cy, cp * cy
+	};
+
+	for(INT nColumn = 0; nColumn < 3; nColumn++)
+	{
+		for(INT nRow = 0; nRow < 3; nRow++)
+			m_rgView[nColumn * 4 + nRow] = static_cast<FLOAT>(rgRotation[nColumn * 3 + nRow]);
+		m_rgView[nColumn * 4 + 3] = 0.0f;
+	}
+
+	for(INT nRow = 0; nRow < 3; nRow++)
+		m_rgView[12 + nRow] = static_cast<FLOAT>(-(rgRotation[nRow] * x + rgRotation[3 + nRow] * y + rgRotation[6 + nRow] * z));
+	m_rgView[15] = 1.0f;
+
+	m_fCombinedDirty = TRUE;
+	m_fInverseDirty = TRUE;
+}
+
+const FLOAT* CViewTransform::GetViewProjection (VOID)
+{
+	UpdateCombined();
+	return m_rgViewProjection;
+}
+
+SIZE_T CViewTransform::ProjectPoints (const FPOINT* prgPoints, __out_ecount(cPoints) POINT* prgScreen, SIZE_T cPoints)
+{
+	PROJECT_PARAMS params;
+	SIZE_T cFront = 0;
+
+	UpdateCombined();
+
+	params.prgMatrix = m_rgViewProjection;
+	params.xHalf = static_cast<FLOAT>(m_xViewportSize) / 2.0f;
+	params.yHalf = static_cast<FLOAT>(m_yViewportSize) / 2.0f;
+	params.xCenter = static_cast<FLOAT>(m_xViewport) + params.xHalf;
+	params.yCenter = static_cast<FLOAT>(m_yViewport) + params.yHalf;
+
+	// The points are gathered four at a time into lanes, and the last group is padded.
+	for(SIZE_T i = 0; i < cPoints; i += 4)
+	{
+		FLOAT rgx[4] = { 0 }, rgy[4] = { 0 }, rgz[4] = { 0 };
+		LONG rgxScreen[4], rgyScreen[4];
+		INT cLanes = static_cast<INT>(min(cPoints - i, 4));
+		INT cLaneFront;
+
+		for(INT n = 0; n < cLanes; n++)
+		{
+			rgx[n] = prgPoints[i + n].x;
+			rgy[n] = prgPoints[i + n].y;
+			rgz[n] = prgPoints[i + n].z;
+		}
+
+		cLaneFront = Project4(params, rgx, rgy, rgz, rgxScreen, rgyScreen);
+		for(INT n = 0; n < cLanes; n++)
+		{
+			prgScreen[i + n].x = rgxScreen[n];
+			prgScreen[i + n].y = rgyScreen[n];
+		}
+
+		// Padding lanes sit at the origin, so count them out if they were in front.
+		for(INT n = cLanes; n < 4; n++)
+		{
+			if(VIEW_POINT_BEHIND != rgxScreen[n])
+				cLaneFront--;
+		}
+		cFront += cLaneFront;
+	}
+
+	return cFront;
+}
+
+SIZE_T CViewTransform::UnprojectPoints (const POINT* prgScreen, FLOAT yPlane, __out_ecount(cPoints) FPOINT* prgWorld, SIZE_T cPoints)
+{
+	UNPROJECT_PARAMS params;
+	SIZE_T cHits = 0;
+
+	UpdateInverse();
+
+	if(!m_fInvertible || 0 >= m_xViewportSize || 0 >= m_yViewportSize)
+	{
+		for(SIZE_T i = 0; i < cPoints; i++)
+		{
+			prgWorld[i].x = FLT_MAX;
+			prgWorld[i].y = FLT_MAX;
+			prgWorld[i].z = FLT_MAX;
+		}
+		return 0;
+	}
+
+	// Pixel centers map to normalized device coordinates, with y flipped.
+	params.prgInverse = m_rgInverse;
+	params.xScale = 2.0f / static_cast<FLOAT>(m_xViewportSize);
+	params.yScale = -2.0f / static_cast<FLOAT>(m_yViewportSize);
+	params.xOffset = (static_cast<FLOAT>(-m_xViewport) + 0.5f) * params.xScale - 1.0f;
+	params.yOffset = (static_cast<FLOAT>(-m_yViewport) + 0.5f) * params.yScale + 1.0f;
+	params.yPlane = yPlane;
+
+	for(SIZE_T i = 0; i < cPoints; i += 4)
+	{
+		LONG rgxScreen[4] = { 0 }, rgyScreen[4] = { 0 };
+		FLOAT rgx[4], rgy[4], rgz[4];
+		INT cLanes = static_cast<INT>(min(cPoints - i, 4));
+		INT cLaneHits;
+
+		for(INT n = 0; n < cLanes; n++)
+		{
+			rgxScreen[n] = prgScreen[i + n].x;
+			rgyScreen[n] = prgScreen[i + n].y;
+		}
+
+		cLaneHits = Unproject4(params, rgxScreen, rgyScreen, rgx, rgy, rgz);
+		for(INT n = 0; n < cLanes; n++)
+		{
+			prgWorld[i + n].x = rgx[n];
+			prgWorld[i + n].y = rgy[n];
+			prgWorld[i + n].z = rgz[n];
+		}
+
+		for(INT n = cLanes; n < 4; n++)
+		{
+			if(FLT_MAX != rgx[n])
+				cLaneHits--;
+		}
+		cHits += cLaneHits;
+	}
+
+	return cHits;
+}
+
+VOID CViewTransform::UpdateCombined (VOID)
+{
+	if(m_fCombinedDirty)
+	{
+		Multiply(m_rgProjection, m_rgView, m_rgViewProjection);
+		m_fCombinedDirty = FALSE;
+	}
+}
+
+VOID CViewTransform::UpdateInverse (VOID)
+{
+	UpdateCombined();
+	if(m_fInverseDirty)
+	{
+		m_fInvertible = Invert(m_rgViewProjection, m_rgInverse);
+		m_fInverseDirty = FALSE;
+	}
+}
+
+VOID CViewTransform::Multiply (const FLOAT* prgLeft, const FLOAT* prgRight, __out_ecount(16) FLOAT* prgResult)
+{
+	for(INT nColumn = 0; nColumn < 4; nColumn++)
+	{
+		for(INT nRow = 0; nRow < 4; nRow++)
+		{
+			FLOAT r = 0.0f;
+			for(INT n = 0; n < 4; n++)
+				r += prgLeft[n * 4 + nRow] * prgRight[nColumn * 4 + n];
+			prgResult[nColumn * 4 + nRow] = r;
+		}
+	}
+}
+
+// Cofactor expansion in DOUBLE, the same way gluInvertMatrix() does it
+BOOL CViewTransform::Invert (const FLOAT* m, __out_ecount(16) FLOAT* prgInverse)
+{
+	DOUBLE inv[16], det;
+
+	inv[0] = (DOUBLE)m[5] * m[10] * m[15] - (DOUBLE)m[5] * m[11] * m[14] - (DOUBLE)m[9] * m[6] * m[15] + (DOUBLE)m[9] * m[7] * m[14] + (DOUBLE)m[13] * m[6] * m[11] - (DOUBLE)m[13] * m[7] * m[10];
+	inv[4] = -(DOUBLE)m[4] * m[10] * m[15] + (DOUBLE)m[4] * m[11] * m[14] + (DOUBLE)m[8] * m[6] * m[15] - (DOUBLE)m[8] * m[7] * m[14] - (DOUBLE)m[12] * m[6] * m[11] + (DOUBLE)m[12] * m[7] * m[10];
+	inv[8] = (DOUBLE)m[4] * m[9] * m[15] - (DOUBLE)m[4] * m[11] * m[13] - (DOUBLE)m[8] * m[5] * m[15] + (DOUBLE)m[8] * m[7] * m[13] + (DOUBLE)m[12] * m[5] * m[11] - (DOUBLE)m[12] * m[7] * m[9];
+	inv[12] = -(DOUBLE)m[4] * m[9] * m[14] + (DOUBLE)m[4] * m[10] * m[13] + (DOUBLE)m[8] * m[5] * m[14] - (DOUBLE)m[8] * m[6] * m[13] - (DOUBLE)m[12] * m[5] * m[10] + (DOUBLE)m[12] * m[6] * m[9];
+	inv[1] = -(DOUBLE)m[1] * m[10] * m[15] + (DOUBLE)m[1] * m[11] * m[14] + (DOUBLE)m[9] * m[2] * m[15] - (DOUBLE)m[9] * m[3] * m[14] - (DOUBLE)m[13] * m[2] * m[11] + (DOUBLE)m[13] * m[3] * m[10];
+	inv[5] = (DOUBLE)m[0] * m[10] * m[15] - (DOUBLE)m[0] * m[11] * m[14] - (DOUBLE)m[8] * m[2] * m[15] + (DOUBLE)m[8] * m[3] * m[14] + (DOUBLE)m[12] * m[2] * m[11] - (DOUBLE)m[12] * m[3] * m[10];
+	inv[9] = -(DOUBLE)m[0] * m[9] * m[15] + (DOUBLE)m[0] * m[11] * m[13] + (DOUBLE)m[8] * m[1] * m[15] - (DOUBLE)m[8] * m[3] * m[13] - (DOUBLE)m[12] * m[1] * m[11] + (DOUBLE)m[12] * m[3] * m[9];
+	inv[13] = (DOUBLE)m[0] * m[9] * m[14] - (DOUBLE)m[0] * m[10] * m[13] - (DOUBLE)m[8] * m[1] * m[14] + (DOUBLE)m[8] * m[2] * m[13] + (DOUBLE)m[12] * m[1] * m[10] - (DOUBLE)m[12] * m[2] * m[9];
+	inv[2] = (DOUBLE)m[1] * m[6] * m[15] - (DOUBLE)m[1] * m[7] * m[14] - (DOUBLE)m[5] * m[2] * m[15] + (DOUBLE)m[5] * m[3] * m[14] + (DOUBLE)m[13] * m[2] * m[7] - (DOUBLE)m[13] * m[3] * m[6];
+	inv[6] = -(DOUBLE)m[0] * m[6] * m[15] + (DOUBLE)m[0] * m[7] * m[14] + (DOUBLE)m[4] * m[2] * m[15] - (DOUBLE)m[4] * m[3] * m[14] - (DOUBLE)m[12] * m[2] * m[7] + (DOUBLE)m[12] * m[3] * m[6];
+	inv[10] = (DOUBLE)m[0] * m[5] * m[15] - (DOUBLE)m[0] * m[7] * m[13] - (DOUBLE)m[4] * m[1] * m[15] + (DOUBLE)m[4] * m[3] * m[13] + (DOUBLE)m[12] * m[1] * m[7] - (DOUBLE)m[12] * m[3] * m[5];
+	inv[14] = -(DOUBLE)m[0] * m[5] * m[14] + (DOUBLE)m[0] * m[6] * m[13] + (DOUBLE)m[4] * m[1] * m[14] - (DOUBLE)m[4] * m[2] * m[13] - (DOUBLE)m[12] * m[1] * m[6] + (DOUBLE)m[12] * m[2] * m[5];
+	inv[3] = -(DOUBLE)m[1] * m[6] * m[11] + (DOUBLE)m[1] * m[7] * m[10] + (DOUBLE)m[5] * m[2] * m[11] - (DOUBLE)m[5] * m[3] * m[10] - (DOUBLE)m[9] * m[2] * m[7] + (DOUBLE)m[9] * m[3] * m[6];
+	inv[7] = (DOUBLE)m[0] * m[6] * m[11] - (DOUBLE)m[0] * m[7] * m[10] - (DOUBLE)m[4] * m[2] * m[11] + (DOUBLE)m[4] * m[3] * m[10] + (DOUBLE)m[8] * m[2] * m[7] - (DOUBLE)m[8] * m[3] * m[6];
+	inv[11] = -(DOUBLE)m[0] * m[5] * m[11] + (DOUBLE)m[0] * m[7] * m[9] + (DOUBLE)m[4] * m[1] * m[11] - (DOUBLE)m[4] * m[3] * m[9] - (DOUBLE)m[8] * m[1] * m[7] + (DOUBLE)m[8] * m[3] * m[5];
+	inv[15] = (DOUBLE)m[0] * m[5] * m[10] - (DOUBLE)m[0] * m[6] * m[9] - (DOUBLE)m[4] * m[1] * m[10] + (DOUBLE)m[4] * m[2] * m[9] + (DOUBLE)m[8] * m[1] * m[6] - (DOUBLE)m[8] * m[2] * m[5];
+
+	det = (DOUBLE)m[0] * inv[0] + (DOUBLE)m[1] * inv[4] + (DOUBLE)m[2] * inv[8] + (DOUBLE)m[3] * inv[12];
+	if(0.0 == det)
+		return FALSE;
+
+	det = 1.0 / det;
+	for(INT i = 0; i < 16; i++)
+		prgInverse[i] = static_cast<FLOAT>(inv[i] * det);
+	return TRUE;
+}
+
+VOID CViewTransform::SetIdentity (__out_ecount(16) FLOAT* prgMatrix)
+{
+	ZeroMemory(prgMatrix, sizeof(FLOAT) * 16);
+	prgMatrix[0] = 1.0f;
+	prgMatrix[5] = 1.0f;
+	prgMatrix[10] = 1.0f;
+	prgMatrix[15] = 1.0f;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "GeometryTypes.h"
+
+// ProjectPoints() gives both coordinates this value for points at or behind the camera.
+#define	VIEW_POINT_BEHIND		LONG_MIN
+
+// Column-major view, projection and viewport state for a camera, laid out like the
+// OpenGL matrices so they can be handed to CFrustum::Update() or glLoadMatrixf().  The
+// combined view-projection matrix and its inverse are only computed again after one of
+// their inputs has changed, and the batch transforms work on four points at a time when
+// SSE2 is available.
+
+class CViewTransform
+{
+private:
+	FLOAT m_rgView[16];
+	FLOAT m_rgProjection[16];
+	FLOAT m_rgViewProjection[16];
+	FLOAT m_rgInverse[16];
+	BOOL m_fCombinedDirty;
+	BOOL m_fInverseDirty;
+	BOOL m_fInvertible;
+
+	INT m_xViewport, m_yViewport;
+	INT m_xViewportSize, m_yViewportSize;
+
+public:
+	CViewTransform ();
+	~CViewTransform ();
+
+	// Matches gluPerspective().
+	VOID SetPerspective (FLOAT rFieldOfView, FLOAT rAspect, FLOAT rNear, FLOAT rFar);
+
+	// Screen coordinates follow Windows, with y growing downward from the top of the
+	// viewport.
+	VOID SetViewport (INT x, INT y, INT xSize, INT ySize);
+
+	// The same as glRotatef(rPitch, 1, 0, 0), then glRotatef(rYaw, 0, 1, 0), then
+	// glTranslated(-x, -y, -z).  The translation is folded in with DOUBLE precision.
+	VOID SetView (DOUBLE x, DOUBLE y, DOUBLE z, FLOAT rPitch, FLOAT rYaw);
+
+	inline const FLOAT* GetView (VOID) const { return m_rgView; }
+	inline const FLOAT* GetProjection (VOID) const { return m_rgProjection; }
+	const FLOAT* GetViewProjection (VOID);
+
+	// Returns the number of points in front of the camera.  The others are set to
+	// VIEW_POINT_BEHIND.
+	SIZE_T ProjectPoints (const FPOINT* prgPoints, __out_ecount(cPoints) POINT* prgScreen, SIZE_T cPoints);
+
+	// Finds the point on the horizontal plane at yPlane under the center of each screen
+	// pixel, which is how tiles and objects on the ground are picked.  Returns the number
+	// of pixels whose view ray meets the plane in front of the camera.  The others are set
+	// to FLT_MAX.
+	SIZE_T UnprojectPoints (const POINT* prgScreen, FLOAT yPlane, __out_ecount(cPoints) FPOINT* prgWorld, SIZE_T cPoints);
+
+private:
+	VOID UpdateCombined (VOID);
+	VOID UpdateInverse (VOID);
+
+	static VOID Multiply (const FLOAT* prgLeft, const FLOAT* prgRight, __out_ecount(16) FLOAT* prgResult);
+	static BOOL Invert (const FLOAT* prgMatrix, __out_ecount(16) FLOAT* prgInverse);
+	static VOID SetIdentity (__out_ecount(16) FLOAT* prgMatrix);
+};
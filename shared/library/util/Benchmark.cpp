@@ -0,0 +1,135 @@
+#include <windows.h>
+#if defined(_M_IX86) || defined(_M_X64)
+	#include <intrin.h>
+#endif
+#include "..\Core\CoreDefs.h"
+#include "StreamHelpers.h"
+#include "Benchmark.h"
+
+static inline ULONGLONG ReadCycleCounter (VOID)
+{
+#if defined(_M_IX86) || defined(_M_X64)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static HRESULT WriteValue (ISequentialStream* pStream, const BENCHMARK_COLUMN& column, const BYTE* pcbResult, BOOL fJson)
+{
+	HRESULT hr;
+	const VOID* pcvValue = pcbResult + column.cbOffset;
+
+	switch(column.eType)
+	{
+	case BENCHMARK_COLUMN_STRING:
+		hr = Stream::TPrintF(pStream, fJson ? "\"%hs\"" : "%hs", *static_cast<const PCSTR*>(pcvValue));
+		break;
+	case BENCHMARK_COLUMN_INT:
+		hr = Stream::TPrintF(pStream, "%d", *static_cast<const INT*>(pcvValue));
+		break;
+	case BENCHMARK_COLUMN_UINT:
+		hr = Stream::TPrintF(pStream, "%u", *static_cast<const UINT*>(pcvValue));
+		break;
+	case BENCHMARK_COLUMN_SIZE:
+		hr = Stream::TPrintF(pStream, "%Iu", *static_cast<const SIZE_T*>(pcvValue));
+		break;
+	case BENCHMARK_COLUMN_ULONGLONG:
+		hr = Stream::TPrintF(pStream, "%q", *static_cast<const ULONGLONG*>(pcvValue));
+		break;
+	case BENCHMARK_COLUMN_DOUBLE:
+		hr = Stream::TPrintF(pStream, "%.3f", *static_cast<const DOUBLE*>(pcvValue));
+		break;
+	case BENCHMARK_COLUMN_RATE:
+		hr = Stream::TPrintF(pStream, "%q", static_cast<ULONGLONG>(*static_cast<const DOUBLE*>(pcvValue) + 0.5));
+		break;
+	default:
+		hr = E_INVALIDARG;
+		break;
+	}
+
+	return hr;
+}
+
+namespace Benchmark
+{
+	HRESULT Measure (IBenchmarkWorkload* pWorkload, DWORD msMinimum, __out BENCHMARK_TIMING* pTiming)
+	{
+		HRESULT hr;
+		LARGE_INTEGER liFrequency, liStart, liNow;
+		LONGLONG cTicksMinimum;
+		ULONGLONG cIterations = 0, cBatch = 1, nCyclesStart;
+
+		CheckIf(NULL == pWorkload, E_INVALIDARG);
+
+		CheckIfGetLastError(!QueryPerformanceFrequency(&liFrequency));
+		cTicksMinimum = liFrequency.QuadPart * msMinimum / 1000;
+
+		QueryPerformanceCounter(&liStart);
+		nCyclesStart = ReadCycleCounter();
+
+		for(;;)
+		{
+			Check(pWorkload->RunBatch(cBatch));
+			cIterations += cBatch;
+
+			QueryPerformanceCounter(&liNow);
+			if(liNow.QuadPart - liStart.QuadPart >= cTicksMinimum)
+				break;
+			cBatch <<= 1;
+		}
+
+		pTiming->cCycles = ReadCycleCounter() - nCyclesStart;
+		pTiming->cIterations = cIterations;
+		pTiming->dblSeconds = static_cast<DOUBLE>(liNow.QuadPart - liStart.QuadPart) / static_cast<DOUBLE>(liFrequency.QuadPart);
+
+	Cleanup:
+		return hr;
+	}
+
+	HRESULT Write (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat, const BENCHMARK_COLUMN* pcrgColumns, INT cColumns, const VOID* pcvResults, SIZE_T cbResult, sysint cResults)
+	{
+		HRESULT hr;
+		const BYTE* pcbResult = static_cast<const BYTE*>(pcvResults);
+
+		CheckIf(NULL == pcrgColumns || 0 >= cColumns || (NULL == pcvResults && 0 < cResults), E_INVALIDARG);
+
+		if(BENCHMARK_CSV == eFormat)
+		{
+			for(INT n = 0; n < cColumns; n++)
+				Check(Stream::TPrintF(pStream, "%hs%hs", 0 == n ? "" : ",", pcrgColumns[n].pcszCsvName));
+			Check(Stream::TPrintF(pStream, "\r\n"));
+
+			for(sysint i = 0; i < cResults; i++, pcbResult += cbResult)
+			{
+				for(INT n = 0; n < cColumns; n++)
+				{
+					if(0 < n)
+						Check(Stream::TPrintF(pStream, ","));
+					Check(WriteValue(pStream, pcrgColumns[n], pcbResult, FALSE));
+				}
+				Check(Stream::TPrintF(pStream, "\r\n"));
+			}
+		}
+		else
+		{
+			CheckIf(BENCHMARK_JSON != eFormat, E_INVALIDARG);
+
+			Check(Stream::TPrintF(pStream, "["));
+			for(sysint i = 0; i < cResults; i++, pcbResult += cbResult)
+			{
+				Check(Stream::TPrintF(pStream, "%hs\r\n\t{", 0 == i ? "" : ","));
+				for(INT n = 0; n < cColumns; n++)
+				{
+					Check(Stream::TPrintF(pStream, "%hs\"%hs\": ", 0 == n ? "" : ", ", pcrgColumns[n].pcszJsonName));
+					Check(WriteValue(pStream, pcrgColumns[n], pcbResult, TRUE));
+				}
+				Check(Stream::TPrintF(pStream, "}"));
+			}
+			Check(Stream::TPrintF(pStream, "\r\n]\r\n"));
+		}
+
+	Cleanup:
+		return hr;
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "..\Core\Array.h"
+
+// Timing and result output shared by the library's benchmarks.  A benchmark supplies
+// its workload and a table describing the columns of its result structure, and
+// Benchmark::Measure() and Benchmark::Write() do the rest.
+
+enum BENCHMARK_FORMAT
+{
+	BENCHMARK_CSV,
+	BENCHMARK_JSON
+};
+
+enum BENCHMARK_COLUMN_TYPE
+{
+	BENCHMARK_COLUMN_STRING,	// PCSTR
+	BENCHMARK_COLUMN_INT,		// INT
+	BENCHMARK_COLUMN_UINT,		// UINT
+	BENCHMARK_COLUMN_SIZE,		// SIZE_T
+	BENCHMARK_COLUMN_ULONGLONG,	// ULONGLONG
+	BENCHMARK_COLUMN_DOUBLE,	// DOUBLE, written with three decimals
+	BENCHMARK_COLUMN_RATE		// DOUBLE, rounded to a whole number
+};
+
+struct BENCHMARK_COLUMN
+{
+	PCSTR pcszCsvName;
+	PCSTR pcszJsonName;
+	BENCHMARK_COLUMN_TYPE eType;
+	SIZE_T cbOffset;			// Offset of the value within the result structure
+};
+
+struct BENCHMARK_TIMING
+{
+	ULONGLONG cIterations;
+	DOUBLE dblSeconds;
+	ULONGLONG cCycles;			// Zero when no cycle counter is available
+};
+
+interface IBenchmarkWorkload
+{
+	// Runs the workload cIterations times.
+	virtual HRESULT RunBatch (ULONGLONG cIterations) = 0;
+};
+
+namespace Benchmark
+{
+	// Batches double in size until at least msMinimum has elapsed, which keeps the
+	// timer calls from dominating the measurement of short workloads.
+	HRESULT Measure (IBenchmarkWorkload* pWorkload, DWORD msMinimum, __out BENCHMARK_TIMING* pTiming);
+
+	// Writes cResults structures of cbResult bytes, one row or object per result.
+	HRESULT Write (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat, const BENCHMARK_COLUMN* pcrgColumns, INT cColumns, const VOID* pcvResults, SIZE_T cbResult, sysint cResults);
+
+	template <typename T, INT cColumns>
+	HRESULT TWrite (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat, const BENCHMARK_COLUMN (&rgColumns)[cColumns], const TArray<T>& aResults)
+	{
+		return Write(pStream, eFormat, rgColumns, cColumns, 0 < aResults.Length() ? &aResults[0] : NULL, sizeof(T), aResults.Length());
+	}
+}
@@ -14,6 +14,10 @@
 	#include "Published\SimbeyCore.h"
 #endif
 
+#ifdef	CORE_SSE2
+	#include <emmintrin.h>
+#endif
+
 namespace Stream
 {
 	HRESULT WINAPI CopyAnsiToStreamW (UINT nCodePage, ISequentialStream* pStream, PCSTR pcszString, INT cchString, INT cchCopy)
@@ -29,11 +33,28 @@ namespace Stream
 		else if(cchString < cchCopy)
 			cchCopy = cchString;
 
-		cchWide = MultiByteToWideChar(nCodePage, 0, pcszString, cchCopy, NULL, 0);
-		pwzWide = reinterpret_cast<PWSTR>(_malloca(cchWide * sizeof(WCHAR)));
-		CheckAlloc(pwzWide);
+		if(CP_UTF8 == nCodePage)
+		{
+			// UTF-8 never produces more UTF-16 code units than it has bytes, so one
+			// buffer works for both the fast path and the system's lenient conversion.
+			pwzWide = reinterpret_cast<PWSTR>(_malloca(cchCopy * sizeof(WCHAR)));
+			CheckAlloc(pwzWide);
+
+			if(FAILED(Utf8ToUtf16(pcszString, cchCopy, pwzWide, cchCopy, &cchWide)))
+			{
+				cchWide = MultiByteToWideChar(nCodePage, 0, pcszString, cchCopy, pwzWide, cchCopy);
+				CheckIfGetLastError(0 == cchWide && 0 != cchCopy);
+			}
+		}
+		else
+		{
+			cchWide = MultiByteToWideChar(nCodePage, 0, pcszString, cchCopy, NULL, 0);
+			pwzWide = reinterpret_cast<PWSTR>(_malloca(cchWide * sizeof(WCHAR)));
+			CheckAlloc(pwzWide);
+
+			CheckIfGetLastError(cchWide != MultiByteToWideChar(nCodePage, 0, pcszString, cchCopy, pwzWide, cchWide));
+		}
 
-		CheckIfGetLastError(cchWide != MultiByteToWideChar(nCodePage, 0, pcszString, cchCopy, pwzWide, cchWide));
 		Check(Stream::TWrite(pStream, pwzWide, cchWide, &cbWrite));
 
 	Cleanup:
@@ -57,11 +78,28 @@ namespace Stream
 		else if(cchString < cchCopy)
 			cchCopy = cchString;
 
-		cchMultiByte = WideCharToMultiByte(nCodePage, 0, pcwzString, cchCopy, NULL, 0, NULL, NULL);
-		pszMultiByte = reinterpret_cast<PSTR>(_malloca(cchMultiByte));
-		CheckAlloc(pszMultiByte);
+		if(CP_UTF8 == nCodePage)
+		{
+			// Each UTF-16 code unit expands to at most three UTF-8 bytes, including
+			// the replacement character the system substitutes for lone surrogates.
+			pszMultiByte = reinterpret_cast<PSTR>(_malloca(cchCopy * 3));
+			CheckAlloc(pszMultiByte);
+
+			if(FAILED(Utf16ToUtf8(pcwzString, cchCopy, pszMultiByte, cchCopy * 3, &cchMultiByte)))
+			{
+				cchMultiByte = WideCharToMultiByte(nCodePage, 0, pcwzString, cchCopy, pszMultiByte, cchCopy * 3, NULL, NULL);
+				CheckIfGetLastError(0 == cchMultiByte && 0 != cchCopy);
+			}
+		}
+		else
+		{
+			cchMultiByte = WideCharToMultiByte(nCodePage, 0, pcwzString, cchCopy, NULL, 0, NULL, NULL);
+			pszMultiByte = reinterpret_cast<PSTR>(_malloca(cchMultiByte));
+			CheckAlloc(pszMultiByte);
+
+			CheckIfGetLastError(cchMultiByte != WideCharToMultiByte(nCodePage, 0, pcwzString, cchCopy, pszMultiByte, cchMultiByte, NULL, NULL));
+		}
 
-		CheckIfGetLastError(cchMultiByte != WideCharToMultiByte(nCodePage, 0, pcwzString, cchCopy, pszMultiByte, cchMultiByte, NULL, NULL));
 		Check(Stream::TWrite(pStream, pszMultiByte, cchMultiByte, &cbWrite));
 
 	Cleanup:
@@ -784,11 +822,237 @@ namespace Stream
 
 		CheckIfIgnore(0 == cchWide, S_OK);
 
-		cchMultiByte = WideCharToMultiByte(nCodePage, dwFlags, pcwzWide, cchWide, NULL, 0, NULL, NULL);
-		CheckIfGetLastError(0 == cchMultiByte);
+		// Well-formed UTF-16 converts identically regardless of dwFlags, so only
+		// malformed input needs the system's handling.
+		if(CP_UTF8 == nCodePage && SUCCEEDED(Utf16ToUtf8(pcwzWide, cchWide, NULL, 0, &cchMultiByte)))
+		{
+			Check(pstmDest->TWriteAdvance(&pszWritePtr, cchMultiByte));
+			SideAssertHr(Utf16ToUtf8(pcwzWide, cchWide, pszWritePtr, cchMultiByte, &cchMultiByte));
+		}
+		else
+		{
+			cchMultiByte = WideCharToMultiByte(nCodePage, dwFlags, pcwzWide, cchWide, NULL, 0, NULL, NULL);
+			CheckIfGetLastError(0 == cchMultiByte);
+
+			Check(pstmDest->TWriteAdvance(&pszWritePtr, cchMultiByte));
+			SideAssertCompare(WideCharToMultiByte(nCodePage, dwFlags, pcwzWide, cchWide, pszWritePtr, cchMultiByte, NULL, NULL), cchMultiByte);
+		}
+
+	Cleanup:
+		return hr;
+	}
+
+	HRESULT WINAPI Utf8ToUtf16 (__in_ecount(cbUtf8) PCSTR pcszUtf8, INT cbUtf8, __out_ecount_part_opt(cchMaxWide, *pcchWide) PWSTR pwzWide, INT cchMaxWide, __out INT* pcchWide)
+	{
+		HRESULT hr;
+		const BYTE* pbRead = reinterpret_cast<const BYTE*>(pcszUtf8);
+		const BYTE* pbEnd = pbRead + cbUtf8;
+		INT cchWide = 0;
+
+		CheckIf(0 > cbUtf8 || (NULL == pcszUtf8 && 0 < cbUtf8), E_INVALIDARG);
+
+		while(pbRead < pbEnd)
+		{
+#ifdef	CORE_SSE2
+			// Widen sixteen ASCII bytes at a time until a lead or continuation byte appears.
+			while(pbEnd - pbRead >= 16)
+			{
+				__m128i xmmBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pbRead));
+				if(0 != _mm_movemask_epi8(xmmBytes))
+					break;
+				if(pwzWide)
+				{
+					if(cchMaxWide - cchWide < 16)
+						break;
+					__m128i xmmZero = _mm_setzero_si128();
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(pwzWide + cchWide), _mm_unpacklo_epi8(xmmBytes, xmmZero));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(pwzWide + cchWide + 8), _mm_unpackhi_epi8(xmmBytes, xmmZero));
+				}
+				pbRead += 16;
+				cchWide += 16;
+			}
+
+			if(pbRead == pbEnd)
+				break;
+#endif
+
+			UINT nLead = *pbRead, nCodePoint;
+			INT cbSequence;
+			BYTE bMin = 0x80, bMax = 0xBF;
+
+			if(nLead < 0x80)
+			{
+				nCodePoint = nLead;
+				cbSequence = 1;
+			}
+			else if(nLead < 0xC2)		// Continuation byte or overlong two byte form
+				break;
+			else if(nLead < 0xE0)
+			{
+				nCodePoint = nLead & 0x1F;
+				cbSequence = 2;
+			}
+			else if(nLead < 0xF0)
+			{
+				nCodePoint = nLead & 0x0F;
+				cbSequence = 3;
+				if(0xE0 == nLead)
+					bMin = 0xA0;		// Overlong
+				else if(0xED == nLead)
+					bMax = 0x9F;		// Surrogates
+			}
+			else if(nLead < 0xF5)
+			{
+				nCodePoint = nLead & 0x07;
+				cbSequence = 4;
+				if(0xF0 == nLead)
+					bMin = 0x90;		// Overlong
+				else if(0xF4 == nLead)
+					bMax = 0x8F;		// Beyond U+10FFFF
+			}
+			else
+				break;
+
+			if(pbEnd - pbRead < cbSequence)
+				break;
+
+			// Only the first continuation byte has a restricted range.
+			for(INT i = 1; i < cbSequence; i++)
+			{
+				BYTE bNext = pbRead[i];
+				if(bNext < bMin || bNext > bMax)
+				{
+					cbSequence = 0;
+					break;
+				}
+				nCodePoint = (nCodePoint << 6) | (bNext & 0x3F);
+				bMin = 0x80;
+				bMax = 0xBF;
+			}
+
+			if(0 == cbSequence)
+				break;
+
+			INT cchUnits = (nCodePoint < 0x10000) ? 1 : 2;
+			if(pwzWide)
+			{
+				CheckIf(cchMaxWide - cchWide < cchUnits, HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER));
+				if(1 == cchUnits)
+					pwzWide[cchWide] = static_cast<WCHAR>(nCodePoint);
+				else
+				{
+					nCodePoint -= 0x10000;
+					pwzWide[cchWide] = static_cast<WCHAR>(0xD800 + (nCodePoint >> 10));
+					pwzWide[cchWide + 1] = static_cast<WCHAR>(0xDC00 + (nCodePoint & 0x3FF));
+				}
+			}
+
+			pbRead += cbSequence;
+			cchWide += cchUnits;
+		}
+
+		CheckIfIgnore(pbRead < pbEnd, HRESULT_FROM_WIN32(ERROR_NO_UNICODE_TRANSLATION));
+
+		*pcchWide = cchWide;
+		hr = S_OK;
+
+	Cleanup:
+		return hr;
+	}
+
+	HRESULT WINAPI Utf16ToUtf8 (__in_ecount(cchWide) PCWSTR pcwzWide, INT cchWide, __out_ecount_part_opt(cbMaxUtf8, *pcbUtf8) PSTR pszUtf8, INT cbMaxUtf8, __out INT* pcbUtf8)
+	{
+		HRESULT hr;
+		const WCHAR* pwcRead = pcwzWide;
+		const WCHAR* pwcEnd = pwcRead + cchWide;
+		BYTE* pbWrite = reinterpret_cast<BYTE*>(pszUtf8);
+		INT cbUtf8 = 0;
+
+		CheckIf(0 > cchWide || (NULL == pcwzWide && 0 < cchWide), E_INVALIDARG);
+
+		while(pwcRead < pwcEnd)
+		{
+#ifdef	CORE_SSE2
+			// Narrow sixteen ASCII code units at a time.
+			while(pwcEnd - pwcRead >= 16)
+			{
+				__m128i xmmLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pwcRead));
+				__m128i xmmHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pwcRead + 8));
+				__m128i xmmMask = _mm_set1_epi16(static_cast<SHORT>(0xFF80));
+				__m128i xmmTest = _mm_and_si128(_mm_or_si128(xmmLow, xmmHigh), xmmMask);
+				if(0xFFFF != _mm_movemask_epi8(_mm_cmpeq_epi16(xmmTest, _mm_setzero_si128())))
+					break;
+				if(pbWrite)
+				{
+					if(cbMaxUtf8 - cbUtf8 < 16)
+						break;
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(pbWrite + cbUtf8), _mm_packus_epi16(xmmLow, xmmHigh));
+				}
+				pwcRead += 16;
+				cbUtf8 += 16;
+			}
+
+			if(pwcRead == pwcEnd)
+				break;
+#endif
+
+			UINT nCodePoint = *pwcRead;
+			INT cchUnits = 1, cbSequence;
+
+			if(nCodePoint >= 0xD800 && nCodePoint <= 0xDFFF)
+			{
+				// Only a high surrogate followed by a low surrogate is valid.
+				if(nCodePoint > 0xDBFF || pwcEnd - pwcRead < 2 || pwcRead[1] < 0xDC00 || pwcRead[1] > 0xDFFF)
+					break;
+				nCodePoint = 0x10000 + ((nCodePoint - 0xD800) << 10) + (pwcRead[1] - 0xDC00);
+				cchUnits = 2;
+			}
+
+			if(nCodePoint < 0x80)
+				cbSequence = 1;
+			else if(nCodePoint < 0x800)
+				cbSequence = 2;
+			else if(nCodePoint < 0x10000)
+				cbSequence = 3;
+			else
+				cbSequence = 4;
+
+			if(pbWrite)
+			{
+				BYTE* pbSequence = pbWrite + cbUtf8;
+
+				CheckIf(cbMaxUtf8 - cbUtf8 < cbSequence, HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER));
+				switch(cbSequence)
+				{
+				case 1:
+					pbSequence[0] = static_cast<BYTE>(nCodePoint);
+					break;
+				case 2:
+					pbSequence[0] = static_cast<BYTE>(0xC0 | (nCodePoint >> 6));
+					pbSequence[1] = static_cast<BYTE>(0x80 | (nCodePoint & 0x3F));
+					break;
+				case 3:
+					pbSequence[0] = static_cast<BYTE>(0xE0 | (nCodePoint >> 12));
+					pbSequence[1] = static_cast<BYTE>(0x80 | ((nCodePoint >> 6) & 0x3F));
+					pbSequence[2] = static_cast<BYTE>(0x80 | (nCodePoint & 0x3F));
+					break;
+				case 4:
+					pbSequence[0] = static_cast<BYTE>(0xF0 | (nCodePoint >> 18));
+					pbSequence[1] = static_cast<BYTE>(0x80 | ((nCodePoint >> 12) & 0x3F));
+					pbSequence[2] = static_cast<BYTE>(0x80 | ((nCodePoint >> 6) & 0x3F));
+					pbSequence[3] = static_cast<BYTE>(0x80 | (nCodePoint & 0x3F));
+					break;
+				}
+			}
+
+			pwcRead += cchUnits;
+			cbUtf8 += cbSequence;
+		}
+
+		CheckIfIgnore(pwcRead < pwcEnd, HRESULT_FROM_WIN32(ERROR_NO_UNICODE_TRANSLATION));
 
-		Check(pstmDest->TWriteAdvance(&pszWritePtr, cchMultiByte));
-		SideAssertCompare(WideCharToMultiByte(nCodePage, dwFlags, pcwzWide, cchWide, pszWritePtr, cchMultiByte, NULL, NULL), cchMultiByte);
+		*pcbUtf8 = cbUtf8;
+		hr = S_OK;
 
 	Cleanup:
 		return hr;
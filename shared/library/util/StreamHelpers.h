@@ -68,4 +68,12 @@ namespace Stream
 	}
 
 	HRESULT WriteWideToCodePage (CMemoryStream* pstmDest, UINT nCodePage, DWORD dwFlags, INT cchWide, PCWSTR pcwzWide);
+
+	// Strict UTF-8 <-> UTF-16 transcoding into caller supplied buffers.  Runs of ASCII
+	// are converted sixteen characters at a time.  Pass NULL for the destination to
+	// measure the output.  Malformed input (overlong forms, encoded surrogates, unpaired
+	// surrogates, truncated sequences) fails with ERROR_NO_UNICODE_TRANSLATION, and a
+	// destination that is too small fails with ERROR_INSUFFICIENT_BUFFER.
+	HRESULT WINAPI Utf8ToUtf16 (__in_ecount(cbUtf8) PCSTR pcszUtf8, INT cbUtf8, __out_ecount_part_opt(cchMaxWide, *pcchWide) PWSTR pwzWide, INT cchMaxWide, __out INT* pcchWide);
+	HRESULT WINAPI Utf16ToUtf8 (__in_ecount(cchWide) PCWSTR pcwzWide, INT cchWide, __out_ecount_part_opt(cbMaxUtf8, *pcbUtf8) PSTR pszUtf8, INT cbMaxUtf8, __out INT* pcbUtf8);
 }
@@ -2,6 +2,7 @@
 #include "..\Core\CoreDefs.h"
 #include "..\Core\StringCore.h"
 #include "..\Core\Endian.h"
+#include "StreamHelpers.h"
 #include "TextHelpers.h"
 
 namespace Text
@@ -22,10 +23,40 @@ namespace Text
 		return hr;
 	}
 
+	static HRESULT AllocateUnicodeFromUTF8 (const BYTE* pbRawText, ULONG cbRawText, PWSTR* ppwzText, INT* pcchText)
+	{
+		HRESULT hr;
+		PWSTR pwzText;
+
+		// The UTF-16 form never has more code units than the UTF-8 form has bytes,
+		// so convert in a single pass instead of measuring first.
+		pwzText = __new WCHAR[cbRawText + 1];
+		CheckAlloc(pwzText);
+
+		CheckNoTrace(Stream::Utf8ToUtf16(reinterpret_cast<PCSTR>(pbRawText), cbRawText, pwzText, cbRawText, pcchText));
+		pwzText[*pcchText] = L'\0';
+
+		*ppwzText = pwzText;
+		pwzText = NULL;
+
+	Cleanup:
+		SafeDeleteArray(pwzText);
+		return hr;
+	}
+
 	HRESULT WINAPI AllocateUnicodeFromCodePage (const BYTE* pbRawText, ULONG cbRawText, PWSTR* ppwzText, INT* pcchText, UINT nCodePage)
 	{
 		HRESULT hr;
 		DWORD dwFlags = (CP_UTF8 == nCodePage || CP_UTF7 == nCodePage) ? 0 : MB_PRECOMPOSED;
+
+		// Malformed UTF-8 is left to the system, which substitutes replacement characters.
+		if(CP_UTF8 == nCodePage && 0 < cbRawText)
+		{
+			hr = AllocateUnicodeFromUTF8(pbRawText, cbRawText, ppwzText, pcchText);
+			if(HRESULT_FROM_WIN32(ERROR_NO_UNICODE_TRANSLATION) != hr)
+				return hr;
+		}
+
 		*pcchText = MultiByteToWideChar(nCodePage, dwFlags, (PCSTR)pbRawText, cbRawText, NULL, 0);
 		if(0 < *pcchText)
 		{
@@ -0,0 +1,167 @@
+#include <windows.h>
+#include "..\Core\CoreDefs.h"
+#include "WorkerPool.h"
+
+CWorkerPool::CWorkerPool () :
+	m_prgWorkers(NULL),
+	m_cWorkers(0),
+	m_hWake(NULL),
+	m_hIdle(NULL),
+	m_fShutdown(FALSE),
+	m_pfnItem(NULL),
+	m_pvContext(NULL),
+	m_cItems(0),
+	m_iNextItem(0),
+	m_cBusy(0)
+{
+	InitializeCriticalSection(&m_csJob);
+}
+
+CWorkerPool::~CWorkerPool ()
+{
+	Shutdown();
+	DeleteCriticalSection(&m_csJob);
+}
+
+HRESULT CWorkerPool::Initialize (INT cThreads)
+{
+	HRESULT hr;
+
+	EnterCriticalSection(&m_csJob);
+
+	CheckIf(NULL != m_hWake, E_UNEXPECTED);
+	CheckIf(0 > cThreads, E_INVALIDARG);
+
+	if(0 == cThreads)
+	{
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		cThreads = static_cast<INT>(si.dwNumberOfProcessors) - 1;
+	}
+
+	m_hWake = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+	CheckIfGetLastError(NULL == m_hWake);
+
+	m_hIdle = CreateEvent(NULL, FALSE, FALSE, NULL);
+	CheckIfGetLastError(NULL == m_hIdle);
+
+	m_fShutdown = FALSE;
+
+	if(0 < cThreads)
+	{
+		m_prgWorkers = __new WORKER[cThreads];
+		CheckAlloc(m_prgWorkers);
+
+		for(INT i = 0; i < cThreads; i++)
+		{
+			WORKER* pWorker = m_prgWorkers + i;
+			DWORD idThread;
+
+			pWorker->pPool = this;
+			pWorker->iWorker = i + 1;
+			pWorker->hThread = CreateThread(NULL, 0, _WorkerThread, pWorker, 0, &idThread);
+			CheckIfGetLastError(NULL == pWorker->hThread);
+
+			m_cWorkers++;
+		}
+	}
+
+	hr = S_OK;
+
+Cleanup:
+	LeaveCriticalSection(&m_csJob);
+	if(FAILED(hr))
+		Shutdown();
+	return hr;
+}
+
+VOID CWorkerPool::Shutdown (VOID)
+{
+	EnterCriticalSection(&m_csJob);
+
+	if(0 < m_cWorkers)
+	{
+		m_fShutdown = TRUE;
+		ReleaseSemaphore(m_hWake, m_cWorkers, NULL);
+
+		for(INT i = 0; i < m_cWorkers; i++)
+		{
+			WaitForSingleObject(m_prgWorkers[i].hThread, INFINITE);
+			CloseHandle(m_prgWorkers[i].hThread);
+		}
+		m_cWorkers = 0;
+	}
+
+	SafeDeleteArray(m_prgWorkers);
+	SafeCloseHandle(m_hWake);
+	SafeCloseHandle(m_hIdle);
+
+	LeaveCriticalSection(&m_csJob);
+}
+
+HRESULT CWorkerPool::ParallelFor (SIZE_T cItems, PFNWORKITEM pfnItem, PVOID pvContext)
+{
+	HRESULT hr;
+	LONG cWake;
+
+	CheckIf(NULL == pfnItem || static_cast<SIZE_T>(LONG_MAX - m_cWorkers - 1) < cItems, E_INVALIDARG);
+
+	EnterCriticalSection(&m_csJob);
+
+	m_pfnItem = pfnItem;
+	m_pvContext = pvContext;
+	m_cItems = static_cast<LONG>(cItems);
+	m_iNextItem = 0;
+
+	// The calling thread takes items too, so only wake as many workers as can help.
+	cWake = min(static_cast<LONG>(m_cWorkers), m_cItems - 1);
+	if(0 < cWake)
+	{
+		m_cBusy = cWake;
+		ReleaseSemaphore(m_hWake, cWake, NULL);
+	}
+
+	RunItems(0);
+
+	// Every woken worker must leave the job before its fields can be reused.
+	if(0 < cWake)
+		WaitForSingleObject(m_hIdle, INFINITE);
+
+	m_pfnItem = NULL;
+	m_pvContext = NULL;
+
+	LeaveCriticalSection(&m_csJob);
+
+	hr = S_OK;
+
+Cleanup:
+	return hr;
+}
+
+VOID CWorkerPool::RunItems (INT iWorker)
+{
+	LONG iItem;
+
+	while((iItem = InterlockedIncrement(&m_iNextItem) - 1) < m_cItems)
+		m_pfnItem(m_pvContext, static_cast<SIZE_T>(iItem), iWorker);
+}
+
+DWORD CALLBACK CWorkerPool::_WorkerThread (PVOID pvParam)
+{
+	WORKER* pWorker = reinterpret_cast<WORKER*>(pvParam);
+	CWorkerPool* pPool = pWorker->pPool;
+
+	for(;;)
+	{
+		WaitForSingleObject(pPool->m_hWake, INFINITE);
+		if(pPool->m_fShutdown)
+			break;
+
+		pPool->RunItems(pWorker->iWorker);
+
+		if(0 == InterlockedDecrement(&pPool->m_cBusy))
+			SetEvent(pPool->m_hIdle);
+	}
+
+	return 0;
+}
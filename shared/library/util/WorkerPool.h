@@ -0,0 +1,50 @@
+#pragma once
+
+// A fixed set of worker threads that share indexed work items with the calling
+// thread.  ParallelFor() returns once every item has run.  Items are handed out in
+// order, but they may complete in any order and on any worker.
+
+typedef VOID (WINAPI* PFNWORKITEM)(PVOID pvContext, SIZE_T iItem, INT iWorker);
+
+class CWorkerPool
+{
+private:
+	struct WORKER
+	{
+		CWorkerPool* pPool;
+		INT iWorker;
+		HANDLE hThread;
+	};
+
+	CRITICAL_SECTION m_csJob;
+	WORKER* m_prgWorkers;
+	INT m_cWorkers;
+	HANDLE m_hWake;
+	HANDLE m_hIdle;
+	volatile BOOL m_fShutdown;
+
+	// Current job
+	PFNWORKITEM m_pfnItem;
+	PVOID m_pvContext;
+	LONG m_cItems;
+	volatile LONG m_iNextItem;
+	volatile LONG m_cBusy;
+
+public:
+	CWorkerPool ();
+	~CWorkerPool ();
+
+	// With cThreads at zero, one thread is started for each additional processor.
+	HRESULT Initialize (INT cThreads = 0);
+	VOID Shutdown (VOID);
+
+	// Worker indexes passed to items range from zero (the calling thread) to
+	// GetWorkerCount() - 1, and no two concurrent items share an index.
+	inline INT GetWorkerCount (VOID) const { return m_cWorkers + 1; }
+
+	HRESULT ParallelFor (SIZE_T cItems, PFNWORKITEM pfnItem, PVOID pvContext);
+
+private:
+	VOID RunItems (INT iWorker);
+	static DWORD CALLBACK _WorkerThread (PVOID pvParam);
+};
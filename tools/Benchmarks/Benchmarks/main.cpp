@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <windows.h>
+#include "Library\Core\CoreDefs.h"
+#include "Library\Core\StringCore.h"
+#include "Library\Util\FileStream.h"
+#include "Library\Crypto\DigestBenchmark.h"
+#include "Library\Crypto\Secp256k1Benchmark.h"
+#include "Library\Spatial\PathBenchmark.h"
+#include "Library\Spatial\ProjectionBenchmark.h"
+#include "Library\Spatial\SpatialIndexBenchmark.h"
+
+typedef HRESULT (*PFNRUNSUITE)(ISequentialStream* pStream, BENCHMARK_FORMAT eFormat);
+
+struct BENCHMARK_SUITE
+{
+	PCWSTR pcwzName;
+	PCWSTR pcwzDescription;
+	PFNRUNSUITE pfnRun;
+};
+
+HRESULT RunDigestSuite (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat)
+{
+	HRESULT hr;
+	CDigestBenchmark benchmark;
+
+	Check(benchmark.RunStandardSuite());
+	Check(benchmark.Write(pStream, eFormat));
+
+Cleanup:
+	return hr;
+}
+
+HRESULT RunSecp256k1Suite (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat)
+{
+	HRESULT hr;
+	CSecp256k1Benchmark benchmark;
+
+	Check(benchmark.RunStandardSuite());
+	Check(benchmark.Write(pStream, eFormat));
+
+Cleanup:
+	return hr;
+}
+
+HRESULT RunPathSuite (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat)
+{
+	HRESULT hr;
+	CPathBenchmark benchmark;
+
+	Check(benchmark.RunStandardSuite());
+	Check(benchmark.Write(pStream, eFormat));
+
+Cleanup:
+	return hr;
+}
+
+HRESULT RunSpatialIndexSuite (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat)
+{
+	HRESULT hr;
+	CSpatialIndexBenchmark benchmark;
+
+	Check(benchmark.RunStandardSuite());
+	Check(benchmark.RunLargeSuite());
+	Check(benchmark.Write(pStream, eFormat));
+
+Cleanup:
+	return hr;
+}
+
+HRESULT RunProjectionSuite (ISequentialStream* pStream, BENCHMARK_FORMAT eFormat)
+{
+	HRESULT hr;
+	CProjectionBenchmark benchmark;
+
+	Check(benchmark.RunStandardSuite());
+	Check(benchmark.Write(pStream, eFormat));
+
+Cleanup:
+	return hr;
+}
+
+static const BENCHMARK_SUITE c_rgSuites[] =
+{
+	{ L"digest", L"Every digest and HMAC, 16 bytes to 64 MB", RunDigestSuite },
+	{ L"secp256k1", L"ECDSA and Schnorr verification, one thread up to the processor count", RunSecp256k1Suite },
+	{ L"path", L"CAStar2D queries on a combat-sized map", RunPathSuite },
+	{ L"spatial", L"Spatial index queries with 10,000 and 1,000,000 items", RunSpatialIndexSuite },
+	{ L"projection", L"CIsometricCamera transforms on a 64 by 64 tile map", RunProjectionSuite }
+};
+
+INT wmain (INT cArgs, WCHAR* pwzArgs[])
+{
+#if defined(_DEBUG) && !defined(__VIRTUAL_DBGMEM)
+	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+
+	HRESULT hr = E_INVALIDARG;
+	const BENCHMARK_SUITE* pcSuite = NULL;
+	BENCHMARK_FORMAT eFormat = BENCHMARK_CSV;
+
+	for(INT i = 1; i < cArgs; i++)
+	{
+		PCWSTR pcwzArg = pwzArgs[i];
+		if(pcwzArg[0] == '-' || pcwzArg[0] == '/')
+		{
+			if(0 == TStrCmpIAssert(pcwzArg + 1, L"json"))
+				eFormat = BENCHMARK_JSON;
+			else if(0 == TStrCmpIAssert(pcwzArg + 1, L"csv"))
+				eFormat = BENCHMARK_CSV;
+			else
+			{
+				wprintf(L"ERROR: Unknown option: %ls\r\n", pcwzArg);
+				goto PrintHelp;
+			}
+		}
+		else
+		{
+			for(INT n = 0; n < ARRAYSIZE(c_rgSuites); n++)
+			{
+				if(0 == TStrCmpIAssert(pcwzArg, c_rgSuites[n].pcwzName))
+				{
+					pcSuite = c_rgSuites + n;
+					break;
+				}
+			}
+
+			if(NULL == pcSuite)
+			{
+				wprintf(L"ERROR: Unknown suite: %ls\r\n", pcwzArg);
+				goto PrintHelp;
+			}
+		}
+	}
+
+	if(pcSuite)
+	{
+		// Results go to the standard output so runs can be redirected to a file and
+		// compared across builds.
+		CFileStream stmOutput(GetStdHandle(STD_OUTPUT_HANDLE));
+
+		hr = pcSuite->pfnRun(&stmOutput, eFormat);
+		if(FAILED(hr))
+			fwprintf(stderr, L"ERROR: The %ls suite failed with 0x%.8X\r\n", pcSuite->pcwzName, hr);
+	}
+	else
+	{
+PrintHelp:
+		PCWSTR pcwzName = pwzArgs[0];
+		PCWSTR pcwzPtr = TStrRChr(pcwzName, L'\\');
+		if(pcwzPtr)
+			pcwzName = pcwzPtr + 1;
+		wprintf(L"Required usage:\r\n\t%ls <suite> [-csv | -json]\r\n", pcwzName);
+		wprintf(L"Suites:\r\n");
+		for(INT n = 0; n < ARRAYSIZE(c_rgSuites); n++)
+			wprintf(L"\t%ls\t%ls\r\n", c_rgSuites[n].pcwzName, c_rgSuites[n].pcwzDescription);
+	}
+
+	return SUCCEEDED(hr) ? 0 : 1;
+}